@@ -0,0 +1,108 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *field_names[] = {
+    "x",          "y",          "vel_x",      "vel_y",
+    "angle",      "direction",  "weapon",     "hook_state",
+    "hook_x",     "hook_y",     "attack_tick", "tick"};
+
+static void print_stats(const char *title, const ghost_codec_stats_t *stats) {
+  const double snaps = stats->num_snapshots;
+  long long field_bits = 0;
+  for (int f = 0; f < 12; f++)
+    field_bits += stats->field_huffman_bits[f];
+
+  printf("--- %s ---\n", title);
+  printf("Ghosts:          %d\n", stats->num_ghosts);
+  printf("Snapshots:       %lld\n", stats->num_snapshots);
+  printf("Chunks:          %lld\n", stats->num_chunks);
+  printf("File bytes:      %lld\n", stats->total_bytes);
+  printf("Varint bytes:    %lld\n", stats->varint_bytes);
+  printf("Huffman bytes:   %lld\n", (stats->huffman_bits + 7) / 8);
+  printf("Bits/snapshot:   %.2f (character data %.2f)\n",
+         stats->total_bytes * 8.0 / snaps, field_bits / snaps);
+  printf("\n%-12s %12s %12s %8s\n", "field", "varint B/snap", "bits/snap",
+         "share");
+  for (int f = 0; f < 12; f++) {
+    printf("%-12s %12.2f %12.2f %7.1f%%\n", field_names[f],
+           stats->field_varint_bytes[f] / snaps,
+           stats->field_huffman_bits[f] / snaps,
+           field_bits ? 100.0 * stats->field_huffman_bits[f] / field_bits
+                      : 0.0);
+  }
+  printf("\n");
+}
+
+static void print_table(const ghost_codec_stats_t *stats) {
+  long long max = 1;
+  for (int i = 0; i < 256; i++)
+    if (stats->byte_freq[i] > max)
+      max = stats->byte_freq[i];
+
+  // Scale into a range that keeps every code well below 24 bits.
+  printf("static const unsigned ghost_freq_table[HUFFMAN_MAX_SYMBOLS] = {\n");
+  for (int i = 0; i < 256; i++) {
+    const unsigned long long value = 1 + stats->byte_freq[i] * 65535 / max;
+    printf("%s%llu,%s", i % 12 == 0 ? "    " : " ", value,
+           i % 12 == 11 || i == 255 ? "\n" : "");
+  }
+  printf("    1};\n");
+}
+
+int main(int argc, char *argv[]) {
+  if (argc <= 1) {
+    printf("Usage: %s [--emit-table] <ghost files...>\n", argv[0]);
+    return 1;
+  }
+
+  int emit_table = 0;
+  ghost_codec_stats_t network, trained;
+  memset(&network, 0, sizeof(network));
+  memset(&trained, 0, sizeof(trained));
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--emit-table") == 0) {
+      emit_table = 1;
+      continue;
+    }
+
+    ghost_t *ghost = ghost_load(argv[i]);
+    if (!ghost) {
+      printf("Skipping '%s': could not be loaded\n", argv[i]);
+      continue;
+    }
+    ghost_codec_stats_add(&network, ghost, GHOST_HUFFMAN_TABLE_NETWORK);
+    ghost_codec_stats_add(&trained, ghost, GHOST_HUFFMAN_TABLE_GHOST);
+    ghost_free(ghost);
+  }
+
+  if (network.num_snapshots == 0) {
+    printf("No snapshots found\n");
+    return 1;
+  }
+
+  if (emit_table) {
+    print_table(&network);
+    return 0;
+  }
+
+  print_stats("Network huffman table (default)", &network);
+  print_stats("Ghost huffman table (opt-in)", &trained);
+
+  printf("--- Most frequent bytes after var_compress ---\n");
+  long long shown[256];
+  memcpy(shown, network.byte_freq, sizeof(shown));
+  for (int n = 0; n < 16; n++) {
+    int best = 0;
+    for (int i = 1; i < 256; i++)
+      if (shown[i] > shown[best])
+        best = i;
+    if (shown[best] == 0)
+      break;
+    printf("0x%02x %10lld %6.2f%%\n", best, shown[best],
+           100.0 * shown[best] / network.varint_bytes);
+    shown[best] = -1;
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static long file_size(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+static double decode_seconds(const char *filename, int iterations) {
+  clock_t start = clock();
+  for (int i = 0; i < iterations; i++) {
+    ghost_t *ghost = ghost_load(filename);
+    if (!ghost)
+      return -1.0;
+    ghost_free(ghost);
+  }
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc <= 1) {
+    printf("Usage: %s <ghost files...>\n", argv[0]);
+    printf("Converts every ghost to version 6 and 7 and compares size and "
+           "decode speed\n");
+    return 1;
+  }
+
+  const int iterations = 200;
+  long total_v6 = 0, total_v7 = 0;
+  long total_ticks = 0;
+  double time_v6 = 0.0, time_v7 = 0.0;
+
+  for (int i = 1; i < argc; i++) {
+    ghost_t *ghost = ghost_load(argv[i]);
+    if (!ghost) {
+      printf("Skipping '%s': could not be loaded\n", argv[i]);
+      continue;
+    }
+    const int num_ticks = ghost->path.num_items;
+    ghost_free(ghost);
+
+    if (ghost_convert(argv[i], "convert_v6.gho", 6) != 0 ||
+        ghost_convert(argv[i], "convert_v7.gho", 7) != 0) {
+      printf("Skipping '%s': could not be converted\n", argv[i]);
+      continue;
+    }
+
+    const long size_v6 = file_size("convert_v6.gho");
+    const long size_v7 = file_size("convert_v7.gho");
+    const double seconds_v6 = decode_seconds("convert_v6.gho", iterations);
+    const double seconds_v7 = decode_seconds("convert_v7.gho", iterations);
+
+    printf("%s: %d ticks, v6 %ld bytes, v7 %ld bytes (%.1f%%)\n", argv[i],
+           num_ticks, size_v6, size_v7, 100.0 * size_v7 / size_v6);
+
+    total_v6 += size_v6;
+    total_v7 += size_v7;
+    total_ticks += num_ticks;
+    time_v6 += seconds_v6;
+    time_v7 += seconds_v7;
+  }
+
+  remove("convert_v6.gho");
+  remove("convert_v7.gho");
+
+  if (total_ticks == 0)
+    return 1;
+
+  printf("----------------------------------------\n");
+  printf("Size:   v6 %ld bytes, v7 %ld bytes (%.1f%%)\n", total_v6, total_v7,
+         100.0 * total_v7 / total_v6);
+  printf("Decode: v6 %.1f Mticks/s, v7 %.1f Mticks/s\n",
+         total_ticks * iterations / time_v6 / 1e6,
+         total_ticks * iterations / time_v7 / 1e6);
+  return 0;
+}
@@ -0,0 +1,19 @@
+#include <ddnet_ghost/ghost_arrow.h>
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+  if (argc <= 2) {
+    printf("Usage: %s <output directory> <ghost files...>\n", argv[0]);
+    printf("Writes one Arrow IPC file per map with a row per snapshot\n");
+    return 1;
+  }
+
+  const int written = ghost_arrow_export_by_map(
+      (const char *const *)(argv + 2), argc - 2, argv[1]);
+  if (written < 0) {
+    printf("Failed to write the tables\n");
+    return 1;
+  }
+  printf("Exported %d of %d ghosts to '%s'\n", written, argc - 2, argv[1]);
+  return 0;
+}
@@ -8,6 +8,9 @@
 extern "C" {
 #endif
 
+// Snapshots are recorded once per server tick.
+#define GHOST_TICKS_PER_SECOND 50
+
 typedef struct ghost_skin_t {
   int skin[6];
   int use_custom_color;
@@ -47,16 +50,352 @@ typedef struct ghost_t {
   int time;
 } ghost_t;
 
+enum {
+  GHOST_HUFFMAN_TABLE_NETWORK = 0,
+  GHOST_HUFFMAN_TABLE_GHOST,
+};
+
+enum {
+  GHOST_CHUNKING_FIXED = 0,
+  GHOST_CHUNKING_SMALLEST,
+};
+
+enum {
+  GHOST_SIMD_SCALAR = 0,
+  GHOST_SIMD_SSE42,
+  GHOST_SIMD_AVX2,
+  GHOST_SIMD_NUM_VARIANTS,
+};
+
+enum {
+  GHOST_VERIFY_OK = 0,
+  GHOST_VERIFY_ERROR_IO,
+  GHOST_VERIFY_ERROR_MARKER,
+  GHOST_VERIFY_ERROR_VERSION,
+  GHOST_VERIFY_ERROR_HUFFMAN_TABLE,
+  GHOST_VERIFY_ERROR_NAME,
+  GHOST_VERIFY_ERROR_NUM_TICKS,
+  GHOST_VERIFY_ERROR_TIME,
+  GHOST_VERIFY_ERROR_CHUNK_SIZE,
+  GHOST_VERIFY_ERROR_TRUNCATED,
+  GHOST_VERIFY_ERROR_DECOMPRESS,
+  GHOST_VERIFY_ERROR_ITEM_SIZE,
+  GHOST_VERIFY_ERROR_TOO_MANY_TICKS,
+  GHOST_VERIFY_NUM_ERRORS,
+};
+
+typedef struct ghost_save_options_t {
+  // 0 selects the default (6). 7 is the experimental columnar format, which
+  // only this library can read.
+  int version;
+  // GHOST_HUFFMAN_TABLE_GHOST uses a table trained on ghost chunks. Such
+  // files are marked in the header and only this library can read them.
+  int huffman_table;
+  // GHOST_CHUNKING_SMALLEST cuts version 6 chunks wherever the file gets
+  // smallest instead of every 50 snapshots. The files stay readable by
+  // DDNet; saving takes up to twice as long.
+  int chunking;
+} ghost_save_options_t;
+
+typedef struct ghost_codec_stats_t {
+  int num_ghosts;
+  long long num_snapshots;
+  long long num_chunks;
+  long long total_bytes;
+  long long varint_bytes;
+  long long huffman_bits;
+  long long byte_freq[256];
+  long long field_varint_bytes[sizeof(ghost_character_t) / sizeof(int)];
+  long long field_huffman_bits[sizeof(ghost_character_t) / sizeof(int)];
+} ghost_codec_stats_t;
+
+typedef struct ghost_header_info_t {
+  int version;
+  char player[16];
+  char map[64];
+  int num_ticks;
+  int time;
+} ghost_header_info_t;
+
+// Per-run summary gathered while snapshots are decoded. Distances are in
+// world units and speeds in units per tick, both measured between
+// consecutive positions.
+typedef struct ghost_run_stats_t {
+  int num_ticks;
+  float distance;
+  float max_speed;
+  float mean_speed;
+  // Snapshots whose y differs from the previous one. Ghosts record no
+  // grounded flag, and y only changes off the ground.
+  int air_ticks;
+  // Times the hook went out (became flying or grabbed).
+  int hook_count;
+  int weapon_switches;
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+} ghost_run_stats_t;
+
 ghost_t *ghost_load(const char *filename);
+ghost_t *ghost_load_mem(const void *data, size_t size);
+// Same as ghost_load, filling `stats` in the decoding pass.
+ghost_t *ghost_load_stats(const char *filename, ghost_run_stats_t *stats);
+ghost_t *ghost_load_stats_mem(const void *data, size_t size,
+                              ghost_run_stats_t *stats);
+// Decodes the file for its stats only, without building a path.
+int ghost_run_stats_file(const char *filename, ghost_run_stats_t *stats);
+int ghost_run_stats_mem(const void *data, size_t size,
+                        ghost_run_stats_t *stats);
+// Reads and validates only the file header.
+int ghost_read_info(const char *filename, ghost_header_info_t *info);
+int ghost_read_info_mem(const void *data, size_t size,
+                        ghost_header_info_t *info);
 ghost_t *ghost_create(void);
 void ghost_free(ghost_t *ghost);
 int ghost_save(const ghost_t *ghost, const char *filename);
+int ghost_save_ex(const ghost_t *ghost, const char *filename,
+                  const ghost_save_options_t *options);
+int ghost_convert(const char *src_filename, const char *dst_filename,
+                  int version);
+// Writes snapshots [first, first + count) of a ghost to a new file. Chunks
+// inside the range are copied without being decoded; only the chunks cut at
+// either end are re-encoded. The start tick becomes the tick of the first
+// snapshot kept.
+int ghost_slice(const char *src_filename, const char *dst_filename, int first,
+                int count);
+// Writes the snapshots of several ghosts one after another. The ticks of
+// each later file are shifted to continue right after the previous one.
+// Metadata, skin and format come from the first file; chunks of files
+// encoded differently are re-encoded.
+int ghost_concat(const char *const *src_filenames, int num_files,
+                 const char *dst_filename);
+// Runs the version 6 encoder over `ghost` without writing anything and adds
+// byte frequencies after var_compress and per-field sizes to `stats`.
+int ghost_codec_stats_add(ghost_codec_stats_t *stats, const ghost_t *ghost,
+                          int huffman_table);
 void ghost_set_meta(ghost_t *ghost, const char *player, const char *map,
                     int time_ms);
 void ghost_set_skin(ghost_t *ghost, const char *skin_name, int use_custom_color,
                     int color_body, int color_feet);
 void ghost_add_snap(ghost_t *ghost, const ghost_character_t *snap);
 ghost_character_t *ghost_get_snap(const ghost_path_t *path, int index);
+// Last snapshot at or before `tick`, NULL if the tick is outside the ghost.
+// Lookups move `playback_pos`, which makes sequential playback cheap.
+ghost_character_t *ghost_get_snap_at_tick(ghost_t *ghost, int tick);
+// Snapshot at a fractional tick: position, velocity and angle are
+// interpolated between the neighbouring snapshots, everything else is taken
+// from the earlier one. Returns -1 if the tick is outside the ghost.
+int ghost_sample(ghost_t *ghost, float tick, ghost_character_t *out);
+// Samples the whole path at `rate` frames per second, starting at its first
+// tick, e.g. for rendering video at 60 or 144 fps. Frames are interpolated
+// like ghost_sample. Returns the number of frames the path spans, of which
+// at most `max_frames` are written to `out` (pass NULL to only count), or
+// -1 on error.
+int ghost_resample(const ghost_path_t *path, float rate,
+                   ghost_character_t *out, int max_frames);
+
+// Playback position over a ghost that is not modified while the cursor is
+// in use. Each thread or viewer keeps its own cursor, so one ghost can be
+// played back from many places at once. Cursors do not own the ghost.
+typedef struct ghost_cursor_t {
+  const ghost_t *ghost;
+  int pos;
+} ghost_cursor_t;
+
+void ghost_cursor_init(ghost_cursor_t *cursor, const ghost_t *ghost);
+const ghost_character_t *ghost_cursor_snap_at_tick(ghost_cursor_t *cursor,
+                                                   int tick);
+int ghost_cursor_sample(ghost_cursor_t *cursor, float tick,
+                        ghost_character_t *out);
+
+// Reference-counted, read-only ghost that can be handed between threads and
+// sessions without copying. ghost_share takes ownership of `ghost` with one
+// reference; the last ghost_release frees it. Retain and release are atomic.
+typedef struct ghost_shared_t ghost_shared_t;
+
+ghost_shared_t *ghost_share(ghost_t *ghost);
+ghost_shared_t *ghost_retain(ghost_shared_t *shared);
+void ghost_release(ghost_shared_t *shared);
+const ghost_t *ghost_shared_ghost(const ghost_shared_t *shared);
+// Codec kernels (Huffman and varint coding, item deltas) exist in scalar,
+// SSE4.2 and AVX2 builds. The best one the CPU supports is used unless
+// another is forced with ghost_simd_set_variant, which fails if the CPU
+// lacks it.
+int ghost_simd_variant(void);
+int ghost_simd_supported(int variant);
+int ghost_simd_set_variant(int variant);
+const char *ghost_simd_variant_name(int variant);
+
+typedef struct ghost_verify_result_t {
+  // GHOST_VERIFY_OK or the first problem found.
+  int error;
+  // Start of the chunk the error was found in, -1 for header errors.
+  long offset;
+  int version;
+  int num_ticks;
+  int start_tick;
+  // FNV-1a over the fields of the decoded snapshots (without their ticks)
+  // and the start tick. Equal for the same run saved in any version.
+  uint64_t hash;
+} ghost_verify_result_t;
+
+// Decodes the whole file like ghost_load but keeps only the current snapshot,
+// stopping at the first error. ghost_verify_mem does not allocate at all.
+// Both return 0 if the file is valid and -1 otherwise.
+int ghost_verify(const char *filename, ghost_verify_result_t *result);
+int ghost_verify_mem(const void *data, size_t size,
+                     ghost_verify_result_t *result);
+const char *ghost_verify_error_string(int error);
+// The hash ghost_verify reports for the file `ghost` was loaded from.
+uint64_t ghost_hash(const ghost_t *ghost);
+
+enum {
+  GHOST_SCAN_TICK_GAP = 1 << 0,
+  GHOST_SCAN_TELEPORT = 1 << 1,
+  GHOST_SCAN_VELOCITY = 1 << 2,
+  GHOST_SCAN_ANGLE = 1 << 3,
+  GHOST_SCAN_HOOK = 1 << 4,
+  GHOST_SCAN_ATTACK = 1 << 5,
+};
+
+// Thresholds for ghost_scan. A negative value disables the check.
+typedef struct ghost_scan_options_t {
+  // Largest tick difference between snapshots. Snapshots further apart
+  // than one tick are only checked for tick gaps and attack ticks.
+  int max_tick_gap;
+  // Largest position change per tick on either axis (teleports).
+  int max_step;
+  // Largest velocity on either axis, in 1/256 units per tick.
+  int max_velocity;
+  // Largest difference between the position change over a tick and the
+  // velocity, in 1/256 units.
+  int max_velocity_error;
+  // Largest aim change per tick in 1/256 radians.
+  int max_angle_step;
+  // Largest hook movement per tick while it is flying or attached.
+  int max_hook_step;
+} ghost_scan_options_t;
+
+typedef struct ghost_scan_range_t {
+  // Ticks of the first and last snapshot involved.
+  int first_tick;
+  int last_tick;
+  // GHOST_SCAN_* checks that failed in the range.
+  int flags;
+} ghost_scan_range_t;
+
+// Defaults: no tick gaps, 256 units per tick, the protocol's velocity
+// limit, 64 units of velocity error, any aim change and 96 units of hook
+// movement.
+void ghost_scan_default_options(ghost_scan_options_t *options);
+// Checks every snapshot for physically implausible values: position
+// changes against the velocity, tick continuity, angle range, hook state
+// transitions and hook jumps, and attack ticks that run backwards or ahead
+// of the tick. Consecutive flagged snapshots are merged into one range.
+// Stores up to `max_ranges` ranges and returns the total number found, or
+// -1 on error. `options` may be NULL for the defaults. The file variants
+// stream the snapshots and also return -1 for files that fail to decode.
+int ghost_scan(const ghost_path_t *path, const ghost_scan_options_t *options,
+               ghost_scan_range_t *ranges, int max_ranges);
+int ghost_scan_file(const char *filename, const ghost_scan_options_t *options,
+                    ghost_scan_range_t *ranges, int max_ranges);
+int ghost_scan_mem(const void *data, size_t size,
+                   const ghost_scan_options_t *options,
+                   ghost_scan_range_t *ranges, int max_ranges);
+
+// Stores `ghost` as differences against `reference`, typically the
+// player's previous best on the same map. Loading needs the same reference;
+// it is identified by ghost_hash and loading fails with any other ghost.
+// Delta files cannot be read by ghost_load.
+int ghost_save_delta(const ghost_t *ghost, const ghost_t *reference,
+                     const char *filename);
+ghost_t *ghost_load_delta(const char *filename, const ghost_t *reference);
+ghost_t *ghost_load_delta_mem(const void *data, size_t size,
+                              const ghost_t *reference);
+
+typedef struct ghost_packed_path_t ghost_packed_path_t;
+
+// Read-only copy of a path in 24 bytes per snapshot instead of 48, for
+// keeping many ghosts resident. Snapshots with values outside the packed
+// ranges (fast velocities, long hooks) are kept unpacked, as is the first
+// snapshot after a tick gap.
+ghost_packed_path_t *ghost_packed_path_create(const ghost_path_t *path);
+void ghost_packed_path_free(ghost_packed_path_t *packed);
+int ghost_packed_path_num_items(const ghost_packed_path_t *packed);
+size_t ghost_packed_path_bytes(const ghost_packed_path_t *packed);
+int ghost_packed_path_get(const ghost_packed_path_t *packed, int index,
+                          ghost_character_t *out);
+// Unpacks snapshots [first, first + count) into `out`.
+int ghost_packed_path_unpack(const ghost_packed_path_t *packed, int first,
+                             int count, ghost_character_t *out);
+
+typedef struct ghost_reader_t ghost_reader_t;
+
+// Streams snapshots without holding the path. Files without ticks (version
+// 4) number their snapshots from 0; once the last one was read the start
+// tick in ghost_reader_meta is final, and adding it gives the ticks
+// ghost_load reports.
+ghost_reader_t *ghost_reader_open(const char *filename);
+ghost_reader_t *ghost_reader_open_mem(const void *data, size_t size);
+int ghost_reader_next(ghost_reader_t *reader, ghost_character_t *snap);
+int ghost_reader_num_ticks(const ghost_reader_t *reader);
+const ghost_t *ghost_reader_meta(const ghost_reader_t *reader);
+// 0 once a snapshot of a file without ticks was read, 1 otherwise.
+int ghost_reader_has_ticks(const ghost_reader_t *reader);
+// Collects run stats while reading. Must be called before the first
+// ghost_reader_next; returns -1 afterwards.
+int ghost_reader_enable_stats(ghost_reader_t *reader);
+// Stats of the snapshots returned so far. Returns -1 if they are not
+// collected.
+int ghost_reader_stats(const ghost_reader_t *reader, ghost_run_stats_t *stats);
+void ghost_reader_close(ghost_reader_t *reader);
+
+typedef struct ghost_decoder_t ghost_decoder_t;
+typedef void (*ghost_decoder_snap_fn)(void *user_data,
+                                      const ghost_character_t *snap);
+
+// Push-mode decoder for files arriving in pieces, e.g. from a non-blocking
+// socket. Only the header or chunk in transit is buffered; `on_snap` is
+// called for each snapshot as soon as its chunk is complete, with ticks as
+// ghost_reader_next reports them. The start tick in ghost_decoder_meta is
+// final after ghost_decoder_finish.
+ghost_decoder_t *ghost_decoder_create(ghost_decoder_snap_fn on_snap,
+                                      void *user_data);
+void ghost_decoder_free(ghost_decoder_t *decoder);
+// Consumes `size` bytes. Returns -1 as soon as the data is known to be
+// invalid; the decoder then rejects everything that follows.
+int ghost_decoder_feed(ghost_decoder_t *decoder, const void *data,
+                       size_t size);
+// Call once the upload has ended. Returns 0 if a complete ghost was read.
+int ghost_decoder_finish(ghost_decoder_t *decoder);
+// GHOST_VERIFY_* code of the failure, GHOST_VERIFY_OK otherwise.
+int ghost_decoder_error(const ghost_decoder_t *decoder);
+// Snapshots decoded so far.
+int ghost_decoder_num_ticks(const ghost_decoder_t *decoder);
+// Metadata, available once the header has arrived (NULL before).
+const ghost_t *ghost_decoder_meta(const ghost_decoder_t *decoder);
+// Same as for the reader: enable before the first snapshot is decoded.
+int ghost_decoder_enable_stats(ghost_decoder_t *decoder);
+int ghost_decoder_stats(const ghost_decoder_t *decoder,
+                        ghost_run_stats_t *stats);
+
+typedef struct ghost_lazy_t ghost_lazy_t;
+
+// Keeps only the compressed file and an index of its chunks in memory and
+// decodes chunks on first access. Version 4 files and files without ticks
+// cannot be decoded per chunk and are loaded fully instead.
+ghost_lazy_t *ghost_load_lazy(const char *filename);
+ghost_lazy_t *ghost_load_lazy_mem(const void *data, size_t size);
+// Metadata of the ghost. The path is always empty.
+const ghost_t *ghost_lazy_meta(const ghost_lazy_t *lazy);
+int ghost_lazy_num_ticks(const ghost_lazy_t *lazy);
+// The returned snapshot stays valid until the next call on `lazy`.
+const ghost_character_t *ghost_lazy_get_snap(ghost_lazy_t *lazy, int index);
+// Drops all decoded chunks, returning the ghost to its idle size.
+void ghost_lazy_release(ghost_lazy_t *lazy);
+size_t ghost_lazy_resident_bytes(const ghost_lazy_t *lazy);
+void ghost_lazy_free(ghost_lazy_t *lazy);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,40 @@
+#ifndef DDNET_GHOST_ARROW_H
+#define DDNET_GHOST_ARROW_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_arrow_writer_t ghost_arrow_writer_t;
+
+// Writes snapshots as an Apache Arrow IPC file that pyarrow, DuckDB, Polars
+// and other Arrow readers can open. Each row is one snapshot with the
+// columns ghost (number of the ghost in the file), player, time,
+// start_tick and one int32 column per ghost_character_t field. Rows are
+// written in record batches of up to 4096 snapshots. `map` is stored in the
+// schema metadata and may be NULL.
+ghost_arrow_writer_t *ghost_arrow_open(const char *filename, const char *map);
+int ghost_arrow_add_ghost(ghost_arrow_writer_t *writer, const ghost_t *ghost);
+// Decodes the file chunk by chunk, so only the compressed file and one
+// record batch are held in memory. If decoding fails part way, the rows
+// already added for the file are removed again and -1 is returned.
+int ghost_arrow_add_file(ghost_arrow_writer_t *writer, const char *filename);
+// Writes the footer. Returns -1 if anything failed since the writer was
+// opened.
+int ghost_arrow_close(ghost_arrow_writer_t *writer);
+
+// Writes one table per map into `dir`, named after the map with characters
+// other than letters, digits, '-', '_' and '.' replaced by '_'. Maps whose
+// names end up equal, ignoring case, get a suffix "_2", "_3", ... in order
+// of their map names. Ghosts that cannot be read are skipped. Returns the
+// number of ghosts written or -1 if an output file could not be written.
+int ghost_arrow_export_by_map(const char *const *filenames, int num_files,
+                              const char *dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_ARROW_H
@@ -0,0 +1,47 @@
+#ifndef DDNET_GHOST_BATCH_H
+#define DDNET_GHOST_BATCH_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_batch_t ghost_batch_t;
+
+typedef struct ghost_batch_options_t {
+  // Files read or waiting for decode at once. 0 selects 64.
+  int queue_depth;
+  // Decode threads. 0 selects 2.
+  int num_decode_threads;
+  // Reader threads for the pread fallback. 0 selects 8.
+  int num_io_threads;
+  // Use the pread fallback even where io_uring is available.
+  int disable_io_uring;
+} ghost_batch_options_t;
+
+typedef struct ghost_batch_result_t {
+  void *user_data;
+  // NULL if the file could not be read or decoded.
+  ghost_t *ghost;
+} ghost_batch_result_t;
+
+// Loads many ghosts asynchronously: files are read with io_uring on Linux
+// (or reader threads using pread) while decode threads turn finished reads
+// into ghosts. `options` may be NULL.
+ghost_batch_t *ghost_batch_create(const ghost_batch_options_t *options);
+// Stops all threads. Ghosts not collected with ghost_batch_wait are freed.
+void ghost_batch_destroy(ghost_batch_t *batch);
+int ghost_batch_submit(ghost_batch_t *batch, const char *filename,
+                       void *user_data);
+// Waits for the next finished load. Returns 1 with `result` filled in, or 0
+// once every submitted file has been returned.
+int ghost_batch_wait(ghost_batch_t *batch, ghost_batch_result_t *result);
+// Whether reads go through io_uring.
+int ghost_batch_uses_io_uring(const ghost_batch_t *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_BATCH_H
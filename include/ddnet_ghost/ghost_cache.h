@@ -0,0 +1,45 @@
+#ifndef DDNET_GHOST_CACHE_H
+#define DDNET_GHOST_CACHE_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_cache_t ghost_cache_t;
+typedef struct ghost_cache_entry_t ghost_cache_entry_t;
+
+typedef struct ghost_cache_stats_t {
+  long long hits;
+  long long misses;
+  long long evictions;
+  long long failures;
+  int num_entries;
+  size_t bytes;
+  size_t budget;
+} ghost_cache_stats_t;
+
+// Thread-safe cache of decoded ghosts keyed by path, mtime and size. The
+// budget counts `path.num_items * sizeof(ghost_character_t)` per ghost;
+// unreferenced ghosts are evicted least recently used first.
+ghost_cache_t *ghost_cache_create(size_t budget);
+// All entries must have been released.
+void ghost_cache_destroy(ghost_cache_t *cache);
+void ghost_cache_set_budget(ghost_cache_t *cache, size_t budget);
+
+// Returns a referenced entry, decoding the file if needed. Concurrent
+// requests for the same file wait for a single decode. NULL on failure.
+ghost_cache_entry_t *ghost_cache_acquire(ghost_cache_t *cache,
+                                         const char *filename);
+// The ghost is shared and must not be modified.
+const ghost_t *ghost_cache_entry_ghost(const ghost_cache_entry_t *entry);
+void ghost_cache_release(ghost_cache_t *cache, ghost_cache_entry_t *entry);
+
+void ghost_cache_get_stats(ghost_cache_t *cache, ghost_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_CACHE_H
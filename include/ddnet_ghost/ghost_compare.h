@@ -0,0 +1,32 @@
+#ifndef DDNET_GHOST_COMPARE_H
+#define DDNET_GHOST_COMPARE_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_compare_result_t {
+  int num_compared;
+  int tick_delta;
+  int first_mismatch;
+  int first_mismatch_tick;
+  int max_distance_index;
+  float max_distance;
+  float mean_distance;
+} ghost_compare_result_t;
+
+// Compares two paths index by index (tick i of `a` against tick i of `b`).
+// `tick_delta` is `b->num_items - a->num_items`, `first_mismatch` is the
+// first index where any field differs (-1 if none). If `distances` is not
+// NULL it receives `num_compared` per-tick positional distances.
+// Returns 0 on success.
+int ghost_compare(const ghost_path_t *a, const ghost_path_t *b,
+                  ghost_compare_result_t *result, float *distances);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_COMPARE_H
@@ -0,0 +1,65 @@
+#ifndef DDNET_GHOST_DIR_INDEX_H
+#define DDNET_GHOST_DIR_INDEX_H
+
+#include <ddnet_ghost/ghost.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_dir_index_t ghost_dir_index_t;
+
+typedef struct ghost_dir_entry_t {
+  char filename[256];
+  char player[16];
+  char map[64];
+  int version;
+  int time;
+  int num_ticks;
+  int64_t size;
+  int64_t mtime_ns;
+  // Filled with GHOST_DIR_INDEX_STATS. `stats.num_ticks` is 0 if the
+  // snapshots could not be decoded or the stats were not collected.
+  ghost_run_stats_t stats;
+} ghost_dir_entry_t;
+
+enum {
+  // Also decode every file for its run stats.
+  GHOST_DIR_INDEX_STATS = 1 << 0,
+};
+
+// Indexes the headers of all .gho files in `directory`, and with
+// GHOST_DIR_INDEX_STATS in `flags` their run stats, so queries can be
+// pruned without decoding. If `cache_filename` is set, entries whose size
+// and mtime match the cache are not re-read, and the cache is rewritten by
+// ghost_dir_index_save_cache and on close. Cached entries without stats are
+// re-read if stats are wanted.
+ghost_dir_index_t *ghost_dir_index_open(const char *directory,
+                                        const char *cache_filename, int flags);
+void ghost_dir_index_close(ghost_dir_index_t *index);
+
+// Applies pending changes to the directory, waiting up to `timeout_ms` for
+// one (0 returns immediately, -1 blocks). Uses inotify on Linux and a rescan
+// elsewhere. Returns the number of entries added, updated or removed, or -1.
+int ghost_dir_index_poll(ghost_dir_index_t *index, int timeout_ms);
+// File descriptor that becomes readable when ghost_dir_index_poll has work,
+// for use in an existing event loop. -1 without inotify.
+int ghost_dir_index_fd(const ghost_dir_index_t *index);
+// Re-reads the directory from scratch, still skipping unchanged files.
+int ghost_dir_index_rescan(ghost_dir_index_t *index);
+int ghost_dir_index_save_cache(const ghost_dir_index_t *index);
+
+int ghost_dir_index_count(const ghost_dir_index_t *index);
+const ghost_dir_entry_t *ghost_dir_index_find(const ghost_dir_index_t *index,
+                                              const char *filename);
+// Fastest `max_out` ghosts on `map`, ordered by time. Returns the number
+// written to `out`. The pointers stay valid until the next poll or rescan.
+int ghost_dir_index_top(const ghost_dir_index_t *index, const char *map,
+                        const ghost_dir_entry_t **out, int max_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_DIR_INDEX_H
@@ -0,0 +1,63 @@
+#ifndef DDNET_GHOST_HEATMAP_H
+#define DDNET_GHOST_HEATMAP_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  // Every snapshot adds 1.
+  GHOST_HEATMAP_WEIGHT_COUNT = 0,
+  // Seconds since the previous snapshot, so tick gaps count fully.
+  GHOST_HEATMAP_WEIGHT_TIME,
+  // Distance moved since the previous snapshot per tick.
+  GHOST_HEATMAP_WEIGHT_SPEED,
+};
+
+// Density of ghost positions over a map, `width` x `height` cells of
+// `cell_size` units starting at world position (0, 0). `cells` is row-major,
+// cell (x, y) at `cells[y * width + x]`.
+typedef struct ghost_heatmap_t {
+  int width;
+  int height;
+  int cell_size;
+  int weighting;
+  float *cells;
+} ghost_heatmap_t;
+
+// `cell_size` <= 0 selects 32 units (one tile), so a map's size in tiles
+// gives its full extent. Positions outside the grid are dropped.
+ghost_heatmap_t *ghost_heatmap_create(int width, int height, int cell_size,
+                                      int weighting);
+void ghost_heatmap_free(ghost_heatmap_t *heatmap);
+void ghost_heatmap_clear(ghost_heatmap_t *heatmap);
+
+// Adds the positions of one path, or of a file read with the streaming
+// reader. Returns 0 on success. A file that fails to decode part way still
+// adds the snapshots read before the error.
+int ghost_heatmap_add_path(ghost_heatmap_t *heatmap, const ghost_path_t *path);
+int ghost_heatmap_add_file(ghost_heatmap_t *heatmap, const char *filename);
+
+// Adds many ghosts or files on `num_threads` threads (0 selects one per
+// CPU). Each thread fills its own grid; the grids are summed into `heatmap`
+// at the end. Returns the number of ghosts or files added completely, or
+// -1; failed files still add their snapshots as above.
+int ghost_heatmap_add_ghosts(ghost_heatmap_t *heatmap,
+                             const ghost_t *const *ghosts, int num_ghosts,
+                             int num_threads);
+int ghost_heatmap_add_files(ghost_heatmap_t *heatmap,
+                            const char *const *filenames, int num_files,
+                            int num_threads);
+
+// Writes the cells as raw little-endian float32, row by row, with no
+// header. Returns 0 on success.
+int ghost_heatmap_save_raw(const ghost_heatmap_t *heatmap,
+                           const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_HEATMAP_H
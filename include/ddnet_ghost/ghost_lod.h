@@ -0,0 +1,46 @@
+#ifndef DDNET_GHOST_LOD_H
+#define DDNET_GHOST_LOD_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_lod_point_t {
+  int x;
+  int y;
+  int tick;
+} ghost_lod_point_t;
+
+typedef struct ghost_lod_level_t {
+  float max_error;
+  int num_points;
+  ghost_lod_point_t *points;
+} ghost_lod_level_t;
+
+typedef struct ghost_lod_t {
+  int num_levels;
+  ghost_lod_level_t *levels;
+} ghost_lod_t;
+
+// Builds a polyline pyramid. Level 0 holds every snapshot, level k > 0 is a
+// Douglas-Peucker simplification whose points are all within
+// `base_error * 2^(k-1)` units of the original route.
+ghost_lod_t *ghost_lod_build(const ghost_path_t *path, float base_error,
+                             int num_levels);
+// Same as ghost_lod_build but consumes the remaining snapshots of a reader
+// without materialising a ghost_path_t. Ticks match ghost_load, also for
+// files without ticks.
+ghost_lod_t *ghost_lod_build_from_reader(ghost_reader_t *reader,
+                                         float base_error, int num_levels);
+// Returns the coarsest level whose error bound is within `tolerance`.
+const ghost_lod_level_t *ghost_lod_pick(const ghost_lod_t *lod,
+                                        float tolerance);
+void ghost_lod_free(ghost_lod_t *lod);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_LOD_H
@@ -0,0 +1,59 @@
+#ifndef DDNET_GHOST_PACK_H
+#define DDNET_GHOST_PACK_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_pack_t ghost_pack_t;
+typedef struct ghost_pack_writer_t ghost_pack_writer_t;
+
+typedef struct ghost_pack_entry_t {
+  const char *map;
+  const char *player;
+  int time;
+  int num_ticks;
+  // The complete ghost file, pointing into the mapped pack.
+  const void *data;
+  size_t size;
+} ghost_pack_entry_t;
+
+// Maps a pack file read-only. Entries are sorted by map, player and time.
+ghost_pack_t *ghost_pack_open(const char *filename);
+void ghost_pack_close(ghost_pack_t *pack);
+int ghost_pack_count(const ghost_pack_t *pack);
+int ghost_pack_entry(const ghost_pack_t *pack, int index,
+                     ghost_pack_entry_t *entry);
+// Binary search for a key. With `time` < 0 the fastest ghost of `player` on
+// `map` is returned. Returns the entry index or -1.
+int ghost_pack_find(const ghost_pack_t *pack, const char *map,
+                    const char *player, int time);
+// Returns the first entry of `map` and stores the number of entries of that
+// map in `count`, or -1 if there are none.
+int ghost_pack_find_map(const ghost_pack_t *pack, const char *map,
+                        int *count);
+ghost_t *ghost_pack_load(const ghost_pack_t *pack, int index);
+
+// Opens a pack for appending, creating it if it does not exist. Existing
+// ghosts are kept. New ghosts and the new index are written after the old
+// index by ghost_pack_writer_close, so if appending is interrupted the pack
+// still opens with its previous contents. The old indexes stay behind as dead
+// space; when it grows larger than the ghosts, closing the writer also
+// compacts the pack.
+ghost_pack_writer_t *ghost_pack_writer_open(const char *filename);
+int ghost_pack_writer_add(ghost_pack_writer_t *writer, const void *data,
+                          size_t size);
+int ghost_pack_writer_add_file(ghost_pack_writer_t *writer,
+                               const char *filename);
+int ghost_pack_writer_close(ghost_pack_writer_t *writer);
+// Rewrites the pack without dead space into "<filename>.tmp" and renames it
+// over the pack, which stays unchanged until then.
+int ghost_pack_compact(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_PACK_H
@@ -0,0 +1,30 @@
+#ifndef DDNET_GHOST_RESAMPLE_H
+#define DDNET_GHOST_RESAMPLE_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_resample_job_t {
+  const ghost_path_t *path;
+  // Room for `max_frames` frames; size it with ghost_resample(path, rate,
+  // NULL, 0).
+  ghost_character_t *out;
+  int max_frames;
+  // Set to the result of ghost_resample.
+  int num_frames;
+} ghost_resample_job_t;
+
+// Resamples the paths of `num_jobs` ghosts to `rate` frames per second on
+// `num_threads` threads (0 selects one per CPU). Returns the number of jobs
+// that succeeded.
+int ghost_resample_paths(ghost_resample_job_t *jobs, int num_jobs, float rate,
+                         int num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_RESAMPLE_H
@@ -0,0 +1,65 @@
+#ifndef DDNET_GHOST_ROUTE_H
+#define DDNET_GHOST_ROUTE_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GHOST_ROUTE_POINTS 32
+
+// Shape of a run independent of its speed: the x/y path with jitter below
+// half a tile removed, resampled to GHOST_ROUTE_POINTS points evenly spaced
+// along its length. `num_ticks` is 0 if no fingerprint could be made.
+typedef struct ghost_route_t {
+  float x[GHOST_ROUTE_POINTS];
+  float y[GHOST_ROUTE_POINTS];
+  float length;
+  int num_ticks;
+} ghost_route_t;
+
+// Returns 0 on success, -1 for an empty path or unreadable file.
+int ghost_route_fingerprint(const ghost_path_t *path, ghost_route_t *route);
+// Streams the file, so the path is never held in memory.
+int ghost_route_fingerprint_file(const char *filename, ghost_route_t *route);
+// Fingerprints `num_files` files into `routes` on `num_threads` threads (0
+// selects one per CPU). Files that cannot be read get `num_ticks` 0.
+// Returns the number of fingerprints made.
+int ghost_route_fingerprint_files(const char *const *filenames, int num_files,
+                                  ghost_route_t *routes, int num_threads);
+// Root mean square distance between corresponding route points.
+float ghost_route_distance(const ghost_route_t *a, const ghost_route_t *b);
+
+typedef struct ghost_route_index_t ghost_route_index_t;
+
+// Locality-sensitive hash index over route fingerprints. Routes within
+// `radius` (see ghost_route_distance) of a query are found with high
+// probability; `radius` <= 0 selects 64 units (two tiles).
+ghost_route_index_t *ghost_route_index_create(float radius);
+void ghost_route_index_free(ghost_route_index_t *index);
+// Returns the id of the added route (ids count up from 0), or -1.
+int ghost_route_index_add(ghost_route_index_t *index,
+                          const ghost_route_t *route);
+// Sorts the routes added since the last build into the hash tables. Queries
+// still find routes added later but compare them one by one. Returns 0, or
+// -1 if `index` is NULL.
+int ghost_route_index_build(ghost_route_index_t *index);
+int ghost_route_index_size(const ghost_route_index_t *index);
+const ghost_route_t *ghost_route_index_get(const ghost_route_index_t *index,
+                                           int id);
+// Stores the ids of up to `k` nearest routes in `ids`, closest first, and
+// their distances in `distances` if it is not NULL. Only routes sharing a
+// hash bucket with the query are compared; if there are fewer than `k` of
+// them the whole index is scanned. Returns the number of ids stored, or -1.
+// Queries only read the index, so they may run concurrently with each
+// other but not with ghost_route_index_add or ghost_route_index_build.
+int ghost_route_index_query(const ghost_route_index_t *index,
+                            const ghost_route_t *route, int k, int *ids,
+                            float *distances);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_ROUTE_H
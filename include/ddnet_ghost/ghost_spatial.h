@@ -0,0 +1,42 @@
+#ifndef DDNET_GHOST_SPATIAL_H
+#define DDNET_GHOST_SPATIAL_H
+
+#include <ddnet_ghost/ghost.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ghost_spatial_index_t ghost_spatial_index_t;
+
+// Creates an empty uniform grid index. `cell_size` <= 0 selects 32 units
+// (one tile).
+ghost_spatial_index_t *ghost_spatial_index_create(int cell_size);
+// Creates an index containing every snapshot of `path`.
+ghost_spatial_index_t *ghost_spatial_index_build(const ghost_path_t *path,
+                                                 int cell_size);
+void ghost_spatial_index_free(ghost_spatial_index_t *index);
+
+// Adds one snapshot under the given path index. Returns 0 on success.
+int ghost_spatial_index_add(ghost_spatial_index_t *index,
+                            const ghost_character_t *snap, int path_index);
+// Adds all snapshots of `path` that were recorded since the last sync, e.g.
+// after each `ghost_add_snap`. Returns 0 on success.
+int ghost_spatial_index_sync(ghost_spatial_index_t *index,
+                             const ghost_path_t *path);
+int ghost_spatial_index_size(const ghost_spatial_index_t *index);
+
+// Returns the path index of the snapshot closest to (x, y), or -1 if the
+// index is empty. Ties resolve to the lower path index.
+int ghost_spatial_index_nearest(const ghost_spatial_index_t *index, int x,
+                                int y, float *distance);
+// Stores up to `max_out` path indices within `radius` of (x, y) in `out` and
+// returns the total number of matches.
+int ghost_spatial_index_within(const ghost_spatial_index_t *index, int x,
+                               int y, float radius, int *out, int max_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDNET_GHOST_SPATIAL_H
@@ -1,4 +1,5 @@
 #include <ddnet_ghost/ghost.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -6,6 +7,22 @@
 #include <stdlib.h>
 #include <string.h>
 
+// The codec hot paths are compiled once per instruction set and picked at
+// runtime, so the library itself needs no -m flags.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GHOST_CODEC_DISPATCH
+#include <immintrin.h>
+#define CODEC_INLINE static inline __attribute__((always_inline))
+#define CODEC_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define CODEC_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#else
+#define CODEC_INLINE static inline
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #define HUFFMAN_EOF_SYMBOL 256
 #define HUFFMAN_MAX_SYMBOLS (HUFFMAN_EOF_SYMBOL + 1)
 #define HUFFMAN_MAX_NODES (HUFFMAN_MAX_SYMBOLS * 2 - 1)
@@ -27,6 +44,43 @@ typedef struct huffman_context_t {
   int num_nodes;
 } huffman_context_t;
 
+typedef struct scan_limits_t {
+  int max_tick_gap;
+  int max_step;
+  int max_velocity;
+  int max_velocity_error;
+  int max_angle_step;
+  int max_hook_step;
+  // All bits set unless the ticks are only snapshot indices.
+  int check_attack_tick;
+} scan_limits_t;
+
+// One output frame of ghost_resample: the snapshots around it and how far
+// between them it lies. `next` equals `prev` past the end of the path.
+typedef struct resample_frame_t {
+  const ghost_character_t *prev;
+  const ghost_character_t *next;
+  double amount;
+} resample_frame_t;
+
+typedef struct codec_kernels_t {
+  int (*huffman_decompress)(const huffman_context_t *ctx, const void *input,
+                            int in_size, void *output, int out_size);
+  long (*var_decompress)(const void *src, int src_size, void *dst,
+                         int dst_size);
+  long (*var_compress)(const void *src, int src_size, void *dst, int dst_size);
+  void (*undiff_item)(const uint32_t *past, const uint32_t *diff,
+                      uint32_t *out, size_t size);
+  void (*diff_item)(const uint32_t *past, const uint32_t *current,
+                    uint32_t *out, size_t size);
+  int (*scan_pairs)(const ghost_character_t *snaps, int count,
+                    const scan_limits_t *limits, uint8_t *flags);
+  void (*resample_frames)(const resample_frame_t *frames, int count,
+                          ghost_character_t *out);
+} codec_kernels_t;
+
+static const codec_kernels_t *codec_kernels(void);
+
 static const unsigned huffman_freq_table[HUFFMAN_MAX_SYMBOLS] = {
     1 << 30, 4545, 2657, 431, 1950, 919,  444, 482, 2244, 617, 838, 542,  715,
     1814,    304,  240,  754, 212,  647,  186, 283, 131,  146, 166, 543,  164,
@@ -49,15 +103,58 @@ static const unsigned huffman_freq_table[HUFFMAN_MAX_SYMBOLS] = {
     19,      18,   16,   26,  17,   18,   9,   10,  25,   22,  22,  17,   20,
     16,      6,    16,   15,  20,   14,   18,  24,  335,  1517};
 
+// Byte frequencies of ghost chunk payloads after var_compress, generated with
+// `example_analyze --emit-table`.
+static const unsigned ghost_freq_table[HUFFMAN_MAX_SYMBOLS] = {
+    65536, 11612, 900, 833, 833, 685, 712, 497, 605, 672, 497, 484,
+    497, 484, 443, 470, 417, 860, 1222, 1128, 631, 900, 752, 390,
+    323, 927, 188, 175, 994, 175, 323, 1383, 1195, 564, 202, 81,
+    108, 752, 242, 645, 1370, 14, 14, 14, 14, 14, 1, 14,
+    14, 14, 1, 14, 14, 14, 27, 14, 1, 41, 14, 1,
+    14, 1, 1, 1, 752, 417, 470, 350, 417, 256, 215, 229,
+    162, 202, 202, 242, 202, 121, 148, 108, 94, 94, 108, 108,
+    135, 175, 309, 806, 1021, 121, 135, 188, 269, 202, 202, 175,
+    175, 188, 175, 162, 108, 54, 27, 41, 14, 68, 14, 14,
+    54, 27, 14, 14, 1, 14, 41, 14, 14, 14, 27, 1,
+    1, 14, 27, 1, 41, 14, 1, 14, 309, 54, 54, 121,
+    27, 68, 94, 108, 81, 68, 54, 68, 68, 41, 94, 27,
+    54, 41, 54, 27, 27, 27, 41, 54, 27, 41, 54, 41,
+    41, 54, 1, 81, 68, 14, 54, 27, 14, 68, 41, 54,
+    27, 68, 1, 41, 27, 14, 14, 27, 108, 94, 41, 68,
+    68, 1, 27, 27, 27, 27, 41, 54, 14, 54, 41, 81,
+    54, 14, 41, 54, 41, 41, 54, 14, 41, 14, 68, 41,
+    27, 108, 41, 27, 27, 41, 27, 27, 41, 1, 41, 27,
+    14, 41, 41, 68, 14, 27, 1, 27, 27, 54, 27, 27,
+    27, 14, 27, 27, 14, 27, 41, 27, 1, 14, 27, 14,
+    14, 14, 54, 54, 14, 14, 41, 81, 14, 1, 27, 81,
+    54, 68, 14, 229,
+    1};
+
+static const unsigned *huffman_table(int table) {
+  switch (table) {
+  case GHOST_HUFFMAN_TABLE_NETWORK:
+    return huffman_freq_table;
+  case GHOST_HUFFMAN_TABLE_GHOST:
+    return ghost_freq_table;
+  default:
+    return NULL;
+  }
+}
+
 typedef struct construct_node_t {
   unsigned short node_id;
   int frequency;
 } construct_node_t;
 
-static int compare_nodes(const void *a, const void *b) {
-  const construct_node_t *node_a = *(const construct_node_t **)a;
-  const construct_node_t *node_b = *(const construct_node_t **)b;
-  return node_b->frequency - node_a->frequency;
+// Stable descending insertion step: moves nodes[index] to the left past all
+// nodes with a lower frequency, like a stable sort of the whole array would.
+static void sift_node(construct_node_t **nodes, int index) {
+  construct_node_t *node = nodes[index];
+  while (index > 0 && nodes[index - 1]->frequency < node->frequency) {
+    nodes[index] = nodes[index - 1];
+    index--;
+  }
+  nodes[index] = node;
 }
 
 static void set_bits_recursive(huffman_node_t *nodes, huffman_node_t *node,
@@ -94,10 +191,12 @@ static void construct_tree(huffman_context_t *ctx,
 
   ctx->num_nodes = HUFFMAN_MAX_SYMBOLS;
 
-  while (num_nodes_left > 1) {
-    qsort(nodes_left, num_nodes_left, sizeof(construct_node_t *),
-          compare_nodes);
+  // Only the merged node changes between rounds, so the list is kept sorted
+  // incrementally instead of being re-sorted every round.
+  for (int i = 1; i < num_nodes_left; i++)
+    sift_node(nodes_left, i);
 
+  while (num_nodes_left > 1) {
     huffman_node_t *new_node = &ctx->nodes[ctx->num_nodes];
     new_node->num_bits = 0;
     new_node->leafs[0] = nodes_left[num_nodes_left - 1]->node_id;
@@ -106,6 +205,7 @@ static void construct_tree(huffman_context_t *ctx,
     nodes_left[num_nodes_left - 2]->node_id = ctx->num_nodes;
     nodes_left[num_nodes_left - 2]->frequency +=
         nodes_left[num_nodes_left - 1]->frequency;
+    sift_node(nodes_left, num_nodes_left - 2);
 
     ctx->num_nodes++;
     num_nodes_left--;
@@ -115,9 +215,9 @@ static void construct_tree(huffman_context_t *ctx,
   set_bits_recursive(ctx->nodes, ctx->start_node, 0, 0);
 }
 
-static void huffman_init(huffman_context_t *ctx) {
+static void huffman_init(huffman_context_t *ctx, const unsigned *frequencies) {
   memset(ctx, 0, sizeof(*ctx));
-  construct_tree(ctx, huffman_freq_table);
+  construct_tree(ctx, frequencies);
 
   for (int i = 0; i < HUFFMAN_LUTSIZE; i++) {
     unsigned bits = i;
@@ -138,8 +238,9 @@ static void huffman_init(huffman_context_t *ctx) {
   }
 }
 
-static int huffman_decompress(const huffman_context_t *ctx, const void *input,
-                              int in_size, void *output, int out_size) {
+CODEC_INLINE int huffman_decompress_impl(const huffman_context_t *ctx,
+                                         const void *input, int in_size,
+                                         void *output, int out_size) {
   const unsigned char *src = (const unsigned char *)input;
   const unsigned char *src_end = src + in_size;
   unsigned char *dst = (unsigned char *)output;
@@ -216,6 +317,10 @@ struct ghost_info_t {
   int time;
 } typedef ghost_info_t;
 
+// `zeroes[0]` is zero in every version 6 DDNet ghost. This library uses it
+// to mark files written with an opt-in Huffman table (GHOST_HUFFMAN_TABLE_*).
+// Older versions store a map CRC in `zeroes` and always use the network
+// table.
 struct ghost_header_t {
   unsigned char marker[8];
   unsigned char version;
@@ -239,9 +344,17 @@ enum {
   GHOSTDATA_TYPE_START_TICK
 };
 
+struct mem_stream_t {
+  const unsigned char *data;
+  size_t size;
+  size_t pos;
+} typedef mem_stream_t;
+
 struct ghost_loader_t {
   void *file;
   char filename[IO_MAX_PATH_LENGTH];
+  bool in_memory;
+  mem_stream_t mem;
 
   ghost_header_t header;
   ghost_info_t info;
@@ -254,12 +367,20 @@ struct ghost_loader_t {
   int buffer_num_items;
   int buffer_cur_item;
   int buffer_prev_item;
+  bool buffer_columnar;
   ghost_item_t last_item;
+
+  huffman_context_t huffman;
+
+  // GHOST_VERIFY_* code of the first failure and where its chunk starts.
+  int error;
+  long chunk_offset;
 } typedef ghost_loader_t;
 
 static const unsigned char header_marker[8] = {'T', 'W', 'G', 'H',
                                                'O', 'S', 'T', 0};
 static const unsigned char current_version = 6;
+static const unsigned char columnar_version = 7;
 
 static bool mem_has_null(const void *block, size_t size) {
   const unsigned char *bytes = (const unsigned char *)block;
@@ -285,22 +406,36 @@ static int get_time(const ghost_header_t *header) {
   return bytes_be_to_uint(header->time);
 }
 
-static bool validate_header(const ghost_header_t *header,
-                            const char *filename) {
+static int get_huffman_table(const ghost_header_t *header) {
+  return header->version >= 6 ? header->zeroes[0]
+                              : GHOST_HUFFMAN_TABLE_NETWORK;
+}
+
+// Returns GHOST_VERIFY_OK or the first problem found.
+static int validate_header(const ghost_header_t *header,
+                           const char *filename) {
   if (memcmp(header->marker, header_marker, sizeof(header_marker)) != 0) {
     fprintf(
         stderr,
         "ghost_loader: Failed to read ghost file '%s': invalid header marker\n",
         filename);
-    return false;
+    return GHOST_VERIFY_ERROR_MARKER;
   }
 
-  if (header->version < 4 || header->version > current_version) {
+  if (header->version < 4 || header->version > columnar_version) {
     fprintf(stderr,
             "ghost_loader: Failed to read ghost file '%s': ghost version '%d' "
             "is not supported\n",
             filename, header->version);
-    return false;
+    return GHOST_VERIFY_ERROR_VERSION;
+  }
+
+  if (!huffman_table(get_huffman_table(header))) {
+    fprintf(stderr,
+            "ghost_loader: Failed to read ghost file '%s': huffman table '%d' "
+            "is not supported\n",
+            filename, get_huffman_table(header));
+    return GHOST_VERIFY_ERROR_HUFFMAN_TABLE;
   }
 
   if (!mem_has_null(header->owner, sizeof(header->owner))) {
@@ -308,7 +443,7 @@ static bool validate_header(const ghost_header_t *header,
         stderr,
         "ghost_loader: Failed to read ghost file '%s': owner name is invalid\n",
         filename);
-    return false;
+    return GHOST_VERIFY_ERROR_NAME;
   }
 
   if (!mem_has_null(header->map, sizeof(header->map))) {
@@ -316,7 +451,7 @@ static bool validate_header(const ghost_header_t *header,
         stderr,
         "ghost_loader: Failed to read ghost file '%s': map name is invalid\n",
         filename);
-    return false;
+    return GHOST_VERIFY_ERROR_NAME;
   }
 
   const int num_ticks = get_ticks(header);
@@ -326,7 +461,7 @@ static bool validate_header(const ghost_header_t *header,
         "ghost_loader: Failed to read ghost file '%s': number of ticks '%d' "
         "is invalid\n",
         filename, num_ticks);
-    return false;
+    return GHOST_VERIFY_ERROR_NUM_TICKS;
   }
 
   const int time = get_time(header);
@@ -335,14 +470,16 @@ static bool validate_header(const ghost_header_t *header,
         stderr,
         "ghost_loader: Failed to read ghost file '%s': time '%d' is invalid\n",
         filename, time);
-    return false;
+    return GHOST_VERIFY_ERROR_TIME;
   }
 
-  return true;
+  return GHOST_VERIFY_OK;
 }
 
 typedef void *io_handle_t;
-static io_handle_t read_header(ghost_header_t *header, const char *filename) {
+static io_handle_t read_header(ghost_header_t *header, const char *filename,
+                               int *error) {
+  *error = GHOST_VERIFY_ERROR_IO;
   FILE *file = fopen(filename, "rb");
   if (!file) {
     fprintf(stderr,
@@ -357,10 +494,12 @@ static io_handle_t read_header(ghost_header_t *header, const char *filename) {
             "header\n",
             filename);
     fclose(file);
+    *error = GHOST_VERIFY_ERROR_TRUNCATED;
     return NULL;
   }
 
-  if (!validate_header(header, filename)) {
+  *error = validate_header(header, filename);
+  if (*error != GHOST_VERIFY_OK) {
     fclose(file);
     return NULL;
   }
@@ -368,6 +507,39 @@ static io_handle_t read_header(ghost_header_t *header, const char *filename) {
   return file;
 }
 
+static int read_header_mem(ghost_header_t *header, mem_stream_t *mem,
+                           const char *name) {
+  if (mem->size < sizeof(*header)) {
+    fprintf(stderr,
+            "ghost_loader: Failed to read ghost file '%s': failed to read "
+            "header\n",
+            name);
+    return GHOST_VERIFY_ERROR_TRUNCATED;
+  }
+
+  memcpy(header, mem->data, sizeof(*header));
+  mem->pos = sizeof(*header);
+  return validate_header(header, name);
+}
+
+static bool loader_read(ghost_loader_t *loader, void *dst, size_t size) {
+  if (!loader->in_memory)
+    return fread(dst, size, 1, loader->file) == 1;
+
+  mem_stream_t *mem = &loader->mem;
+  if (mem->size - mem->pos < size)
+    return false;
+  memcpy(dst, mem->data + mem->pos, size);
+  mem->pos += size;
+  return true;
+}
+
+static long loader_tell(ghost_loader_t *loader) {
+  if (loader->in_memory)
+    return (long)loader->mem.pos;
+  return ftell((FILE *)loader->file);
+}
+
 static int io_seek(io_handle_t io, int64_t offset) {
 #if defined(CONF_FAMILY_WINDOWS)
   return _fseeki64((FILE *)io, offset, SEEK_CUR);
@@ -391,10 +563,11 @@ static void reset_loader_buffer(ghost_loader_t *loader) {
   loader->buffer_num_items = 0;
   loader->buffer_cur_item = 0;
   loader->buffer_prev_item = -1;
+  loader->buffer_columnar = false;
 }
 
-static void undiff_item(const uint32_t *past, const uint32_t *diff,
-                        uint32_t *out, size_t size) {
+CODEC_INLINE void undiff_item_impl(const uint32_t *past, const uint32_t *diff,
+                                   uint32_t *out, size_t size) {
   while (size) {
     *out = *past + *diff;
     out++;
@@ -431,8 +604,8 @@ static const unsigned char *var_unpack(const unsigned char *src, int *in_out,
   return src;
 }
 
-static long var_decompress(const void *src_void, int src_size, void *dst_void,
-                           int dst_size) {
+CODEC_INLINE long var_decompress_impl(const void *src_void, int src_size,
+                                      void *dst_void, int dst_size) {
   if (dst_size % sizeof(int) != 0) {
     return -1;
     fprintf(stderr, "Variable int invalid bounds\n");
@@ -454,15 +627,195 @@ static long var_decompress(const void *src_void, int src_size, void *dst_void,
   return (long)((unsigned char *)dst - (unsigned char *)dst_void);
 }
 
+enum {
+  COLUMN_DELTA = 0,
+  COLUMN_DELTA2,
+  COLUMN_BLOCK_SIZE = 32,
+  COLUMN_BLOCK_SPARSE = 0x80,
+  COLUMN_BLOCK_WIDTH_MASK = 0x3f,
+  COLUMNAR_ITEMS_PER_CHUNK = 128,
+  NUM_CHARACTER_FIELDS = sizeof(ghost_character_t) / sizeof(int),
+};
+
+static uint32_t zigzag_encode(uint32_t v) {
+  return (v << 1) ^ (uint32_t)-(int32_t)(v >> 31);
+}
+
+static uint32_t zigzag_decode(uint32_t v) { return (v >> 1) ^ -(v & 1); }
+
+static const unsigned char *uvar_unpack(const unsigned char *src,
+                                        const unsigned char *src_end,
+                                        uint32_t *out) {
+  uint32_t value = 0;
+  for (unsigned shift = 0; shift < 35; shift += 7) {
+    if (src >= src_end)
+      return NULL;
+    const unsigned char byte = *src++;
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *out = value;
+      return src;
+    }
+  }
+  return NULL;
+}
+
+// Column values are stored in blocks of 32. A packed block holds all 32 at a
+// fixed bit width in exactly `width` little-endian 32-bit words, so it can be
+// unpacked without branching on bit positions. A sparse block holds a bitmask
+// of its non-zero values followed by those values as varints.
+// Block words are little-endian in the file. On little-endian hosts they
+// are copied as is; the byte loop keeps other hosts reading the same values.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+CODEC_INLINE uint64_t load_le64(const unsigned char *src, unsigned len) {
+  uint64_t value = 0;
+  for (unsigned i = 0; i < len; i++)
+    value |= (uint64_t)src[i] << (8 * i);
+  return value;
+}
+
+CODEC_INLINE void store_le64(unsigned char *dst, uint64_t value, unsigned len) {
+  for (unsigned i = 0; i < len; i++)
+    dst[i] = (unsigned char)(value >> (8 * i));
+}
+#else
+CODEC_INLINE uint64_t load_le64(const unsigned char *src, unsigned len) {
+  uint64_t value = 0;
+  memcpy(&value, src, len);
+  return value;
+}
+
+CODEC_INLINE void store_le64(unsigned char *dst, uint64_t value, unsigned len) {
+  memcpy(dst, &value, len);
+}
+#endif
+
+static void unpack_block(const unsigned char *src, int width, uint32_t *out) {
+  const uint64_t mask = ((uint64_t)1 << width) - 1;
+  const unsigned size = (unsigned)width * sizeof(uint32_t);
+  for (unsigned j = 0; j < COLUMN_BLOCK_SIZE; j++) {
+    const unsigned bit = j * (unsigned)width;
+    const unsigned avail = size - bit / 8;
+    const uint64_t window = load_le64(src + bit / 8, avail < 8 ? avail : 8);
+    out[j] = (uint32_t)((window >> (bit % 8)) & mask);
+  }
+}
+
+static const unsigned char *decode_blocks(const unsigned char *src,
+                                          const unsigned char *src_end,
+                                          uint32_t *out, int count) {
+  for (int base = 0; base < count; base += COLUMN_BLOCK_SIZE) {
+    if (src >= src_end)
+      return NULL;
+    const int header = *src++;
+
+    if (header & COLUMN_BLOCK_SPARSE) {
+      if (src_end - src < 4)
+        return NULL;
+      const uint32_t bitmask = (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+                               ((uint32_t)src[2] << 16) |
+                               ((uint32_t)src[3] << 24);
+      src += 4;
+      memset(out + base, 0, COLUMN_BLOCK_SIZE * sizeof(uint32_t));
+      for (int j = 0; j < COLUMN_BLOCK_SIZE; j++) {
+        if (!(bitmask & (1u << j)))
+          continue;
+        src = uvar_unpack(src, src_end, &out[base + j]);
+        if (!src)
+          return NULL;
+      }
+    } else {
+      const int width = header & COLUMN_BLOCK_WIDTH_MASK;
+      if (width > 32 || src_end - src < width * (int)sizeof(uint32_t))
+        return NULL;
+      unpack_block(src, width, out + base);
+      src += width * sizeof(uint32_t);
+    }
+  }
+  return src;
+}
+
+// `out` must have room for `count` rounded up to a whole block.
+static const unsigned char *decode_column(const unsigned char *src,
+                                          const unsigned char *src_end,
+                                          uint32_t *out, int count) {
+  if (src >= src_end)
+    return NULL;
+  const int mode = *src++;
+  if (mode != COLUMN_DELTA && mode != COLUMN_DELTA2)
+    return NULL;
+
+  uint32_t first;
+  src = uvar_unpack(src, src_end, &first);
+  if (!src)
+    return NULL;
+  out[0] = zigzag_decode(first);
+
+  int skip = 1;
+  uint32_t step = 0;
+  if (mode == COLUMN_DELTA2) {
+    src = uvar_unpack(src, src_end, &step);
+    if (!src || count < 2)
+      return NULL;
+    step = zigzag_decode(step);
+    out[1] = out[0] + step;
+    skip = 2;
+  }
+
+  const int num_packed = count > skip ? count - skip : 0;
+  uint32_t *packed = out + skip;
+  src = decode_blocks(src, src_end, packed, num_packed);
+  if (!src)
+    return NULL;
+
+  for (int i = 0; i < num_packed; i++)
+    packed[i] = zigzag_decode(packed[i]);
+  if (mode == COLUMN_DELTA2) {
+    for (int i = 0; i < num_packed; i++) {
+      step += packed[i];
+      packed[i] = step;
+    }
+  }
+  for (int i = skip; i < count; i++)
+    out[i] += out[i - 1];
+
+  return src;
+}
+
+static long columnar_decompress(const void *src_void, int src_size,
+                                void *dst_void, int dst_size, int num_items) {
+  if (num_items <= 0 || num_items > COLUMNAR_ITEMS_PER_CHUNK ||
+      (size_t)num_items * sizeof(ghost_character_t) > (size_t)dst_size)
+    return -1;
+
+  const unsigned char *src = (const unsigned char *)src_void;
+  const unsigned char *src_end = src + src_size;
+  uint32_t *dst = (uint32_t *)dst_void;
+  uint32_t column[COLUMNAR_ITEMS_PER_CHUNK + COLUMN_BLOCK_SIZE];
+
+  for (int field = 0; field < NUM_CHARACTER_FIELDS; field++) {
+    src = decode_column(src, src_end, column, num_items);
+    if (!src)
+      return -1;
+    for (int i = 0; i < num_items; i++)
+      dst[i * NUM_CHARACTER_FIELDS + field] = column[i];
+  }
+
+  if (src != src_end)
+    return -1;
+  return (long)(num_items * sizeof(ghost_character_t));
+}
+
 static bool read_chunk(ghost_loader_t *loader, int *type) {
   if (loader->header.version != 4) {
     loader->last_item.type = -1;
   }
 
   reset_loader_buffer(loader);
+  loader->chunk_offset = loader_tell(loader);
 
   unsigned char chunk_header[4];
-  if (fread(chunk_header, sizeof(chunk_header), 1, loader->file) != 1) {
+  if (!loader_read(loader, chunk_header, sizeof(chunk_header))) {
     return false;
   }
 
@@ -476,39 +829,61 @@ static bool read_chunk(ghost_loader_t *loader, int *type) {
         "ghost_loader: Failed to read ghost file '%s': invalid chunk header "
         "size\n",
         loader->filename);
+    loader->error = GHOST_VERIFY_ERROR_CHUNK_SIZE;
     return false;
   }
 
-  if (fread(loader->buffer, size, 1, loader->file) != 1) {
+  if (!loader_read(loader, loader->buffer, size)) {
     fprintf(stderr,
             "ghost_loader: Failed to read ghost file '%s': error reading chunk "
             "data\n",
             loader->filename);
+    loader->error = GHOST_VERIFY_ERROR_TRUNCATED;
     return false;
   }
 
-  huffman_context_t ctx;
-  huffman_init(&ctx);
+  if (loader->header.version == columnar_version &&
+      *type == GHOSTDATA_TYPE_CHARACTER) {
+    memcpy(loader->buffer_temp, loader->buffer, size);
+    size = columnar_decompress(loader->buffer_temp, size, loader->buffer,
+                               sizeof(loader->buffer),
+                               loader->buffer_num_items);
+    if (size < 0) {
+      fprintf(stderr,
+              "ghost_loader: Failed to read ghost file '%s': error during "
+              "columnar decompression\n",
+              loader->filename);
+      loader->error = GHOST_VERIFY_ERROR_DECOMPRESS;
+      return false;
+    }
+    loader->buffer_columnar = true;
+    loader->buffer_end = loader->buffer + size;
+    return true;
+  }
 
-  size = huffman_decompress(&ctx, loader->buffer, size, loader->buffer_temp,
-                            sizeof(loader->buffer_temp));
+  const codec_kernels_t *kernels = codec_kernels();
+  size = kernels->huffman_decompress(&loader->huffman, loader->buffer, size,
+                                     loader->buffer_temp,
+                                     sizeof(loader->buffer_temp));
   if (size < 0) {
     fprintf(
         stderr,
         "ghost_loader: Failed to read ghost file '%s': error during network "
         "decompression\n",
         loader->filename);
+    loader->error = GHOST_VERIFY_ERROR_DECOMPRESS;
     return false;
   }
 
-  size = var_decompress(loader->buffer_temp, size, loader->buffer,
-                        sizeof(loader->buffer));
+  size = kernels->var_decompress(loader->buffer_temp, size, loader->buffer,
+                                 sizeof(loader->buffer));
   if (size < 0) {
     fprintf(
         stderr,
         "ghost_loader: Failed to read ghost file '%s': error during intpack "
         "decompression\n",
         loader->filename);
+    loader->error = GHOST_VERIFY_ERROR_DECOMPRESS;
     return false;
   }
 
@@ -558,15 +933,17 @@ static int read_data(ghost_loader_t *loader, int type, void *data,
             "(type='%d', got='%zu', wanted='%zu')\n",
             loader->filename, type,
             (size_t)(loader->buffer_end - loader->buffer_pos), size);
+    loader->error = GHOST_VERIFY_ERROR_ITEM_SIZE;
     return 1;
   }
 
   ghost_item_t item_data;
   item_data.type = type;
-  if (loader->last_item.type == item_data.type) {
-    undiff_item((const uint32_t *)loader->last_item.data,
-                (const uint32_t *)loader->buffer_pos,
-                (uint32_t *)item_data.data, size / sizeof(uint32_t));
+  if (loader->last_item.type == item_data.type && !loader->buffer_columnar) {
+    codec_kernels()->undiff_item((const uint32_t *)loader->last_item.data,
+                                 (const uint32_t *)loader->buffer_pos,
+                                 (uint32_t *)item_data.data,
+                                 size / sizeof(uint32_t));
   } else {
     memcpy(item_data.data, loader->buffer_pos, size);
   }
@@ -584,36 +961,59 @@ static void close_ghost_loader(ghost_loader_t *loader) {
     return;
   }
 
-  fclose(loader->file);
+  if (!loader->in_memory)
+    fclose(loader->file);
   loader->file = NULL;
   loader->filename[0] = '\0';
 }
 
-static ghost_loader_t new_ghost_loader(void) {
-  ghost_loader_t loader;
-  loader.file = NULL;
-  loader.filename[0] = '\0';
-  reset_loader_buffer(&loader);
-  return loader;
+static void init_loader_state(ghost_loader_t *loader) {
+  loader->info = to_ghost_info(&loader->header);
+  loader->error = GHOST_VERIFY_OK;
+  loader->chunk_offset = -1;
+  loader->last_item.type = -1;
+  reset_loader_buffer(loader);
+  huffman_init(&loader->huffman, huffman_table(get_huffman_table(&loader->header)));
 }
 
-static ghost_loader_t init_ghost_loader(const char *filename) {
-  ghost_loader_t loader;
-  io_handle_t file = read_header(&loader.header, filename);
+static bool init_ghost_loader(ghost_loader_t *loader, const char *filename) {
+  io_handle_t file = read_header(&loader->header, filename, &loader->error);
   if (!file) {
-    loader.file = NULL;
-    return loader;
+    loader->file = NULL;
+    return false;
   }
 
-  if (loader.header.version < 6)
+  if (loader->header.version < 6)
     io_seek(file, -(int)sizeof(sha256_digest_t));
 
-  loader.file = file;
-  strcpy(loader.filename, filename);
-  loader.info = to_ghost_info(&loader.header);
-  loader.last_item.type = -1;
-  reset_loader_buffer(&loader);
-  return loader;
+  loader->file = file;
+  loader->in_memory = false;
+  strncpy(loader->filename, filename, sizeof(loader->filename) - 1);
+  loader->filename[sizeof(loader->filename) - 1] = '\0';
+  init_loader_state(loader);
+  return true;
+}
+
+static bool init_ghost_loader_mem(ghost_loader_t *loader, const void *data,
+                                  size_t size) {
+  strcpy(loader->filename, "<memory>");
+  loader->in_memory = true;
+  loader->mem.data = (const unsigned char *)data;
+  loader->mem.size = size;
+  loader->mem.pos = 0;
+  loader->error =
+      read_header_mem(&loader->header, &loader->mem, loader->filename);
+  if (loader->error != GHOST_VERIFY_OK) {
+    loader->file = NULL;
+    return false;
+  }
+
+  if (loader->header.version < 6)
+    loader->mem.pos -= sizeof(sha256_digest_t);
+
+  loader->file = &loader->mem;
+  init_loader_state(loader);
+  return true;
 }
 
 ghost_character_t *ghost_get_snap(const ghost_path_t *path, int index) {
@@ -625,6 +1025,507 @@ ghost_character_t *ghost_get_snap(const ghost_path_t *path, int index) {
   return &path->chunks[chunk][pos];
 }
 
+// Index of the last snapshot at or before `tick`, or -1 outside the path.
+// Starts at the playback cursor: sequential ticks are found in a few steps,
+// gaps and jumps fall back to a binary search.
+static int find_tick_index(const ghost_path_t *path, int *cursor_pos,
+                           int tick) {
+  const int num_items = path->num_items;
+  if (!path->chunks || num_items <= 0 ||
+      tick < ghost_get_snap(path, 0)->tick ||
+      tick > ghost_get_snap(path, num_items - 1)->tick)
+    return -1;
+
+  const int cursor = *cursor_pos;
+  if (cursor >= 0 && cursor < num_items) {
+    const int cursor_tick = ghost_get_snap(path, cursor)->tick;
+    if (cursor_tick <= tick) {
+      // Contiguous ticks map straight to an index.
+      const int64_t guess = (int64_t)cursor + (tick - cursor_tick);
+      if (guess < num_items && ghost_get_snap(path, (int)guess)->tick == tick) {
+        *cursor_pos = (int)guess;
+        return (int)guess;
+      }
+      int index = cursor;
+      for (int step = 0; step < 4 && index + 1 < num_items; step++) {
+        if (ghost_get_snap(path, index + 1)->tick > tick) {
+          *cursor_pos = index;
+          return index;
+        }
+        index++;
+      }
+    }
+  }
+
+  int low = 0;
+  int high = num_items - 1;
+  while (low < high) {
+    const int mid = low + (high - low + 1) / 2;
+    if (ghost_get_snap(path, mid)->tick <= tick)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+  *cursor_pos = low;
+  return low;
+}
+
+ghost_character_t *ghost_get_snap_at_tick(ghost_t *ghost, int tick) {
+  if (!ghost)
+    return NULL;
+  return ghost_get_snap(&ghost->path,
+                        find_tick_index(&ghost->path, &ghost->playback_pos,
+                                        tick));
+}
+
+static int mix_int(int a, int b, double amount) {
+  return (int)lround(a + (b - (double)a) * amount);
+}
+
+// Angles are in 1/256 radians; turn the short way round like DDNet does.
+static double mix_angle(int a, int b, double amount) {
+  const double full_turn = 2.0 * 3.14159265358979323846 * 256.0;
+  double next_angle = b;
+  if (next_angle - a > full_turn / 2)
+    next_angle -= full_turn;
+  else if (a - next_angle > full_turn / 2)
+    next_angle += full_turn;
+  return a + (next_angle - a) * amount;
+}
+
+static int sample_path(const ghost_path_t *path, int *cursor, float tick,
+                       ghost_character_t *out) {
+  if (!out || !(tick == tick))
+    return -1;
+
+  const double base = floor(tick);
+  if (base < INT32_MIN || base > INT32_MAX)
+    return -1;
+  const int index = find_tick_index(path, cursor, (int)base);
+  if (index < 0)
+    return -1;
+
+  const ghost_character_t *prev = ghost_get_snap(path, index);
+  const ghost_character_t *next = ghost_get_snap(path, index + 1);
+  *out = *prev;
+  if (!next || tick <= prev->tick)
+    return 0;
+
+  // Ticks above 2^24 do not fit a float and their distance may not fit an
+  // int, so the factor is computed in double throughout.
+  const double amount = ((double)tick - prev->tick) /
+                        ((double)next->tick - prev->tick);
+  out->x = mix_int(prev->x, next->x, amount);
+  out->y = mix_int(prev->y, next->y, amount);
+  out->vel_x = mix_int(prev->vel_x, next->vel_x, amount);
+  out->vel_y = mix_int(prev->vel_y, next->vel_y, amount);
+  out->angle = (int)lround(mix_angle(prev->angle, next->angle, amount));
+  return 0;
+}
+
+int ghost_sample(ghost_t *ghost, float tick, ghost_character_t *out) {
+  if (!ghost)
+    return -1;
+  return sample_path(&ghost->path, &ghost->playback_pos, tick, out);
+}
+
+// Rounds half away from zero exactly like lround, as the vector variants
+// do, so that every variant produces the same frames. Adding 0.5 before
+// truncating would round 0.49999999999999994 up since the sum rounds to 1;
+// the distance to the truncated value is exact.
+CODEC_INLINE int round_frame_value(double value) {
+  const int whole = (int)value;
+  const double rest = value - whole;
+  return whole + (rest >= 0.5) - (rest <= -0.5);
+}
+
+CODEC_INLINE void resample_frames_impl(const resample_frame_t *frames,
+                                       int count, ghost_character_t *out) {
+  for (int i = 0; i < count; i++) {
+    const ghost_character_t *prev = frames[i].prev;
+    const ghost_character_t *next = frames[i].next;
+    const double amount = frames[i].amount;
+    out[i] = *prev;
+    out[i].x = round_frame_value(prev->x + ((double)next->x - prev->x) * amount);
+    out[i].y = round_frame_value(prev->y + ((double)next->y - prev->y) * amount);
+    out[i].vel_x = round_frame_value(
+        prev->vel_x + ((double)next->vel_x - prev->vel_x) * amount);
+    out[i].vel_y = round_frame_value(
+        prev->vel_y + ((double)next->vel_y - prev->vel_y) * amount);
+    out[i].angle =
+        round_frame_value(mix_angle(prev->angle, next->angle, amount));
+  }
+}
+
+enum { RESAMPLE_BLOCK = 256 };
+
+int ghost_resample(const ghost_path_t *path, float rate,
+                   ghost_character_t *out, int max_frames) {
+  if (!path || !(rate > 0.0f) || max_frames < 0)
+    return -1;
+  const int num_items = path->num_items;
+  if (!path->chunks || num_items <= 0)
+    return 0;
+
+  const int first_tick = ghost_get_snap(path, 0)->tick;
+  const double span =
+      (double)ghost_get_snap(path, num_items - 1)->tick - first_tick;
+  if (span < 0)
+    return -1;
+  const double step = GHOST_TICKS_PER_SECOND / (double)rate;
+  const double num_frames = floor(span / step) + 1;
+  if (num_frames > INT32_MAX) {
+    fprintf(stderr, "ghost: Failed to resample, too many frames\n");
+    return -1;
+  }
+  if (!out)
+    return (int)num_frames;
+
+  // Frames are located in blocks, then interpolated by the selected kernel
+  // while the block's snapshots are still in cache.
+  const codec_kernels_t *kernels = codec_kernels();
+  const int count = num_frames < max_frames ? (int)num_frames : max_frames;
+  resample_frame_t frames[RESAMPLE_BLOCK];
+  int index = 0;
+  const ghost_character_t *prev = ghost_get_snap(path, 0);
+  const ghost_character_t *next = ghost_get_snap(path, num_items > 1 ? 1 : 0);
+  for (int done = 0; done < count;) {
+    const int block =
+        count - done < RESAMPLE_BLOCK ? count - done : RESAMPLE_BLOCK;
+    for (int i = 0; i < block; i++) {
+      const double tick = first_tick + (done + i) * step;
+      while (index + 1 < num_items && next->tick <= tick) {
+        index++;
+        prev = next;
+        next = ghost_get_snap(path, index + 1 < num_items ? index + 1 : index);
+      }
+      frames[i].prev = prev;
+      frames[i].next = next;
+      frames[i].amount =
+          next->tick > prev->tick && tick > prev->tick
+              ? (tick - prev->tick) / ((double)next->tick - prev->tick)
+              : 0.0;
+    }
+    kernels->resample_frames(frames, block, out + done);
+    done += block;
+  }
+  return (int)num_frames;
+}
+
+void ghost_cursor_init(ghost_cursor_t *cursor, const ghost_t *ghost) {
+  if (!cursor)
+    return;
+  cursor->ghost = ghost;
+  cursor->pos = -1;
+}
+
+const ghost_character_t *ghost_cursor_snap_at_tick(ghost_cursor_t *cursor,
+                                                   int tick) {
+  if (!cursor || !cursor->ghost)
+    return NULL;
+  const ghost_path_t *path = &cursor->ghost->path;
+  return ghost_get_snap(path, find_tick_index(path, &cursor->pos, tick));
+}
+
+int ghost_cursor_sample(ghost_cursor_t *cursor, float tick,
+                        ghost_character_t *out) {
+  if (!cursor || !cursor->ghost)
+    return -1;
+  return sample_path(&cursor->ghost->path, &cursor->pos, tick, out);
+}
+
+struct ghost_shared_t {
+  ghost_t *ghost;
+  int refs;
+};
+
+ghost_shared_t *ghost_share(ghost_t *ghost) {
+  if (!ghost)
+    return NULL;
+  ghost_shared_t *shared = (ghost_shared_t *)malloc(sizeof(ghost_shared_t));
+  if (!shared)
+    return NULL;
+  shared->ghost = ghost;
+  shared->refs = 1;
+  return shared;
+}
+
+ghost_shared_t *ghost_retain(ghost_shared_t *shared) {
+  if (!shared)
+    return NULL;
+#if defined(_MSC_VER)
+  _InterlockedIncrement((volatile long *)&shared->refs);
+#else
+  __atomic_add_fetch(&shared->refs, 1, __ATOMIC_RELAXED);
+#endif
+  return shared;
+}
+
+void ghost_release(ghost_shared_t *shared) {
+  if (!shared)
+    return;
+#if defined(_MSC_VER)
+  const int refs = _InterlockedDecrement((volatile long *)&shared->refs);
+#else
+  const int refs = __atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL);
+#endif
+  if (refs == 0) {
+    ghost_free(shared->ghost);
+    free(shared);
+  }
+}
+
+const ghost_t *ghost_shared_ghost(const ghost_shared_t *shared) {
+  return shared ? shared->ghost : NULL;
+}
+
+// 24 bytes per snapshot. Hook positions are relative to the player. The
+// tick is relative to the tick the record would have if ticks advanced by
+// one from the last escape, or from tick_base if there is none, so a gap
+// costs at most one escape. Attack ticks, which change only when the player
+// fires, go through a table of distinct runs; records hold the run relative
+// to the first run of their block of PACKED_ATTACK_BLOCK records, which
+// always fits 16 bits. Snapshots that do not fit are stored whole in
+// `escapes`; their record has direction PACKED_ESCAPE and the escape index
+// in x.
+typedef struct packed_snap_t {
+  int32_t x;
+  int32_t y;
+  int16_t vel_x;
+  int16_t vel_y;
+  int16_t angle;
+  int16_t hook_dx;
+  int16_t hook_dy;
+  uint16_t attack;
+  int8_t direction;
+  int8_t weapon;
+  int8_t hook_state;
+  int8_t tick_offset;
+} packed_snap_t;
+
+enum { PACKED_ESCAPE = INT8_MIN, PACKED_ATTACK_BLOCK = 1 << 16 };
+
+struct ghost_packed_path_t {
+  packed_snap_t *records;
+  int num_items;
+  int tick_base;
+  int *attack_ticks;
+  int num_attack_ticks;
+  int *attack_bases;
+  ghost_character_t *escapes;
+  int *escape_indices;
+  int num_escapes;
+};
+
+static bool fits_int16(int64_t value) {
+  return value >= INT16_MIN && value <= INT16_MAX;
+}
+
+static bool fits_int8(int64_t value) {
+  return value > INT8_MIN && value <= INT8_MAX;
+}
+
+static bool pack_snap(const ghost_character_t *snap, int64_t tick_offset,
+                      int attack, packed_snap_t *out) {
+  const int64_t hook_dx = (int64_t)snap->hook_x - snap->x;
+  const int64_t hook_dy = (int64_t)snap->hook_y - snap->y;
+  if (!fits_int16(snap->vel_x) || !fits_int16(snap->vel_y) ||
+      !fits_int16(snap->angle) || !fits_int16(hook_dx) ||
+      !fits_int16(hook_dy) || !fits_int8(snap->direction) ||
+      !fits_int8(snap->weapon) || !fits_int8(snap->hook_state) ||
+      !fits_int8(tick_offset))
+    return false;
+
+  out->x = snap->x;
+  out->y = snap->y;
+  out->vel_x = (int16_t)snap->vel_x;
+  out->vel_y = (int16_t)snap->vel_y;
+  out->angle = (int16_t)snap->angle;
+  out->hook_dx = (int16_t)hook_dx;
+  out->hook_dy = (int16_t)hook_dy;
+  out->attack = (uint16_t)attack;
+  out->direction = (int8_t)snap->direction;
+  out->weapon = (int8_t)snap->weapon;
+  out->hook_state = (int8_t)snap->hook_state;
+  out->tick_offset = (int8_t)tick_offset;
+  return true;
+}
+
+ghost_packed_path_t *ghost_packed_path_create(const ghost_path_t *path) {
+  if (!path || path->num_items < 0)
+    return NULL;
+  ghost_packed_path_t *packed =
+      (ghost_packed_path_t *)calloc(1, sizeof(ghost_packed_path_t));
+  if (!packed)
+    return NULL;
+
+  const int num_items = path->num_items;
+  const int num_blocks = (num_items + PACKED_ATTACK_BLOCK - 1) /
+                         PACKED_ATTACK_BLOCK;
+  packed->num_items = num_items;
+  packed->records = (packed_snap_t *)malloc(
+      (num_items > 0 ? num_items : 1) * sizeof(packed_snap_t));
+  packed->attack_bases =
+      (int *)malloc((num_blocks > 0 ? num_blocks : 1) * sizeof(int));
+  if (!packed->records || !packed->attack_bases) {
+    ghost_packed_path_free(packed);
+    return NULL;
+  }
+  if (num_items > 0)
+    packed->tick_base = ghost_get_snap(path, 0)->tick;
+
+  // First pass sizes the side tables so that they are allocated exactly.
+  int num_attack_ticks = 0;
+  int escapes_capacity = 0;
+  int64_t next_tick = packed->tick_base;
+  for (int i = 0; i < num_items; i++) {
+    const ghost_character_t *snap = ghost_get_snap(path, i);
+    if (i == 0 || snap->attack_tick != ghost_get_snap(path, i - 1)->attack_tick)
+      num_attack_ticks++;
+    if (!pack_snap(snap, snap->tick - next_tick, 0, &packed->records[i])) {
+      escapes_capacity++;
+      next_tick = snap->tick;
+    }
+    next_tick++;
+  }
+  packed->attack_ticks = (int *)malloc(
+      (num_attack_ticks > 0 ? num_attack_ticks : 1) * sizeof(int));
+  if (escapes_capacity > 0) {
+    packed->escapes = (ghost_character_t *)malloc(escapes_capacity *
+                                                  sizeof(ghost_character_t));
+    packed->escape_indices = (int *)malloc(escapes_capacity * sizeof(int));
+  }
+  if (!packed->attack_ticks ||
+      (escapes_capacity > 0 && (!packed->escapes || !packed->escape_indices))) {
+    ghost_packed_path_free(packed);
+    return NULL;
+  }
+
+  next_tick = packed->tick_base;
+  for (int i = 0; i < num_items; i++) {
+    const ghost_character_t *snap = ghost_get_snap(path, i);
+    if (packed->num_attack_ticks == 0 ||
+        snap->attack_tick !=
+            packed->attack_ticks[packed->num_attack_ticks - 1])
+      packed->attack_ticks[packed->num_attack_ticks++] = snap->attack_tick;
+    if (i % PACKED_ATTACK_BLOCK == 0)
+      packed->attack_bases[i / PACKED_ATTACK_BLOCK] =
+          packed->num_attack_ticks - 1;
+    const int attack = packed->num_attack_ticks - 1 -
+                       packed->attack_bases[i / PACKED_ATTACK_BLOCK];
+    packed_snap_t *record = &packed->records[i];
+    if (!pack_snap(snap, snap->tick - next_tick, attack, record)) {
+      memset(record, 0, sizeof(*record));
+      record->direction = PACKED_ESCAPE;
+      record->x = packed->num_escapes;
+      packed->escape_indices[packed->num_escapes] = i;
+      packed->escapes[packed->num_escapes++] = *snap;
+      next_tick = snap->tick;
+    }
+    next_tick++;
+  }
+  return packed;
+}
+
+void ghost_packed_path_free(ghost_packed_path_t *packed) {
+  if (!packed)
+    return;
+  free(packed->records);
+  free(packed->attack_ticks);
+  free(packed->attack_bases);
+  free(packed->escapes);
+  free(packed->escape_indices);
+  free(packed);
+}
+
+int ghost_packed_path_num_items(const ghost_packed_path_t *packed) {
+  return packed ? packed->num_items : 0;
+}
+
+size_t ghost_packed_path_bytes(const ghost_packed_path_t *packed) {
+  if (!packed)
+    return 0;
+  const size_t num_blocks =
+      ((size_t)packed->num_items + PACKED_ATTACK_BLOCK - 1) /
+      PACKED_ATTACK_BLOCK;
+  return sizeof(ghost_packed_path_t) +
+         (size_t)packed->num_items * sizeof(packed_snap_t) +
+         (size_t)packed->num_attack_ticks * sizeof(int) +
+         num_blocks * sizeof(int) +
+         (size_t)packed->num_escapes *
+             (sizeof(ghost_character_t) + sizeof(int));
+}
+
+// `next_tick` is the tick of the first record if it is stored unchanged.
+CODEC_INLINE void unpack_snaps_impl(const packed_snap_t *records,
+                                    const int *attack_ticks,
+                                    const int *attack_bases,
+                                    const ghost_character_t *escapes,
+                                    int first, int next_tick, int count,
+                                    ghost_character_t *out) {
+  for (int i = 0; i < count; i++) {
+    const packed_snap_t *record = &records[first + i];
+    ghost_character_t *snap = &out[i];
+    if (record->direction == PACKED_ESCAPE) {
+      *snap = escapes[record->x];
+      next_tick = snap->tick + 1;
+      continue;
+    }
+    snap->x = record->x;
+    snap->y = record->y;
+    snap->vel_x = record->vel_x;
+    snap->vel_y = record->vel_y;
+    snap->angle = record->angle;
+    snap->direction = record->direction;
+    snap->weapon = record->weapon;
+    snap->hook_state = record->hook_state;
+    snap->hook_x = record->x + record->hook_dx;
+    snap->hook_y = record->y + record->hook_dy;
+    snap->attack_tick =
+        attack_ticks[attack_bases[(first + i) / PACKED_ATTACK_BLOCK] +
+                     record->attack];
+    snap->tick = next_tick + record->tick_offset;
+    next_tick++;
+  }
+}
+
+static void unpack_snaps(const ghost_packed_path_t *packed, int first,
+                         int count, ghost_character_t *out) {
+  // Ticks continue from the last escape before `first`.
+  int lo = 0, hi = packed->num_escapes;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (packed->escape_indices[mid] < first)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  const int next_tick =
+      lo > 0 ? packed->escapes[lo - 1].tick +
+                   (first - packed->escape_indices[lo - 1])
+             : packed->tick_base + first;
+  unpack_snaps_impl(packed->records, packed->attack_ticks,
+                    packed->attack_bases, packed->escapes, first, next_tick,
+                    count, out);
+}
+
+int ghost_packed_path_get(const ghost_packed_path_t *packed, int index,
+                          ghost_character_t *out) {
+  if (!packed || !out || index < 0 || index >= packed->num_items)
+    return -1;
+  unpack_snaps(packed, index, 1, out);
+  return 0;
+}
+
+int ghost_packed_path_unpack(const ghost_packed_path_t *packed, int first,
+                             int count, ghost_character_t *out) {
+  if (!packed || !out || first < 0 || count < 0 ||
+      first > packed->num_items - count)
+    return -1;
+  unpack_snaps(packed, first, count, out);
+  return 0;
+}
+
 static void str_to_ints(int *ints, size_t num_ints, const char *str) {
   const size_t str_size = strlen(str) + 1;
 
@@ -709,385 +1610,2549 @@ static void reset_ghost(ghost_t *ghost) {
   ghost->playback_pos = -1;
 }
 
-ghost_t *ghost_load(const char *filename) {
-  ghost_loader_t loader = new_ghost_loader();
-  loader = init_ghost_loader(filename);
-  if (!loader.file)
-    return NULL;
+enum {
+  HOOK_RETRACTED = -1,
+  HOOK_FLYING = 4,
+  HOOK_GRABBED = 5,
+};
 
-  ghost_t *ghost = (ghost_t *)calloc(1, sizeof(ghost_t));
-  if (!ghost) {
-    close_ghost_loader(&loader);
-    return NULL;
-  }
-  ghost->path.chunk_size = 25 * 60;
+// Run statistics folded in by reader_next while each snapshot is still in
+// cache. The distance is summed in double so long runs do not drift.
+typedef struct run_stats_state_t {
+  ghost_run_stats_t stats;
+  double distance;
+  int first_tick;
+  ghost_character_t last;
+} run_stats_state_t;
 
-  const ghost_info_t *info = &loader.info;
+struct ghost_reader_t {
+  ghost_loader_t loader;
+  ghost_t meta;
+  int index;
+  bool found_skin;
+  bool no_tick;
+  bool error;
+  bool collect_stats;
+  run_stats_state_t run_stats;
+  // Files without ticks number their snapshots from 0. Their start tick is
+  // derived from the last attack tick change, as DDNet does.
+  int first_tick;
+  int no_tick_start;
+  int prev_attack_tick;
+};
 
-  reset_ghost(ghost);
-  set_ghost_path_size(&ghost->path, info->num_ticks);
-  if (ghost->path.num_items != info->num_ticks) {
-    fprintf(stderr, "ghost: Failed to allocate memory for path\n");
-    close_ghost_loader(&loader);
-    ghost_free(ghost);
-    return NULL;
+static void run_stats_reset(run_stats_state_t *state) {
+  memset(state, 0, sizeof(*state));
+}
+
+CODEC_INLINE void run_stats_add(run_stats_state_t *state,
+                                const ghost_character_t *snap) {
+  ghost_run_stats_t *stats = &state->stats;
+  const ghost_character_t *last = &state->last;
+  if (stats->num_ticks == 0) {
+    state->first_tick = snap->tick;
+    stats->min_x = stats->max_x = snap->x;
+    stats->min_y = stats->max_y = snap->y;
+    stats->hook_count = snap->hook_state >= HOOK_FLYING;
+  } else {
+    const double dx = (double)snap->x - last->x;
+    const double dy = (double)snap->y - last->y;
+    const double step = sqrt(dx * dx + dy * dy);
+    const int gap = snap->tick - last->tick;
+    const float speed = (float)(gap > 1 ? step / gap : step);
+    state->distance += step;
+    if (speed > stats->max_speed)
+      stats->max_speed = speed;
+    stats->air_ticks += snap->y != last->y;
+    stats->hook_count +=
+        snap->hook_state >= HOOK_FLYING && last->hook_state < HOOK_FLYING;
+    stats->weapon_switches += snap->weapon != last->weapon;
+    if (snap->x < stats->min_x)
+      stats->min_x = snap->x;
+    if (snap->x > stats->max_x)
+      stats->max_x = snap->x;
+    if (snap->y < stats->min_y)
+      stats->min_y = snap->y;
+    if (snap->y > stats->max_y)
+      stats->max_y = snap->y;
   }
+  stats->num_ticks++;
+  state->last = *snap;
+}
 
-  strcpy(ghost->player, info->owner);
-  strcpy(ghost->map, info->map);
-  ghost->time = info->time;
+static void run_stats_get(const run_stats_state_t *state,
+                          ghost_run_stats_t *stats) {
+  *stats = state->stats;
+  stats->distance = (float)state->distance;
+  const int elapsed = state->last.tick - state->first_tick;
+  stats->mean_speed = elapsed > 0 ? (float)(state->distance / elapsed) : 0.0f;
+}
 
-  int index = 0;
-  bool found_skin = false;
-  bool no_tick = false;
-  bool error = false;
+static void init_reader_state(ghost_reader_t *reader) {
+  memset(&reader->meta, 0, sizeof(reader->meta));
+
+  const ghost_info_t *info = &reader->loader.info;
+  strcpy(reader->meta.player, info->owner);
+  strcpy(reader->meta.map, info->map);
+  reader->meta.time = info->time;
+  reader->meta.start_tick = -1;
+  reader->meta.playback_pos = -1;
+  reader->index = 0;
+  reader->found_skin = false;
+  reader->no_tick = false;
+  reader->error = false;
+  reader->collect_stats = false;
+  reader->first_tick = 0;
+  reader->no_tick_start = 0;
+  reader->prev_attack_tick = 0;
+  run_stats_reset(&reader->run_stats);
+}
 
-  int type;
-  while (!error && read_next_type(&loader, &type)) {
-    if (index == info->num_ticks &&
-        (type == GHOSTDATA_TYPE_CHARACTER ||
-         type == GHOSTDATA_TYPE_CHARACTER_NO_TICK)) {
-      error = true;
-      break;
-    }
+static bool init_ghost_reader(ghost_reader_t *reader, const char *filename) {
+  if (!init_ghost_loader(&reader->loader, filename))
+    return false;
+  init_reader_state(reader);
+  return true;
+}
 
-    if (type == GHOSTDATA_TYPE_SKIN && !found_skin) {
-      found_skin = true;
-      if (read_data(&loader, type, &ghost->skin, sizeof(ghost_skin_t) - 24))
-        error = true;
-      else {
-        ints_to_str(ghost->skin.skin, 6, ghost->skin.skin_name, 24);
-      }
+static bool init_ghost_reader_mem(ghost_reader_t *reader, const void *data,
+                                  size_t size) {
+  if (!init_ghost_loader_mem(&reader->loader, data, size))
+    return false;
+  init_reader_state(reader);
+  return true;
+}
 
-    } else if (type == GHOSTDATA_TYPE_CHARACTER_NO_TICK) {
-      no_tick = true;
-      if (read_data(&loader, type, ghost_get_snap(&ghost->path, index++),
-                    sizeof(ghost_character_t) - sizeof(int)))
-        error = true;
-    } else if (type == GHOSTDATA_TYPE_CHARACTER) {
-      if (read_data(&loader, type, ghost_get_snap(&ghost->path, index++),
-                    sizeof(ghost_character_t)))
-        error = true;
-    } else if (type == GHOSTDATA_TYPE_START_TICK) {
-      if (read_data(&loader, type, &ghost->start_tick, sizeof(int)))
-        error = true;
+// Reads the current item of `type` into the reader's metadata or `snap`.
+// Returns true if it was a snapshot; failures set `reader->error`.
+static bool reader_item(ghost_reader_t *reader, int type,
+                        ghost_character_t *snap) {
+  ghost_loader_t *loader = &reader->loader;
+  if (reader->index == loader->info.num_ticks &&
+      (type == GHOSTDATA_TYPE_CHARACTER ||
+       type == GHOSTDATA_TYPE_CHARACTER_NO_TICK)) {
+    loader->error = GHOST_VERIFY_ERROR_TOO_MANY_TICKS;
+    reader->error = true;
+    return false;
+  }
+
+  if (type == GHOSTDATA_TYPE_SKIN && !reader->found_skin) {
+    reader->found_skin = true;
+    if (read_data(loader, type, &reader->meta.skin, sizeof(ghost_skin_t) - 24))
+      reader->error = true;
+    else
+      ints_to_str(reader->meta.skin.skin, 6, reader->meta.skin.skin_name, 24);
+  } else if (type == GHOSTDATA_TYPE_CHARACTER_NO_TICK) {
+    reader->no_tick = true;
+    if (read_data(loader, type, snap,
+                  sizeof(ghost_character_t) - sizeof(int))) {
+      reader->error = true;
+    } else {
+      if (reader->index > 0 && snap->attack_tick != reader->prev_attack_tick)
+        reader->no_tick_start = snap->attack_tick - reader->index;
+      reader->prev_attack_tick = snap->attack_tick;
+      snap->tick = reader->index++;
+      if (reader->collect_stats)
+        run_stats_add(&reader->run_stats, snap);
+      return true;
     }
+  } else if (type == GHOSTDATA_TYPE_CHARACTER) {
+    if (read_data(loader, type, snap, sizeof(ghost_character_t))) {
+      reader->error = true;
+    } else {
+      if (reader->index == 0)
+        reader->first_tick = snap->tick;
+      reader->index++;
+      if (reader->collect_stats)
+        run_stats_add(&reader->run_stats, snap);
+      return true;
+    }
+  } else if (type == GHOSTDATA_TYPE_START_TICK) {
+    if (read_data(loader, type, &reader->meta.start_tick, sizeof(int)))
+      reader->error = true;
   }
+  return false;
+}
+
+// Called once all snapshots were read. Files without a start tick item get
+// the tick of their first snapshot, the same value ghost_load reports.
+static void reader_finish(ghost_reader_t *reader) {
+  if (reader->meta.start_tick == -1 && reader->index > 0)
+    reader->meta.start_tick =
+        reader->no_tick ? reader->no_tick_start : reader->first_tick;
+}
+
+static int reader_next(ghost_reader_t *reader, ghost_character_t *snap) {
+  ghost_loader_t *loader = &reader->loader;
+  const int num_ticks = loader->info.num_ticks;
 
-  close_ghost_loader(&loader);
+  int type;
+  while (!reader->error && read_next_type(loader, &type)) {
+    if (reader_item(reader, type, snap))
+      return 1;
+  }
 
-  if (error || index != info->num_ticks) {
+  if (reader->error || reader->index != num_ticks) {
     fprintf(stderr,
             "ghost: Failed to read all ghost data (error='%d', got '%d' ticks, "
             "wanted '%d' ticks)\n",
-            error, index, info->num_ticks);
-    ghost_free(ghost);
-    return NULL;
+            reader->error, reader->index, num_ticks);
+    if (loader->error == GHOST_VERIFY_OK)
+      loader->error = GHOST_VERIFY_ERROR_TRUNCATED;
+    reader->error = true;
+    return -1;
   }
+  reader_finish(reader);
+  return 0;
+}
 
-  if (no_tick) {
-    int start_tick = 0;
-    for (int i = 1; i < info->num_ticks; i++)
-      if (ghost_get_snap(&ghost->path, i)->attack_tick !=
-          ghost_get_snap(&ghost->path, i - 1)->attack_tick)
-        start_tick = ghost_get_snap(&ghost->path, i)->attack_tick - i;
-    for (int i = 0; i < info->num_ticks; i++)
-      ghost_get_snap(&ghost->path, i - 1)->tick = start_tick + i;
+ghost_reader_t *ghost_reader_open(const char *filename) {
+  ghost_reader_t *reader = (ghost_reader_t *)malloc(sizeof(ghost_reader_t));
+  if (!reader)
+    return NULL;
+  if (!init_ghost_reader(reader, filename)) {
+    free(reader);
+    return NULL;
   }
+  return reader;
+}
 
-  if (ghost->start_tick == -1 && ghost->path.num_items > 0)
-    ghost->start_tick = ghost_get_snap(&ghost->path, 0)->tick;
-
-  if (!found_skin) {
-    ghost_set_skin(ghost, "default", 0, 0, 0);
+ghost_reader_t *ghost_reader_open_mem(const void *data, size_t size) {
+  if (!data)
+    return NULL;
+  ghost_reader_t *reader = (ghost_reader_t *)malloc(sizeof(ghost_reader_t));
+  if (!reader)
+    return NULL;
+  if (!init_ghost_reader_mem(reader, data, size)) {
+    free(reader);
+    return NULL;
   }
-
-  return ghost;
+  return reader;
 }
 
-void ghost_free(ghost_t *ghost) {
-  if (!ghost)
-    return;
-  reset_ghost_path(&ghost->path);
-  free(ghost);
+int ghost_reader_enable_stats(ghost_reader_t *reader) {
+  if (!reader || reader->index > 0)
+    return -1;
+  reader->collect_stats = true;
+  return 0;
 }
 
-int huffman_compress(const huffman_context_t *ctx, const void *input,
-                     int in_size, void *output, int out_size) {
-  const unsigned char *src = (const unsigned char *)input;
-  const unsigned char *src_end = src + in_size;
-  unsigned char *dst = (unsigned char *)output;
-  unsigned char *dst_end = dst + out_size;
+int ghost_reader_next(ghost_reader_t *reader, ghost_character_t *snap) {
+  if (!reader || !snap || !reader->loader.file)
+    return -1;
+  return reader_next(reader, snap);
+}
 
-  unsigned bits = 0;
-  unsigned bitcount = 0;
+int ghost_reader_num_ticks(const ghost_reader_t *reader) {
+  return reader ? reader->loader.info.num_ticks : 0;
+}
 
-  if (in_size == 0) {
-    const huffman_node_t *node = &ctx->nodes[HUFFMAN_EOF_SYMBOL];
-    bits |= (unsigned)node->bits << bitcount;
-    bitcount += node->num_bits;
+const ghost_t *ghost_reader_meta(const ghost_reader_t *reader) {
+  return reader ? &reader->meta : NULL;
+}
 
-    while (bitcount >= 8) {
-      if (dst >= dst_end)
-        return -1;
-      *dst++ = bits & 0xff;
-      bits >>= 8;
-      bitcount -= 8;
-    }
-    if (dst >= dst_end)
-      return -1;
-    *dst++ = bits & 0xff;
-    return (int)(dst - (unsigned char *)output);
-  }
+int ghost_reader_has_ticks(const ghost_reader_t *reader) {
+  return reader && !reader->no_tick;
+}
 
-  int symbol = *src++;
+int ghost_reader_stats(const ghost_reader_t *reader, ghost_run_stats_t *stats) {
+  if (!reader || !stats || !reader->collect_stats)
+    return -1;
+  run_stats_get(&reader->run_stats, stats);
+  return 0;
+}
 
-  while (src != src_end) {
-    const huffman_node_t *node = &ctx->nodes[symbol];
-    bits |= (unsigned)node->bits << bitcount;
-    bitcount += node->num_bits;
+void ghost_reader_close(ghost_reader_t *reader) {
+  if (!reader)
+    return;
+  close_ghost_loader(&reader->loader);
+  free(reader);
+}
 
-    symbol = *src++;
+enum {
+  CHUNK_HEADER_SIZE = 4,
+  OLD_HEADER_SIZE = sizeof(ghost_header_t) - sizeof(sha256_digest_t),
+};
 
-    while (bitcount >= 8) {
-      if (dst >= dst_end)
-        return -1;
-      *dst++ = (unsigned char)(bits & 0xff);
-      bits >>= 8;
-      bitcount -= 8;
-    }
-  }
+// Push-mode reader. Only the header or chunk currently arriving is kept in
+// `pending`; each complete chunk is decoded through the reader's loader,
+// which sees it as a memory stream holding exactly that chunk.
+struct ghost_decoder_t {
+  ghost_reader_t reader;
+  ghost_decoder_snap_fn on_snap;
+  void *user_data;
+  bool has_header;
+  bool failed;
+  bool collect_stats;
+  size_t pending_size;
+  unsigned char pending[CHUNK_HEADER_SIZE + MAX_CHUNK_SIZE];
+};
 
-  const huffman_node_t *last_node = &ctx->nodes[symbol];
-  bits |= (unsigned)last_node->bits << bitcount;
-  bitcount += last_node->num_bits;
-  while (bitcount >= 8) {
-    if (dst >= dst_end)
-      return -1;
-    *dst++ = (unsigned char)(bits & 0xff);
-    bits >>= 8;
-    bitcount -= 8;
-  }
+ghost_decoder_t *ghost_decoder_create(ghost_decoder_snap_fn on_snap,
+                                      void *user_data) {
+  ghost_decoder_t *decoder =
+      (ghost_decoder_t *)calloc(1, sizeof(ghost_decoder_t));
+  if (!decoder)
+    return NULL;
+  decoder->on_snap = on_snap;
+  decoder->user_data = user_data;
+  decoder->reader.loader.error = GHOST_VERIFY_OK;
+  return decoder;
+}
 
-  const huffman_node_t *eof_node = &ctx->nodes[HUFFMAN_EOF_SYMBOL];
-  bits |= (unsigned)eof_node->bits << bitcount;
-  bitcount += eof_node->num_bits;
-  while (bitcount >= 8) {
-    if (dst >= dst_end)
-      return -1;
-    *dst++ = (unsigned char)(bits & 0xff);
-    bits >>= 8;
-    bitcount -= 8;
-  }
+void ghost_decoder_free(ghost_decoder_t *decoder) { free(decoder); }
 
-  if (dst >= dst_end)
+int ghost_decoder_enable_stats(ghost_decoder_t *decoder) {
+  if (!decoder || (decoder->has_header && decoder->reader.index > 0))
     return -1;
-  *dst++ = bits;
-
-  return (int)(dst - (unsigned char *)output);
+  decoder->collect_stats = true;
+  decoder->reader.collect_stats = true;
+  return 0;
 }
 
-static unsigned char *var_pack(unsigned char *dst, int i, int dst_size) {
-  if (dst_size <= 0)
-    return NULL;
+static int decoder_fail(ghost_decoder_t *decoder, int error) {
+  if (decoder->reader.loader.error == GHOST_VERIFY_OK)
+    decoder->reader.loader.error = error;
+  decoder->failed = true;
+  return -1;
+}
 
-  dst_size--;
-  *dst = 0;
-  if (i < 0) {
-    *dst |= 0x40;
-    i = ~i;
+// Bytes `pending` must hold before the decoder can move on. Version 6 and 7
+// headers end with the map's SHA-256, older ones do not, so the header is
+// read up to the version byte first.
+static size_t decoder_wanted(const ghost_decoder_t *decoder) {
+  const size_t version_offset = offsetof(ghost_header_t, version);
+  if (!decoder->has_header) {
+    if (decoder->pending_size <= version_offset)
+      return version_offset + 1;
+    return decoder->pending[version_offset] < 6 ? OLD_HEADER_SIZE
+                                                : sizeof(ghost_header_t);
   }
+  if (decoder->pending_size < CHUNK_HEADER_SIZE)
+    return CHUNK_HEADER_SIZE;
+  return CHUNK_HEADER_SIZE +
+         ((decoder->pending[2] << 8) | decoder->pending[3]);
+}
 
-  *dst |= i & 0x3F;
-  i >>= 6;
+static int decoder_header(ghost_decoder_t *decoder) {
+  // Old headers are padded to the full size; the loader steps back over the
+  // missing digest.
+  unsigned char header[sizeof(ghost_header_t)];
+  memset(header, 0, sizeof(header));
+  memcpy(header, decoder->pending, decoder->pending_size);
+  ghost_reader_t *reader = &decoder->reader;
+  if (!init_ghost_reader_mem(reader, header, sizeof(header)))
+    return decoder_fail(decoder, reader->loader.error);
+  strcpy(reader->loader.filename, "<stream>");
+  reader->collect_stats = decoder->collect_stats;
+  decoder->has_header = true;
+  decoder->pending_size = 0;
+  return 0;
+}
 
-  while (i) {
-    if (dst_size <= 0)
-      return NULL;
-    *dst |= 0x80;
-    dst_size--;
-    dst++;
-    *dst = i & 0x7F;
-    i >>= 7;
-  }
+static int decoder_chunk(ghost_decoder_t *decoder) {
+  ghost_reader_t *reader = &decoder->reader;
+  ghost_loader_t *loader = &reader->loader;
+  loader->mem.data = decoder->pending;
+  loader->mem.size = decoder->pending_size;
+  loader->mem.pos = 0;
+  decoder->pending_size = 0;
 
-  dst++;
-  return dst;
+  // The stream ends with the chunk, so the loop stops after its last item.
+  int type;
+  ghost_character_t snap;
+  while (!reader->error && read_next_type(loader, &type)) {
+    if (reader_item(reader, type, &snap) && decoder->on_snap)
+      decoder->on_snap(decoder->user_data, &snap);
+  }
+  if (reader->error || loader->error != GHOST_VERIFY_OK)
+    return decoder_fail(decoder, GHOST_VERIFY_ERROR_DECOMPRESS);
+  return 0;
 }
 
-static long var_compress(const void *src_void, int src_size, void *dst_void,
-                         int dst_size) {
-  if (src_size % sizeof(int) != 0) {
-    return -1;
+// Called whenever `pending` holds what decoder_wanted asked for.
+static int decoder_advance(ghost_decoder_t *decoder) {
+  if (!decoder->has_header) {
+    if (memcmp(decoder->pending, header_marker, sizeof(header_marker)) != 0) {
+      fprintf(stderr,
+              "ghost_decoder: Failed to read upload: invalid header marker\n");
+      return decoder_fail(decoder, GHOST_VERIFY_ERROR_MARKER);
+    }
+    if (decoder->pending_size < decoder_wanted(decoder))
+      return 0;
+    return decoder_header(decoder);
   }
+  if (decoder->pending_size > CHUNK_HEADER_SIZE)
+    return decoder_chunk(decoder);
+
+  const size_t wanted = decoder_wanted(decoder);
+  if (wanted == CHUNK_HEADER_SIZE ||
+      wanted > CHUNK_HEADER_SIZE + MAX_CHUNK_SIZE) {
+    fprintf(stderr, "ghost_decoder: Failed to read upload: invalid chunk "
+                    "header size\n");
+    return decoder_fail(decoder, GHOST_VERIFY_ERROR_CHUNK_SIZE);
+  }
+  return 0;
+}
 
-  const int *src = (const int *)src_void;
-  const int *src_end = src + src_size / sizeof(int);
-  unsigned char *dst = (unsigned char *)dst_void;
-  const unsigned char *dst_start = (const unsigned char *)dst_void;
-  const unsigned char *dst_end = dst + dst_size;
+int ghost_decoder_feed(ghost_decoder_t *decoder, const void *data,
+                       size_t size) {
+  if (!decoder || decoder->failed || (!data && size > 0))
+    return -1;
 
-  while (src < src_end) {
-    dst = var_pack(dst, *src, dst_end - dst);
-    if (!dst)
+  const unsigned char *bytes = (const unsigned char *)data;
+  while (size > 0) {
+    const size_t wanted = decoder_wanted(decoder);
+    size_t take = wanted - decoder->pending_size;
+    if (take > size)
+      take = size;
+    memcpy(decoder->pending + decoder->pending_size, bytes, take);
+    decoder->pending_size += take;
+    bytes += take;
+    size -= take;
+
+    if (decoder->pending_size == wanted && decoder_advance(decoder) != 0)
       return -1;
-    src++;
   }
-
-  return (long)(dst - dst_start);
+  return 0;
 }
 
-static void diff_item(const uint32_t *past, const uint32_t *current,
-                      uint32_t *out, size_t size) {
-  while (size) {
-    *out = *current - *past;
-    out++;
-    past++;
-    current++;
-    size--;
+int ghost_decoder_finish(ghost_decoder_t *decoder) {
+  if (!decoder || decoder->failed)
+    return -1;
+  ghost_reader_t *reader = &decoder->reader;
+  if (!decoder->has_header || decoder->pending_size > 0 ||
+      reader->index != reader->loader.info.num_ticks) {
+    fprintf(stderr,
+            "ghost_decoder: Upload ended early (got '%d' ticks, wanted '%d' "
+            "ticks)\n",
+            reader->index, decoder->has_header ? reader->loader.info.num_ticks
+                                               : 0);
+    return decoder_fail(decoder, GHOST_VERIFY_ERROR_TRUNCATED);
   }
+  reader_finish(reader);
+  return 0;
 }
 
-static void uint_to_bytes_be(unsigned char *bytes, unsigned val) {
-  bytes[0] = (val >> 24) & 0xff;
-  bytes[1] = (val >> 16) & 0xff;
-  bytes[2] = (val >> 8) & 0xff;
-  bytes[3] = val & 0xff;
+int ghost_decoder_error(const ghost_decoder_t *decoder) {
+  return decoder ? decoder->reader.loader.error : GHOST_VERIFY_ERROR_IO;
 }
 
-typedef struct ghost_saver_t {
-  FILE *file;
-  char filename[IO_MAX_PATH_LENGTH];
-  huffman_context_t *huffman;
+int ghost_decoder_num_ticks(const ghost_decoder_t *decoder) {
+  return decoder ? decoder->reader.index : 0;
+}
 
-  unsigned char buffer[MAX_CHUNK_SIZE];
+const ghost_t *ghost_decoder_meta(const ghost_decoder_t *decoder) {
+  return decoder && decoder->has_header ? &decoder->reader.meta : NULL;
+}
 
-  unsigned char buffer_temp[MAX_CHUNK_SIZE * 2];
-  unsigned char compress_buffer[MAX_CHUNK_SIZE * 2];
+int ghost_decoder_stats(const ghost_decoder_t *decoder,
+                        ghost_run_stats_t *stats) {
+  if (!decoder || !stats || !decoder->collect_stats)
+    return -1;
+  run_stats_get(&decoder->reader.run_stats, stats);
+  return 0;
+}
 
-  unsigned char *buffer_pos;
-  int buffer_num_items;
+// Fills `stats`, if it is set, in the same pass that decodes the path.
+static ghost_t *load_ghost(ghost_reader_t *reader, ghost_run_stats_t *stats) {
+  reader->collect_stats = stats != NULL;
+  ghost_t *ghost = (ghost_t *)calloc(1, sizeof(ghost_t));
+  if (!ghost) {
+    close_ghost_loader(&reader->loader);
+    return NULL;
+  }
+  ghost->path.chunk_size = 25 * 60;
 
-  ghost_item_t last_item;
-} ghost_saver_t;
+  const ghost_info_t *info = &reader->loader.info;
 
-static void reset_saver_buffer(ghost_saver_t *saver) {
-  saver->buffer_pos = saver->buffer;
-  saver->buffer_num_items = 0;
-}
+  reset_ghost(ghost);
+  set_ghost_path_size(&ghost->path, info->num_ticks);
+  if (ghost->path.num_items != info->num_ticks) {
+    fprintf(stderr, "ghost: Failed to allocate memory for path\n");
+    close_ghost_loader(&reader->loader);
+    ghost_free(ghost);
+    return NULL;
+  }
 
-static bool flush_chunk(ghost_saver_t *saver) {
-  if (saver->buffer_num_items == 0)
-    return true;
+  int index = 0;
+  int result;
+  while ((result = reader_next(reader, ghost_get_snap(&ghost->path, index))) ==
+         1)
+    index++;
 
-  int raw_size = (int)((unsigned char *)saver->buffer_pos -
-                       (unsigned char *)saver->buffer);
+  close_ghost_loader(&reader->loader);
 
-  if (raw_size == 0) {
-    reset_saver_buffer(saver);
-    saver->last_item.type = -1;
-    return true;
+  if (result != 0) {
+    ghost_free(ghost);
+    return NULL;
   }
 
-  long var_size = var_compress(saver->buffer, raw_size, saver->buffer_temp,
-                               sizeof(saver->buffer_temp));
-  if (var_size < 0) {
-    fprintf(
-        stderr,
-        "ghost_saver: Failed to write ghost file '%s': varcompress failed\n",
-        saver->filename);
-    return false;
+  strcpy(ghost->player, reader->meta.player);
+  strcpy(ghost->map, reader->meta.map);
+  ghost->time = reader->meta.time;
+  ghost->skin = reader->meta.skin;
+  ghost->start_tick = reader->meta.start_tick;
+
+  if (reader->no_tick) {
+    for (int i = 0; i < info->num_ticks; i++)
+      ghost_get_snap(&ghost->path, i)->tick = reader->no_tick_start + i;
   }
 
-  int compressed_size =
-      huffman_compress(saver->huffman, saver->buffer_temp, (int)var_size,
-                       saver->compress_buffer, sizeof(saver->compress_buffer));
-  if (compressed_size < 0) {
-    fprintf(stderr,
+  if (!reader->found_skin) {
+    ghost_set_skin(ghost, "default", 0, 0, 0);
+  }
+
+  if (stats)
+    run_stats_get(&reader->run_stats, stats);
+  return ghost;
+}
+
+ghost_t *ghost_load(const char *filename) {
+  ghost_reader_t reader;
+  if (!init_ghost_reader(&reader, filename))
+    return NULL;
+  return load_ghost(&reader, NULL);
+}
+
+ghost_t *ghost_load_mem(const void *data, size_t size) {
+  if (!data)
+    return NULL;
+  ghost_reader_t reader;
+  if (!init_ghost_reader_mem(&reader, data, size))
+    return NULL;
+  return load_ghost(&reader, NULL);
+}
+
+ghost_t *ghost_load_stats(const char *filename, ghost_run_stats_t *stats) {
+  ghost_reader_t reader;
+  if (!init_ghost_reader(&reader, filename))
+    return NULL;
+  return load_ghost(&reader, stats);
+}
+
+ghost_t *ghost_load_stats_mem(const void *data, size_t size,
+                              ghost_run_stats_t *stats) {
+  if (!data)
+    return NULL;
+  ghost_reader_t reader;
+  if (!init_ghost_reader_mem(&reader, data, size))
+    return NULL;
+  return load_ghost(&reader, stats);
+}
+
+static int run_stats_reader(ghost_reader_t *reader, ghost_run_stats_t *stats) {
+  reader->collect_stats = true;
+  ghost_character_t snap;
+  int status;
+  while ((status = reader_next(reader, &snap)) == 1)
+    ;
+  close_ghost_loader(&reader->loader);
+  if (status != 0)
+    return -1;
+  run_stats_get(&reader->run_stats, stats);
+  return 0;
+}
+
+int ghost_run_stats_file(const char *filename, ghost_run_stats_t *stats) {
+  if (!stats)
+    return -1;
+  ghost_reader_t reader;
+  if (!init_ghost_reader(&reader, filename))
+    return -1;
+  return run_stats_reader(&reader, stats);
+}
+
+int ghost_run_stats_mem(const void *data, size_t size,
+                        ghost_run_stats_t *stats) {
+  if (!data || !stats)
+    return -1;
+  ghost_reader_t reader;
+  if (!init_ghost_reader_mem(&reader, data, size))
+    return -1;
+  return run_stats_reader(&reader, stats);
+}
+
+static const char *const verify_error_strings[GHOST_VERIFY_NUM_ERRORS] = {
+    "ok",
+    "file could not be read",
+    "invalid header marker",
+    "unsupported version",
+    "unknown huffman table",
+    "invalid player or map name",
+    "invalid number of ticks",
+    "invalid time",
+    "invalid chunk size",
+    "file is truncated",
+    "chunk could not be decompressed",
+    "chunk item size mismatch",
+    "more snapshots than ticks",
+};
+
+const char *ghost_verify_error_string(int error) {
+  if (error < 0 || error >= GHOST_VERIFY_NUM_ERRORS)
+    return "unknown error";
+  return verify_error_strings[error];
+}
+
+// FNV-1a taking a whole field per step, which keeps the hash from costing as
+// much as the decode itself.
+static const uint64_t fnv_offset_basis = 0xcbf29ce484222325ull;
+
+static uint64_t fnv1a_64(uint64_t hash, const int *fields, int num_fields) {
+  for (int i = 0; i < num_fields; i++)
+    hash = (hash ^ (uint32_t)fields[i]) * 0x100000001b3ull;
+  return hash;
+}
+
+// Runs the reader over a single snapshot; the start tick is the one ghost_load
+// reports.
+static int verify_ghost(ghost_reader_t *reader, ghost_verify_result_t *result) {
+  ghost_loader_t *loader = &reader->loader;
+  uint64_t hash = fnv_offset_basis;
+  ghost_character_t snap;
+  int status;
+  while ((status = reader_next(reader, &snap)) == 1)
+    hash = fnv1a_64(hash, (const int *)&snap, NUM_CHARACTER_FIELDS - 1);
+  close_ghost_loader(loader);
+
+  result->version = loader->header.version;
+  result->num_ticks = loader->info.num_ticks;
+  if (status != 0) {
+    result->error = loader->error;
+    result->offset = loader->chunk_offset;
+    return -1;
+  }
+
+  result->start_tick = reader->meta.start_tick;
+  result->hash = fnv1a_64(hash, &reader->meta.start_tick, 1);
+  return 0;
+}
+
+uint64_t ghost_hash(const ghost_t *ghost) {
+  if (!ghost)
+    return 0;
+  uint64_t hash = fnv_offset_basis;
+  for (int i = 0; i < ghost->path.num_items; i++)
+    hash = fnv1a_64(hash, (const int *)ghost_get_snap(&ghost->path, i),
+                    NUM_CHARACTER_FIELDS - 1);
+  return fnv1a_64(hash, &ghost->start_tick, 1);
+}
+
+static void reset_verify_result(ghost_verify_result_t *result) {
+  memset(result, 0, sizeof(*result));
+  result->offset = -1;
+  result->start_tick = -1;
+}
+
+int ghost_verify(const char *filename, ghost_verify_result_t *result) {
+  if (!filename || !result)
+    return -1;
+  reset_verify_result(result);
+
+  ghost_reader_t reader;
+  if (!init_ghost_reader(&reader, filename)) {
+    result->error = reader.loader.error;
+    return -1;
+  }
+  return verify_ghost(&reader, result);
+}
+
+int ghost_verify_mem(const void *data, size_t size,
+                     ghost_verify_result_t *result) {
+  if (!result)
+    return -1;
+  reset_verify_result(result);
+  if (!data) {
+    result->error = GHOST_VERIFY_ERROR_IO;
+    return -1;
+  }
+
+  ghost_reader_t reader;
+  if (!init_ghost_reader_mem(&reader, data, size)) {
+    result->error = reader.loader.error;
+    return -1;
+  }
+  return verify_ghost(&reader, result);
+}
+
+// Coordinates and velocities are clamped before taking differences so that
+// nothing overflows; anything clamped is far beyond every threshold anyway.
+#define SCAN_COORD_LIMIT (1 << 29)
+#define SCAN_DELTA_LIMIT (1 << 21)
+// Aim angles are sent in 1/256 radians between -pi/2 and 3pi/2.
+#define SCAN_ANGLE_MIN (-403)
+#define SCAN_ANGLE_MAX 1207
+#define SCAN_ANGLE_CIRCLE 1608
+
+enum { SCAN_BLOCK = 256 };
+
+// Hook states a hook can be in one tick after each state (-1 to 5, then
+// invalid ones), as bits of the state plus one. Releasing always returns to
+// idle and the retract states count up to retracted. Bit 7 stands for
+// invalid states, which are flagged on their own.
+static const int hook_transitions[8] = {0x83, 0xE7, 0x8A, 0x92,
+                                        0x83, 0xE7, 0xC3, 0xFF};
+
+CODEC_INLINE int clamp_int(int value, int min, int max) {
+  return value < min ? min : value > max ? max : value;
+}
+
+CODEC_INLINE int hook_state_index(int hook_state) {
+  return hook_state < HOOK_RETRACTED || hook_state > HOOK_GRABBED
+             ? 7
+             : hook_state + 1;
+}
+
+CODEC_INLINE bool hook_attached(int hook_state) {
+  return hook_state == HOOK_FLYING || hook_state == HOOK_GRABBED;
+}
+
+// Checks that need only one snapshot.
+CODEC_INLINE int scan_snap(const ghost_character_t *snap,
+                           const scan_limits_t *limits) {
+  int flags = 0;
+  const int vel_x =
+      abs(clamp_int(snap->vel_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  const int vel_y =
+      abs(clamp_int(snap->vel_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  if (vel_x > limits->max_velocity || vel_y > limits->max_velocity)
+    flags |= GHOST_SCAN_VELOCITY;
+  if (snap->angle < SCAN_ANGLE_MIN || snap->angle > SCAN_ANGLE_MAX)
+    flags |= GHOST_SCAN_ANGLE;
+  if (hook_state_index(snap->hook_state) == 7)
+    flags |= GHOST_SCAN_HOOK;
+  if ((limits->check_attack_tick & 1) && snap->attack_tick > snap->tick)
+    flags |= GHOST_SCAN_ATTACK;
+  return flags;
+}
+
+CODEC_INLINE int scan_pair(const ghost_character_t *a,
+                           const ghost_character_t *b,
+                           const scan_limits_t *limits) {
+  int flags = scan_snap(b, limits);
+  const int dt = (int)((uint32_t)b->tick - (uint32_t)a->tick);
+  if (dt < 1 || dt > limits->max_tick_gap)
+    flags |= GHOST_SCAN_TICK_GAP;
+  if (b->attack_tick < a->attack_tick)
+    flags |= GHOST_SCAN_ATTACK;
+  if (dt != 1)
+    return flags;
+
+  const int dx = clamp_int(b->x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT) -
+                 clamp_int(a->x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+  const int dy = clamp_int(b->y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT) -
+                 clamp_int(a->y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+  if (abs(dx) > limits->max_step || abs(dy) > limits->max_step)
+    flags |= GHOST_SCAN_TELEPORT;
+
+  const int error_x =
+      abs(clamp_int(dx, -SCAN_DELTA_LIMIT, SCAN_DELTA_LIMIT) * 256 -
+          clamp_int(b->vel_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  const int error_y =
+      abs(clamp_int(dy, -SCAN_DELTA_LIMIT, SCAN_DELTA_LIMIT) * 256 -
+          clamp_int(b->vel_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  if (error_x > limits->max_velocity_error ||
+      error_y > limits->max_velocity_error)
+    flags |= GHOST_SCAN_VELOCITY;
+
+  int angle_step =
+      abs(clamp_int(b->angle, SCAN_ANGLE_MIN, SCAN_ANGLE_MAX) -
+          clamp_int(a->angle, SCAN_ANGLE_MIN, SCAN_ANGLE_MAX));
+  if (SCAN_ANGLE_CIRCLE - angle_step < angle_step)
+    angle_step = SCAN_ANGLE_CIRCLE - angle_step;
+  if (angle_step > limits->max_angle_step)
+    flags |= GHOST_SCAN_ANGLE;
+
+  if (!((hook_transitions[hook_state_index(a->hook_state)] >>
+         hook_state_index(b->hook_state)) &
+        1))
+    flags |= GHOST_SCAN_HOOK;
+  if (hook_attached(a->hook_state) && hook_attached(b->hook_state)) {
+    const int hook_dx =
+        clamp_int(b->hook_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT) -
+        clamp_int(a->hook_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    const int hook_dy =
+        clamp_int(b->hook_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT) -
+        clamp_int(a->hook_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    if (abs(hook_dx) > limits->max_hook_step ||
+        abs(hook_dy) > limits->max_hook_step)
+      flags |= GHOST_SCAN_HOOK;
+  }
+  return flags;
+}
+
+// Flags of the pairs (snaps[i], snaps[i + 1]) for the `count - 1` pairs.
+// Returns all flags or-ed together.
+CODEC_INLINE int scan_pairs_impl(const ghost_character_t *snaps, int count,
+                                 const scan_limits_t *limits, uint8_t *flags) {
+  int any = 0;
+  for (int i = 0; i + 1 < count; i++) {
+    flags[i] = (uint8_t)scan_pair(&snaps[i], &snaps[i + 1], limits);
+    any |= flags[i];
+  }
+  return any;
+}
+
+typedef struct scan_state_t {
+  scan_limits_t limits;
+  ghost_scan_range_t *ranges;
+  int max_ranges;
+  int num_ranges;
+  // Open range over snapshots [range_first, range_last]; range_last is -1
+  // while there is none.
+  ghost_scan_range_t range;
+  long range_last;
+  ghost_character_t last;
+  long num_snaps;
+} scan_state_t;
+
+static int scan_limit(int value) { return value < 0 ? INT32_MAX : value; }
+
+void ghost_scan_default_options(ghost_scan_options_t *options) {
+  if (!options)
+    return;
+  options->max_tick_gap = 1;
+  options->max_step = 256;
+  options->max_velocity = 6000 * 256;
+  options->max_velocity_error = 64 * 256;
+  options->max_angle_step = -1;
+  options->max_hook_step = 96;
+}
+
+static void init_scan_state(scan_state_t *state,
+                            const ghost_scan_options_t *options,
+                            ghost_scan_range_t *ranges, int max_ranges) {
+  ghost_scan_options_t defaults;
+  if (!options) {
+    ghost_scan_default_options(&defaults);
+    options = &defaults;
+  }
+  state->limits.max_tick_gap = scan_limit(options->max_tick_gap);
+  state->limits.max_step = scan_limit(options->max_step);
+  state->limits.max_velocity = scan_limit(options->max_velocity);
+  state->limits.max_velocity_error = scan_limit(options->max_velocity_error);
+  state->limits.max_angle_step = scan_limit(options->max_angle_step);
+  state->limits.max_hook_step = scan_limit(options->max_hook_step);
+  state->limits.check_attack_tick = -1;
+  state->ranges = ranges;
+  state->max_ranges = ranges ? max_ranges : 0;
+  state->num_ranges = 0;
+  state->range_last = -1;
+  state->num_snaps = 0;
+}
+
+static void scan_emit(scan_state_t *state) {
+  if (state->range_last < 0)
+    return;
+  if (state->num_ranges < state->max_ranges)
+    state->ranges[state->num_ranges] = state->range;
+  state->num_ranges++;
+  state->range_last = -1;
+}
+
+// Records flags for snapshots [first, last], extending the open range if it
+// reaches `first`.
+static void scan_flag(scan_state_t *state, long first, long last,
+                      int first_tick, int last_tick, int flags) {
+  if (state->range_last < first)
+    scan_emit(state);
+  if (state->range_last < 0) {
+    state->range.first_tick = first_tick;
+    state->range.flags = 0;
+  }
+  state->range.last_tick = last_tick;
+  state->range.flags |= flags;
+  state->range_last = last;
+}
+
+static void scan_block(scan_state_t *state, const ghost_character_t *snaps,
+                       int count) {
+  const codec_kernels_t *kernels = codec_kernels();
+  uint8_t flags[SCAN_BLOCK];
+  const long base = state->num_snaps;
+  if (count <= 0)
+    return;
+
+  if (base == 0) {
+    const int first = scan_snap(&snaps[0], &state->limits);
+    if (first)
+      scan_flag(state, 0, 0, snaps[0].tick, snaps[0].tick, first);
+  } else {
+    const ghost_character_t pair[2] = {state->last, snaps[0]};
+    if (kernels->scan_pairs(pair, 2, &state->limits, flags))
+      scan_flag(state, base - 1, base, state->last.tick, snaps[0].tick,
+                flags[0]);
+  }
+
+  for (int start = 0; start + 1 < count; start += SCAN_BLOCK) {
+    const int num =
+        count - start > SCAN_BLOCK + 1 ? SCAN_BLOCK + 1 : count - start;
+    if (!kernels->scan_pairs(snaps + start, num, &state->limits, flags))
+      continue;
+    for (int i = 0; i < num - 1; i++) {
+      if (flags[i])
+        scan_flag(state, base + start + i, base + start + i + 1,
+                  snaps[start + i].tick, snaps[start + i + 1].tick, flags[i]);
+    }
+  }
+  state->last = snaps[count - 1];
+  state->num_snaps += count;
+}
+
+int ghost_scan(const ghost_path_t *path, const ghost_scan_options_t *options,
+               ghost_scan_range_t *ranges, int max_ranges) {
+  if (!path || (path->num_items > 0 && !path->chunks))
+    return -1;
+
+  scan_state_t state;
+  init_scan_state(&state, options, ranges, max_ranges);
+  for (int first = 0; first < path->num_items; first += path->chunk_size) {
+    const int count = path->num_items - first < path->chunk_size
+                          ? path->num_items - first
+                          : path->chunk_size;
+    scan_block(&state, path->chunks[first / path->chunk_size], count);
+  }
+  scan_emit(&state);
+  return state.num_ranges;
+}
+
+// Ticks of files without them are snapshot indices, so attack ticks can
+// only be checked for running backwards.
+static int scan_reader(ghost_reader_t *reader, scan_state_t *state) {
+  ghost_character_t snaps[SCAN_BLOCK];
+  int count = 0;
+  int status;
+  while ((status = reader_next(reader, &snaps[count])) == 1) {
+    if (reader->no_tick)
+      state->limits.check_attack_tick = 0;
+    if (++count == SCAN_BLOCK) {
+      scan_block(state, snaps, count);
+      count = 0;
+    }
+  }
+  close_ghost_loader(&reader->loader);
+  if (status != 0)
+    return -1;
+  scan_block(state, snaps, count);
+  scan_emit(state);
+  return state->num_ranges;
+}
+
+int ghost_scan_file(const char *filename, const ghost_scan_options_t *options,
+                    ghost_scan_range_t *ranges, int max_ranges) {
+  ghost_reader_t reader;
+  if (!filename || !init_ghost_reader(&reader, filename))
+    return -1;
+  scan_state_t state;
+  init_scan_state(&state, options, ranges, max_ranges);
+  return scan_reader(&reader, &state);
+}
+
+int ghost_scan_mem(const void *data, size_t size,
+                   const ghost_scan_options_t *options,
+                   ghost_scan_range_t *ranges, int max_ranges) {
+  ghost_reader_t reader;
+  if (!data || !init_ghost_reader_mem(&reader, data, size))
+    return -1;
+  scan_state_t state;
+  init_scan_state(&state, options, ranges, max_ranges);
+  return scan_reader(&reader, &state);
+}
+
+enum { LAZY_NUM_SLOTS = 4 };
+
+typedef struct lazy_chunk_t {
+  size_t offset;
+  int first_item;
+  int num_items;
+} lazy_chunk_t;
+
+typedef struct lazy_slot_t {
+  int chunk;
+  unsigned last_used;
+  ghost_character_t *items;
+} lazy_slot_t;
+
+struct ghost_lazy_t {
+  unsigned char *data;
+  size_t size;
+  ghost_t meta;
+  int num_ticks;
+  int version;
+  int huffman_table;
+
+  lazy_chunk_t *chunks;
+  int num_chunks;
+  int max_chunk_items;
+
+  // Only allocated while chunks are decoded.
+  ghost_loader_t *loader;
+  lazy_slot_t slots[LAZY_NUM_SLOTS];
+  unsigned clock;
+  int last_chunk;
+
+  // Fallback for files that cannot be decoded per chunk.
+  ghost_t *full;
+};
+
+// Decodes the items of the chunk at `offset`. Every chunk of version 5 and
+// later starts without a delta base, so chunks decode independently.
+static bool decode_chunk_at(ghost_loader_t *loader, size_t offset,
+                            int expected_type, void *items, int num_items,
+                            size_t item_size) {
+  loader->mem.pos = offset;
+  int type;
+  if (!read_chunk(loader, &type) || type != expected_type ||
+      loader->buffer_num_items < num_items)
+    return false;
+  for (int i = 0; i < num_items; i++)
+    if (read_data(loader, type, (unsigned char *)items + i * item_size,
+                  item_size))
+      return false;
+  return true;
+}
+
+static bool lazy_activate(ghost_lazy_t *lazy) {
+  if (lazy->loader)
+    return true;
+
+  lazy->loader = (ghost_loader_t *)malloc(sizeof(ghost_loader_t));
+  if (!lazy->loader)
+    return false;
+  if (!init_ghost_loader_mem(lazy->loader, lazy->data, lazy->size)) {
+    free(lazy->loader);
+    lazy->loader = NULL;
+    return false;
+  }
+
+  for (int i = 0; i < LAZY_NUM_SLOTS; i++) {
+    lazy->slots[i].chunk = -1;
+    lazy->slots[i].last_used = 0;
+    lazy->slots[i].items = (ghost_character_t *)malloc(
+        lazy->max_chunk_items * sizeof(ghost_character_t));
+    if (!lazy->slots[i].items) {
+      ghost_lazy_release(lazy);
+      return false;
+    }
+  }
+  return true;
+}
+
+void ghost_lazy_release(ghost_lazy_t *lazy) {
+  if (!lazy || !lazy->loader)
+    return;
+  for (int i = 0; i < LAZY_NUM_SLOTS; i++) {
+    free(lazy->slots[i].items);
+    lazy->slots[i].items = NULL;
+    lazy->slots[i].chunk = -1;
+  }
+  free(lazy->loader);
+  lazy->loader = NULL;
+  lazy->last_chunk = -1;
+}
+
+static lazy_slot_t *lazy_decode(ghost_lazy_t *lazy, int chunk) {
+  lazy_slot_t *victim = &lazy->slots[0];
+  for (int i = 0; i < LAZY_NUM_SLOTS; i++) {
+    lazy_slot_t *slot = &lazy->slots[i];
+    if (slot->chunk == chunk) {
+      slot->last_used = ++lazy->clock;
+      return slot;
+    }
+    if (slot->last_used < victim->last_used)
+      victim = slot;
+  }
+
+  const lazy_chunk_t *info = &lazy->chunks[chunk];
+  victim->chunk = -1;
+  if (!decode_chunk_at(lazy->loader, info->offset, GHOSTDATA_TYPE_CHARACTER,
+                       victim->items, info->num_items,
+                       sizeof(ghost_character_t))) {
+    fprintf(stderr, "ghost: Failed to decode chunk %d of lazy ghost\n",
+            chunk);
+    return NULL;
+  }
+  victim->chunk = chunk;
+  victim->last_used = ++lazy->clock;
+  return victim;
+}
+
+static int find_lazy_chunk(const ghost_lazy_t *lazy, int index) {
+  if (lazy->last_chunk >= 0) {
+    const lazy_chunk_t *last = &lazy->chunks[lazy->last_chunk];
+    if (index >= last->first_item && index < last->first_item + last->num_items)
+      return lazy->last_chunk;
+  }
+
+  int lo = 0, hi = lazy->num_chunks - 1;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo + 1) / 2;
+    if (lazy->chunks[mid].first_item <= index)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return lo;
+}
+
+const ghost_character_t *ghost_lazy_get_snap(ghost_lazy_t *lazy, int index) {
+  if (!lazy || index < 0 || index >= lazy->num_ticks)
+    return NULL;
+  if (lazy->full)
+    return ghost_get_snap(&lazy->full->path, index);
+  if (!lazy_activate(lazy))
+    return NULL;
+
+  const int chunk = find_lazy_chunk(lazy, index);
+  lazy_slot_t *slot = lazy_decode(lazy, chunk);
+  if (!slot)
+    return NULL;
+  lazy->last_chunk = chunk;
+  return &slot->items[index - lazy->chunks[chunk].first_item];
+}
+
+static bool index_lazy_chunks(ghost_lazy_t *lazy, bool *per_chunk) {
+  ghost_loader_t *loader = lazy->loader;
+  size_t pos = loader->mem.pos;
+  int capacity = 0;
+  int num_items = 0;
+  bool found_skin = false;
+  *per_chunk = loader->header.version != 4;
+
+  while (lazy->size - pos >= 4) {
+    const unsigned char *chunk_header = lazy->data + pos;
+    const int type = chunk_header[0];
+    const int items = chunk_header[1];
+    const size_t size = (chunk_header[2] << 8) | chunk_header[3];
+    if (size == 0 || size > MAX_CHUNK_SIZE || lazy->size - pos - 4 < size) {
+      fprintf(stderr,
+              "ghost_loader: Failed to read ghost file '%s': invalid chunk "
+              "header size\n",
+              loader->filename);
+      return false;
+    }
+
+    if (type == GHOSTDATA_TYPE_CHARACTER_NO_TICK) {
+      *per_chunk = false;
+    } else if (type == GHOSTDATA_TYPE_CHARACTER && *per_chunk) {
+      if (lazy->num_chunks == capacity) {
+        capacity = capacity ? capacity * 2 : 16;
+        lazy_chunk_t *chunks = (lazy_chunk_t *)realloc(
+            lazy->chunks, capacity * sizeof(lazy_chunk_t));
+        if (!chunks)
+          return false;
+        lazy->chunks = chunks;
+      }
+      lazy->chunks[lazy->num_chunks++] = (lazy_chunk_t){pos, num_items, items};
+      if (items > lazy->max_chunk_items)
+        lazy->max_chunk_items = items;
+      num_items += items;
+    } else if (type == GHOSTDATA_TYPE_SKIN && !found_skin && *per_chunk) {
+      found_skin = true;
+      if (!decode_chunk_at(loader, pos, type, &lazy->meta.skin, 1,
+                           sizeof(ghost_skin_t) - 24))
+        return false;
+      ints_to_str(lazy->meta.skin.skin, 6, lazy->meta.skin.skin_name, 24);
+    } else if (type == GHOSTDATA_TYPE_START_TICK && *per_chunk) {
+      if (!decode_chunk_at(loader, pos, type, &lazy->meta.start_tick, 1,
+                           sizeof(int)))
+        return false;
+    }
+    pos += 4 + size;
+  }
+
+  if (!*per_chunk)
+    return true;
+  if (num_items != lazy->num_ticks) {
+    fprintf(stderr,
+            "ghost: Failed to read all ghost data (got '%d' ticks, wanted "
+            "'%d' ticks)\n",
+            num_items, lazy->num_ticks);
+    return false;
+  }
+  if (!found_skin)
+    ghost_set_skin(&lazy->meta, "default", 0, 0, 0);
+  return true;
+}
+
+static ghost_lazy_t *load_lazy(unsigned char *data, size_t size) {
+  ghost_lazy_t *lazy = (ghost_lazy_t *)calloc(1, sizeof(ghost_lazy_t));
+  if (!lazy) {
+    free(data);
+    return NULL;
+  }
+  lazy->data = data;
+  lazy->size = size;
+  lazy->last_chunk = -1;
+
+  lazy->loader = (ghost_loader_t *)malloc(sizeof(ghost_loader_t));
+  if (!lazy->loader || !init_ghost_loader_mem(lazy->loader, data, size)) {
+    free(lazy->loader);
+    lazy->loader = NULL;
+    ghost_lazy_free(lazy);
+    return NULL;
+  }
+
+  const ghost_info_t *info = &lazy->loader->info;
+  strcpy(lazy->meta.player, info->owner);
+  strcpy(lazy->meta.map, info->map);
+  lazy->meta.time = info->time;
+  lazy->meta.start_tick = -1;
+  lazy->meta.playback_pos = -1;
+  lazy->num_ticks = info->num_ticks;
+  lazy->version = lazy->loader->header.version;
+  lazy->huffman_table = get_huffman_table(&lazy->loader->header);
+
+  bool per_chunk;
+  const bool indexed = index_lazy_chunks(lazy, &per_chunk);
+  free(lazy->loader);
+  lazy->loader = NULL;
+  if (!indexed) {
+    ghost_lazy_free(lazy);
+    return NULL;
+  }
+
+  if (!per_chunk) {
+    lazy->full = ghost_load_mem(lazy->data, lazy->size);
+    free(lazy->chunks);
+    lazy->chunks = NULL;
+    lazy->num_chunks = 0;
+    free(lazy->data);
+    lazy->data = NULL;
+    if (!lazy->full) {
+      ghost_lazy_free(lazy);
+      return NULL;
+    }
+    lazy->meta.skin = lazy->full->skin;
+    lazy->meta.start_tick = lazy->full->start_tick;
+    return lazy;
+  }
+
+  if (lazy->meta.start_tick == -1) {
+    const ghost_character_t *first = ghost_lazy_get_snap(lazy, 0);
+    if (!first) {
+      ghost_lazy_free(lazy);
+      return NULL;
+    }
+    lazy->meta.start_tick = first->tick;
+    ghost_lazy_release(lazy);
+  }
+  return lazy;
+}
+
+ghost_lazy_t *ghost_load_lazy(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr,
+            "ghost_loader: Failed to open ghost file '%s' for reading\n",
+            filename);
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  unsigned char *data = size > 0 ? (unsigned char *)malloc(size) : NULL;
+  if (!data || fread(data, size, 1, file) != 1) {
+    fprintf(stderr,
+            "ghost_loader: Failed to read ghost file '%s': failed to read "
+            "header\n",
+            filename);
+    free(data);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+  return load_lazy(data, (size_t)size);
+}
+
+ghost_lazy_t *ghost_load_lazy_mem(const void *data, size_t size) {
+  if (!data || size == 0)
+    return NULL;
+  unsigned char *copy = (unsigned char *)malloc(size);
+  if (!copy)
+    return NULL;
+  memcpy(copy, data, size);
+  return load_lazy(copy, size);
+}
+
+const ghost_t *ghost_lazy_meta(const ghost_lazy_t *lazy) {
+  return lazy ? &lazy->meta : NULL;
+}
+
+int ghost_lazy_num_ticks(const ghost_lazy_t *lazy) {
+  return lazy ? lazy->num_ticks : 0;
+}
+
+size_t ghost_lazy_resident_bytes(const ghost_lazy_t *lazy) {
+  if (!lazy)
+    return 0;
+  size_t bytes = sizeof(ghost_lazy_t) + lazy->size +
+                 lazy->num_chunks * sizeof(lazy_chunk_t);
+  if (lazy->loader)
+    bytes += sizeof(ghost_loader_t) + LAZY_NUM_SLOTS * lazy->max_chunk_items *
+                                          sizeof(ghost_character_t);
+  if (lazy->full) {
+    const ghost_path_t *path = &lazy->full->path;
+    const int chunks = (path->num_items + path->chunk_size - 1) /
+                       path->chunk_size;
+    bytes += sizeof(ghost_t) + chunks * (sizeof(ghost_character_t *) +
+                                         path->chunk_size *
+                                             sizeof(ghost_character_t));
+  }
+  return bytes;
+}
+
+void ghost_lazy_free(ghost_lazy_t *lazy) {
+  if (!lazy)
+    return;
+  ghost_lazy_release(lazy);
+  ghost_free(lazy->full);
+  free(lazy->chunks);
+  free(lazy->data);
+  free(lazy);
+}
+
+
+static void to_header_info(const ghost_header_t *header,
+                           ghost_header_info_t *info) {
+  memset(info, 0, sizeof(*info));
+  info->version = header->version;
+  strcpy(info->player, header->owner);
+  strcpy(info->map, header->map);
+  info->num_ticks = get_ticks(header);
+  info->time = get_time(header);
+}
+
+int ghost_read_info(const char *filename, ghost_header_info_t *info) {
+  if (!filename || !info)
+    return -1;
+
+  ghost_header_t header;
+  int error;
+  io_handle_t file = read_header(&header, filename, &error);
+  if (!file)
+    return -1;
+  fclose((FILE *)file);
+
+  to_header_info(&header, info);
+  return 0;
+}
+
+int ghost_read_info_mem(const void *data, size_t size,
+                        ghost_header_info_t *info) {
+  if (!data || !info)
+    return -1;
+
+  ghost_header_t header;
+  mem_stream_t mem = {(const unsigned char *)data, size, 0};
+  if (read_header_mem(&header, &mem, "<memory>") != GHOST_VERIFY_OK)
+    return -1;
+
+  to_header_info(&header, info);
+  return 0;
+}
+
+void ghost_free(ghost_t *ghost) {
+  if (!ghost)
+    return;
+  reset_ghost_path(&ghost->path);
+  free(ghost);
+}
+
+int huffman_compress(const huffman_context_t *ctx, const void *input,
+                     int in_size, void *output, int out_size) {
+  const unsigned char *src = (const unsigned char *)input;
+  const unsigned char *src_end = src + in_size;
+  unsigned char *dst = (unsigned char *)output;
+  unsigned char *dst_end = dst + out_size;
+
+  unsigned bits = 0;
+  unsigned bitcount = 0;
+
+  if (in_size == 0) {
+    const huffman_node_t *node = &ctx->nodes[HUFFMAN_EOF_SYMBOL];
+    bits |= (unsigned)node->bits << bitcount;
+    bitcount += node->num_bits;
+
+    while (bitcount >= 8) {
+      if (dst >= dst_end)
+        return -1;
+      *dst++ = bits & 0xff;
+      bits >>= 8;
+      bitcount -= 8;
+    }
+    if (dst >= dst_end)
+      return -1;
+    *dst++ = bits & 0xff;
+    return (int)(dst - (unsigned char *)output);
+  }
+
+  int symbol = *src++;
+
+  while (src != src_end) {
+    const huffman_node_t *node = &ctx->nodes[symbol];
+    bits |= (unsigned)node->bits << bitcount;
+    bitcount += node->num_bits;
+
+    symbol = *src++;
+
+    while (bitcount >= 8) {
+      if (dst >= dst_end)
+        return -1;
+      *dst++ = (unsigned char)(bits & 0xff);
+      bits >>= 8;
+      bitcount -= 8;
+    }
+  }
+
+  const huffman_node_t *last_node = &ctx->nodes[symbol];
+  bits |= (unsigned)last_node->bits << bitcount;
+  bitcount += last_node->num_bits;
+  while (bitcount >= 8) {
+    if (dst >= dst_end)
+      return -1;
+    *dst++ = (unsigned char)(bits & 0xff);
+    bits >>= 8;
+    bitcount -= 8;
+  }
+
+  const huffman_node_t *eof_node = &ctx->nodes[HUFFMAN_EOF_SYMBOL];
+  bits |= (unsigned)eof_node->bits << bitcount;
+  bitcount += eof_node->num_bits;
+  while (bitcount >= 8) {
+    if (dst >= dst_end)
+      return -1;
+    *dst++ = (unsigned char)(bits & 0xff);
+    bits >>= 8;
+    bitcount -= 8;
+  }
+
+  if (dst >= dst_end)
+    return -1;
+  *dst++ = bits;
+
+  return (int)(dst - (unsigned char *)output);
+}
+
+static unsigned char *var_pack(unsigned char *dst, int i, int dst_size) {
+  if (dst_size <= 0)
+    return NULL;
+
+  dst_size--;
+  *dst = 0;
+  if (i < 0) {
+    *dst |= 0x40;
+    i = ~i;
+  }
+
+  *dst |= i & 0x3F;
+  i >>= 6;
+
+  while (i) {
+    if (dst_size <= 0)
+      return NULL;
+    *dst |= 0x80;
+    dst_size--;
+    dst++;
+    *dst = i & 0x7F;
+    i >>= 7;
+  }
+
+  dst++;
+  return dst;
+}
+
+CODEC_INLINE long var_compress_impl(const void *src_void, int src_size,
+                                    void *dst_void, int dst_size) {
+  if (src_size % sizeof(int) != 0) {
+    return -1;
+  }
+
+  const int *src = (const int *)src_void;
+  const int *src_end = src + src_size / sizeof(int);
+  unsigned char *dst = (unsigned char *)dst_void;
+  const unsigned char *dst_start = (const unsigned char *)dst_void;
+  const unsigned char *dst_end = dst + dst_size;
+
+  while (src < src_end) {
+    dst = var_pack(dst, *src, dst_end - dst);
+    if (!dst)
+      return -1;
+    src++;
+  }
+
+  return (long)(dst - dst_start);
+}
+
+CODEC_INLINE void diff_item_impl(const uint32_t *past, const uint32_t *current,
+                                 uint32_t *out, size_t size) {
+  while (size) {
+    *out = *current - *past;
+    out++;
+    past++;
+    current++;
+    size--;
+  }
+}
+
+static int uvar_size(uint32_t v) {
+  int size = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static unsigned char *uvar_pack(unsigned char *dst, uint32_t v) {
+  while (v >= 0x80) {
+    *dst++ = (unsigned char)(v | 0x80);
+    v >>= 7;
+  }
+  *dst++ = (unsigned char)v;
+  return dst;
+}
+
+static int bit_width(uint32_t v) {
+  int width = 0;
+  while (v) {
+    v >>= 1;
+    width++;
+  }
+  return width;
+}
+
+static void pack_block(const uint32_t *in, int width, unsigned char *dst) {
+  const unsigned size = (unsigned)width * sizeof(uint32_t);
+  memset(dst, 0, size);
+  for (unsigned j = 0; j < COLUMN_BLOCK_SIZE; j++) {
+    const unsigned bit = j * (unsigned)width;
+    const unsigned avail = size - bit / 8;
+    const unsigned len = avail < 8 ? avail : 8;
+    uint64_t window = load_le64(dst + bit / 8, len);
+    window |= (uint64_t)in[j] << (bit % 8);
+    store_le64(dst + bit / 8, window, len);
+  }
+}
+
+// Writes `count` zigzagged values as blocks and returns the number of bytes
+// used. With `dst` set to NULL only the size is computed.
+static size_t encode_blocks(const uint32_t *values, int count,
+                            unsigned char *dst) {
+  size_t total = 0;
+  for (int base = 0; base < count; base += COLUMN_BLOCK_SIZE) {
+    uint32_t block[COLUMN_BLOCK_SIZE] = {0};
+    const int n =
+        count - base < COLUMN_BLOCK_SIZE ? count - base : COLUMN_BLOCK_SIZE;
+    memcpy(block, values + base, n * sizeof(uint32_t));
+
+    uint32_t max = 0;
+    uint32_t bitmask = 0;
+    size_t sparse_size = 1 + 4;
+    for (int j = 0; j < n; j++) {
+      if (block[j] > max)
+        max = block[j];
+      if (block[j]) {
+        bitmask |= 1u << j;
+        sparse_size += uvar_size(block[j]);
+      }
+    }
+    const int width = bit_width(max);
+    const size_t packed_size = 1 + width * sizeof(uint32_t);
+
+    if (packed_size <= sparse_size) {
+      if (dst) {
+        dst[total] = (unsigned char)width;
+        pack_block(block, width, dst + total + 1);
+      }
+      total += packed_size;
+    } else {
+      if (dst) {
+        unsigned char *p = dst + total;
+        *p++ = COLUMN_BLOCK_SPARSE;
+        *p++ = bitmask & 0xff;
+        *p++ = (bitmask >> 8) & 0xff;
+        *p++ = (bitmask >> 16) & 0xff;
+        *p++ = (bitmask >> 24) & 0xff;
+        for (int j = 0; j < n; j++)
+          if (block[j])
+            p = uvar_pack(p, block[j]);
+      }
+      total += sparse_size;
+    }
+  }
+  return total;
+}
+
+// Each column is stored either as deltas or, for smooth fields like
+// positions and ticks, as deltas of deltas, whichever is smaller.
+static long encode_column(const uint32_t *values, int count,
+                          unsigned char *dst) {
+  uint32_t delta1[COLUMNAR_ITEMS_PER_CHUNK];
+  uint32_t delta2[COLUMNAR_ITEMS_PER_CHUNK];
+
+  for (int i = 1; i < count; i++)
+    delta1[i - 1] = zigzag_encode(values[i] - values[i - 1]);
+  for (int i = 2; i < count; i++)
+    delta2[i - 2] = zigzag_encode((values[i] - values[i - 1]) -
+                                  (values[i - 1] - values[i - 2]));
+
+  const uint32_t first = zigzag_encode(values[0]);
+  const size_t size1 =
+      1 + uvar_size(first) + encode_blocks(delta1, count - 1, NULL);
+  size_t size2 = size1 + 1;
+  if (count >= 3)
+    size2 = 1 + uvar_size(first) + uvar_size(delta1[0]) +
+            encode_blocks(delta2, count - 2, NULL);
+
+  unsigned char *start = dst;
+  if (size1 <= size2) {
+    *dst++ = COLUMN_DELTA;
+    dst = uvar_pack(dst, first);
+    dst += encode_blocks(delta1, count - 1, dst);
+  } else {
+    *dst++ = COLUMN_DELTA2;
+    dst = uvar_pack(dst, first);
+    dst = uvar_pack(dst, delta1[0]);
+    dst += encode_blocks(delta2, count - 2, dst);
+  }
+  return (long)(dst - start);
+}
+
+// A column never needs more than its mode, two varints and four blocks of
+// 129 bytes, so a full chunk of 128 items always fits in MAX_CHUNK_SIZE.
+static long columnar_compress(const ghost_character_t *items, int num_items,
+                              void *dst_void, int dst_size) {
+  if (num_items <= 0 || num_items > COLUMNAR_ITEMS_PER_CHUNK ||
+      dst_size < MAX_CHUNK_SIZE)
+    return -1;
+
+  const uint32_t *src = (const uint32_t *)items;
+  unsigned char *dst = (unsigned char *)dst_void;
+  uint32_t column[COLUMNAR_ITEMS_PER_CHUNK];
+  long total = 0;
+
+  for (int field = 0; field < NUM_CHARACTER_FIELDS; field++) {
+    for (int i = 0; i < num_items; i++)
+      column[i] = src[i * NUM_CHARACTER_FIELDS + field];
+    total += encode_column(column, num_items, dst + total);
+  }
+
+  return total;
+}
+
+static void uint_to_bytes_be(unsigned char *bytes, unsigned val) {
+  bytes[0] = (val >> 24) & 0xff;
+  bytes[1] = (val >> 16) & 0xff;
+  bytes[2] = (val >> 8) & 0xff;
+  bytes[3] = val & 0xff;
+}
+
+typedef struct ghost_saver_t {
+  FILE *file;
+  char filename[IO_MAX_PATH_LENGTH];
+  huffman_context_t *huffman;
+
+  unsigned char buffer[MAX_CHUNK_SIZE];
+
+  unsigned char buffer_temp[MAX_CHUNK_SIZE * 2];
+  unsigned char compress_buffer[MAX_CHUNK_SIZE * 2];
+
+  unsigned char *buffer_pos;
+  int buffer_num_items;
+
+  ghost_item_t last_item;
+  ghost_codec_stats_t *stats;
+  // Chunks are cut by write_optimal_path instead of every
+  // NUM_ITEMS_PER_CHUNK items.
+  bool optimize_chunks;
+} ghost_saver_t;
+
+static void reset_saver_buffer(ghost_saver_t *saver) {
+  saver->buffer_pos = saver->buffer;
+  saver->buffer_num_items = 0;
+}
+
+static bool write_chunk(ghost_saver_t *saver, int type, int num_items,
+                        const void *data, int size) {
+  if (saver->stats) {
+    saver->stats->num_chunks++;
+    saver->stats->total_bytes += 4 + size;
+  }
+  if (!saver->file)
+    return true;
+
+  unsigned char chunk_header[4];
+  chunk_header[0] = type;
+  chunk_header[1] = num_items;
+  chunk_header[2] = (size >> 8) & 0xff;
+  chunk_header[3] = size & 0xff;
+
+  if (fwrite(chunk_header, sizeof(chunk_header), 1, saver->file) != 1) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': error writing chunk "
+            "header\n",
+            saver->filename);
+    return false;
+  }
+  if (fwrite(data, size, 1, saver->file) != 1) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': error writing chunk "
+            "data\n",
+            saver->filename);
+    return false;
+  }
+  return true;
+}
+
+static void collect_chunk_stats(ghost_saver_t *saver, int raw_size) {
+  ghost_codec_stats_t *stats = saver->stats;
+  const huffman_context_t *ctx = saver->huffman;
+  const int *ints = (const int *)saver->buffer;
+  const int num_ints = raw_size / (int)sizeof(int);
+  const bool character = saver->last_item.type == GHOSTDATA_TYPE_CHARACTER;
+
+  for (int i = 0; i < num_ints; i++) {
+    unsigned char packed[8] = {0};
+    const unsigned char *end = var_pack(packed, ints[i], sizeof(packed));
+    const int num_bytes = (int)(end - packed);
+    int bits = 0;
+    for (int b = 0; b < num_bytes; b++) {
+      stats->byte_freq[packed[b]]++;
+      bits += ctx->nodes[packed[b]].num_bits;
+    }
+
+    stats->varint_bytes += num_bytes;
+    stats->huffman_bits += bits;
+    if (character) {
+      stats->field_varint_bytes[i % NUM_CHARACTER_FIELDS] += num_bytes;
+      stats->field_huffman_bits[i % NUM_CHARACTER_FIELDS] += bits;
+    }
+  }
+  stats->huffman_bits += ctx->nodes[HUFFMAN_EOF_SYMBOL].num_bits;
+}
+
+static bool flush_chunk(ghost_saver_t *saver) {
+  if (saver->buffer_num_items == 0)
+    return true;
+
+  int raw_size = (int)((unsigned char *)saver->buffer_pos -
+                       (unsigned char *)saver->buffer);
+
+  if (raw_size == 0) {
+    reset_saver_buffer(saver);
+    saver->last_item.type = -1;
+    return true;
+  }
+
+  if (saver->stats)
+    collect_chunk_stats(saver, raw_size);
+
+  long var_size = codec_kernels()->var_compress(
+      saver->buffer, raw_size, saver->buffer_temp, sizeof(saver->buffer_temp));
+  if (var_size < 0 || var_size > MAX_CHUNK_SIZE) {
+    fprintf(
+        stderr,
+        "ghost_saver: Failed to write ghost file '%s': varcompress failed\n",
+        saver->filename);
+    return false;
+  }
+
+  int compressed_size =
+      huffman_compress(saver->huffman, saver->buffer_temp, (int)var_size,
+                       saver->compress_buffer, sizeof(saver->compress_buffer));
+  if (compressed_size < 0 || compressed_size > MAX_CHUNK_SIZE) {
+    fprintf(stderr,
             "ghost_saver: Failed to write ghost file '%s': huffman compression "
             "failed\n",
             saver->filename);
     return false;
   }
 
-  unsigned char chunk_header[4];
-  chunk_header[0] = saver->last_item.type;
-  chunk_header[1] = saver->buffer_num_items;
-  chunk_header[2] = (compressed_size >> 8) & 0xff;
-  chunk_header[3] = compressed_size & 0xff;
+  if (!write_chunk(saver, saver->last_item.type, saver->buffer_num_items,
+                   saver->compress_buffer, compressed_size))
+    return false;
+
+  reset_saver_buffer(saver);
+  saver->last_item.type = -1;
+  return true;
+}
+
+static bool write_data(ghost_saver_t *saver, int type, const void *data,
+                       size_t size) {
+  if ((size_t)((unsigned char *)saver->buffer + sizeof(saver->buffer) -
+               (unsigned char *)saver->buffer_pos) < size) {
+    if (!flush_chunk(saver))
+      return false;
+  }
+
+  ghost_item_t item_data;
+  item_data.type = type;
+  memcpy(item_data.data, data, size);
+
+  if (saver->last_item.type == item_data.type) {
+    codec_kernels()->diff_item((const uint32_t *)saver->last_item.data,
+                               (const uint32_t *)item_data.data,
+                               (uint32_t *)saver->buffer_pos,
+                               size / sizeof(uint32_t));
+  } else {
+    if (!flush_chunk(saver))
+      return false;
+    memcpy(saver->buffer_pos, item_data.data, size);
+  }
+
+  saver->last_item = item_data;
+  saver->buffer_pos += size;
+  saver->buffer_num_items++;
+
+  if (!saver->optimize_chunks &&
+      saver->buffer_num_items >= NUM_ITEMS_PER_CHUNK) {
+    if (!flush_chunk(saver))
+      return false;
+  }
+
+  return true;
+}
+
+static bool write_header(FILE *file, const ghost_t *ghost, int version,
+                         int table) {
+  ghost_header_t header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.marker, header_marker, sizeof(header_marker));
+  header.version = version;
+  header.zeroes[0] = (unsigned char)table;
+  strncpy(header.owner, ghost->player, sizeof(header.owner));
+  strncpy(header.map, ghost->map, sizeof(header.map));
+  uint_to_bytes_be(header.num_ticks, ghost->path.num_items);
+  uint_to_bytes_be(header.time, ghost->time);
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1) {
+    return false;
+  }
+  return true;
+}
+
+static bool write_columnar_path(ghost_saver_t *saver, const ghost_path_t *path) {
+  ghost_character_t items[COLUMNAR_ITEMS_PER_CHUNK];
+  for (int start = 0; start < path->num_items;
+       start += COLUMNAR_ITEMS_PER_CHUNK) {
+    int count = path->num_items - start;
+    if (count > COLUMNAR_ITEMS_PER_CHUNK)
+      count = COLUMNAR_ITEMS_PER_CHUNK;
+    for (int i = 0; i < count; i++)
+      items[i] = *ghost_get_snap(path, start + i);
+
+    long size = columnar_compress(items, count, saver->compress_buffer,
+                                  sizeof(saver->compress_buffer));
+    if (size < 0 || size > MAX_CHUNK_SIZE) {
+      fprintf(stderr,
+              "ghost_saver: Failed to write ghost file '%s': columnar "
+              "compression failed\n",
+              saver->filename);
+      return false;
+    }
+    if (!write_chunk(saver, GHOSTDATA_TYPE_CHARACTER, count,
+                     saver->compress_buffer, (int)size))
+      return false;
+  }
+  return true;
+}
+
+int ghost_save(const ghost_t *ghost, const char *filename) {
+  return ghost_save_ex(ghost, filename, NULL);
+}
+
+// Bits and var_compress bytes `ints` take in a chunk.
+static void item_cost(const huffman_context_t *ctx, const uint32_t *ints,
+                      int num_ints, int *bits, int *var_bytes) {
+  *bits = 0;
+  *var_bytes = 0;
+  for (int i = 0; i < num_ints; i++) {
+    unsigned char packed[8];
+    const unsigned char *end = var_pack(packed, (int)ints[i], sizeof(packed));
+    for (const unsigned char *b = packed; b < end; b++)
+      *bits += ctx->nodes[*b].num_bits;
+    *var_bytes += (int)(end - packed);
+  }
+}
+
+// The largest chunk the loaders accept: the decoded items, the var_compress
+// output and the Huffman output each have to fit in MAX_CHUNK_SIZE.
+enum {
+  MAX_ITEMS_PER_CHUNK = MAX_CHUNK_SIZE / (int)sizeof(ghost_character_t),
+};
+
+// Per-item costs for choosing chunk boundaries. delta_bits[i] sums the costs
+// of items 1 to i - 1 stored as deltas, so that chunk [start, end) costs
+// raw_bits[start] + delta_bits[end] - delta_bits[start + 1].
+typedef struct chunk_costs_t {
+  int *raw_bits;
+  int *raw_bytes;
+  long long *delta_bits;
+  long long *delta_bytes;
+  int eof_bits;
+} chunk_costs_t;
+
+// Bytes chunk [start, end) takes in the file, or -1 if it is too large.
+static long long chunk_file_size(const chunk_costs_t *costs, int start,
+                                 int end) {
+  if (end - start > MAX_ITEMS_PER_CHUNK)
+    return -1;
+  const long long bytes = costs->raw_bytes[start] + costs->delta_bytes[end] -
+                          costs->delta_bytes[start + 1];
+  const long long bits = costs->raw_bits[start] + costs->delta_bits[end] -
+                         costs->delta_bits[start + 1] + costs->eof_bits;
+  // huffman_compress always writes a final byte.
+  const long long size = bits / 8 + 1;
+  if (bytes > MAX_CHUNK_SIZE || size > MAX_CHUNK_SIZE)
+    return -1;
+  return 4 + size;
+}
+
+// Writes the path with the chunk boundaries that make the file smallest.
+// The Huffman table is fixed, so a chunk costs its header, the bits of its
+// first item stored whole and the bits of the following item deltas, which
+// do not depend on where the chunks are cut. That makes the best boundaries
+// a shortest path over item indices.
+static bool write_optimal_path(ghost_saver_t *saver,
+                               const ghost_path_t *path) {
+  const int num_items = path->num_items;
+  if (num_items == 0)
+    return true;
+
+  chunk_costs_t costs;
+  costs.raw_bits = (int *)malloc(sizeof(int) * num_items);
+  costs.raw_bytes = (int *)malloc(sizeof(int) * num_items);
+  costs.delta_bits = (long long *)malloc(sizeof(long long) * (num_items + 1));
+  costs.delta_bytes = (long long *)malloc(sizeof(long long) * (num_items + 1));
+  costs.eof_bits = saver->huffman->nodes[HUFFMAN_EOF_SYMBOL].num_bits;
+  long long *cost = (long long *)malloc(sizeof(long long) * (num_items + 1));
+  long long *key = (long long *)malloc(sizeof(long long) * (num_items + 1));
+  int *cut = (int *)malloc(sizeof(int) * (num_items + 1));
+  int *queue = (int *)malloc(sizeof(int) * (num_items + 1));
+  bool ok = costs.raw_bits && costs.raw_bytes && costs.delta_bits &&
+            costs.delta_bytes && cost && key && cut && queue;
+  if (!ok) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': failed to allocate "
+            "memory for chunk boundaries\n",
+            saver->filename);
+  }
+
+  if (ok) {
+    costs.delta_bits[0] = costs.delta_bits[1] = 0;
+    costs.delta_bytes[0] = costs.delta_bytes[1] = 0;
+    for (int i = 0; i < num_items; i++) {
+      const uint32_t *item = (const uint32_t *)ghost_get_snap(path, i);
+      item_cost(saver->huffman, item, NUM_CHARACTER_FIELDS, &costs.raw_bits[i],
+                &costs.raw_bytes[i]);
+      if (i == 0)
+        continue;
+      uint32_t diff[NUM_CHARACTER_FIELDS];
+      diff_item_impl((const uint32_t *)ghost_get_snap(path, i - 1), item, diff,
+                     NUM_CHARACTER_FIELDS);
+      int bits, bytes;
+      item_cost(saver->huffman, diff, NUM_CHARACTER_FIELDS, &bits, &bytes);
+      costs.delta_bits[i + 1] = costs.delta_bits[i] + bits;
+      costs.delta_bytes[i + 1] = costs.delta_bytes[i] + bytes;
+    }
+  }
+
+  // cost[start] + chunk_file_size(start, end) only grows with
+  // key[start] = 8 * cost[start] + raw_bits[start] - delta_bits[start + 1],
+  // so the best start is the one with the smallest key among the last
+  // MAX_ITEMS_PER_CHUNK, kept in a monotone queue. Only if that chunk is too
+  // large in bytes are all starts tried.
+  int head = 0, tail = 0;
+  if (ok)
+    cost[0] = 0;
+  for (int end = 1; ok && end <= num_items; end++) {
+    const int start = end - 1;
+    key[start] = 8 * cost[start] + costs.raw_bits[start] -
+                 costs.delta_bits[start + 1];
+    while (tail > head && key[queue[tail - 1]] >= key[start])
+      tail--;
+    queue[tail++] = start;
+    while (queue[head] < end - MAX_ITEMS_PER_CHUNK)
+      head++;
+
+    const long long size = chunk_file_size(&costs, queue[head], end);
+    if (size >= 0) {
+      cost[end] = cost[queue[head]] + size;
+      cut[end] = queue[head];
+      continue;
+    }
+    cost[end] = -1;
+    for (int first = start; first >= 0 && first >= end - MAX_ITEMS_PER_CHUNK;
+         first--) {
+      const long long first_size = chunk_file_size(&costs, first, end);
+      if (first_size >= 0 &&
+          (cost[end] < 0 || cost[first] + first_size < cost[end])) {
+        cost[end] = cost[first] + first_size;
+        cut[end] = first;
+      }
+    }
+    if (cost[end] < 0) {
+      fprintf(stderr,
+              "ghost_saver: Failed to write ghost file '%s': snapshot %d "
+              "does not fit in a chunk\n",
+              saver->filename, start);
+      ok = false;
+    }
+  }
+
+  if (ok) {
+    // Walking back from the end yields the chunk starts last to first.
+    int *starts = queue;
+    int num_chunks = 0;
+    for (int end = num_items; end > 0; end = cut[end])
+      starts[num_chunks++] = cut[end];
+    for (int chunk = num_chunks - 1; chunk >= 0 && ok; chunk--) {
+      const int end = chunk > 0 ? starts[chunk - 1] : num_items;
+      for (int i = starts[chunk]; i < end && ok; i++)
+        ok = write_data(saver, GHOSTDATA_TYPE_CHARACTER,
+                        ghost_get_snap(path, i), sizeof(ghost_character_t));
+      if (ok)
+        ok = flush_chunk(saver);
+    }
+  }
+
+  free(costs.raw_bits);
+  free(costs.raw_bytes);
+  free(costs.delta_bits);
+  free(costs.delta_bytes);
+  free(cost);
+  free(key);
+  free(cut);
+  free(queue);
+  return ok;
+}
+
+static bool write_ghost(ghost_saver_t *saver, const ghost_t *ghost,
+                        int version) {
+  if (!write_data(saver, GHOSTDATA_TYPE_SKIN, &ghost->skin,
+                  sizeof(ghost_skin_t) - 24))
+    return false;
+
+  if (!write_data(saver, GHOSTDATA_TYPE_START_TICK, &ghost->start_tick,
+                  sizeof(int)))
+    return false;
+
+  if (version == columnar_version) {
+    if (!flush_chunk(saver))
+      return false;
+    return write_columnar_path(saver, &ghost->path);
+  }
+
+  if (saver->optimize_chunks) {
+    if (!write_optimal_path(saver, &ghost->path))
+      return false;
+    return flush_chunk(saver);
+  }
+
+  for (int i = 0; i < ghost->path.num_items; i++) {
+    ghost_character_t *character = ghost_get_snap(&ghost->path, i);
+    if (!write_data(saver, GHOSTDATA_TYPE_CHARACTER, character,
+                    sizeof(ghost_character_t)))
+      return false;
+  }
+
+  return flush_chunk(saver);
+}
+
+int ghost_save_ex(const ghost_t *ghost, const char *filename,
+                  const ghost_save_options_t *options) {
+  int version = current_version;
+  int table = GHOST_HUFFMAN_TABLE_NETWORK;
+  if (options && options->version != 0)
+    version = options->version;
+  if (options)
+    table = options->huffman_table;
+  if (version != current_version && version != columnar_version) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': ghost version '%d' "
+            "is not supported\n",
+            filename, version);
+    return -1;
+  }
+  if (!huffman_table(table)) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': huffman table '%d' "
+            "is not supported\n",
+            filename, table);
+    return -1;
+  }
+
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    fprintf(stderr, "ghost_saver: Failed to open ghost file '%s' for writing\n",
+            filename);
+    return -1;
+  }
+
+  if (!write_header(file, ghost, version, table)) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': failed to write "
+            "header\n",
+            filename);
+    fclose(file);
+    return -1;
+  }
+
+  huffman_context_t ctx;
+  huffman_init(&ctx, huffman_table(table));
+
+  ghost_saver_t saver;
+  memset(&saver, 0, sizeof(saver));
+  saver.file = file;
+  strncpy(saver.filename, filename, sizeof(saver.filename) - 1);
+  saver.huffman = &ctx;
+  saver.last_item.type = -1;
+  saver.optimize_chunks =
+      options && options->chunking == GHOST_CHUNKING_SMALLEST;
+  reset_saver_buffer(&saver);
+
+  bool error = !write_ghost(&saver, ghost, version);
+
+  fclose(file);
+
+  if (error) {
+    fprintf(stderr,
+            "ghost_saver: An error occurred while writing ghost data to '%s'\n",
+            filename);
+    return -1;
+  }
+
+  return 0;
+}
+
+int ghost_codec_stats_add(ghost_codec_stats_t *stats, const ghost_t *ghost,
+                          int huffman_table_id) {
+  if (!stats || !ghost || !huffman_table(huffman_table_id))
+    return -1;
+
+  huffman_context_t ctx;
+  huffman_init(&ctx, huffman_table(huffman_table_id));
+
+  ghost_saver_t saver;
+  memset(&saver, 0, sizeof(saver));
+  strncpy(saver.filename, "<stats>", sizeof(saver.filename) - 1);
+  saver.huffman = &ctx;
+  saver.stats = stats;
+  saver.last_item.type = -1;
+  reset_saver_buffer(&saver);
+
+  if (!write_ghost(&saver, ghost, current_version))
+    return -1;
+
+  stats->num_ghosts++;
+  stats->num_snapshots += ghost->path.num_items;
+  stats->total_bytes += sizeof(ghost_header_t);
+  return 0;
+}
+
+int ghost_convert(const char *src_filename, const char *dst_filename,
+                  int version) {
+  ghost_t *ghost = ghost_load(src_filename);
+  if (!ghost)
+    return -1;
+
+  ghost_save_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.version = version;
+  int result = ghost_save_ex(ghost, dst_filename, &options);
+  ghost_free(ghost);
+  return result;
+}
+
+// Writes a ghost pieced together from ranges of other ghosts. Whole chunks
+// are copied as they are whenever their encoding matches the output; items
+// of chunks that are cut, or encoded differently, go through the saver.
+typedef struct splice_writer_t {
+  ghost_saver_t saver;
+  huffman_context_t huffman;
+  int table;
+  bool columnar;
+  ghost_character_t pending[COLUMNAR_ITEMS_PER_CHUNK];
+  int num_pending;
+  // Added to the tick of every snapshot written.
+  int tick_shift;
+} splice_writer_t;
+
+static bool splice_flush(splice_writer_t *writer) {
+  if (!writer->columnar)
+    return flush_chunk(&writer->saver);
+  if (writer->num_pending == 0)
+    return true;
+
+  ghost_saver_t *saver = &writer->saver;
+  long size = columnar_compress(writer->pending, writer->num_pending,
+                                saver->compress_buffer,
+                                sizeof(saver->compress_buffer));
+  if (size < 0 || size > MAX_CHUNK_SIZE) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': columnar "
+            "compression failed\n",
+            saver->filename);
+    return false;
+  }
+  const int count = writer->num_pending;
+  writer->num_pending = 0;
+  return write_chunk(saver, GHOSTDATA_TYPE_CHARACTER, count,
+                     saver->compress_buffer, (int)size);
+}
+
+static bool splice_add(splice_writer_t *writer,
+                       const ghost_character_t *snap) {
+  ghost_character_t shifted = *snap;
+  shifted.tick = (int)((unsigned)shifted.tick + (unsigned)writer->tick_shift);
+  if (!writer->columnar)
+    return write_data(&writer->saver, GHOSTDATA_TYPE_CHARACTER, &shifted,
+                      sizeof(ghost_character_t));
+  writer->pending[writer->num_pending++] = shifted;
+  if (writer->num_pending == COLUMNAR_ITEMS_PER_CHUNK)
+    return splice_flush(writer);
+  return true;
+}
+
+static splice_writer_t *splice_open(const char *filename, const ghost_t *meta,
+                                    int num_ticks, int version, int table) {
+  splice_writer_t *writer =
+      (splice_writer_t *)calloc(1, sizeof(splice_writer_t));
+  if (!writer)
+    return NULL;
+
+  // Chunks of version 5 files are stored the same way as in version 6.
+  writer->columnar = version == columnar_version;
+  writer->table = writer->columnar ? GHOST_HUFFMAN_TABLE_NETWORK : table;
+  ghost_t header_meta = *meta;
+  header_meta.path.num_items = num_ticks;
+
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    fprintf(stderr, "ghost_saver: Failed to open ghost file '%s' for writing\n",
+            filename);
+    free(writer);
+    return NULL;
+  }
+  if (!write_header(file, &header_meta,
+                    writer->columnar ? columnar_version : current_version,
+                    writer->table)) {
+    fprintf(stderr,
+            "ghost_saver: Failed to write ghost file '%s': failed to write "
+            "header\n",
+            filename);
+    fclose(file);
+    free(writer);
+    return NULL;
+  }
+
+  huffman_init(&writer->huffman, huffman_table(writer->table));
+  ghost_saver_t *saver = &writer->saver;
+  saver->file = file;
+  strncpy(saver->filename, filename, sizeof(saver->filename) - 1);
+  saver->huffman = &writer->huffman;
+  saver->last_item.type = -1;
+  reset_saver_buffer(saver);
+
+  if (!write_data(saver, GHOSTDATA_TYPE_SKIN, &meta->skin,
+                  sizeof(ghost_skin_t) - 24) ||
+      !write_data(saver, GHOSTDATA_TYPE_START_TICK, &meta->start_tick,
+                  sizeof(int)) ||
+      !flush_chunk(saver)) {
+    fclose(file);
+    free(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+static int splice_close(splice_writer_t *writer, bool ok) {
+  ok = ok && splice_flush(writer);
+  if (fclose(writer->saver.file) != 0)
+    ok = false;
+  if (!ok)
+    fprintf(stderr,
+            "ghost_saver: An error occurred while writing ghost data to '%s'\n",
+            writer->saver.filename);
+  free(writer);
+  return ok ? 0 : -1;
+}
+
+// Only the first item of a row chunk, and the first value of a columnar
+// chunk's tick column, hold an absolute tick; everything after them is
+// stored as differences. Shifting a copied chunk's ticks therefore only
+// re-encodes that one value. Returns the new chunk size, or -1.
+static long shift_chunk_ticks(splice_writer_t *writer, const unsigned char *src,
+                              int size, int num_items, unsigned char *dst) {
+  ghost_saver_t *saver = &writer->saver;
+  const unsigned shift = (unsigned)writer->tick_shift;
+  if (writer->columnar) {
+    const unsigned char *end = src + size;
+    const unsigned char *tick_column = src;
+    uint32_t column[COLUMNAR_ITEMS_PER_CHUNK + COLUMN_BLOCK_SIZE];
+    for (int field = 0; tick_column && field < NUM_CHARACTER_FIELDS - 1;
+         field++)
+      tick_column = decode_column(tick_column, end, column, num_items);
+    uint32_t first;
+    const unsigned char *rest =
+        tick_column && tick_column < end
+            ? uvar_unpack(tick_column + 1, end, &first)
+            : NULL;
+    if (!rest)
+      return -1;
+    const size_t prefix = (size_t)(tick_column + 1 - src);
+    memcpy(dst, src, prefix);
+    unsigned char *out =
+        uvar_pack(dst + prefix, zigzag_encode(zigzag_decode(first) + shift));
+    if ((out - dst) + (end - rest) > MAX_CHUNK_SIZE)
+      return -1;
+    memcpy(out, rest, end - rest);
+    return (long)((out - dst) + (end - rest));
+  }
+
+  const codec_kernels_t *kernels = codec_kernels();
+  long raw_size =
+      kernels->huffman_decompress(&writer->huffman, src, size,
+                                  saver->buffer_temp,
+                                  sizeof(saver->buffer_temp));
+  if (raw_size >= 0)
+    raw_size = kernels->var_decompress(saver->buffer_temp, (int)raw_size,
+                                       saver->buffer, sizeof(saver->buffer));
+  if (raw_size < (long)sizeof(ghost_character_t))
+    return -1;
+  ghost_character_t first;
+  memcpy(&first, saver->buffer, sizeof(first));
+  first.tick = (int)((unsigned)first.tick + shift);
+  memcpy(saver->buffer, &first, sizeof(first));
+
+  const long var_size =
+      kernels->var_compress(saver->buffer, (int)raw_size, saver->buffer_temp,
+                            sizeof(saver->buffer_temp));
+  if (var_size < 0 || var_size > MAX_CHUNK_SIZE)
+    return -1;
+  const int compressed_size =
+      huffman_compress(&writer->huffman, saver->buffer_temp, (int)var_size,
+                       dst, MAX_CHUNK_SIZE);
+  return compressed_size;
+}
+
+// Copies a whole chunk of matching encoding, shifting its ticks if needed.
+static bool splice_copy(splice_writer_t *writer, const unsigned char *raw) {
+  const int size = (raw[2] << 8) | raw[3];
+  if (!splice_flush(writer))
+    return false;
+  if (writer->tick_shift == 0)
+    return write_chunk(&writer->saver, raw[0], raw[1], raw + 4, size);
 
-  if (fwrite(chunk_header, sizeof(chunk_header), 1, saver->file) != 1) {
+  ghost_saver_t *saver = &writer->saver;
+  const long shifted_size =
+      shift_chunk_ticks(writer, raw + 4, size, raw[1], saver->compress_buffer);
+  if (shifted_size <= 0) {
     fprintf(stderr,
-            "ghost_saver: Failed to write ghost file '%s': error writing chunk "
-            "header\n",
+            "ghost_saver: Failed to write ghost file '%s': could not shift "
+            "chunk ticks\n",
             saver->filename);
     return false;
   }
-  if (fwrite(saver->compress_buffer, compressed_size, 1, saver->file) != 1) {
-    fprintf(stderr,
-            "ghost_saver: Failed to write ghost file '%s': error writing chunk "
-            "data\n",
-            saver->filename);
-    return false;
+  return write_chunk(saver, raw[0], raw[1], saver->compress_buffer,
+                     (int)shifted_size);
+}
+
+// Appends items [first, first + count) of `lazy`.
+static bool splice_range(splice_writer_t *writer, ghost_lazy_t *lazy,
+                         int first, int count) {
+  const int end = first + count;
+  if (lazy->full) {
+    for (int i = first; i < end; i++)
+      if (!splice_add(writer, ghost_get_snap(&lazy->full->path, i)))
+        return false;
+    return true;
   }
 
-  reset_saver_buffer(saver);
-  saver->last_item.type = -1;
+  const bool columnar = lazy->version == columnar_version;
+  const bool copy = columnar == writer->columnar &&
+                    (columnar || lazy->huffman_table == writer->table);
+  for (int c = find_lazy_chunk(lazy, first);
+       c < lazy->num_chunks && lazy->chunks[c].first_item < end; c++) {
+    const lazy_chunk_t *chunk = &lazy->chunks[c];
+    const int chunk_end = chunk->first_item + chunk->num_items;
+    if (copy && chunk->first_item >= first && chunk_end <= end) {
+      if (!splice_copy(writer, lazy->data + chunk->offset))
+        return false;
+      continue;
+    }
+
+    lazy_slot_t *slot = lazy_activate(lazy) ? lazy_decode(lazy, c) : NULL;
+    if (!slot)
+      return false;
+    const int from = first > chunk->first_item ? first : chunk->first_item;
+    const int to = end < chunk_end ? end : chunk_end;
+    for (int i = from; i < to; i++)
+      if (!splice_add(writer, &slot->items[i - chunk->first_item]))
+        return false;
+  }
+  ghost_lazy_release(lazy);
   return true;
 }
 
-static bool write_data(ghost_saver_t *saver, int type, const void *data,
-                       size_t size) {
-  if ((size_t)((unsigned char *)saver->buffer + sizeof(saver->buffer) -
-               (unsigned char *)saver->buffer_pos) < size) {
-    if (!flush_chunk(saver))
-      return false;
+int ghost_slice(const char *src_filename, const char *dst_filename, int first,
+                int count) {
+  if (!src_filename || !dst_filename)
+    return -1;
+  ghost_lazy_t *lazy = ghost_load_lazy(src_filename);
+  if (!lazy)
+    return -1;
+  if (first < 0 || count <= 0 || first > lazy->num_ticks - count) {
+    fprintf(stderr,
+            "ghost: Failed to slice ghost file '%s': ticks %d to %d are out of "
+            "range\n",
+            src_filename, first, first + count);
+    ghost_lazy_free(lazy);
+    return -1;
   }
 
-  ghost_item_t item_data;
-  item_data.type = type;
-  memcpy(item_data.data, data, size);
+  ghost_t meta = lazy->meta;
+  if (first > 0) {
+    const ghost_character_t *snap = ghost_lazy_get_snap(lazy, first);
+    if (!snap) {
+      ghost_lazy_free(lazy);
+      return -1;
+    }
+    meta.start_tick = snap->tick;
+    ghost_lazy_release(lazy);
+  }
 
-  if (saver->last_item.type == item_data.type) {
-    diff_item((const uint32_t *)saver->last_item.data,
-              (const uint32_t *)item_data.data, (uint32_t *)saver->buffer_pos,
-              size / sizeof(uint32_t));
-  } else {
-    if (!flush_chunk(saver))
-      return false;
-    memcpy(saver->buffer_pos, item_data.data, size);
+  splice_writer_t *writer = splice_open(dst_filename, &meta, count,
+                                        lazy->version, lazy->huffman_table);
+  if (!writer) {
+    ghost_lazy_free(lazy);
+    return -1;
   }
+  const bool ok = splice_range(writer, lazy, first, count);
+  ghost_lazy_free(lazy);
+  return splice_close(writer, ok);
+}
 
-  saver->last_item = item_data;
-  saver->buffer_pos += size;
-  saver->buffer_num_items++;
+int ghost_concat(const char *const *src_filenames, int num_files,
+                 const char *dst_filename) {
+  if (!src_filenames || num_files <= 0 || !dst_filename)
+    return -1;
 
-  if (saver->buffer_num_items >= NUM_ITEMS_PER_CHUNK) {
-    if (!flush_chunk(saver))
-      return false;
+  // Every source is read before the output is opened, so the output may be
+  // one of them. Only the compressed files are held in memory.
+  ghost_lazy_t **sources =
+      (ghost_lazy_t **)calloc(num_files, sizeof(ghost_lazy_t *));
+  if (!sources)
+    return -1;
+  int num_ticks = 0;
+  bool ok = true;
+  for (int i = 0; ok && i < num_files; i++) {
+    sources[i] = ghost_load_lazy(src_filenames[i]);
+    if (!sources[i] || sources[i]->num_ticks > INT32_MAX - num_ticks)
+      ok = false;
+    else
+      num_ticks += sources[i]->num_ticks;
   }
 
-  return true;
+  splice_writer_t *writer = NULL;
+  if (ok)
+    writer = splice_open(dst_filename, &sources[0]->meta, num_ticks,
+                         sources[0]->version, sources[0]->huffman_table);
+  if (writer) {
+    // Each source continues right after the last tick of the one before.
+    int next_tick = 0;
+    for (int i = 0; ok && i < num_files; i++) {
+      const ghost_character_t *first = ghost_lazy_get_snap(sources[i], 0);
+      const int first_tick = first ? first->tick : 0;
+      const ghost_character_t *last =
+          ghost_lazy_get_snap(sources[i], sources[i]->num_ticks - 1);
+      ok = first && last;
+      if (!ok)
+        break;
+      writer->tick_shift =
+          i == 0 ? 0 : (int)((unsigned)next_tick - (unsigned)first_tick);
+      next_tick = (int)((unsigned)last->tick + (unsigned)writer->tick_shift + 1u);
+      ghost_lazy_release(sources[i]);
+      ok = splice_range(writer, sources[i], 0, sources[i]->num_ticks);
+      ghost_lazy_free(sources[i]);
+      sources[i] = NULL;
+    }
+  }
+
+  for (int i = 0; i < num_files; i++)
+    ghost_lazy_free(sources[i]);
+  free(sources);
+  return writer ? splice_close(writer, ok) : -1;
 }
 
-static bool write_header(FILE *file, const ghost_t *ghost) {
-  ghost_header_t header;
-  memset(&header, 0, sizeof(header));
+// A delta file is a prefix naming the reference followed by a version 6
+// ghost whose snapshots are residuals: the tick against the previous tick
+// plus one, every other field against the reference snapshot at the same
+// tick relative to the start. The saver's item deltas then turn stretches
+// that follow the reference, or follow it at a constant offset, into zeros.
+enum { DELTA_PREFIX_SIZE = 24, DELTA_FORMAT_VERSION = 1 };
+
+static const unsigned char delta_marker[8] = {'T', 'W', 'G', 'D',
+                                              'E', 'L', 'T', 'A'};
+
+typedef struct delta_predictor_t {
+  ghost_cursor_t reference;
+  int start_tick;
+  int prev_tick;
+} delta_predictor_t;
+
+static void init_delta_predictor(delta_predictor_t *predictor,
+                                 const ghost_t *reference, int start_tick) {
+  ghost_cursor_init(&predictor->reference, reference);
+  predictor->start_tick = start_tick;
+  predictor->prev_tick = start_tick - 1;
+}
 
-  memcpy(header.marker, header_marker, sizeof(header_marker));
-  header.version = current_version;
-  strncpy(header.owner, ghost->player, sizeof(header.owner));
-  strncpy(header.map, ghost->map, sizeof(header.map));
-  uint_to_bytes_be(header.num_ticks, ghost->path.num_items);
-  uint_to_bytes_be(header.time, ghost->time);
+// Reference snapshot at the same tick relative to the start, clamped to the
+// ends of the reference.
+static const ghost_character_t *delta_prediction(delta_predictor_t *predictor,
+                                                 int tick) {
+  const ghost_t *reference = predictor->reference.ghost;
+  const ghost_path_t *path = &reference->path;
+  if (path->num_items == 0)
+    return NULL;
+  const int64_t target =
+      (int64_t)reference->start_tick + tick - predictor->start_tick;
+  if (target <= ghost_get_snap(path, 0)->tick)
+    return ghost_get_snap(path, 0);
+  if (target >= ghost_get_snap(path, path->num_items - 1)->tick)
+    return ghost_get_snap(path, path->num_items - 1);
+  return ghost_cursor_snap_at_tick(&predictor->reference, (int)target);
+}
 
-  if (fwrite(&header, sizeof(header), 1, file) != 1) {
-    return false;
+static void delta_apply(delta_predictor_t *predictor,
+                        const ghost_character_t *in, ghost_character_t *out,
+                        int sign) {
+  const int expected_tick = predictor->prev_tick + 1;
+  const int tick = sign > 0 ? (int)((uint32_t)in->tick + expected_tick)
+                            : in->tick;
+  const ghost_character_t *prediction = delta_prediction(predictor, tick);
+
+  const uint32_t *src = (const uint32_t *)in;
+  uint32_t *dst = (uint32_t *)out;
+  const uint32_t *base = (const uint32_t *)prediction;
+  for (int i = 0; i < NUM_CHARACTER_FIELDS - 1; i++) {
+    const uint32_t value = base ? base[i] : 0;
+    dst[i] = sign > 0 ? src[i] + value : src[i] - value;
   }
-  return true;
+  out->tick = sign > 0 ? tick : (int)((uint32_t)in->tick - expected_tick);
+  predictor->prev_tick = tick;
 }
 
-int ghost_save(const ghost_t *ghost, const char *filename) {
+int ghost_save_delta(const ghost_t *ghost, const ghost_t *reference,
+                     const char *filename) {
+  if (!ghost || !reference || !filename)
+    return -1;
+
   FILE *file = fopen(filename, "wb");
   if (!file) {
     fprintf(stderr, "ghost_saver: Failed to open ghost file '%s' for writing\n",
@@ -1095,7 +4160,16 @@ int ghost_save(const ghost_t *ghost, const char *filename) {
     return -1;
   }
 
-  if (!write_header(file, ghost)) {
+  unsigned char prefix[DELTA_PREFIX_SIZE] = {0};
+  const uint64_t reference_hash = ghost_hash(reference);
+  memcpy(prefix, delta_marker, sizeof(delta_marker));
+  prefix[8] = DELTA_FORMAT_VERSION;
+  uint_to_bytes_be(prefix + 12, (unsigned)(reference_hash >> 32));
+  uint_to_bytes_be(prefix + 16, (unsigned)reference_hash);
+  uint_to_bytes_be(prefix + 20, reference->path.num_items);
+  if (fwrite(prefix, sizeof(prefix), 1, file) != 1 ||
+      !write_header(file, ghost, current_version,
+                    GHOST_HUFFMAN_TABLE_NETWORK)) {
     fprintf(stderr,
             "ghost_saver: Failed to write ghost file '%s': failed to write "
             "header\n",
@@ -1104,53 +4178,105 @@ int ghost_save(const ghost_t *ghost, const char *filename) {
     return -1;
   }
 
-  huffman_context_t ctx;
-  huffman_init(&ctx);
-
-  ghost_saver_t saver;
-  memset(&saver, 0, sizeof(saver));
-  saver.file = file;
-  strncpy(saver.filename, filename, sizeof(saver.filename) - 1);
-  saver.huffman = &ctx;
-  saver.last_item.type = -1;
-  reset_saver_buffer(&saver);
-
-  bool error = false;
+  // Stored the way ghost_load reports it, so both sides predict from the
+  // same start.
+  int start_tick = ghost->start_tick;
+  if (start_tick == -1 && ghost->path.num_items > 0)
+    start_tick = ghost_get_snap(&ghost->path, 0)->tick;
 
-  if (!write_data(&saver, GHOSTDATA_TYPE_SKIN, &ghost->skin,
-                  sizeof(ghost_skin_t) - 24)) {
-    error = true;
+  huffman_context_t ctx;
+  huffman_init(&ctx, huffman_table(GHOST_HUFFMAN_TABLE_NETWORK));
+  ghost_saver_t *saver = (ghost_saver_t *)calloc(1, sizeof(ghost_saver_t));
+  bool ok = saver != NULL;
+  if (ok) {
+    saver->file = file;
+    strncpy(saver->filename, filename, sizeof(saver->filename) - 1);
+    saver->huffman = &ctx;
+    saver->last_item.type = -1;
+    reset_saver_buffer(saver);
+    ok = write_data(saver, GHOSTDATA_TYPE_SKIN, &ghost->skin,
+                    sizeof(ghost_skin_t) - 24) &&
+         write_data(saver, GHOSTDATA_TYPE_START_TICK, &start_tick,
+                    sizeof(int));
   }
 
-  if (!error && !write_data(&saver, GHOSTDATA_TYPE_START_TICK,
-                            &ghost->start_tick, sizeof(int))) {
-    error = true;
+  delta_predictor_t predictor;
+  init_delta_predictor(&predictor, reference, start_tick);
+  for (int i = 0; ok && i < ghost->path.num_items; i++) {
+    ghost_character_t residual;
+    delta_apply(&predictor, ghost_get_snap(&ghost->path, i), &residual, -1);
+    ok = write_data(saver, GHOSTDATA_TYPE_CHARACTER, &residual,
+                    sizeof(ghost_character_t));
   }
+  ok = ok && flush_chunk(saver);
+  free(saver);
 
-  for (int i = 0; i < ghost->path.num_items; i++) {
-    if (error)
-      break;
-    ghost_character_t *character = ghost_get_snap(&ghost->path, i);
-    if (!write_data(&saver, GHOSTDATA_TYPE_CHARACTER, character,
-                    sizeof(ghost_character_t))) {
-      error = true;
-    }
+  if (fclose(file) != 0)
+    ok = false;
+  if (!ok) {
+    fprintf(stderr,
+            "ghost_saver: An error occurred while writing ghost data to '%s'\n",
+            filename);
+    return -1;
   }
+  return 0;
+}
 
-  if (!error && !flush_chunk(&saver)) {
-    error = true;
+ghost_t *ghost_load_delta_mem(const void *data, size_t size,
+                              const ghost_t *reference) {
+  if (!data || !reference)
+    return NULL;
+  const unsigned char *bytes = (const unsigned char *)data;
+  if (size < DELTA_PREFIX_SIZE ||
+      memcmp(bytes, delta_marker, sizeof(delta_marker)) != 0 ||
+      bytes[8] != DELTA_FORMAT_VERSION) {
+    fprintf(stderr, "ghost: Failed to read delta ghost: invalid header\n");
+    return NULL;
+  }
+  const uint64_t reference_hash = ((uint64_t)bytes_be_to_uint(bytes + 12)
+                                   << 32) |
+                                  bytes_be_to_uint(bytes + 16);
+  if (reference_hash != ghost_hash(reference)) {
+    fprintf(stderr,
+            "ghost: Failed to read delta ghost: the reference does not match\n");
+    return NULL;
   }
 
-  fclose(file);
+  ghost_t *ghost = ghost_load_mem(bytes + DELTA_PREFIX_SIZE,
+                                  size - DELTA_PREFIX_SIZE);
+  if (!ghost)
+    return NULL;
 
-  if (error) {
+  // The residuals were stored with explicit ticks, so load_ghost left them
+  // untouched; rebuild the snapshots in place.
+  delta_predictor_t predictor;
+  init_delta_predictor(&predictor, reference, ghost->start_tick);
+  for (int i = 0; i < ghost->path.num_items; i++) {
+    ghost_character_t *snap = ghost_get_snap(&ghost->path, i);
+    delta_apply(&predictor, snap, snap, 1);
+  }
+  return ghost;
+}
+
+ghost_t *ghost_load_delta(const char *filename, const ghost_t *reference) {
+  if (!filename)
+    return NULL;
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
     fprintf(stderr,
-            "ghost_saver: An error occurred while writing ghost data to '%s'\n",
+            "ghost_loader: Failed to open ghost file '%s' for reading\n",
             filename);
-    return -1;
+    return NULL;
   }
-
-  return 0;
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = size > 0 ? (unsigned char *)malloc(size) : NULL;
+  const bool read = data && fread(data, size, 1, file) == 1;
+  fclose(file);
+  ghost_t *ghost = read ? ghost_load_delta_mem(data, size, reference) : NULL;
+  free(data);
+  return ghost;
 }
 
 ghost_t *ghost_create(void) {
@@ -1220,3 +4346,668 @@ void ghost_add_snap(ghost_t *ghost, const ghost_character_t *snap) {
   memcpy(&ghost->path.chunks[chunk][pos], snap, sizeof(ghost_character_t));
   ghost->path.num_items++;
 }
+
+// Scalar variants. The SSE4.2 and AVX2 builds of huffman_decompress reuse the
+// same code compiled for the wider instruction set; the others add vector
+// fast paths.
+static int huffman_decompress_scalar(const huffman_context_t *ctx,
+                                     const void *input, int in_size,
+                                     void *output, int out_size) {
+  return huffman_decompress_impl(ctx, input, in_size, output, out_size);
+}
+
+static long var_decompress_scalar(const void *src, int src_size, void *dst,
+                                  int dst_size) {
+  return var_decompress_impl(src, src_size, dst, dst_size);
+}
+
+static long var_compress_scalar(const void *src, int src_size, void *dst,
+                                int dst_size) {
+  return var_compress_impl(src, src_size, dst, dst_size);
+}
+
+static void undiff_item_scalar(const uint32_t *past, const uint32_t *diff,
+                               uint32_t *out, size_t size) {
+  undiff_item_impl(past, diff, out, size);
+}
+
+static void diff_item_scalar(const uint32_t *past, const uint32_t *current,
+                             uint32_t *out, size_t size) {
+  diff_item_impl(past, current, out, size);
+}
+
+static int scan_pairs_scalar(const ghost_character_t *snaps, int count,
+                             const scan_limits_t *limits, uint8_t *flags) {
+  return scan_pairs_impl(snaps, count, limits, flags);
+}
+
+static void resample_frames_scalar(const resample_frame_t *frames, int count,
+                                   ghost_character_t *out) {
+  resample_frames_impl(frames, count, out);
+}
+
+#if defined(GHOST_CODEC_DISPATCH)
+static uint32_t load_u32(const unsigned char *src) {
+  uint32_t value;
+  memcpy(&value, src, sizeof(value));
+  return value;
+}
+
+// Decodes four single-byte varints: six value bits, bit 6 the sign.
+CODEC_TARGET_SSE42 static __m128i unpack_small_sse42(__m128i bytes) {
+  const __m128i value = _mm_and_si128(bytes, _mm_set1_epi32(0x3F));
+  const __m128i sign = _mm_srai_epi32(_mm_slli_epi32(bytes, 25), 31);
+  return _mm_xor_si128(value, sign);
+}
+
+CODEC_TARGET_SSE42 static int huffman_decompress_sse42(
+    const huffman_context_t *ctx, const void *input, int in_size,
+    void *output, int out_size) {
+  return huffman_decompress_impl(ctx, input, in_size, output, out_size);
+}
+
+// Runs of bytes without a continuation bit are single-byte varints, which
+// make up most of a delta-coded chunk. Those are decoded 16 at a time.
+CODEC_TARGET_SSE42 static long var_decompress_sse42(const void *src_void,
+                                                    int src_size,
+                                                    void *dst_void,
+                                                    int dst_size) {
+  if (dst_size % sizeof(int) != 0)
+    return -1;
+
+  const unsigned char *src = (const unsigned char *)src_void;
+  const unsigned char *src_end = src + src_size;
+  int *dst = (int *)dst_void;
+  const int *dst_end = dst + dst_size / sizeof(int);
+  while (src_end - src >= 16 && dst_end - dst >= 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)src);
+    const unsigned continued = (unsigned)_mm_movemask_epi8(bytes);
+    const int run = continued ? __builtin_ctz(continued) : 16;
+    if (run > 0) {
+      for (int i = 0; i < run; i += 4)
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         unpack_small_sse42(_mm_cvtepu8_epi32(
+                             _mm_cvtsi32_si128((int)load_u32(src + i)))));
+      src += run;
+      dst += run;
+    }
+    if (run < 16) {
+      src = var_unpack(src, dst, src_end - src);
+      if (!src)
+        return -1;
+      dst++;
+    }
+  }
+
+  const long done = (long)((unsigned char *)dst - (unsigned char *)dst_void);
+  const long rest = var_decompress_impl(src, (int)(src_end - src), dst,
+                                        dst_size - (int)done);
+  return rest < 0 ? -1 : done + rest;
+}
+
+// Four values in [-64, 63] pack to four single bytes.
+CODEC_TARGET_SSE42 static long var_compress_sse42(const void *src_void,
+                                                  int src_size,
+                                                  void *dst_void,
+                                                  int dst_size) {
+  if (src_size % sizeof(int) != 0)
+    return -1;
+
+  const int *src = (const int *)src_void;
+  const int *src_end = src + src_size / sizeof(int);
+  unsigned char *dst = (unsigned char *)dst_void;
+  const unsigned char *dst_end = dst + dst_size;
+  while (src_end - src >= 4 && dst_end - dst >= 4) {
+    const __m128i values = _mm_loadu_si128((const __m128i *)src);
+    const __m128i sign = _mm_srai_epi32(values, 31);
+    const __m128i magnitude = _mm_xor_si128(values, sign);
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x3F)))) {
+      dst = var_pack(dst, *src, dst_end - dst);
+      if (!dst)
+        return -1;
+      src++;
+      continue;
+    }
+    const __m128i bytes = _mm_or_si128(
+        magnitude, _mm_and_si128(sign, _mm_set1_epi32(0x40)));
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(bytes, bytes),
+                                            _mm_setzero_si128());
+    const uint32_t out = (uint32_t)_mm_cvtsi128_si32(packed);
+    memcpy(dst, &out, sizeof(out));
+    src += 4;
+    dst += 4;
+  }
+
+  const long done = (long)(dst - (unsigned char *)dst_void);
+  const long rest = var_compress_impl(src, (int)((src_end - src) * sizeof(int)),
+                                      dst, dst_size - (int)done);
+  return rest < 0 ? -1 : done + rest;
+}
+
+CODEC_TARGET_SSE42 static void undiff_item_sse42(const uint32_t *past,
+                                                 const uint32_t *diff,
+                                                 uint32_t *out, size_t size) {
+  for (; size >= 4; size -= 4, past += 4, diff += 4, out += 4)
+    _mm_storeu_si128(
+        (__m128i *)out,
+        _mm_add_epi32(_mm_loadu_si128((const __m128i *)past),
+                      _mm_loadu_si128((const __m128i *)diff)));
+  undiff_item_impl(past, diff, out, size);
+}
+
+CODEC_TARGET_SSE42 static void diff_item_sse42(const uint32_t *past,
+                                               const uint32_t *current,
+                                               uint32_t *out, size_t size) {
+  for (; size >= 4; size -= 4, past += 4, current += 4, out += 4)
+    _mm_storeu_si128(
+        (__m128i *)out,
+        _mm_sub_epi32(_mm_loadu_si128((const __m128i *)current),
+                      _mm_loadu_si128((const __m128i *)past)));
+  diff_item_impl(past, current, out, size);
+}
+
+CODEC_TARGET_SSE42 static int scan_pairs_sse42(const ghost_character_t *snaps,
+                                               int count,
+                                               const scan_limits_t *limits,
+                                               uint8_t *flags) {
+  return scan_pairs_impl(snaps, count, limits, flags);
+}
+
+// Position and velocity are the first four fields, blended two at a time.
+CODEC_TARGET_SSE42 static void resample_frames_sse42(
+    const resample_frame_t *frames, int count, ghost_character_t *out) {
+  const __m128d sign = _mm_set1_pd(-0.0);
+  const __m128d half = _mm_set1_pd(0.5);
+  const __m128d one = _mm_set1_pd(1.0);
+  for (int i = 0; i < count; i++) {
+    const ghost_character_t *prev = frames[i].prev;
+    const ghost_character_t *next = frames[i].next;
+    const __m128d amount = _mm_set1_pd(frames[i].amount);
+    const __m128i a = _mm_loadu_si128((const __m128i *)prev);
+    const __m128i b = _mm_loadu_si128((const __m128i *)next);
+    __m128i halves[2];
+    for (int h = 0; h < 2; h++) {
+      const __m128d from = _mm_cvtepi32_pd(h ? _mm_srli_si128(a, 8) : a);
+      const __m128d to = _mm_cvtepi32_pd(h ? _mm_srli_si128(b, 8) : b);
+      const __m128d mixed =
+          _mm_add_pd(from, _mm_mul_pd(_mm_sub_pd(to, from), amount));
+      // round_frame_value on both lanes.
+      const __m128d whole =
+          _mm_round_pd(mixed, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      const __m128d away = _mm_or_pd(one, _mm_and_pd(mixed, sign));
+      const __m128d far = _mm_cmpge_pd(
+          _mm_andnot_pd(sign, _mm_sub_pd(mixed, whole)), half);
+      halves[h] = _mm_cvttpd_epi32(_mm_add_pd(whole, _mm_and_pd(far, away)));
+    }
+    out[i] = *prev;
+    _mm_storeu_si128((__m128i *)&out[i],
+                     _mm_unpacklo_epi64(halves[0], halves[1]));
+    out[i].angle = round_frame_value(
+        mix_angle(prev->angle, next->angle, frames[i].amount));
+  }
+}
+
+CODEC_TARGET_AVX2 static __m256i unpack_small_avx2(__m256i bytes) {
+  const __m256i value = _mm256_and_si256(bytes, _mm256_set1_epi32(0x3F));
+  const __m256i sign = _mm256_srai_epi32(_mm256_slli_epi32(bytes, 25), 31);
+  return _mm256_xor_si256(value, sign);
+}
+
+CODEC_TARGET_AVX2 static int huffman_decompress_avx2(
+    const huffman_context_t *ctx, const void *input, int in_size,
+    void *output, int out_size) {
+  return huffman_decompress_impl(ctx, input, in_size, output, out_size);
+}
+
+CODEC_TARGET_AVX2 static long var_decompress_avx2(const void *src_void,
+                                                  int src_size,
+                                                  void *dst_void,
+                                                  int dst_size) {
+  if (dst_size % sizeof(int) != 0)
+    return -1;
+
+  const unsigned char *src = (const unsigned char *)src_void;
+  const unsigned char *src_end = src + src_size;
+  int *dst = (int *)dst_void;
+  const int *dst_end = dst + dst_size / sizeof(int);
+  while (src_end - src >= 32 && dst_end - dst >= 32) {
+    const __m256i bytes = _mm256_loadu_si256((const __m256i *)src);
+    const unsigned continued = (unsigned)_mm256_movemask_epi8(bytes);
+    const int run = continued ? __builtin_ctz(continued) : 32;
+    if (run > 0) {
+      for (int i = 0; i < run; i += 8)
+        _mm256_storeu_si256(
+            (__m256i *)(dst + i),
+            unpack_small_avx2(_mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i *)(src + i)))));
+      src += run;
+      dst += run;
+    }
+    if (run < 32) {
+      src = var_unpack(src, dst, src_end - src);
+      if (!src)
+        return -1;
+      dst++;
+    }
+  }
+
+  const long done = (long)((unsigned char *)dst - (unsigned char *)dst_void);
+  const long rest = var_decompress_impl(src, (int)(src_end - src), dst,
+                                        dst_size - (int)done);
+  return rest < 0 ? -1 : done + rest;
+}
+
+CODEC_TARGET_AVX2 static long var_compress_avx2(const void *src_void,
+                                                int src_size, void *dst_void,
+                                                int dst_size) {
+  if (src_size % sizeof(int) != 0)
+    return -1;
+
+  const int *src = (const int *)src_void;
+  const int *src_end = src + src_size / sizeof(int);
+  unsigned char *dst = (unsigned char *)dst_void;
+  const unsigned char *dst_end = dst + dst_size;
+  while (src_end - src >= 8 && dst_end - dst >= 8) {
+    const __m256i values = _mm256_loadu_si256((const __m256i *)src);
+    const __m256i sign = _mm256_srai_epi32(values, 31);
+    const __m256i magnitude = _mm256_xor_si256(values, sign);
+    const unsigned large = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpgt_epi32(magnitude, _mm256_set1_epi32(0x3F)));
+    if (large) {
+      // Pack the small values in front of the first large one one by one.
+      const int small = __builtin_ctz(large) / 4;
+      for (int i = 0; i <= small; i++) {
+        dst = var_pack(dst, src[i], dst_end - dst);
+        if (!dst)
+          return -1;
+      }
+      src += small + 1;
+      continue;
+    }
+    const __m256i bytes = _mm256_or_si256(
+        magnitude, _mm256_and_si256(sign, _mm256_set1_epi32(0x40)));
+    const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(bytes),
+                                          _mm256_extracti128_si256(bytes, 1));
+    const __m128i packed = _mm_packus_epi16(words, words);
+    _mm_storel_epi64((__m128i *)dst, packed);
+    src += 8;
+    dst += 8;
+  }
+
+  const long done = (long)(dst - (unsigned char *)dst_void);
+  const long rest = var_compress_impl(src, (int)((src_end - src) * sizeof(int)),
+                                      dst, dst_size - (int)done);
+  return rest < 0 ? -1 : done + rest;
+}
+
+CODEC_TARGET_AVX2 static void undiff_item_avx2(const uint32_t *past,
+                                               const uint32_t *diff,
+                                               uint32_t *out, size_t size) {
+  for (; size >= 8; size -= 8, past += 8, diff += 8, out += 8)
+    _mm256_storeu_si256(
+        (__m256i *)out,
+        _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)past),
+                         _mm256_loadu_si256((const __m256i *)diff)));
+  undiff_item_sse42(past, diff, out, size);
+}
+
+CODEC_TARGET_AVX2 static void diff_item_avx2(const uint32_t *past,
+                                             const uint32_t *current,
+                                             uint32_t *out, size_t size) {
+  for (; size >= 8; size -= 8, past += 8, current += 8, out += 8)
+    _mm256_storeu_si256(
+        (__m256i *)out,
+        _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)current),
+                         _mm256_loadu_si256((const __m256i *)past)));
+  diff_item_sse42(past, current, out, size);
+}
+
+CODEC_TARGET_AVX2 static __m256i clamp_avx2(__m256i value, int min, int max) {
+  return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_set1_epi32(min)),
+                          _mm256_set1_epi32(max));
+}
+
+// Lane i of the result is lane i - 1 of `current`, lane 0 is lane 7 of
+// `previous`.
+CODEC_TARGET_AVX2 static __m256i shift_in_avx2(__m256i current,
+                                               __m256i previous) {
+  const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+  return _mm256_blend_epi32(_mm256_permutevar8x32_epi32(current, rotate),
+                            _mm256_permutevar8x32_epi32(previous, rotate),
+                            0x01);
+}
+
+CODEC_TARGET_AVX2 static __m256i hook_index_avx2(__m256i hook_state,
+                                                 __m256i *invalid) {
+  *invalid = _mm256_or_si256(
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(HOOK_RETRACTED), hook_state),
+      _mm256_cmpgt_epi32(hook_state, _mm256_set1_epi32(HOOK_GRABBED)));
+  return _mm256_blendv_epi8(
+      _mm256_add_epi32(hook_state, _mm256_set1_epi32(1)),
+      _mm256_set1_epi32(7), *invalid);
+}
+
+CODEC_TARGET_AVX2 static __m256i hook_attached_avx2(__m256i hook_state) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi32(hook_state, _mm256_set1_epi32(HOOK_FLYING - 1)),
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(HOOK_GRABBED + 1), hook_state));
+}
+
+CODEC_TARGET_AVX2 static __m256i flag_avx2(__m256i mask, int flag) {
+  return _mm256_and_si256(mask, _mm256_set1_epi32(flag));
+}
+
+// Eight pairs per step: eight snapshots are transposed into one vector per
+// field, and the snapshot before each lane is shifted in from the previous
+// step.
+CODEC_TARGET_AVX2 static int scan_pairs_avx2(const ghost_character_t *snaps,
+                                             int count,
+                                             const scan_limits_t *limits,
+                                             uint8_t *flags) {
+  if (count < 2)
+    return 0;
+
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i transitions =
+      _mm256_loadu_si256((const __m256i *)hook_transitions);
+  const __m256i max_tick_gap = _mm256_set1_epi32(limits->max_tick_gap);
+  const __m256i max_step = _mm256_set1_epi32(limits->max_step);
+  const __m256i max_velocity = _mm256_set1_epi32(limits->max_velocity);
+  const __m256i max_velocity_error =
+      _mm256_set1_epi32(limits->max_velocity_error);
+  const __m256i max_angle_step = _mm256_set1_epi32(limits->max_angle_step);
+  const __m256i max_hook_step = _mm256_set1_epi32(limits->max_hook_step);
+  const __m256i check_attack_tick =
+      _mm256_set1_epi32(limits->check_attack_tick);
+
+  __m256i prev_x = _mm256_set1_epi32(
+      clamp_int(snaps[0].x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  __m256i prev_y = _mm256_set1_epi32(
+      clamp_int(snaps[0].y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  __m256i prev_angle = _mm256_set1_epi32(
+      clamp_int(snaps[0].angle, SCAN_ANGLE_MIN, SCAN_ANGLE_MAX));
+  __m256i prev_hook_index =
+      _mm256_set1_epi32(hook_state_index(snaps[0].hook_state));
+  __m256i prev_attached =
+      _mm256_set1_epi32(hook_attached(snaps[0].hook_state) ? -1 : 0);
+  __m256i prev_hook_x = _mm256_set1_epi32(
+      clamp_int(snaps[0].hook_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  __m256i prev_hook_y = _mm256_set1_epi32(
+      clamp_int(snaps[0].hook_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT));
+  __m256i prev_attack_tick = _mm256_set1_epi32(snaps[0].attack_tick);
+  __m256i prev_tick = _mm256_set1_epi32(snaps[0].tick);
+
+  __m256i any = zero;
+  int i = 1;
+  for (; i + 8 <= count; i += 8) {
+    const int *src = (const int *)&snaps[i];
+    __m256i rows[8];
+    for (int k = 0; k < 8; k++)
+      rows[k] = _mm256_loadu_si256((const __m256i *)(src + k * 12));
+    __m256i t[8];
+    for (int k = 0; k < 8; k += 2) {
+      t[k] = _mm256_unpacklo_epi32(rows[k], rows[k + 1]);
+      t[k + 1] = _mm256_unpackhi_epi32(rows[k], rows[k + 1]);
+    }
+    const __m256i u0 = _mm256_unpacklo_epi64(t[0], t[2]);
+    const __m256i u1 = _mm256_unpackhi_epi64(t[0], t[2]);
+    const __m256i u2 = _mm256_unpacklo_epi64(t[1], t[3]);
+    const __m256i u3 = _mm256_unpackhi_epi64(t[1], t[3]);
+    const __m256i u4 = _mm256_unpacklo_epi64(t[4], t[6]);
+    const __m256i u5 = _mm256_unpackhi_epi64(t[4], t[6]);
+    const __m256i u6 = _mm256_unpacklo_epi64(t[5], t[7]);
+    const __m256i u7 = _mm256_unpackhi_epi64(t[5], t[7]);
+    const __m256i raw_x = _mm256_permute2x128_si256(u0, u4, 0x20);
+    const __m256i raw_y = _mm256_permute2x128_si256(u1, u5, 0x20);
+    const __m256i raw_vel_x = _mm256_permute2x128_si256(u2, u6, 0x20);
+    const __m256i raw_vel_y = _mm256_permute2x128_si256(u3, u7, 0x20);
+    const __m256i raw_angle = _mm256_permute2x128_si256(u0, u4, 0x31);
+    const __m256i hook_state = _mm256_permute2x128_si256(u3, u7, 0x31);
+
+    __m256i s[4];
+    for (int k = 0; k < 4; k++)
+      s[k] = _mm256_set_m128i(
+          _mm_loadu_si128((const __m128i *)(src + (k + 4) * 12 + 8)),
+          _mm_loadu_si128((const __m128i *)(src + k * 12 + 8)));
+    const __m256i v0 = _mm256_unpacklo_epi32(s[0], s[1]);
+    const __m256i v1 = _mm256_unpackhi_epi32(s[0], s[1]);
+    const __m256i v2 = _mm256_unpacklo_epi32(s[2], s[3]);
+    const __m256i v3 = _mm256_unpackhi_epi32(s[2], s[3]);
+    const __m256i raw_hook_x = _mm256_unpacklo_epi64(v0, v2);
+    const __m256i raw_hook_y = _mm256_unpackhi_epi64(v0, v2);
+    const __m256i attack_tick = _mm256_unpacklo_epi64(v1, v3);
+    const __m256i tick = _mm256_unpackhi_epi64(v1, v3);
+
+    const __m256i x = clamp_avx2(raw_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    const __m256i y = clamp_avx2(raw_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    const __m256i vel_x =
+        clamp_avx2(raw_vel_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    const __m256i vel_y =
+        clamp_avx2(raw_vel_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    const __m256i angle =
+        clamp_avx2(raw_angle, SCAN_ANGLE_MIN, SCAN_ANGLE_MAX);
+    const __m256i hook_x =
+        clamp_avx2(raw_hook_x, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    const __m256i hook_y =
+        clamp_avx2(raw_hook_y, -SCAN_COORD_LIMIT, SCAN_COORD_LIMIT);
+    __m256i hook_invalid;
+    const __m256i hook_index = hook_index_avx2(hook_state, &hook_invalid);
+    const __m256i attached = hook_attached_avx2(hook_state);
+
+    // Single snapshot checks.
+    __m256i velocity = _mm256_cmpgt_epi32(
+        _mm256_max_epi32(_mm256_abs_epi32(vel_x), _mm256_abs_epi32(vel_y)),
+        max_velocity);
+    __m256i angle_bad = _mm256_cmpeq_epi32(raw_angle, angle);
+    angle_bad = _mm256_xor_si256(angle_bad, _mm256_set1_epi32(-1));
+    __m256i hook = hook_invalid;
+    __m256i attack = _mm256_and_si256(
+        check_attack_tick, _mm256_cmpgt_epi32(attack_tick, tick));
+
+    // Pair checks.
+    const __m256i dt = _mm256_sub_epi32(tick, shift_in_avx2(tick, prev_tick));
+    const __m256i tick_gap =
+        _mm256_or_si256(_mm256_cmpgt_epi32(one, dt),
+                        _mm256_cmpgt_epi32(dt, max_tick_gap));
+    attack = _mm256_or_si256(
+        attack, _mm256_cmpgt_epi32(
+                    shift_in_avx2(attack_tick, prev_attack_tick), attack_tick));
+    const __m256i consecutive = _mm256_cmpeq_epi32(dt, one);
+
+    const __m256i dx = _mm256_sub_epi32(x, shift_in_avx2(x, prev_x));
+    const __m256i dy = _mm256_sub_epi32(y, shift_in_avx2(y, prev_y));
+    const __m256i teleport = _mm256_and_si256(
+        consecutive,
+        _mm256_cmpgt_epi32(
+            _mm256_max_epi32(_mm256_abs_epi32(dx), _mm256_abs_epi32(dy)),
+            max_step));
+
+    const __m256i error_x = _mm256_abs_epi32(_mm256_sub_epi32(
+        _mm256_slli_epi32(clamp_avx2(dx, -SCAN_DELTA_LIMIT, SCAN_DELTA_LIMIT),
+                          8),
+        vel_x));
+    const __m256i error_y = _mm256_abs_epi32(_mm256_sub_epi32(
+        _mm256_slli_epi32(clamp_avx2(dy, -SCAN_DELTA_LIMIT, SCAN_DELTA_LIMIT),
+                          8),
+        vel_y));
+    velocity = _mm256_or_si256(
+        velocity,
+        _mm256_and_si256(consecutive,
+                         _mm256_cmpgt_epi32(_mm256_max_epi32(error_x, error_y),
+                                            max_velocity_error)));
+
+    __m256i angle_step = _mm256_abs_epi32(
+        _mm256_sub_epi32(angle, shift_in_avx2(angle, prev_angle)));
+    angle_step = _mm256_min_epi32(
+        angle_step,
+        _mm256_sub_epi32(_mm256_set1_epi32(SCAN_ANGLE_CIRCLE), angle_step));
+    angle_bad = _mm256_or_si256(
+        angle_bad, _mm256_and_si256(consecutive,
+                                    _mm256_cmpgt_epi32(angle_step,
+                                                       max_angle_step)));
+
+    const __m256i allowed = _mm256_permutevar8x32_epi32(
+        transitions, shift_in_avx2(hook_index, prev_hook_index));
+    const __m256i transition_bad = _mm256_cmpeq_epi32(
+        _mm256_and_si256(_mm256_srlv_epi32(allowed, hook_index), one), zero);
+    const __m256i hook_dx =
+        _mm256_sub_epi32(hook_x, shift_in_avx2(hook_x, prev_hook_x));
+    const __m256i hook_dy =
+        _mm256_sub_epi32(hook_y, shift_in_avx2(hook_y, prev_hook_y));
+    const __m256i hook_jump = _mm256_and_si256(
+        _mm256_and_si256(attached, shift_in_avx2(attached, prev_attached)),
+        _mm256_cmpgt_epi32(_mm256_max_epi32(_mm256_abs_epi32(hook_dx),
+                                            _mm256_abs_epi32(hook_dy)),
+                           max_hook_step));
+    hook = _mm256_or_si256(
+        hook, _mm256_and_si256(consecutive,
+                               _mm256_or_si256(transition_bad, hook_jump)));
+
+    const __m256i result = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_or_si256(flag_avx2(tick_gap, GHOST_SCAN_TICK_GAP),
+                            flag_avx2(teleport, GHOST_SCAN_TELEPORT)),
+            _mm256_or_si256(flag_avx2(velocity, GHOST_SCAN_VELOCITY),
+                            flag_avx2(angle_bad, GHOST_SCAN_ANGLE))),
+        _mm256_or_si256(flag_avx2(hook, GHOST_SCAN_HOOK),
+                        flag_avx2(attack, GHOST_SCAN_ATTACK)));
+
+    if (_mm256_testz_si256(result, result)) {
+      memset(flags + i - 1, 0, 8);
+    } else {
+      const __m256i bytes = _mm256_packus_epi16(
+          _mm256_packus_epi32(result, result), zero);
+      const uint32_t low = (uint32_t)_mm256_extract_epi32(bytes, 0);
+      const uint32_t high = (uint32_t)_mm256_extract_epi32(bytes, 4);
+      memcpy(flags + i - 1, &low, 4);
+      memcpy(flags + i + 3, &high, 4);
+      any = _mm256_or_si256(any, result);
+    }
+
+    prev_x = x;
+    prev_y = y;
+    prev_angle = angle;
+    prev_hook_index = hook_index;
+    prev_attached = attached;
+    prev_hook_x = hook_x;
+    prev_hook_y = hook_y;
+    prev_attack_tick = attack_tick;
+    prev_tick = tick;
+  }
+
+  int any_flags = 0;
+  if (!_mm256_testz_si256(any, any)) {
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, any);
+    for (int k = 0; k < 8; k++)
+      any_flags |= lanes[k];
+  }
+  if (i < count)
+    any_flags |= scan_pairs_impl(snaps + i - 1, count - i + 1, limits,
+                                 flags + i - 1);
+  return any_flags;
+}
+
+// Position and velocity are the first four fields, blended in one register.
+CODEC_TARGET_AVX2 static void resample_frames_avx2(
+    const resample_frame_t *frames, int count, ghost_character_t *out) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d one = _mm256_set1_pd(1.0);
+  for (int i = 0; i < count; i++) {
+    const ghost_character_t *prev = frames[i].prev;
+    const ghost_character_t *next = frames[i].next;
+    const __m256d from =
+        _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)prev));
+    const __m256d to =
+        _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)next));
+    const __m256d mixed = _mm256_add_pd(
+        from, _mm256_mul_pd(_mm256_sub_pd(to, from),
+                            _mm256_set1_pd(frames[i].amount)));
+    // round_frame_value on all four lanes.
+    const __m256d whole =
+        _mm256_round_pd(mixed, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256d away = _mm256_or_pd(one, _mm256_and_pd(mixed, sign));
+    const __m256d far = _mm256_cmp_pd(
+        _mm256_andnot_pd(sign, _mm256_sub_pd(mixed, whole)), half, _CMP_GE_OQ);
+    out[i] = *prev;
+    _mm_storeu_si128((__m128i *)&out[i],
+                     _mm256_cvttpd_epi32(
+                         _mm256_add_pd(whole, _mm256_and_pd(far, away))));
+    out[i].angle = round_frame_value(
+        mix_angle(prev->angle, next->angle, frames[i].amount));
+  }
+}
+#endif
+
+static const codec_kernels_t codec_variants[GHOST_SIMD_NUM_VARIANTS] = {
+    {huffman_decompress_scalar, var_decompress_scalar, var_compress_scalar,
+     undiff_item_scalar, diff_item_scalar, scan_pairs_scalar,
+     resample_frames_scalar},
+#if defined(GHOST_CODEC_DISPATCH)
+    {huffman_decompress_sse42, var_decompress_sse42, var_compress_sse42,
+     undiff_item_sse42, diff_item_sse42, scan_pairs_sse42,
+     resample_frames_sse42},
+    {huffman_decompress_avx2, var_decompress_avx2, var_compress_avx2,
+     undiff_item_avx2, diff_item_avx2, scan_pairs_avx2, resample_frames_avx2},
+#endif
+};
+
+static const char *const codec_variant_names[GHOST_SIMD_NUM_VARIANTS] = {
+    "scalar", "sse4.2", "avx2"};
+
+#if defined(GHOST_CODEC_DISPATCH)
+// -1 until the first codec call detects the CPU. Every thread computes the
+// same value, so a racing first call is harmless.
+static int codec_variant = -1;
+#endif
+
+int ghost_simd_supported(int variant) {
+  if (variant == GHOST_SIMD_SCALAR)
+    return 1;
+#if defined(GHOST_CODEC_DISPATCH)
+  __builtin_cpu_init();
+  if (variant == GHOST_SIMD_SSE42)
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+  if (variant == GHOST_SIMD_AVX2)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") &&
+           __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+#endif
+  return 0;
+}
+
+int ghost_simd_variant(void) {
+#if defined(GHOST_CODEC_DISPATCH)
+  int variant = __atomic_load_n(&codec_variant, __ATOMIC_RELAXED);
+  if (variant < 0) {
+    variant = GHOST_SIMD_AVX2;
+    while (!ghost_simd_supported(variant))
+      variant--;
+    __atomic_store_n(&codec_variant, variant, __ATOMIC_RELAXED);
+  }
+  return variant;
+#else
+  return GHOST_SIMD_SCALAR;
+#endif
+}
+
+int ghost_simd_set_variant(int variant) {
+  if (variant < 0 || variant >= GHOST_SIMD_NUM_VARIANTS ||
+      !ghost_simd_supported(variant))
+    return -1;
+#if defined(GHOST_CODEC_DISPATCH)
+  __atomic_store_n(&codec_variant, variant, __ATOMIC_RELAXED);
+#endif
+  return 0;
+}
+
+const char *ghost_simd_variant_name(int variant) {
+  if (variant < 0 || variant >= GHOST_SIMD_NUM_VARIANTS)
+    return NULL;
+  return codec_variant_names[variant];
+}
+
+static const codec_kernels_t *codec_kernels(void) {
+  return &codec_variants[ghost_simd_variant()];
+}
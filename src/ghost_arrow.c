@@ -0,0 +1,712 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ddnet_ghost/ghost_arrow.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+// Arrow IPC file layout: magic, schema message, record batch messages, end of
+// stream marker, footer, footer size, magic. Message metadata and the footer
+// are flatbuffers, built here front to back so that every offset points
+// forward. Values are little endian.
+enum {
+  BATCH_ROWS = 4096,
+  PLAYER_LENGTH = 16,
+  NUM_CHARACTER_FIELDS = sizeof(ghost_character_t) / sizeof(int),
+  NUM_INT_COLUMNS = 3 + NUM_CHARACTER_FIELDS,
+  NUM_COLUMNS = NUM_INT_COLUMNS + 1,
+  // Validity and values for int32 columns, plus offsets for the string.
+  NUM_BUFFERS = NUM_COLUMNS * 2 + 1,
+  PLAYER_COLUMN = 1,
+
+  METADATA_VERSION_V5 = 4,
+  MESSAGE_SCHEMA = 1,
+  MESSAGE_RECORD_BATCH = 3,
+  TYPE_INT = 2,
+  TYPE_UTF8 = 5,
+};
+
+static const char arrow_magic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+
+// Column order of the table. The string column sits at PLAYER_COLUMN, the
+// int32 columns fill the remaining slots in order.
+static const char *const column_names[NUM_COLUMNS] = {
+    "ghost",      "player", "time",   "start_tick",  "x",    "y",
+    "vel_x",      "vel_y",  "angle",  "direction",   "weapon",
+    "hook_state", "hook_x", "hook_y", "attack_tick", "tick",
+};
+
+typedef struct arrow_block_t {
+  int64_t offset;
+  int32_t metadata_length;
+  int64_t body_length;
+} arrow_block_t;
+
+struct ghost_arrow_writer_t {
+  FILE *file;
+  char filename[512];
+  char map[64];
+  bool has_map;
+  bool error;
+  int64_t offset;
+
+  arrow_block_t *blocks;
+  int num_blocks;
+  int blocks_capacity;
+
+  int num_ghosts;
+  int num_rows;
+  unsigned char int_columns[NUM_INT_COLUMNS][BATCH_ROWS * 4];
+  unsigned char player_offsets[(BATCH_ROWS + 1) * 4];
+  char player_data[BATCH_ROWS * PLAYER_LENGTH];
+  int player_size;
+
+  // Rollback point while ghost_arrow_add_file decodes a ghost: the rows of
+  // earlier ghosts still buffered and the file position before the first
+  // batch holding rows of this ghost. The buffered rows are saved when that
+  // batch is flushed.
+  bool in_ghost;
+  bool saved;
+  int ghost_rows;
+  int ghost_player_size;
+  int ghost_blocks;
+  int64_t ghost_offset;
+  unsigned char saved_int_columns[NUM_INT_COLUMNS][BATCH_ROWS * 4];
+  unsigned char saved_player_offsets[BATCH_ROWS * 4];
+  char saved_player_data[BATCH_ROWS * PLAYER_LENGTH];
+};
+
+static void uint32_to_le(unsigned char *bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    bytes[i] = (value >> (8 * i)) & 0xff;
+}
+
+typedef struct fb_builder_t {
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+  bool error;
+} fb_builder_t;
+
+// A table field: `size` 1, 2, 4 or 8 for scalars, FB_OFFSET for a reference
+// linked later with fb_link, 0 if absent.
+typedef struct fb_field_t {
+  int size;
+  uint64_t value;
+} fb_field_t;
+
+enum { FB_OFFSET = -4 };
+
+// Reserves `size` zeroed bytes aligned to `align` and returns their position.
+static size_t fb_alloc(fb_builder_t *fb, size_t size, size_t align) {
+  size_t pos = (fb->size + align - 1) & ~(align - 1);
+  if (pos + size > fb->capacity) {
+    size_t capacity = fb->capacity ? fb->capacity * 2 : 1024;
+    while (capacity < pos + size)
+      capacity *= 2;
+    unsigned char *data = (unsigned char *)realloc(fb->data, capacity);
+    if (!data) {
+      fb->error = true;
+      return 0;
+    }
+    fb->data = data;
+    fb->capacity = capacity;
+  }
+  memset(fb->data + fb->size, 0, pos + size - fb->size);
+  fb->size = pos + size;
+  return pos;
+}
+
+static void fb_put(fb_builder_t *fb, size_t pos, uint64_t value, int size) {
+  if (fb->error)
+    return;
+  for (int i = 0; i < size; i++)
+    fb->data[pos + i] = (value >> (8 * i)) & 0xff;
+}
+
+static void fb_link(fb_builder_t *fb, size_t field, size_t target) {
+  fb_put(fb, field, target - field, 4);
+}
+
+// Writes a vtable followed by its table. `positions` receives where each
+// field ended up, for linking references.
+static size_t fb_table(fb_builder_t *fb, const fb_field_t *fields,
+                       int num_fields, size_t *positions) {
+  uint16_t offsets[8] = {0};
+  int table_size = 4;
+  for (int i = 0; i < num_fields; i++) {
+    const int size = fields[i].size < 0 ? -fields[i].size : fields[i].size;
+    if (size == 0)
+      continue;
+    table_size = (table_size + size - 1) & ~(size - 1);
+    offsets[i] = (uint16_t)table_size;
+    table_size += size;
+  }
+
+  const size_t vtable = fb_alloc(fb, 4 + 2 * num_fields, 2);
+  fb_put(fb, vtable, 4 + 2 * num_fields, 2);
+  fb_put(fb, vtable + 2, table_size, 2);
+  for (int i = 0; i < num_fields; i++)
+    fb_put(fb, vtable + 4 + 2 * i, offsets[i], 2);
+
+  const size_t table = fb_alloc(fb, table_size, 8);
+  fb_put(fb, table, table - vtable, 4);
+  for (int i = 0; i < num_fields; i++) {
+    if (positions)
+      positions[i] = table + offsets[i];
+    if (fields[i].size > 0)
+      fb_put(fb, table + offsets[i], fields[i].value, fields[i].size);
+  }
+  return table;
+}
+
+// Returns the position of the length; elements follow it.
+static size_t fb_vector(fb_builder_t *fb, int count, int element_size,
+                        int element_align) {
+  while ((fb->size + 4) % element_align != 0 || fb->size % 4 != 0)
+    fb_alloc(fb, 1, 1);
+  const size_t vector = fb_alloc(fb, 4 + (size_t)count * element_size, 4);
+  fb_put(fb, vector, count, 4);
+  return vector;
+}
+
+static size_t fb_string(fb_builder_t *fb, const char *str) {
+  const size_t length = strlen(str);
+  const size_t pos = fb_alloc(fb, 4 + length + 1, 4);
+  fb_put(fb, pos, length, 4);
+  if (!fb->error)
+    memcpy(fb->data + pos + 4, str, length);
+  return pos;
+}
+
+static size_t fb_begin(fb_builder_t *fb) {
+  fb->size = 0;
+  fb->error = false;
+  return fb_alloc(fb, 4, 4);
+}
+
+static size_t build_schema(fb_builder_t *fb,
+                           const ghost_arrow_writer_t *writer) {
+  const fb_field_t fields[3] = {
+      {2, 0},                               // endianness: little
+      {FB_OFFSET, 0},                       // fields
+      {writer->has_map ? FB_OFFSET : 0, 0}, // custom_metadata
+  };
+  size_t positions[3];
+  const size_t schema = fb_table(fb, fields, 3, positions);
+
+  const size_t columns = fb_vector(fb, NUM_COLUMNS, 4, 4);
+  fb_link(fb, positions[1], columns);
+  for (int i = 0; i < NUM_COLUMNS; i++) {
+    const fb_field_t field_fields[6] = {
+        {FB_OFFSET, 0},                                 // name
+        {1, 0},                                         // nullable
+        {1, i == PLAYER_COLUMN ? TYPE_UTF8 : TYPE_INT}, // type_type
+        {FB_OFFSET, 0},                                 // type
+        {0, 0},                                         // dictionary
+        {FB_OFFSET, 0},                                 // children
+    };
+    size_t field_positions[6];
+    const size_t field = fb_table(fb, field_fields, 6, field_positions);
+    fb_link(fb, columns + 4 + 4 * i, field);
+
+    fb_link(fb, field_positions[0], fb_string(fb, column_names[i]));
+    if (i == PLAYER_COLUMN) {
+      fb_link(fb, field_positions[3], fb_table(fb, NULL, 0, NULL));
+    } else {
+      const fb_field_t int_fields[2] = {{4, 32}, {1, 1}}; // bitWidth, signed
+      fb_link(fb, field_positions[3], fb_table(fb, int_fields, 2, NULL));
+    }
+    fb_link(fb, field_positions[5], fb_vector(fb, 0, 4, 4));
+  }
+
+  if (writer->has_map) {
+    const size_t metadata = fb_vector(fb, 1, 4, 4);
+    fb_link(fb, positions[2], metadata);
+    const fb_field_t key_value[2] = {{FB_OFFSET, 0}, {FB_OFFSET, 0}};
+    size_t kv_positions[2];
+    fb_link(fb, metadata + 4, fb_table(fb, key_value, 2, kv_positions));
+    fb_link(fb, kv_positions[0], fb_string(fb, "map"));
+    fb_link(fb, kv_positions[1], fb_string(fb, writer->map));
+  }
+  return schema;
+}
+
+// Starts a Message table and returns the position of its header reference.
+static size_t build_message(fb_builder_t *fb, int header_type,
+                            int64_t body_length) {
+  const size_t root = fb_begin(fb);
+  const fb_field_t fields[4] = {
+      {2, METADATA_VERSION_V5},   // version
+      {1, (uint64_t)header_type}, // header_type
+      {FB_OFFSET, 0},             // header
+      {8, (uint64_t)body_length}, // bodyLength
+  };
+  size_t positions[4];
+  fb_link(fb, root, fb_table(fb, fields, 4, positions));
+  return positions[2];
+}
+
+static bool write_bytes(ghost_arrow_writer_t *writer, const void *data,
+                        size_t size) {
+  if (size > 0 && fwrite(data, size, 1, writer->file) != 1) {
+    if (!writer->error)
+      fprintf(stderr, "ghost_arrow: Failed to write to '%s'\n",
+              writer->filename);
+    writer->error = true;
+    return false;
+  }
+  writer->offset += size;
+  return true;
+}
+
+static bool write_padding(ghost_arrow_writer_t *writer) {
+  static const unsigned char zeroes[8] = {0};
+  return write_bytes(writer, zeroes, (8 - writer->offset % 8) % 8);
+}
+
+// Writes the encapsulated message: continuation marker, metadata size,
+// metadata padded to 8 bytes.
+static bool write_message(ghost_arrow_writer_t *writer, fb_builder_t *fb,
+                          arrow_block_t *block) {
+  if (fb->error) {
+    fprintf(stderr, "ghost_arrow: Failed to allocate message for '%s'\n",
+            writer->filename);
+    writer->error = true;
+    return false;
+  }
+  unsigned char prefix[8];
+  uint32_to_le(prefix, 0xffffffffu);
+  uint32_to_le(prefix + 4, (uint32_t)fb->size);
+  if (block) {
+    block->offset = writer->offset;
+    block->metadata_length = (int32_t)(sizeof(prefix) + fb->size);
+  }
+  return write_bytes(writer, prefix, sizeof(prefix)) &&
+         write_bytes(writer, fb->data, fb->size);
+}
+
+static int64_t padded(int64_t size) { return (size + 7) & ~(int64_t)7; }
+
+static void save_rows(ghost_arrow_writer_t *writer) {
+  const int rows = writer->ghost_rows;
+  for (int i = 0; i < NUM_INT_COLUMNS; i++)
+    memcpy(writer->saved_int_columns[i], writer->int_columns[i], rows * 4);
+  memcpy(writer->saved_player_offsets, writer->player_offsets, rows * 4);
+  memcpy(writer->saved_player_data, writer->player_data,
+         writer->ghost_player_size);
+  writer->saved = true;
+}
+
+static void restore_rows(ghost_arrow_writer_t *writer) {
+  const int rows = writer->ghost_rows;
+  for (int i = 0; i < NUM_INT_COLUMNS; i++)
+    memcpy(writer->int_columns[i], writer->saved_int_columns[i], rows * 4);
+  memcpy(writer->player_offsets, writer->saved_player_offsets, rows * 4);
+  memcpy(writer->player_data, writer->saved_player_data,
+         writer->ghost_player_size);
+}
+
+static int truncate_file(FILE *file, int64_t size) {
+  if (fflush(file) != 0)
+    return -1;
+#if defined(_WIN32)
+  if (_chsize_s(_fileno(file), size) != 0)
+    return -1;
+  return _fseeki64(file, size, SEEK_SET);
+#else
+  if (ftruncate(fileno(file), (off_t)size) != 0)
+    return -1;
+  return fseeko(file, (off_t)size, SEEK_SET);
+#endif
+}
+
+static void begin_ghost(ghost_arrow_writer_t *writer) {
+  writer->in_ghost = true;
+  writer->saved = false;
+  writer->ghost_rows = writer->num_rows;
+  writer->ghost_player_size = writer->player_size;
+  writer->ghost_blocks = writer->num_blocks;
+  writer->ghost_offset = writer->offset;
+}
+
+// Drops every row added since begin_ghost, including batches already
+// written for them.
+static void rollback_ghost(ghost_arrow_writer_t *writer) {
+  writer->in_ghost = false;
+  if (writer->error)
+    return;
+  if (writer->num_blocks > writer->ghost_blocks) {
+    if (truncate_file(writer->file, writer->ghost_offset) != 0) {
+      fprintf(stderr, "ghost_arrow: Failed to truncate '%s'\n",
+              writer->filename);
+      writer->error = true;
+      return;
+    }
+    writer->num_blocks = writer->ghost_blocks;
+    writer->offset = writer->ghost_offset;
+    restore_rows(writer);
+  }
+  writer->num_rows = writer->ghost_rows;
+  writer->player_size = writer->ghost_player_size;
+}
+
+static bool flush_batch(ghost_arrow_writer_t *writer) {
+  const int num_rows = writer->num_rows;
+  if (num_rows == 0 || writer->error)
+    return !writer->error;
+  if (writer->in_ghost && !writer->saved)
+    save_rows(writer);
+
+  if (writer->num_blocks == writer->blocks_capacity) {
+    const int capacity =
+        writer->blocks_capacity ? writer->blocks_capacity * 2 : 16;
+    arrow_block_t *blocks = (arrow_block_t *)realloc(
+        writer->blocks, capacity * sizeof(arrow_block_t));
+    if (!blocks) {
+      writer->error = true;
+      return false;
+    }
+    writer->blocks = blocks;
+    writer->blocks_capacity = capacity;
+  }
+
+  // Buffer layout of the body: every column has an empty validity buffer
+  // (no nulls), the string column has offsets and data.
+  int64_t lengths[NUM_BUFFERS];
+  int num_buffers = 0;
+  for (int i = 0; i < NUM_COLUMNS; i++) {
+    lengths[num_buffers++] = 0;
+    if (i == PLAYER_COLUMN) {
+      lengths[num_buffers++] = (int64_t)(num_rows + 1) * 4;
+      lengths[num_buffers++] = writer->player_size;
+    } else {
+      lengths[num_buffers++] = (int64_t)num_rows * 4;
+    }
+  }
+  int64_t body_length = 0;
+  for (int i = 0; i < NUM_BUFFERS; i++)
+    body_length += padded(lengths[i]);
+
+  fb_builder_t fb = {0};
+  const size_t header = build_message(&fb, MESSAGE_RECORD_BATCH, body_length);
+  const fb_field_t fields[3] = {
+      {8, (uint64_t)num_rows},
+      {FB_OFFSET, 0},
+      {FB_OFFSET, 0},
+  };
+  size_t positions[3];
+  fb_link(&fb, header, fb_table(&fb, fields, 3, positions));
+
+  const size_t nodes = fb_vector(&fb, NUM_COLUMNS, 16, 8);
+  fb_link(&fb, positions[1], nodes);
+  for (int i = 0; i < NUM_COLUMNS; i++)
+    fb_put(&fb, nodes + 4 + 16 * i, (uint64_t)num_rows, 8);
+
+  const size_t buffers = fb_vector(&fb, NUM_BUFFERS, 16, 8);
+  fb_link(&fb, positions[2], buffers);
+  int64_t offset = 0;
+  for (int i = 0; i < NUM_BUFFERS; i++) {
+    fb_put(&fb, buffers + 4 + 16 * i, (uint64_t)offset, 8);
+    fb_put(&fb, buffers + 4 + 16 * i + 8, (uint64_t)lengths[i], 8);
+    offset += padded(lengths[i]);
+  }
+  fb_alloc(&fb, 0, 8);
+
+  arrow_block_t *block = &writer->blocks[writer->num_blocks];
+  bool ok = write_message(writer, &fb, block);
+  free(fb.data);
+
+  uint32_to_le(writer->player_offsets + num_rows * 4, writer->player_size);
+  int int_column = 0;
+  for (int i = 0; ok && i < NUM_COLUMNS; i++) {
+    if (i == PLAYER_COLUMN) {
+      ok = write_bytes(writer, writer->player_offsets, (num_rows + 1) * 4) &&
+           write_padding(writer) &&
+           write_bytes(writer, writer->player_data, writer->player_size) &&
+           write_padding(writer);
+    } else {
+      ok = write_bytes(writer, writer->int_columns[int_column++],
+                       num_rows * 4) &&
+           write_padding(writer);
+    }
+  }
+  if (!ok)
+    return false;
+
+  block->body_length = body_length;
+  writer->num_blocks++;
+  writer->num_rows = 0;
+  writer->player_size = 0;
+  return true;
+}
+
+static bool add_row(ghost_arrow_writer_t *writer, const ghost_t *meta,
+                    int start_tick, const ghost_character_t *snap) {
+  const int row = writer->num_rows;
+  uint32_to_le(writer->int_columns[0] + row * 4, writer->num_ghosts);
+  uint32_to_le(writer->int_columns[1] + row * 4, meta->time);
+  uint32_to_le(writer->int_columns[2] + row * 4, start_tick);
+  const int *fields = (const int *)snap;
+  for (int i = 0; i < NUM_CHARACTER_FIELDS; i++)
+    uint32_to_le(writer->int_columns[3 + i] + row * 4, fields[i]);
+
+  size_t length = strlen(meta->player);
+  if (length >= PLAYER_LENGTH)
+    length = PLAYER_LENGTH - 1;
+  uint32_to_le(writer->player_offsets + row * 4, writer->player_size);
+  memcpy(writer->player_data + writer->player_size, meta->player, length);
+  writer->player_size += (int)length;
+
+  if (++writer->num_rows == BATCH_ROWS)
+    return flush_batch(writer);
+  return true;
+}
+
+ghost_arrow_writer_t *ghost_arrow_open(const char *filename, const char *map) {
+  if (!filename)
+    return NULL;
+  ghost_arrow_writer_t *writer =
+      (ghost_arrow_writer_t *)calloc(1, sizeof(ghost_arrow_writer_t));
+  if (!writer)
+    return NULL;
+  snprintf(writer->filename, sizeof(writer->filename), "%s", filename);
+  if (map) {
+    snprintf(writer->map, sizeof(writer->map), "%s", map);
+    writer->has_map = true;
+  }
+
+  writer->file = fopen(filename, "wb");
+  if (!writer->file) {
+    fprintf(stderr, "ghost_arrow: Failed to open '%s' for writing\n",
+            filename);
+    free(writer);
+    return NULL;
+  }
+
+  fb_builder_t fb = {0};
+  const size_t header = build_message(&fb, MESSAGE_SCHEMA, 0);
+  fb_link(&fb, header, build_schema(&fb, writer));
+  fb_alloc(&fb, 0, 8);
+  const bool ok = write_bytes(writer, arrow_magic, sizeof(arrow_magic)) &&
+                  write_message(writer, &fb, NULL);
+  free(fb.data);
+  if (!ok) {
+    fclose(writer->file);
+    free(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+int ghost_arrow_add_ghost(ghost_arrow_writer_t *writer, const ghost_t *ghost) {
+  if (!writer || !ghost || writer->error)
+    return -1;
+  for (int i = 0; i < ghost->path.num_items; i++)
+    if (!add_row(writer, ghost, ghost->start_tick,
+                 ghost_get_snap(&ghost->path, i)))
+      return -1;
+  writer->num_ghosts++;
+  return 0;
+}
+
+int ghost_arrow_add_file(ghost_arrow_writer_t *writer, const char *filename) {
+  if (!writer || !filename || writer->error)
+    return -1;
+  ghost_lazy_t *lazy = ghost_load_lazy(filename);
+  if (!lazy)
+    return -1;
+
+  const ghost_t *meta = ghost_lazy_meta(lazy);
+  const int num_ticks = ghost_lazy_num_ticks(lazy);
+  begin_ghost(writer);
+  for (int i = 0; i < num_ticks; i++) {
+    const ghost_character_t *snap = ghost_lazy_get_snap(lazy, i);
+    if (!snap || !add_row(writer, meta, meta->start_tick, snap)) {
+      rollback_ghost(writer);
+      ghost_lazy_free(lazy);
+      return -1;
+    }
+  }
+  writer->in_ghost = false;
+  ghost_lazy_free(lazy);
+  writer->num_ghosts++;
+  return 0;
+}
+
+int ghost_arrow_close(ghost_arrow_writer_t *writer) {
+  if (!writer)
+    return -1;
+
+  flush_batch(writer);
+  // End of stream marker.
+  const unsigned char eos[8] = {0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0};
+  write_bytes(writer, eos, sizeof(eos));
+
+  fb_builder_t fb = {0};
+  const size_t root = fb_begin(&fb);
+  const fb_field_t fields[4] = {
+      {2, METADATA_VERSION_V5}, // version
+      {FB_OFFSET, 0},           // schema
+      {0, 0},                   // dictionaries
+      {FB_OFFSET, 0},           // recordBatches
+  };
+  size_t positions[4];
+  fb_link(&fb, root, fb_table(&fb, fields, 4, positions));
+  fb_link(&fb, positions[1], build_schema(&fb, writer));
+  const size_t blocks = fb_vector(&fb, writer->num_blocks, 24, 8);
+  fb_link(&fb, positions[3], blocks);
+  for (int i = 0; i < writer->num_blocks; i++) {
+    const arrow_block_t *block = &writer->blocks[i];
+    const size_t pos = blocks + 4 + 24 * (size_t)i;
+    fb_put(&fb, pos, (uint64_t)block->offset, 8);
+    fb_put(&fb, pos + 8, (uint32_t)block->metadata_length, 4);
+    fb_put(&fb, pos + 16, (uint64_t)block->body_length, 8);
+  }
+  fb_alloc(&fb, 0, 8);
+
+  unsigned char footer_size[4];
+  uint32_to_le(footer_size, (uint32_t)fb.size);
+  if (fb.error)
+    writer->error = true;
+  else if (write_bytes(writer, fb.data, fb.size) &&
+           write_bytes(writer, footer_size, sizeof(footer_size)))
+    write_bytes(writer, arrow_magic, 6);
+  free(fb.data);
+
+  if (fclose(writer->file) != 0)
+    writer->error = true;
+  const int result = writer->error ? -1 : 0;
+  free(writer->blocks);
+  free(writer);
+  return result;
+}
+
+typedef struct map_file_t {
+  const char *filename;
+  int index;
+  char map[64];
+} map_file_t;
+
+static int compare_map_files(const void *a, const void *b) {
+  const map_file_t *file_a = (const map_file_t *)a;
+  const map_file_t *file_b = (const map_file_t *)b;
+  const int result = strcmp(file_a->map, file_b->map);
+  if (result != 0)
+    return result;
+  // Keep the input order within a map.
+  return (file_a->index > file_b->index) - (file_a->index < file_b->index);
+}
+
+enum { MAP_NAME_LENGTH = 80 };
+
+// Names are compared ignoring case since some file systems do.
+static bool same_name(const char *a, const char *b) {
+  for (;; a++, b++) {
+    const char ca = *a >= 'A' && *a <= 'Z' ? *a - 'A' + 'a' : *a;
+    const char cb = *b >= 'A' && *b <= 'Z' ? *b - 'A' + 'a' : *b;
+    if (ca != cb)
+      return false;
+    if (!ca)
+      return true;
+  }
+}
+
+// Picks a file name for `map` not yet in `used` and appends it there.
+static void map_to_filename(char *out, size_t out_size, const char *dir,
+                            const char *map, char (*used)[MAP_NAME_LENGTH],
+                            int *num_used) {
+  char base[64];
+  size_t length = 0;
+  for (; map[length] && length < sizeof(base) - 1; length++) {
+    const char c = map[length];
+    const bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                      (c >= '0' && c <= '9') || c == '-' || c == '_' ||
+                      c == '.';
+    base[length] = safe ? c : '_';
+  }
+  base[length] = '\0';
+  if (length == 0 || strcmp(base, ".") == 0 || strcmp(base, "..") == 0)
+    snprintf(base, sizeof(base), "_");
+
+  char *name = used[*num_used];
+  snprintf(name, MAP_NAME_LENGTH, "%s", base);
+  for (int suffix = 2;; suffix++) {
+    bool taken = false;
+    for (int i = 0; i < *num_used && !taken; i++)
+      taken = same_name(used[i], name);
+    if (!taken)
+      break;
+    snprintf(name, MAP_NAME_LENGTH, "%s_%d", base, suffix);
+  }
+  (*num_used)++;
+  snprintf(out, out_size, "%s/%s.arrow", dir, name);
+}
+
+int ghost_arrow_export_by_map(const char *const *filenames, int num_files,
+                              const char *dir) {
+  if (!filenames || num_files < 0 || !dir)
+    return -1;
+
+  // Group the files by map from their headers, then write one table at a
+  // time so only one output is open.
+  map_file_t *files = (map_file_t *)calloc(num_files ? num_files : 1,
+                                           sizeof(map_file_t));
+  if (!files)
+    return -1;
+  int count = 0;
+  for (int i = 0; i < num_files; i++) {
+    ghost_header_info_t info;
+    if (ghost_read_info(filenames[i], &info) != 0)
+      continue;
+    files[count].filename = filenames[i];
+    files[count].index = i;
+    memcpy(files[count].map, info.map, sizeof(files[count].map));
+    count++;
+  }
+  qsort(files, count, sizeof(map_file_t), compare_map_files);
+
+  char(*used)[MAP_NAME_LENGTH] = (char(*)[MAP_NAME_LENGTH])malloc(
+      (count ? count : 1) * sizeof(*used));
+  if (!used) {
+    free(files);
+    return -1;
+  }
+  int num_used = 0;
+  int written = 0;
+  for (int start = 0; start < count;) {
+    int end = start + 1;
+    while (end < count && strcmp(files[end].map, files[start].map) == 0)
+      end++;
+
+    char path[1024];
+    map_to_filename(path, sizeof(path), dir, files[start].map, used,
+                    &num_used);
+    ghost_arrow_writer_t *writer = ghost_arrow_open(path, files[start].map);
+    if (!writer) {
+      written = -1;
+      break;
+    }
+    for (int i = start; i < end; i++)
+      if (ghost_arrow_add_file(writer, files[i].filename) == 0)
+        written++;
+    if (ghost_arrow_close(writer) != 0) {
+      written = -1;
+      break;
+    }
+    start = end;
+  }
+  free(used);
+  free(files);
+  return written;
+}
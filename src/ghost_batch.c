@@ -0,0 +1,600 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ddnet_ghost/ghost_batch.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(GHOST_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+enum {
+  DEFAULT_QUEUE_DEPTH = 64,
+  DEFAULT_DECODE_THREADS = 2,
+  DEFAULT_IO_THREADS = 8,
+  MAX_THREADS = 64,
+  MAX_FILE_SIZE = 64 * 1024 * 1024,
+};
+
+typedef struct batch_request_t {
+  struct batch_request_t *next;
+  char *filename;
+  void *user_data;
+
+  int fd;
+  unsigned char *data;
+  size_t size;
+  size_t done;
+  struct iovec iov;
+
+  ghost_t *ghost;
+} batch_request_t;
+
+typedef struct request_queue_t {
+  batch_request_t *head;
+  batch_request_t *tail;
+} request_queue_t;
+
+#if defined(GHOST_HAVE_IO_URING)
+typedef struct uring_t {
+  int fd;
+  unsigned entries;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring;
+  void *cq_ring;
+  size_t sq_ring_size;
+  size_t cq_ring_size;
+  size_t sqes_size;
+} uring_t;
+#endif
+
+struct ghost_batch_t {
+  pthread_mutex_t lock;
+  // Signalled when a request is submitted or a slot frees up.
+  pthread_cond_t work;
+  pthread_cond_t decode;
+  pthread_cond_t done;
+
+  request_queue_t pending;
+  request_queue_t decode_queue;
+  request_queue_t done_queue;
+
+  int queue_depth;
+  // Requests taken from `pending` that have not been decoded yet. Bounds
+  // the number of file buffers held at once.
+  int in_flight;
+  // Submitted requests not yet returned by ghost_batch_wait.
+  int outstanding;
+  bool shutdown;
+
+  pthread_t io_threads[MAX_THREADS];
+  int num_io_threads;
+  pthread_t decode_threads[MAX_THREADS];
+  int num_decode_threads;
+
+  bool use_io_uring;
+#if defined(GHOST_HAVE_IO_URING)
+  uring_t ring;
+#endif
+};
+
+static void queue_push(request_queue_t *queue, batch_request_t *request) {
+  request->next = NULL;
+  if (queue->tail)
+    queue->tail->next = request;
+  else
+    queue->head = request;
+  queue->tail = request;
+}
+
+static batch_request_t *queue_pop(request_queue_t *queue) {
+  batch_request_t *request = queue->head;
+  if (request) {
+    queue->head = request->next;
+    if (!queue->head)
+      queue->tail = NULL;
+  }
+  return request;
+}
+
+static void free_request(batch_request_t *request) {
+  if (request->fd >= 0)
+    close(request->fd);
+  ghost_free(request->ghost);
+  free(request->data);
+  free(request->filename);
+  free(request);
+}
+
+static void free_queue(request_queue_t *queue) {
+  batch_request_t *request;
+  while ((request = queue_pop(queue)))
+    free_request(request);
+}
+
+// Opens the file and allocates its buffer. Returns false after reporting an
+// error.
+static bool prepare_read(batch_request_t *request) {
+  request->fd = open(request->filename, O_RDONLY | O_CLOEXEC);
+  if (request->fd < 0) {
+    fprintf(stderr, "ghost_batch: Failed to open ghost file '%s' for reading\n",
+            request->filename);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(request->fd, &st) != 0 || st.st_size <= 0 ||
+      st.st_size > MAX_FILE_SIZE) {
+    fprintf(stderr, "ghost_batch: Failed to read ghost file '%s': invalid "
+                    "file size\n",
+            request->filename);
+    return false;
+  }
+
+  request->size = (size_t)st.st_size;
+  request->done = 0;
+  request->data = (unsigned char *)malloc(request->size);
+  if (!request->data) {
+    fprintf(stderr, "ghost_batch: Failed to allocate memory\n");
+    return false;
+  }
+  return true;
+}
+
+// Hands a finished read to the decoders, or a failed one straight to the
+// caller. Called without the lock held.
+static void finish_read(ghost_batch_t *batch, batch_request_t *request,
+                        bool ok) {
+  if (request->fd >= 0) {
+    close(request->fd);
+    request->fd = -1;
+  }
+
+  pthread_mutex_lock(&batch->lock);
+  if (ok) {
+    queue_push(&batch->decode_queue, request);
+    pthread_cond_signal(&batch->decode);
+  } else {
+    free(request->data);
+    request->data = NULL;
+    batch->in_flight--;
+    queue_push(&batch->done_queue, request);
+    pthread_cond_broadcast(&batch->done);
+    pthread_cond_broadcast(&batch->work);
+  }
+  pthread_mutex_unlock(&batch->lock);
+}
+
+// Takes the next request if a slot is free. Called with the lock held.
+static batch_request_t *take_request(ghost_batch_t *batch) {
+  if (batch->in_flight >= batch->queue_depth)
+    return NULL;
+  batch_request_t *request = queue_pop(&batch->pending);
+  if (request)
+    batch->in_flight++;
+  return request;
+}
+
+// Reads the rest of the file. Returns false after reporting an error.
+static bool read_rest(batch_request_t *request) {
+  while (request->done < request->size) {
+    const ssize_t result =
+        pread(request->fd, request->data + request->done,
+              request->size - request->done, (off_t)request->done);
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result <= 0) {
+      fprintf(stderr, "ghost_batch: Failed to read ghost file '%s'\n",
+              request->filename);
+      return false;
+    }
+    request->done += (size_t)result;
+  }
+  return true;
+}
+
+static void *pread_thread(void *user) {
+  ghost_batch_t *batch = (ghost_batch_t *)user;
+  pthread_mutex_lock(&batch->lock);
+  for (;;) {
+    batch_request_t *request = NULL;
+    while (!batch->shutdown && !(request = take_request(batch)))
+      pthread_cond_wait(&batch->work, &batch->lock);
+    if (batch->shutdown)
+      break;
+    pthread_mutex_unlock(&batch->lock);
+
+    finish_read(batch, request, prepare_read(request) && read_rest(request));
+
+    pthread_mutex_lock(&batch->lock);
+  }
+  pthread_mutex_unlock(&batch->lock);
+  return NULL;
+}
+
+#if defined(GHOST_HAVE_IO_URING)
+static bool uring_init(uring_t *ring, unsigned entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0)
+    return false;
+
+  ring->entries = params.sq_entries;
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap && ring->cq_ring_size > ring->sq_ring_size)
+    ring->sq_ring_size = ring->cq_ring_size;
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    close(ring->fd);
+    return false;
+  }
+  ring->cq_ring = single_mmap
+                      ? ring->sq_ring
+                      : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = ring->cq_ring == MAP_FAILED
+                   ? MAP_FAILED
+                   : mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    if (ring->cq_ring != MAP_FAILED && !single_mmap)
+      munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    return false;
+  }
+
+  unsigned char *sq = (unsigned char *)ring->sq_ring;
+  unsigned char *cq = (unsigned char *)ring->cq_ring;
+  ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+  ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  return true;
+}
+
+static void uring_free(uring_t *ring) {
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring)
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  close(ring->fd);
+}
+
+// Queues a readv of the rest of the file. Only the I/O thread touches the
+// submission queue.
+static bool uring_queue_read(uring_t *ring, batch_request_t *request) {
+  const unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  const unsigned tail = *ring->sq_tail;
+  if (tail - head >= ring->entries)
+    return false;
+
+  const unsigned index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  request->iov.iov_base = request->data + request->done;
+  request->iov.iov_len = request->size - request->done;
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = request->fd;
+  sqe->off = request->done;
+  sqe->addr = (unsigned long)&request->iov;
+  sqe->len = 1;
+  sqe->user_data = (unsigned long)request;
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Takes back the reads queued since the last successful submit and finishes
+// them with pread instead. Returns how many there were.
+static unsigned uring_unqueue(ghost_batch_t *batch, uring_t *ring) {
+  const unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  const unsigned tail = *ring->sq_tail;
+  __atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+  for (unsigned i = head; i != tail; i++) {
+    const struct io_uring_sqe *sqe =
+        &ring->sqes[ring->sq_array[i & *ring->sq_mask]];
+    batch_request_t *request = (batch_request_t *)(unsigned long)sqe->user_data;
+    finish_read(batch, request, read_rest(request));
+  }
+  return tail - head;
+}
+
+static int uring_enter(uring_t *ring, unsigned to_submit,
+                       unsigned min_complete) {
+  for (;;) {
+    const int result = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit,
+                                    min_complete, IORING_ENTER_GETEVENTS,
+                                    NULL, 0);
+    if (result >= 0 || errno != EINTR)
+      return result;
+  }
+}
+
+static void *uring_thread(void *user) {
+  ghost_batch_t *batch = (ghost_batch_t *)user;
+  uring_t *ring = &batch->ring;
+  unsigned reading = 0;
+  unsigned to_submit = 0;
+  // Set once io_uring_enter fails for good. Reads already in the kernel
+  // are still reaped from the completion queue, everything else uses pread.
+  bool broken = false;
+
+  pthread_mutex_lock(&batch->lock);
+  for (;;) {
+    // Start as many reads as there are free slots, then wait for at least
+    // one completion. With nothing in flight, sleep until new work arrives.
+    batch_request_t *request;
+    while (reading + to_submit < ring->entries &&
+           (request = take_request(batch))) {
+      pthread_mutex_unlock(&batch->lock);
+      if (!prepare_read(request))
+        finish_read(batch, request, false);
+      else if (!broken && uring_queue_read(ring, request))
+        to_submit++;
+      else
+        finish_read(batch, request, read_rest(request));
+      pthread_mutex_lock(&batch->lock);
+    }
+
+    if (reading + to_submit == 0) {
+      if (batch->shutdown)
+        break;
+      pthread_cond_wait(&batch->work, &batch->lock);
+      continue;
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    int submitted = broken ? 0 : uring_enter(ring, to_submit, 1);
+    if (submitted < 0 && (errno == EAGAIN || errno == EBUSY)) {
+      // Out of kernel resources or completions; reap and retry.
+      submitted = 0;
+    } else if (submitted < 0) {
+      fprintf(stderr,
+              "ghost_batch: io_uring_enter failed (%s), falling back to "
+              "pread\n",
+              strerror(errno));
+      broken = true;
+      submitted = 0;
+      to_submit -= uring_unqueue(batch, ring);
+    }
+    reading += (unsigned)submitted;
+    to_submit -= (unsigned)submitted;
+
+    unsigned head = *ring->cq_head;
+    const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      // Nothing completed: the kernel is short on resources or can no
+      // longer be waited on, so back off before polling again.
+      const struct timespec delay = {0, 1000000};
+      nanosleep(&delay, NULL);
+    }
+    for (; head != tail; head++) {
+      const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      batch_request_t *done = (batch_request_t *)(unsigned long)cqe->user_data;
+      const int result = cqe->res;
+      reading--;
+
+      if (result <= 0) {
+        fprintf(stderr, "ghost_batch: Failed to read ghost file '%s'\n",
+                done->filename);
+        finish_read(batch, done, false);
+        continue;
+      }
+      done->done += (size_t)result;
+      if (done->done == done->size)
+        finish_read(batch, done, true);
+      else if (!broken && uring_queue_read(ring, done))
+        to_submit++;
+      else
+        finish_read(batch, done, read_rest(done));
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&batch->lock);
+  }
+  pthread_mutex_unlock(&batch->lock);
+  return NULL;
+}
+#endif
+
+static void *decode_thread(void *user) {
+  ghost_batch_t *batch = (ghost_batch_t *)user;
+  pthread_mutex_lock(&batch->lock);
+  for (;;) {
+    batch_request_t *request = NULL;
+    while (!batch->shutdown && !(request = queue_pop(&batch->decode_queue)))
+      pthread_cond_wait(&batch->decode, &batch->lock);
+    if (batch->shutdown)
+      break;
+    pthread_mutex_unlock(&batch->lock);
+
+    request->ghost = ghost_load_mem(request->data, request->size);
+    free(request->data);
+    request->data = NULL;
+
+    pthread_mutex_lock(&batch->lock);
+    batch->in_flight--;
+    queue_push(&batch->done_queue, request);
+    pthread_cond_broadcast(&batch->done);
+    pthread_cond_broadcast(&batch->work);
+  }
+  pthread_mutex_unlock(&batch->lock);
+  return NULL;
+}
+
+static int clamp_threads(int value, int fallback) {
+  if (value <= 0)
+    return fallback;
+  return value > MAX_THREADS ? MAX_THREADS : value;
+}
+
+ghost_batch_t *ghost_batch_create(const ghost_batch_options_t *options) {
+  ghost_batch_options_t defaults;
+  memset(&defaults, 0, sizeof(defaults));
+  if (!options)
+    options = &defaults;
+
+  ghost_batch_t *batch = (ghost_batch_t *)calloc(1, sizeof(ghost_batch_t));
+  if (!batch)
+    return NULL;
+  pthread_mutex_init(&batch->lock, NULL);
+  pthread_cond_init(&batch->work, NULL);
+  pthread_cond_init(&batch->decode, NULL);
+  pthread_cond_init(&batch->done, NULL);
+  batch->queue_depth =
+      options->queue_depth > 0 ? options->queue_depth : DEFAULT_QUEUE_DEPTH;
+
+#if defined(GHOST_HAVE_IO_URING)
+  if (!options->disable_io_uring)
+    batch->use_io_uring = uring_init(&batch->ring, batch->queue_depth);
+#endif
+
+  bool ok = true;
+  if (batch->use_io_uring) {
+#if defined(GHOST_HAVE_IO_URING)
+    ok = pthread_create(&batch->io_threads[0], NULL, uring_thread, batch) == 0;
+    batch->num_io_threads = ok;
+#endif
+  } else {
+    const int num_io_threads =
+        clamp_threads(options->num_io_threads, DEFAULT_IO_THREADS);
+    for (int i = 0; ok && i < num_io_threads; i++) {
+      ok = pthread_create(&batch->io_threads[i], NULL, pread_thread, batch) ==
+           0;
+      batch->num_io_threads += ok;
+    }
+  }
+
+  const int num_decode_threads =
+      clamp_threads(options->num_decode_threads, DEFAULT_DECODE_THREADS);
+  for (int i = 0; ok && i < num_decode_threads; i++) {
+    ok = pthread_create(&batch->decode_threads[i], NULL, decode_thread,
+                        batch) == 0;
+    batch->num_decode_threads += ok;
+  }
+
+  if (!ok) {
+    fprintf(stderr, "ghost_batch: Failed to start threads\n");
+    ghost_batch_destroy(batch);
+    return NULL;
+  }
+  return batch;
+}
+
+void ghost_batch_destroy(ghost_batch_t *batch) {
+  if (!batch)
+    return;
+
+  pthread_mutex_lock(&batch->lock);
+  batch->shutdown = true;
+  free_queue(&batch->pending);
+  pthread_cond_broadcast(&batch->work);
+  pthread_cond_broadcast(&batch->decode);
+  pthread_mutex_unlock(&batch->lock);
+
+  // The io_uring thread only exits once its reads have completed, so no
+  // buffer is freed while the kernel still writes to it.
+  for (int i = 0; i < batch->num_io_threads; i++)
+    pthread_join(batch->io_threads[i], NULL);
+  for (int i = 0; i < batch->num_decode_threads; i++)
+    pthread_join(batch->decode_threads[i], NULL);
+
+#if defined(GHOST_HAVE_IO_URING)
+  if (batch->use_io_uring)
+    uring_free(&batch->ring);
+#endif
+  free_queue(&batch->decode_queue);
+  free_queue(&batch->done_queue);
+  pthread_cond_destroy(&batch->done);
+  pthread_cond_destroy(&batch->decode);
+  pthread_cond_destroy(&batch->work);
+  pthread_mutex_destroy(&batch->lock);
+  free(batch);
+}
+
+int ghost_batch_submit(ghost_batch_t *batch, const char *filename,
+                       void *user_data) {
+  if (!batch || !filename)
+    return -1;
+
+  batch_request_t *request =
+      (batch_request_t *)calloc(1, sizeof(batch_request_t));
+  const size_t length = strlen(filename) + 1;
+  char *name = request ? (char *)malloc(length) : NULL;
+  if (!name) {
+    free(request);
+    return -1;
+  }
+  memcpy(name, filename, length);
+  request->filename = name;
+  request->user_data = user_data;
+  request->fd = -1;
+
+  pthread_mutex_lock(&batch->lock);
+  queue_push(&batch->pending, request);
+  batch->outstanding++;
+  pthread_cond_broadcast(&batch->work);
+  pthread_mutex_unlock(&batch->lock);
+  return 0;
+}
+
+int ghost_batch_wait(ghost_batch_t *batch, ghost_batch_result_t *result) {
+  if (!batch || !result)
+    return 0;
+
+  pthread_mutex_lock(&batch->lock);
+  batch_request_t *request;
+  while (!(request = queue_pop(&batch->done_queue)) && batch->outstanding > 0)
+    pthread_cond_wait(&batch->done, &batch->lock);
+  if (request)
+    batch->outstanding--;
+  pthread_mutex_unlock(&batch->lock);
+
+  if (!request)
+    return 0;
+  result->user_data = request->user_data;
+  result->ghost = request->ghost;
+  request->ghost = NULL;
+  free_request(request);
+  return 1;
+}
+
+int ghost_batch_uses_io_uring(const ghost_batch_t *batch) {
+  return batch && batch->use_io_uring;
+}
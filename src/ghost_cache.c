@@ -0,0 +1,362 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ddnet_ghost/ghost_cache.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+enum { INITIAL_BUCKETS = 64 };
+
+typedef enum cache_state_t {
+  CACHE_LOADING,
+  CACHE_READY,
+  CACHE_FAILED,
+} cache_state_t;
+
+struct ghost_cache_entry_t {
+  char *filename;
+  uint32_t hash;
+  int64_t mtime_ns;
+  int64_t size;
+
+  ghost_t *ghost;
+  size_t bytes;
+  cache_state_t state;
+  int refs;
+  // Replaced by a newer version of the file; freed on last release.
+  bool stale;
+
+  ghost_cache_entry_t *bucket_next;
+  // LRU list of ready entries, most recently used first.
+  ghost_cache_entry_t *lru_prev;
+  ghost_cache_entry_t *lru_next;
+};
+
+struct ghost_cache_t {
+  pthread_mutex_t lock;
+  pthread_cond_t loaded;
+
+  ghost_cache_entry_t **buckets;
+  int num_buckets;
+  int num_entries;
+
+  ghost_cache_entry_t *lru_head;
+  ghost_cache_entry_t *lru_tail;
+
+  size_t budget;
+  size_t bytes;
+  long long hits;
+  long long misses;
+  long long evictions;
+  long long failures;
+};
+
+static uint32_t hash_string(const char *str) {
+  uint32_t hash = 2166136261u;
+  for (; *str; str++)
+    hash = (hash ^ (unsigned char)*str) * 16777619u;
+  return hash;
+}
+
+static int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+  return (int64_t)st->st_mtimespec.tv_sec * 1000000000 +
+         st->st_mtimespec.tv_nsec;
+#else
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static void lru_unlink(ghost_cache_t *cache, ghost_cache_entry_t *entry) {
+  if (entry->lru_prev)
+    entry->lru_prev->lru_next = entry->lru_next;
+  else if (cache->lru_head == entry)
+    cache->lru_head = entry->lru_next;
+  if (entry->lru_next)
+    entry->lru_next->lru_prev = entry->lru_prev;
+  else if (cache->lru_tail == entry)
+    cache->lru_tail = entry->lru_prev;
+  entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(ghost_cache_t *cache, ghost_cache_entry_t *entry) {
+  entry->lru_prev = NULL;
+  entry->lru_next = cache->lru_head;
+  if (cache->lru_head)
+    cache->lru_head->lru_prev = entry;
+  cache->lru_head = entry;
+  if (!cache->lru_tail)
+    cache->lru_tail = entry;
+}
+
+static void bucket_unlink(ghost_cache_t *cache, ghost_cache_entry_t *entry) {
+  ghost_cache_entry_t **link =
+      &cache->buckets[entry->hash & (cache->num_buckets - 1)];
+  while (*link && *link != entry)
+    link = &(*link)->bucket_next;
+  if (*link) {
+    *link = entry->bucket_next;
+    cache->num_entries--;
+  }
+  entry->bucket_next = NULL;
+}
+
+static void grow_buckets(ghost_cache_t *cache) {
+  const int num_buckets = cache->num_buckets * 2;
+  ghost_cache_entry_t **buckets = (ghost_cache_entry_t **)calloc(
+      num_buckets, sizeof(ghost_cache_entry_t *));
+  if (!buckets)
+    return;
+
+  for (int i = 0; i < cache->num_buckets; i++) {
+    ghost_cache_entry_t *entry = cache->buckets[i];
+    while (entry) {
+      ghost_cache_entry_t *next = entry->bucket_next;
+      const int slot = entry->hash & (num_buckets - 1);
+      entry->bucket_next = buckets[slot];
+      buckets[slot] = entry;
+      entry = next;
+    }
+  }
+  free(cache->buckets);
+  cache->buckets = buckets;
+  cache->num_buckets = num_buckets;
+}
+
+static void free_entry(ghost_cache_entry_t *entry) {
+  ghost_free(entry->ghost);
+  free(entry->filename);
+  free(entry);
+}
+
+// Removes an entry from the lookup table and the LRU list. Entries still
+// referenced are freed by their last release.
+static void detach_entry(ghost_cache_t *cache, ghost_cache_entry_t *entry) {
+  bucket_unlink(cache, entry);
+  lru_unlink(cache, entry);
+  if (entry->state == CACHE_READY)
+    cache->bytes -= entry->bytes;
+  entry->stale = true;
+  if (entry->refs == 0)
+    free_entry(entry);
+}
+
+static void evict(ghost_cache_t *cache) {
+  ghost_cache_entry_t *entry = cache->lru_tail;
+  while (entry && cache->bytes > cache->budget) {
+    ghost_cache_entry_t *prev = entry->lru_prev;
+    if (entry->refs == 0) {
+      detach_entry(cache, entry);
+      cache->evictions++;
+    }
+    entry = prev;
+  }
+}
+
+ghost_cache_t *ghost_cache_create(size_t budget) {
+  ghost_cache_t *cache = (ghost_cache_t *)calloc(1, sizeof(ghost_cache_t));
+  if (!cache)
+    return NULL;
+
+  cache->num_buckets = INITIAL_BUCKETS;
+  cache->buckets = (ghost_cache_entry_t **)calloc(
+      cache->num_buckets, sizeof(ghost_cache_entry_t *));
+  if (!cache->buckets) {
+    free(cache);
+    return NULL;
+  }
+  pthread_mutex_init(&cache->lock, NULL);
+  pthread_cond_init(&cache->loaded, NULL);
+  cache->budget = budget;
+  return cache;
+}
+
+void ghost_cache_destroy(ghost_cache_t *cache) {
+  if (!cache)
+    return;
+  for (int i = 0; i < cache->num_buckets; i++) {
+    ghost_cache_entry_t *entry = cache->buckets[i];
+    while (entry) {
+      ghost_cache_entry_t *next = entry->bucket_next;
+      if (entry->refs > 0)
+        fprintf(stderr, "ghost_cache: Entry '%s' is still referenced\n",
+                entry->filename);
+      free_entry(entry);
+      entry = next;
+    }
+  }
+  pthread_cond_destroy(&cache->loaded);
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->buckets);
+  free(cache);
+}
+
+void ghost_cache_set_budget(ghost_cache_t *cache, size_t budget) {
+  if (!cache)
+    return;
+  pthread_mutex_lock(&cache->lock);
+  cache->budget = budget;
+  evict(cache);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+static ghost_cache_entry_t *find_entry(ghost_cache_t *cache,
+                                       const char *filename, uint32_t hash) {
+  ghost_cache_entry_t *entry =
+      cache->buckets[hash & (cache->num_buckets - 1)];
+  for (; entry; entry = entry->bucket_next)
+    if (entry->hash == hash && strcmp(entry->filename, filename) == 0)
+      return entry;
+  return NULL;
+}
+
+static ghost_cache_entry_t *insert_entry(ghost_cache_t *cache,
+                                         const char *filename, uint32_t hash,
+                                         int64_t mtime_ns, int64_t size) {
+  ghost_cache_entry_t *entry =
+      (ghost_cache_entry_t *)calloc(1, sizeof(ghost_cache_entry_t));
+  const size_t length = strlen(filename) + 1;
+  char *name = entry ? (char *)malloc(length) : NULL;
+  if (!name) {
+    free(entry);
+    return NULL;
+  }
+  memcpy(name, filename, length);
+  entry->filename = name;
+  entry->hash = hash;
+  entry->mtime_ns = mtime_ns;
+  entry->size = size;
+  entry->state = CACHE_LOADING;
+
+  if (cache->num_entries >= cache->num_buckets)
+    grow_buckets(cache);
+  const int slot = hash & (cache->num_buckets - 1);
+  entry->bucket_next = cache->buckets[slot];
+  cache->buckets[slot] = entry;
+  cache->num_entries++;
+  return entry;
+}
+
+ghost_cache_entry_t *ghost_cache_acquire(ghost_cache_t *cache,
+                                         const char *filename) {
+  if (!cache || !filename)
+    return NULL;
+
+  struct stat st;
+  if (stat(filename, &st) != 0) {
+    fprintf(stderr,
+            "ghost_cache: Failed to open ghost file '%s' for reading\n",
+            filename);
+    pthread_mutex_lock(&cache->lock);
+    cache->failures++;
+    pthread_mutex_unlock(&cache->lock);
+    return NULL;
+  }
+  const int64_t mtime_ns = stat_mtime_ns(&st);
+  const int64_t size = (int64_t)st.st_size;
+  const uint32_t hash = hash_string(filename);
+
+  pthread_mutex_lock(&cache->lock);
+  ghost_cache_entry_t *entry;
+  for (;;) {
+    entry = find_entry(cache, filename, hash);
+    if (entry && (entry->mtime_ns != mtime_ns || entry->size != size)) {
+      // The file changed on disk. A decode still in progress for the old
+      // version is left alone; its waiters get the old ghost.
+      if (entry->state == CACHE_LOADING) {
+        pthread_cond_wait(&cache->loaded, &cache->lock);
+        continue;
+      }
+      detach_entry(cache, entry);
+      entry = NULL;
+    }
+    break;
+  }
+
+  if (entry) {
+    entry->refs++;
+    while (entry->state == CACHE_LOADING)
+      pthread_cond_wait(&cache->loaded, &cache->lock);
+    if (entry->state == CACHE_FAILED) {
+      if (--entry->refs == 0 && entry->stale)
+        free_entry(entry);
+      pthread_mutex_unlock(&cache->lock);
+      return NULL;
+    }
+    cache->hits++;
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+    pthread_mutex_unlock(&cache->lock);
+    return entry;
+  }
+
+  entry = insert_entry(cache, filename, hash, mtime_ns, size);
+  if (!entry) {
+    cache->failures++;
+    pthread_mutex_unlock(&cache->lock);
+    return NULL;
+  }
+  entry->refs = 1;
+  cache->misses++;
+  pthread_mutex_unlock(&cache->lock);
+
+  // Decode without holding the lock; other requests for this file wait on
+  // the entry instead of decoding it again.
+  ghost_t *ghost = ghost_load(filename);
+
+  pthread_mutex_lock(&cache->lock);
+  if (ghost) {
+    entry->ghost = ghost;
+    entry->bytes = (size_t)ghost->path.num_items * sizeof(ghost_character_t);
+    entry->state = CACHE_READY;
+    cache->bytes += entry->bytes;
+    lru_push_front(cache, entry);
+    evict(cache);
+  } else {
+    entry->state = CACHE_FAILED;
+    cache->failures++;
+    bucket_unlink(cache, entry);
+    entry->stale = true;
+    if (--entry->refs == 0)
+      free_entry(entry);
+    entry = NULL;
+  }
+  pthread_cond_broadcast(&cache->loaded);
+  pthread_mutex_unlock(&cache->lock);
+  return entry;
+}
+
+const ghost_t *ghost_cache_entry_ghost(const ghost_cache_entry_t *entry) {
+  return entry ? entry->ghost : NULL;
+}
+
+void ghost_cache_release(ghost_cache_t *cache, ghost_cache_entry_t *entry) {
+  if (!cache || !entry)
+    return;
+  pthread_mutex_lock(&cache->lock);
+  if (--entry->refs == 0) {
+    if (entry->stale)
+      free_entry(entry);
+    else
+      evict(cache);
+  }
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void ghost_cache_get_stats(ghost_cache_t *cache, ghost_cache_stats_t *stats) {
+  if (!cache || !stats)
+    return;
+  pthread_mutex_lock(&cache->lock);
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->evictions = cache->evictions;
+  stats->failures = cache->failures;
+  stats->num_entries = cache->num_entries;
+  stats->bytes = cache->bytes;
+  stats->budget = cache->budget;
+  pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,165 @@
+#include <ddnet_ghost/ghost_compare.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GHOST_COMPARE_SSE2
+#endif
+
+enum { COMPARE_BLOCK_SIZE = 256 };
+
+static int contiguous_items(const ghost_path_t *path, int index) {
+  return path->chunk_size - index % path->chunk_size;
+}
+
+#ifdef GHOST_COMPARE_SSE2
+// Differences of the low two ints as floats in the low two lanes. Ints far
+// apart overflow when subtracted as ints, so they are widened to double
+// first, like the scalar loop does.
+static __m128 widened_diff(__m128i a, __m128i b) {
+  return _mm_cvtpd_ps(_mm_sub_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b)));
+}
+#endif
+
+static void distance_kernel(const ghost_character_t *a,
+                            const ghost_character_t *b, float *out, int n) {
+  int i = 0;
+#ifdef GHOST_COMPARE_SSE2
+  for (; i + 4 <= n; i += 4) {
+    // x and y are the first two ints of a ghost_character_t, so one 64-bit
+    // load per snapshot fetches both.
+    __m128i a01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)&a[i]),
+                                     _mm_loadl_epi64((const __m128i *)&a[i + 1]));
+    __m128i a23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)&a[i + 2]),
+                                     _mm_loadl_epi64((const __m128i *)&a[i + 3]));
+    __m128i b01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)&b[i]),
+                                     _mm_loadl_epi64((const __m128i *)&b[i + 1]));
+    __m128i b23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)&b[i + 2]),
+                                     _mm_loadl_epi64((const __m128i *)&b[i + 3]));
+
+    __m128 d01 = _mm_movelh_ps(widened_diff(a01, b01),
+                               widened_diff(_mm_srli_si128(a01, 8),
+                                       _mm_srli_si128(b01, 8)));
+    __m128 d23 = _mm_movelh_ps(widened_diff(a23, b23),
+                               widened_diff(_mm_srli_si128(a23, 8),
+                                       _mm_srli_si128(b23, 8)));
+    d01 = _mm_mul_ps(d01, d01);
+    d23 = _mm_mul_ps(d23, d23);
+
+    __m128 sq_x = _mm_shuffle_ps(d01, d23, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 sq_y = _mm_shuffle_ps(d01, d23, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(&out[i], _mm_sqrt_ps(_mm_add_ps(sq_x, sq_y)));
+  }
+#endif
+  for (; i < n; i++) {
+    const float dx = (float)((double)a[i].x - b[i].x);
+    const float dy = (float)((double)a[i].y - b[i].y);
+    out[i] = sqrtf(dx * dx + dy * dy);
+  }
+}
+
+static float reduce_kernel(const float *dist, int n, double *sum) {
+  int i = 0;
+  float max = 0.0f;
+  double total = 0.0;
+#ifdef GHOST_COMPARE_SSE2
+  __m128 max4 = _mm_setzero_ps();
+  __m128d sum2 = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m128 d = _mm_loadu_ps(&dist[i]);
+    max4 = _mm_max_ps(max4, d);
+    sum2 = _mm_add_pd(sum2, _mm_cvtps_pd(d));
+    sum2 = _mm_add_pd(sum2, _mm_cvtps_pd(_mm_movehl_ps(d, d)));
+  }
+  float lanes[4];
+  double halves[2];
+  _mm_storeu_ps(lanes, max4);
+  _mm_storeu_pd(halves, sum2);
+  for (int k = 0; k < 4; k++)
+    if (lanes[k] > max)
+      max = lanes[k];
+  total = halves[0] + halves[1];
+#endif
+  for (; i < n; i++) {
+    if (dist[i] > max)
+      max = dist[i];
+    total += dist[i];
+  }
+  *sum += total;
+  return max;
+}
+
+static int find_mismatch(const ghost_character_t *a, const ghost_character_t *b,
+                         int n) {
+  if (memcmp(a, b, n * sizeof(ghost_character_t)) == 0)
+    return -1;
+  for (int i = 0; i < n; i++)
+    if (memcmp(&a[i], &b[i], sizeof(ghost_character_t)) != 0)
+      return i;
+  return -1;
+}
+
+int ghost_compare(const ghost_path_t *a, const ghost_path_t *b,
+                  ghost_compare_result_t *result, float *distances) {
+  if (!a || !b || !result)
+    return -1;
+  if ((a->num_items > 0 && (!a->chunks || a->chunk_size <= 0)) ||
+      (b->num_items > 0 && (!b->chunks || b->chunk_size <= 0)))
+    return -1;
+
+  const int num = a->num_items < b->num_items ? a->num_items : b->num_items;
+
+  memset(result, 0, sizeof(*result));
+  result->num_compared = num;
+  result->tick_delta = b->num_items - a->num_items;
+  result->first_mismatch = -1;
+  result->first_mismatch_tick = -1;
+  result->max_distance_index = -1;
+
+  float block[COMPARE_BLOCK_SIZE];
+  double sum = 0.0;
+  int index = 0;
+  while (index < num) {
+    int n = num - index;
+    const int left_a = contiguous_items(a, index);
+    const int left_b = contiguous_items(b, index);
+    if (n > left_a)
+      n = left_a;
+    if (n > left_b)
+      n = left_b;
+    if (!distances && n > COMPARE_BLOCK_SIZE)
+      n = COMPARE_BLOCK_SIZE;
+
+    const ghost_character_t *span_a = ghost_get_snap(a, index);
+    const ghost_character_t *span_b = ghost_get_snap(b, index);
+    float *out = distances ? &distances[index] : block;
+
+    if (result->first_mismatch < 0) {
+      const int mismatch = find_mismatch(span_a, span_b, n);
+      if (mismatch >= 0) {
+        result->first_mismatch = index + mismatch;
+        result->first_mismatch_tick = span_a[mismatch].tick;
+      }
+    }
+
+    distance_kernel(span_a, span_b, out, n);
+    const float max = reduce_kernel(out, n, &sum);
+    if (max > result->max_distance || result->max_distance_index < 0) {
+      for (int i = 0; i < n; i++) {
+        if (out[i] == max) {
+          result->max_distance = max;
+          result->max_distance_index = index + i;
+          break;
+        }
+      }
+    }
+
+    index += n;
+  }
+
+  if (num > 0)
+    result->mean_distance = (float)(sum / num);
+  return 0;
+}
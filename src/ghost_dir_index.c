@@ -0,0 +1,606 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ddnet_ghost/ghost_dir_index.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define GHOST_DIR_INOTIFY
+#endif
+
+enum {
+  CACHE_VERSION = 3,
+  CACHE_HEADER_SIZE = 16,
+  // A flag telling whether the stats were collected, then the stats.
+  CACHE_STATS_SIZE = 12 * 4,
+  CACHE_RECORD_SIZE = 256 + 16 + 64 + 4 + 4 + 4 + 8 + 8 + CACHE_STATS_SIZE,
+};
+
+static const unsigned char cache_marker[8] = {'T', 'W', 'G', 'D',
+                                              'C', 'A', 'C', 'H'};
+
+// The entry comes first so a record pointer is also an entry pointer.
+typedef struct dir_record_t {
+  ghost_dir_entry_t entry;
+  bool has_stats;
+  bool seen;
+} dir_record_t;
+
+typedef struct dir_map_t {
+  char map[64];
+  dir_record_t **records;
+  int count;
+  int capacity;
+} dir_map_t;
+
+struct ghost_dir_index_t {
+  char directory[512];
+  char cache_filename[512];
+  bool with_stats;
+
+  // All records sorted by filename, and per map sorted by time.
+  dir_record_t **by_name;
+  int count;
+  int capacity;
+
+  dir_map_t *maps;
+  int num_maps;
+  int maps_capacity;
+
+  int inotify_fd;
+};
+
+static void uint32_to_le(unsigned char *bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    bytes[i] = (value >> (8 * i)) & 0xff;
+}
+
+static uint32_t le_to_uint32(const unsigned char *bytes) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void float_to_le(unsigned char *bytes, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_to_le(bytes, bits);
+}
+
+static float le_to_float(const unsigned char *bytes) {
+  const uint32_t bits = le_to_uint32(bytes);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void int64_to_le(unsigned char *bytes, int64_t value) {
+  uint32_to_le(bytes, (uint32_t)((uint64_t)value & 0xffffffffu));
+  uint32_to_le(bytes + 4, (uint32_t)((uint64_t)value >> 32));
+}
+
+static int64_t le_to_int64(const unsigned char *bytes) {
+  return (int64_t)((uint64_t)le_to_uint32(bytes) |
+                   ((uint64_t)le_to_uint32(bytes + 4) << 32));
+}
+
+static bool is_ghost_filename(const char *name) {
+  const size_t length = strlen(name);
+  return length > 4 && length < sizeof(((ghost_dir_entry_t *)0)->filename) &&
+         strcmp(name + length - 4, ".gho") == 0;
+}
+
+static int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+  return (int64_t)st->st_mtimespec.tv_sec * 1000000000 +
+         st->st_mtimespec.tv_nsec;
+#else
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static int grow_array(void **array, int *capacity, size_t element_size) {
+  const int new_capacity = *capacity ? *capacity * 2 : 64;
+  void *grown = realloc(*array, new_capacity * element_size);
+  if (!grown) {
+    fprintf(stderr, "ghost_dir_index: Failed to allocate memory\n");
+    return -1;
+  }
+  *array = grown;
+  *capacity = new_capacity;
+  return 0;
+}
+
+// Binary search by filename. Returns the position of the record or, if it is
+// missing, -(insert position) - 1.
+static int find_record(const ghost_dir_index_t *index, const char *filename) {
+  int lo = 0, hi = index->count;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    const int result = strcmp(index->by_name[mid]->entry.filename, filename);
+    if (result == 0)
+      return mid;
+    if (result < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return -lo - 1;
+}
+
+static int find_map(const ghost_dir_index_t *index, const char *map) {
+  int lo = 0, hi = index->num_maps;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    const int result = strcmp(index->maps[mid].map, map);
+    if (result == 0)
+      return mid;
+    if (result < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return -lo - 1;
+}
+
+static int compare_by_time(const ghost_dir_entry_t *a,
+                           const ghost_dir_entry_t *b) {
+  if (a->time != b->time)
+    return a->time < b->time ? -1 : 1;
+  return strcmp(a->filename, b->filename);
+}
+
+static int map_insert(ghost_dir_index_t *index, dir_record_t *record) {
+  int map_pos = find_map(index, record->entry.map);
+  if (map_pos < 0) {
+    map_pos = -map_pos - 1;
+    if (index->num_maps == index->maps_capacity &&
+        grow_array((void **)&index->maps, &index->maps_capacity,
+                   sizeof(dir_map_t)) != 0)
+      return -1;
+    memmove(&index->maps[map_pos + 1], &index->maps[map_pos],
+            (index->num_maps - map_pos) * sizeof(dir_map_t));
+    memset(&index->maps[map_pos], 0, sizeof(dir_map_t));
+    strcpy(index->maps[map_pos].map, record->entry.map);
+    index->num_maps++;
+  }
+
+  dir_map_t *map = &index->maps[map_pos];
+  if (map->count == map->capacity &&
+      grow_array((void **)&map->records, &map->capacity,
+                 sizeof(dir_record_t *)) != 0)
+    return -1;
+
+  int lo = 0, hi = map->count;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (compare_by_time(&map->records[mid]->entry, &record->entry) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  memmove(&map->records[lo + 1], &map->records[lo],
+          (map->count - lo) * sizeof(dir_record_t *));
+  map->records[lo] = record;
+  map->count++;
+  return 0;
+}
+
+static void map_remove(ghost_dir_index_t *index, const dir_record_t *record) {
+  const int map_pos = find_map(index, record->entry.map);
+  if (map_pos < 0)
+    return;
+
+  dir_map_t *map = &index->maps[map_pos];
+  for (int i = 0; i < map->count; i++) {
+    if (map->records[i] != record)
+      continue;
+    memmove(&map->records[i], &map->records[i + 1],
+            (map->count - i - 1) * sizeof(dir_record_t *));
+    map->count--;
+    break;
+  }
+
+  if (map->count == 0) {
+    free(map->records);
+    memmove(&index->maps[map_pos], &index->maps[map_pos + 1],
+            (index->num_maps - map_pos - 1) * sizeof(dir_map_t));
+    index->num_maps--;
+  }
+}
+
+static void remove_record(ghost_dir_index_t *index, int pos) {
+  dir_record_t *record = index->by_name[pos];
+  map_remove(index, record);
+  memmove(&index->by_name[pos], &index->by_name[pos + 1],
+          (index->count - pos - 1) * sizeof(dir_record_t *));
+  index->count--;
+  free(record);
+}
+
+// Inserts or replaces the record for entry->filename.
+static int store_entry(ghost_dir_index_t *index, const ghost_dir_entry_t *entry,
+                       bool has_stats) {
+  int pos = find_record(index, entry->filename);
+  if (pos >= 0) {
+    dir_record_t *record = index->by_name[pos];
+    map_remove(index, record);
+    record->entry = *entry;
+    record->has_stats = has_stats;
+    record->seen = true;
+    if (map_insert(index, record) != 0) {
+      remove_record(index, pos);
+      return -1;
+    }
+    return 0;
+  }
+
+  pos = -pos - 1;
+  if (index->count == index->capacity &&
+      grow_array((void **)&index->by_name, &index->capacity,
+                 sizeof(dir_record_t *)) != 0)
+    return -1;
+
+  dir_record_t *record = (dir_record_t *)malloc(sizeof(dir_record_t));
+  if (!record)
+    return -1;
+  record->entry = *entry;
+  record->has_stats = has_stats;
+  record->seen = true;
+  if (map_insert(index, record) != 0) {
+    free(record);
+    return -1;
+  }
+
+  memmove(&index->by_name[pos + 1], &index->by_name[pos],
+          (index->count - pos) * sizeof(dir_record_t *));
+  index->by_name[pos] = record;
+  index->count++;
+  return 0;
+}
+
+// Brings the record for one file up to date. Returns 1 if the index changed.
+static int update_file(ghost_dir_index_t *index, const char *name) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", index->directory, name);
+
+  const int pos = find_record(index, name);
+  struct stat st;
+  if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+    if (pos < 0)
+      return 0;
+    remove_record(index, pos);
+    return 1;
+  }
+
+  const int64_t mtime_ns = stat_mtime_ns(&st);
+  if (pos >= 0) {
+    dir_record_t *record = index->by_name[pos];
+    record->seen = true;
+    if (record->entry.mtime_ns == mtime_ns &&
+        record->entry.size == (int64_t)st.st_size &&
+        (record->has_stats || !index->with_stats))
+      return 0;
+  }
+
+  ghost_header_info_t info;
+  if (ghost_read_info(path, &info) != 0) {
+    if (pos < 0)
+      return 0;
+    remove_record(index, pos);
+    return 1;
+  }
+
+  ghost_dir_entry_t entry;
+  memset(&entry, 0, sizeof(entry));
+  strcpy(entry.filename, name);
+  strcpy(entry.player, info.player);
+  strcpy(entry.map, info.map);
+  entry.version = info.version;
+  entry.time = info.time;
+  entry.num_ticks = info.num_ticks;
+  entry.size = (int64_t)st.st_size;
+  entry.mtime_ns = mtime_ns;
+  // A file whose body fails to decode keeps its entry with empty stats.
+  if (index->with_stats)
+    ghost_run_stats_file(path, &entry.stats);
+  return store_entry(index, &entry, index->with_stats) == 0 ? 1 : 0;
+}
+
+static void encode_record(unsigned char *out, const dir_record_t *record) {
+  const ghost_dir_entry_t *entry = &record->entry;
+  memcpy(out, entry->filename, 256);
+  memcpy(out + 256, entry->player, 16);
+  memcpy(out + 272, entry->map, 64);
+  uint32_to_le(out + 336, (uint32_t)entry->version);
+  uint32_to_le(out + 340, (uint32_t)entry->time);
+  uint32_to_le(out + 344, (uint32_t)entry->num_ticks);
+  int64_to_le(out + 348, entry->size);
+  int64_to_le(out + 356, entry->mtime_ns);
+
+  const ghost_run_stats_t *stats = &entry->stats;
+  uint32_to_le(out + 364, record->has_stats);
+  unsigned char *raw = out + 368;
+  uint32_to_le(raw, (uint32_t)stats->num_ticks);
+  float_to_le(raw + 4, stats->distance);
+  float_to_le(raw + 8, stats->max_speed);
+  float_to_le(raw + 12, stats->mean_speed);
+  uint32_to_le(raw + 16, (uint32_t)stats->air_ticks);
+  uint32_to_le(raw + 20, (uint32_t)stats->hook_count);
+  uint32_to_le(raw + 24, (uint32_t)stats->weapon_switches);
+  uint32_to_le(raw + 28, (uint32_t)stats->min_x);
+  uint32_to_le(raw + 32, (uint32_t)stats->min_y);
+  uint32_to_le(raw + 36, (uint32_t)stats->max_x);
+  uint32_to_le(raw + 40, (uint32_t)stats->max_y);
+}
+
+static void decode_record(const unsigned char *in, ghost_dir_entry_t *entry,
+                          bool *has_stats) {
+  memcpy(entry->filename, in, 256);
+  memcpy(entry->player, in + 256, 16);
+  memcpy(entry->map, in + 272, 64);
+  entry->filename[255] = '\0';
+  entry->player[15] = '\0';
+  entry->map[63] = '\0';
+  entry->version = (int)le_to_uint32(in + 336);
+  entry->time = (int)le_to_uint32(in + 340);
+  entry->num_ticks = (int)le_to_uint32(in + 344);
+  entry->size = le_to_int64(in + 348);
+  entry->mtime_ns = le_to_int64(in + 356);
+
+  ghost_run_stats_t *stats = &entry->stats;
+  *has_stats = le_to_uint32(in + 364) != 0;
+  const unsigned char *raw = in + 368;
+  stats->num_ticks = (int)le_to_uint32(raw);
+  stats->distance = le_to_float(raw + 4);
+  stats->max_speed = le_to_float(raw + 8);
+  stats->mean_speed = le_to_float(raw + 12);
+  stats->air_ticks = (int)le_to_uint32(raw + 16);
+  stats->hook_count = (int)le_to_uint32(raw + 20);
+  stats->weapon_switches = (int)le_to_uint32(raw + 24);
+  stats->min_x = (int)le_to_uint32(raw + 28);
+  stats->min_y = (int)le_to_uint32(raw + 32);
+  stats->max_x = (int)le_to_uint32(raw + 36);
+  stats->max_y = (int)le_to_uint32(raw + 40);
+}
+
+// A missing or unreadable cache only means the headers are read again.
+static void load_cache(ghost_dir_index_t *index) {
+  FILE *file = fopen(index->cache_filename, "rb");
+  if (!file)
+    return;
+
+  unsigned char header[CACHE_HEADER_SIZE];
+  if (fread(header, sizeof(header), 1, file) != 1 ||
+      memcmp(header, cache_marker, sizeof(cache_marker)) != 0 ||
+      le_to_uint32(header + 8) != CACHE_VERSION) {
+    fclose(file);
+    return;
+  }
+
+  const uint32_t count = le_to_uint32(header + 12);
+  for (uint32_t i = 0; i < count; i++) {
+    unsigned char raw[CACHE_RECORD_SIZE];
+    ghost_dir_entry_t entry;
+    bool has_stats;
+    if (fread(raw, sizeof(raw), 1, file) != 1)
+      break;
+    decode_record(raw, &entry, &has_stats);
+    if (!is_ghost_filename(entry.filename) || strchr(entry.filename, '/'))
+      continue;
+    if (store_entry(index, &entry, has_stats) != 0)
+      break;
+  }
+  fclose(file);
+}
+
+int ghost_dir_index_save_cache(const ghost_dir_index_t *index) {
+  if (!index || !index->cache_filename[0])
+    return -1;
+
+  char tmp_filename[sizeof(index->cache_filename) + 4];
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp",
+           index->cache_filename);
+  FILE *file = fopen(tmp_filename, "wb");
+  if (!file) {
+    fprintf(stderr, "ghost_dir_index: Failed to open cache '%s' for writing\n",
+            tmp_filename);
+    return -1;
+  }
+
+  unsigned char header[CACHE_HEADER_SIZE];
+  memcpy(header, cache_marker, sizeof(cache_marker));
+  uint32_to_le(header + 8, CACHE_VERSION);
+  uint32_to_le(header + 12, (uint32_t)index->count);
+  bool error = fwrite(header, sizeof(header), 1, file) != 1;
+  for (int i = 0; !error && i < index->count; i++) {
+    unsigned char raw[CACHE_RECORD_SIZE];
+    encode_record(raw, index->by_name[i]);
+    error = fwrite(raw, sizeof(raw), 1, file) != 1;
+  }
+  if (fclose(file) != 0)
+    error = true;
+
+  // Replace the old cache only once the new one is complete.
+  if (error || rename(tmp_filename, index->cache_filename) != 0) {
+    fprintf(stderr, "ghost_dir_index: Failed to write cache '%s'\n",
+            index->cache_filename);
+    remove(tmp_filename);
+    return -1;
+  }
+  return 0;
+}
+
+int ghost_dir_index_rescan(ghost_dir_index_t *index) {
+  if (!index)
+    return -1;
+
+  DIR *dir = opendir(index->directory);
+  if (!dir) {
+    fprintf(stderr, "ghost_dir_index: Failed to open directory '%s'\n",
+            index->directory);
+    return -1;
+  }
+
+  for (int i = 0; i < index->count; i++)
+    index->by_name[i]->seen = false;
+
+  int changes = 0;
+  struct dirent *item;
+  while ((item = readdir(dir))) {
+    if (is_ghost_filename(item->d_name))
+      changes += update_file(index, item->d_name);
+  }
+  closedir(dir);
+
+  for (int i = index->count - 1; i >= 0; i--) {
+    if (index->by_name[i]->seen)
+      continue;
+    remove_record(index, i);
+    changes++;
+  }
+  return changes;
+}
+
+ghost_dir_index_t *ghost_dir_index_open(const char *directory,
+                                        const char *cache_filename,
+                                        int flags) {
+  if (!directory)
+    return NULL;
+
+  ghost_dir_index_t *index =
+      (ghost_dir_index_t *)calloc(1, sizeof(ghost_dir_index_t));
+  if (!index)
+    return NULL;
+  strncpy(index->directory, directory, sizeof(index->directory) - 1);
+  if (cache_filename)
+    strncpy(index->cache_filename, cache_filename,
+            sizeof(index->cache_filename) - 1);
+  index->with_stats = (flags & GHOST_DIR_INDEX_STATS) != 0;
+  index->inotify_fd = -1;
+
+#if defined(GHOST_DIR_INOTIFY)
+  // Watch before scanning so nothing written in between is missed.
+  index->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (index->inotify_fd >= 0 &&
+      inotify_add_watch(index->inotify_fd, directory,
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                            IN_DELETE | IN_ATTRIB) < 0) {
+    close(index->inotify_fd);
+    index->inotify_fd = -1;
+  }
+#endif
+
+  if (index->cache_filename[0])
+    load_cache(index);
+  if (ghost_dir_index_rescan(index) < 0) {
+    ghost_dir_index_close(index);
+    return NULL;
+  }
+  return index;
+}
+
+void ghost_dir_index_close(ghost_dir_index_t *index) {
+  if (!index)
+    return;
+  if (index->cache_filename[0])
+    ghost_dir_index_save_cache(index);
+#if defined(GHOST_DIR_INOTIFY)
+  if (index->inotify_fd >= 0)
+    close(index->inotify_fd);
+#endif
+  for (int i = 0; i < index->count; i++)
+    free(index->by_name[i]);
+  for (int i = 0; i < index->num_maps; i++)
+    free(index->maps[i].records);
+  free(index->by_name);
+  free(index->maps);
+  free(index);
+}
+
+int ghost_dir_index_fd(const ghost_dir_index_t *index) {
+  return index ? index->inotify_fd : -1;
+}
+
+int ghost_dir_index_poll(ghost_dir_index_t *index, int timeout_ms) {
+  if (!index)
+    return -1;
+#if defined(GHOST_DIR_INOTIFY)
+  if (index->inotify_fd < 0)
+    return ghost_dir_index_rescan(index);
+
+  struct pollfd pfd = {index->inotify_fd, POLLIN, 0};
+  if (timeout_ms != 0 && poll(&pfd, 1, timeout_ms) <= 0)
+    return 0;
+
+  int changes = 0;
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    const ssize_t length = read(index->inotify_fd, buffer, sizeof(buffer));
+    if (length < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if (length == 0)
+      break;
+
+    for (ssize_t offset = 0; offset < length;) {
+      const struct inotify_event *event =
+          (const struct inotify_event *)(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        const int rescanned = ghost_dir_index_rescan(index);
+        if (rescanned > 0)
+          changes += rescanned;
+        continue;
+      }
+      if (!event->len || !is_ghost_filename(event->name))
+        continue;
+      // update_file stats the file, so deletes and renames need no special
+      // handling beyond looking at what is on disk now.
+      changes += update_file(index, event->name);
+    }
+  }
+  return changes;
+#else
+  (void)timeout_ms;
+  return ghost_dir_index_rescan(index);
+#endif
+}
+
+int ghost_dir_index_count(const ghost_dir_index_t *index) {
+  return index ? index->count : 0;
+}
+
+const ghost_dir_entry_t *ghost_dir_index_find(const ghost_dir_index_t *index,
+                                              const char *filename) {
+  if (!index || !filename)
+    return NULL;
+  const int pos = find_record(index, filename);
+  return pos >= 0 ? &index->by_name[pos]->entry : NULL;
+}
+
+int ghost_dir_index_top(const ghost_dir_index_t *index, const char *map,
+                        const ghost_dir_entry_t **out, int max_out) {
+  if (!index || !map || !out || max_out <= 0)
+    return 0;
+  const int map_pos = find_map(index, map);
+  if (map_pos < 0)
+    return 0;
+
+  const dir_map_t *group = &index->maps[map_pos];
+  const int count = group->count < max_out ? group->count : max_out;
+  for (int i = 0; i < count; i++)
+    out[i] = &group->records[i]->entry;
+  return count;
+}
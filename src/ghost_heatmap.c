@@ -0,0 +1,231 @@
+
+#include "ghost_parallel.h"
+#include <ddnet_ghost/ghost_heatmap.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  DEFAULT_CELL_SIZE = 32,
+  SAVE_BLOCK = 4096,
+};
+
+typedef struct heatmap_state_t {
+  ghost_character_t last;
+  bool has_last;
+} heatmap_state_t;
+
+static void heatmap_deposit(const ghost_heatmap_t *heatmap, float *cells,
+                            heatmap_state_t *state,
+                            const ghost_character_t *snap) {
+  float weight = 1.0f;
+  if (heatmap->weighting != GHOST_HEATMAP_WEIGHT_COUNT) {
+    int gap = state->has_last ? snap->tick - state->last.tick : 1;
+    if (gap < 1)
+      gap = 1;
+    if (heatmap->weighting == GHOST_HEATMAP_WEIGHT_TIME) {
+      weight = (float)gap / GHOST_TICKS_PER_SECOND;
+    } else if (state->has_last) {
+      const double dx = (double)snap->x - state->last.x;
+      const double dy = (double)snap->y - state->last.y;
+      weight = (float)(sqrt(dx * dx + dy * dy) / gap);
+    } else {
+      weight = 0.0f;
+    }
+  }
+  state->last = *snap;
+  state->has_last = true;
+
+  if (snap->x < 0 || snap->y < 0)
+    return;
+  const int cx = snap->x / heatmap->cell_size;
+  const int cy = snap->y / heatmap->cell_size;
+  if (cx >= heatmap->width || cy >= heatmap->height)
+    return;
+  cells[(size_t)cy * heatmap->width + cx] += weight;
+}
+
+static void heatmap_add_path(const ghost_heatmap_t *heatmap, float *cells,
+                             const ghost_path_t *path) {
+  if (!path->chunks)
+    return;
+  heatmap_state_t state;
+  memset(&state, 0, sizeof(state));
+  for (int start = 0; start < path->num_items; start += path->chunk_size) {
+    const ghost_character_t *chunk = path->chunks[start / path->chunk_size];
+    const int count = path->num_items - start < path->chunk_size
+                          ? path->num_items - start
+                          : path->chunk_size;
+    for (int i = 0; i < count; i++)
+      heatmap_deposit(heatmap, cells, &state, &chunk[i]);
+  }
+}
+
+// Snapshots are deposited as they are read, so a file that fails half way
+// still contributes what was decoded before the error.
+static int heatmap_add_file(const ghost_heatmap_t *heatmap, float *cells,
+                            const char *filename) {
+  ghost_reader_t *reader = ghost_reader_open(filename);
+  if (!reader)
+    return -1;
+  heatmap_state_t state;
+  memset(&state, 0, sizeof(state));
+  ghost_character_t snap;
+  int status;
+  while ((status = ghost_reader_next(reader, &snap)) == 1)
+    heatmap_deposit(heatmap, cells, &state, &snap);
+  ghost_reader_close(reader);
+  return status == 0 ? 0 : -1;
+}
+
+ghost_heatmap_t *ghost_heatmap_create(int width, int height, int cell_size,
+                                      int weighting) {
+  if (width <= 0 || height <= 0 ||
+      (size_t)width > SIZE_MAX / sizeof(float) / (size_t)height ||
+      weighting < GHOST_HEATMAP_WEIGHT_COUNT ||
+      weighting > GHOST_HEATMAP_WEIGHT_SPEED)
+    return NULL;
+
+  ghost_heatmap_t *heatmap =
+      (ghost_heatmap_t *)calloc(1, sizeof(ghost_heatmap_t));
+  if (!heatmap)
+    return NULL;
+  heatmap->width = width;
+  heatmap->height = height;
+  heatmap->cell_size = cell_size > 0 ? cell_size : DEFAULT_CELL_SIZE;
+  heatmap->weighting = weighting;
+  heatmap->cells = (float *)calloc((size_t)width * height, sizeof(float));
+  if (!heatmap->cells) {
+    fprintf(stderr, "ghost_heatmap: Failed to allocate %dx%d cells\n", width,
+            height);
+    free(heatmap);
+    return NULL;
+  }
+  return heatmap;
+}
+
+void ghost_heatmap_free(ghost_heatmap_t *heatmap) {
+  if (!heatmap)
+    return;
+  free(heatmap->cells);
+  free(heatmap);
+}
+
+void ghost_heatmap_clear(ghost_heatmap_t *heatmap) {
+  if (!heatmap)
+    return;
+  memset(heatmap->cells, 0,
+         (size_t)heatmap->width * heatmap->height * sizeof(float));
+}
+
+int ghost_heatmap_add_path(ghost_heatmap_t *heatmap, const ghost_path_t *path) {
+  if (!heatmap || !path)
+    return -1;
+  heatmap_add_path(heatmap, heatmap->cells, path);
+  return 0;
+}
+
+int ghost_heatmap_add_file(ghost_heatmap_t *heatmap, const char *filename) {
+  if (!heatmap || !filename)
+    return -1;
+  return heatmap_add_file(heatmap, heatmap->cells, filename);
+}
+
+typedef struct heatmap_batch_t {
+  const ghost_heatmap_t *heatmap;
+  const ghost_t *const *ghosts;
+  const char *const *filenames;
+  // Worker 0 adds to the heatmap's own cells, the others to their own.
+  float *cells[GHOST_PARALLEL_MAX_THREADS];
+} heatmap_batch_t;
+
+static int heatmap_job(void *context, int worker, int index) {
+  const heatmap_batch_t *batch = (const heatmap_batch_t *)context;
+  float *cells = batch->cells[worker];
+  if (batch->filenames)
+    return heatmap_add_file(batch->heatmap, cells, batch->filenames[index]);
+  if (!batch->ghosts[index])
+    return -1;
+  heatmap_add_path(batch->heatmap, cells, &batch->ghosts[index]->path);
+  return 0;
+}
+
+static int heatmap_run(ghost_heatmap_t *heatmap, heatmap_batch_t *batch,
+                       int num_items, int num_threads) {
+  num_threads = ghost_parallel_num_threads(num_threads, num_items);
+  const size_t num_cells = (size_t)heatmap->width * heatmap->height;
+  batch->heatmap = heatmap;
+  batch->cells[0] = heatmap->cells;
+  int num_workers = 1;
+  while (num_workers < num_threads) {
+    batch->cells[num_workers] = (float *)calloc(num_cells, sizeof(float));
+    if (!batch->cells[num_workers])
+      break;
+    num_workers++;
+  }
+
+  const int num_done =
+      ghost_parallel_for(num_items, num_workers, heatmap_job, batch);
+  for (int i = 1; i < num_workers; i++) {
+    const float *cells = batch->cells[i];
+    for (size_t c = 0; c < num_cells; c++)
+      heatmap->cells[c] += cells[c];
+    free(batch->cells[i]);
+  }
+  return num_done;
+}
+
+int ghost_heatmap_add_ghosts(ghost_heatmap_t *heatmap,
+                             const ghost_t *const *ghosts, int num_ghosts,
+                             int num_threads) {
+  if (!heatmap || !ghosts || num_ghosts < 0)
+    return -1;
+  heatmap_batch_t batch = {heatmap, ghosts, NULL, {NULL}};
+  return heatmap_run(heatmap, &batch, num_ghosts, num_threads);
+}
+
+int ghost_heatmap_add_files(ghost_heatmap_t *heatmap,
+                            const char *const *filenames, int num_files,
+                            int num_threads) {
+  if (!heatmap || !filenames || num_files < 0)
+    return -1;
+  heatmap_batch_t batch = {heatmap, NULL, filenames, {NULL}};
+  return heatmap_run(heatmap, &batch, num_files, num_threads);
+}
+
+int ghost_heatmap_save_raw(const ghost_heatmap_t *heatmap,
+                           const char *filename) {
+  if (!heatmap || !filename)
+    return -1;
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    fprintf(stderr, "ghost_heatmap: Failed to open '%s' for writing\n",
+            filename);
+    return -1;
+  }
+
+  const size_t num_cells = (size_t)heatmap->width * heatmap->height;
+  unsigned char buffer[SAVE_BLOCK * 4];
+  bool error = false;
+  for (size_t start = 0; !error && start < num_cells; start += SAVE_BLOCK) {
+    const size_t count =
+        num_cells - start < SAVE_BLOCK ? num_cells - start : SAVE_BLOCK;
+    for (size_t i = 0; i < count; i++) {
+      uint32_t bits;
+      memcpy(&bits, &heatmap->cells[start + i], sizeof(bits));
+      for (int b = 0; b < 4; b++)
+        buffer[i * 4 + b] = (bits >> (8 * b)) & 0xff;
+    }
+    error = fwrite(buffer, 4, count, file) != count;
+  }
+  if (fclose(file) != 0)
+    error = true;
+  if (error) {
+    fprintf(stderr, "ghost_heatmap: Failed to write '%s'\n", filename);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,236 @@
+#include <ddnet_ghost/ghost_lod.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct lod_segment_t {
+  int first;
+  int last;
+  float parent_importance;
+} lod_segment_t;
+
+static float segment_distance(const ghost_lod_point_t *p,
+                              const ghost_lod_point_t *a,
+                              const ghost_lod_point_t *b) {
+  const double abx = (double)b->x - a->x;
+  const double aby = (double)b->y - a->y;
+  const double apx = (double)p->x - a->x;
+  const double apy = (double)p->y - a->y;
+  const double len2 = abx * abx + aby * aby;
+
+  double t = len2 > 0.0 ? (apx * abx + apy * aby) / len2 : 0.0;
+  if (t < 0.0)
+    t = 0.0;
+  else if (t > 1.0)
+    t = 1.0;
+
+  const double dx = apx - t * abx;
+  const double dy = apy - t * aby;
+  return (float)sqrt(dx * dx + dy * dy);
+}
+
+// Runs Douglas-Peucker once with a zero tolerance and records for every point
+// the largest tolerance at which it would still be kept. A point's importance
+// never exceeds that of the split that created its segment, so keeping all
+// points above a tolerance reproduces Douglas-Peucker at that tolerance.
+static int compute_importance(const ghost_lod_point_t *points, int num_points,
+                              float *importance) {
+  if (num_points <= 0)
+    return 0;
+
+  importance[0] = FLT_MAX;
+  importance[num_points - 1] = FLT_MAX;
+  if (num_points <= 2)
+    return 0;
+
+  lod_segment_t *stack =
+      (lod_segment_t *)malloc(num_points * sizeof(lod_segment_t));
+  if (!stack)
+    return -1;
+
+  int top = 0;
+  stack[top++] = (lod_segment_t){0, num_points - 1, FLT_MAX};
+  while (top > 0) {
+    const lod_segment_t segment = stack[--top];
+    if (segment.last - segment.first < 2)
+      continue;
+
+    int split = segment.first + 1;
+    float max_dist = -1.0f;
+    for (int i = segment.first + 1; i < segment.last; i++) {
+      const float dist = segment_distance(&points[i], &points[segment.first],
+                                          &points[segment.last]);
+      if (dist > max_dist) {
+        max_dist = dist;
+        split = i;
+      }
+    }
+
+    if (max_dist <= 0.0f) {
+      for (int i = segment.first + 1; i < segment.last; i++)
+        importance[i] = 0.0f;
+      continue;
+    }
+
+    const float value = max_dist < segment.parent_importance
+                            ? max_dist
+                            : segment.parent_importance;
+    importance[split] = value;
+    stack[top++] = (lod_segment_t){segment.first, split, value};
+    stack[top++] = (lod_segment_t){split, segment.last, value};
+  }
+
+  free(stack);
+  return 0;
+}
+
+static ghost_lod_t *build_levels(const ghost_lod_point_t *points,
+                                 int num_points, float base_error,
+                                 int num_levels) {
+  if (num_levels < 1 || base_error < 0.0f)
+    return NULL;
+
+  float *importance = (float *)malloc((num_points ? num_points : 1) *
+                                      sizeof(float));
+  ghost_lod_t *lod = (ghost_lod_t *)calloc(1, sizeof(ghost_lod_t));
+  if (!importance || !lod ||
+      compute_importance(points, num_points, importance) != 0) {
+    fprintf(stderr, "ghost_lod: Failed to allocate memory\n");
+    free(importance);
+    free(lod);
+    return NULL;
+  }
+
+  lod->levels =
+      (ghost_lod_level_t *)calloc(num_levels, sizeof(ghost_lod_level_t));
+  if (!lod->levels) {
+    free(importance);
+    ghost_lod_free(lod);
+    return NULL;
+  }
+  lod->num_levels = num_levels;
+
+  float error = base_error;
+  for (int level = 0; level < num_levels; level++) {
+    ghost_lod_level_t *out = &lod->levels[level];
+    out->max_error = level == 0 ? 0.0f : error;
+
+    int count = 0;
+    for (int i = 0; i < num_points; i++)
+      if (level == 0 || importance[i] > error)
+        count++;
+
+    out->points = (ghost_lod_point_t *)malloc(
+        (count ? count : 1) * sizeof(ghost_lod_point_t));
+    if (!out->points) {
+      fprintf(stderr, "ghost_lod: Failed to allocate memory\n");
+      free(importance);
+      ghost_lod_free(lod);
+      return NULL;
+    }
+    for (int i = 0; i < num_points; i++)
+      if (level == 0 || importance[i] > error)
+        out->points[out->num_points++] = points[i];
+
+    if (level > 0)
+      error *= 2.0f;
+  }
+
+  free(importance);
+  return lod;
+}
+
+ghost_lod_t *ghost_lod_build(const ghost_path_t *path, float base_error,
+                             int num_levels) {
+  if (!path)
+    return NULL;
+
+  ghost_lod_point_t *points = (ghost_lod_point_t *)malloc(
+      (path->num_items ? path->num_items : 1) * sizeof(ghost_lod_point_t));
+  if (!points)
+    return NULL;
+  for (int i = 0; i < path->num_items; i++) {
+    const ghost_character_t *snap = ghost_get_snap(path, i);
+    points[i].x = snap->x;
+    points[i].y = snap->y;
+    points[i].tick = snap->tick;
+  }
+
+  ghost_lod_t *lod =
+      build_levels(points, path->num_items, base_error, num_levels);
+  free(points);
+  return lod;
+}
+
+ghost_lod_t *ghost_lod_build_from_reader(ghost_reader_t *reader,
+                                         float base_error, int num_levels) {
+  if (!reader)
+    return NULL;
+
+  int capacity = ghost_reader_num_ticks(reader);
+  if (capacity <= 0)
+    capacity = 1;
+  ghost_lod_point_t *points =
+      (ghost_lod_point_t *)malloc(capacity * sizeof(ghost_lod_point_t));
+  if (!points)
+    return NULL;
+
+  int num_points = 0;
+  ghost_character_t snap;
+  int result;
+  while ((result = ghost_reader_next(reader, &snap)) == 1) {
+    if (num_points == capacity) {
+      capacity *= 2;
+      ghost_lod_point_t *grown = (ghost_lod_point_t *)realloc(
+          points, capacity * sizeof(ghost_lod_point_t));
+      if (!grown) {
+        free(points);
+        return NULL;
+      }
+      points = grown;
+    }
+    points[num_points].x = snap.x;
+    points[num_points].y = snap.y;
+    points[num_points].tick = snap.tick;
+    num_points++;
+  }
+
+  ghost_lod_t *lod = NULL;
+  if (result == 0) {
+    // Snapshots of files without ticks are numbered from 0; the start tick
+    // is only known now.
+    if (!ghost_reader_has_ticks(reader)) {
+      const int start_tick = ghost_reader_meta(reader)->start_tick;
+      for (int i = 0; i < num_points; i++)
+        points[i].tick += start_tick;
+    }
+    lod = build_levels(points, num_points, base_error, num_levels);
+  }
+  free(points);
+  return lod;
+}
+
+const ghost_lod_level_t *ghost_lod_pick(const ghost_lod_t *lod,
+                                        float tolerance) {
+  if (!lod || lod->num_levels <= 0)
+    return NULL;
+
+  const ghost_lod_level_t *best = &lod->levels[0];
+  for (int i = 1; i < lod->num_levels; i++)
+    if (lod->levels[i].max_error <= tolerance)
+      best = &lod->levels[i];
+  return best;
+}
+
+void ghost_lod_free(ghost_lod_t *lod) {
+  if (!lod)
+    return;
+  if (lod->levels) {
+    for (int i = 0; i < lod->num_levels; i++)
+      free(lod->levels[i].points);
+    free(lod->levels);
+  }
+  free(lod);
+}
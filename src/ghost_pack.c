@@ -0,0 +1,682 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ddnet_ghost/ghost_pack.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+// Layout: file header, ghost files back to back, index, trailer. The index
+// is sorted by (map, player, time) and the trailer at the very end of the
+// file points to it. All integers are little endian. Appending writes new
+// ghosts, index and trailer after the old trailer, so an interrupted append
+// leaves the previous trailer intact and the pack opens with its old
+// contents. Every append leaves the old index behind as dead space; once it
+// outgrows the ghosts themselves the pack is rewritten into a temporary file
+// that replaces it, which keeps the file below about twice its live data.
+enum {
+  PACK_VERSION = 1,
+  PACK_HEADER_SIZE = 16,
+  PACK_TRAILER_SIZE = 24,
+  PACK_MAP_LENGTH = 64,
+  PACK_PLAYER_LENGTH = 16,
+  PACK_ENTRY_SIZE = PACK_MAP_LENGTH + PACK_PLAYER_LENGTH + 4 + 4 + 8 + 8,
+  PACK_FILENAME_LENGTH = 512,
+  RECOVER_BLOCK_SIZE = 1 << 16,
+};
+
+static const unsigned char pack_marker[8] = {'T', 'W', 'G', 'P',
+                                             'A', 'C', 'K', 0};
+static const unsigned char index_marker[8] = {'T', 'W', 'G', 'P',
+                                              'I', 'D', 'X', 0};
+
+typedef struct pack_entry_t {
+  char map[PACK_MAP_LENGTH];
+  char player[PACK_PLAYER_LENGTH];
+  int time;
+  int num_ticks;
+  uint64_t offset;
+  uint64_t size;
+} pack_entry_t;
+
+struct ghost_pack_t {
+  const unsigned char *data;
+  uint64_t size;
+  const unsigned char *index;
+  int count;
+  bool mapped;
+};
+
+struct ghost_pack_writer_t {
+  FILE *file;
+  char filename[PACK_FILENAME_LENGTH];
+  uint64_t data_end;
+  // False while an existing pack is unchanged, so closing it writes nothing.
+  bool modified;
+  pack_entry_t *entries;
+  int count;
+  int capacity;
+};
+
+static void uint32_to_le(unsigned char *bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    bytes[i] = (value >> (8 * i)) & 0xff;
+}
+
+static void uint64_to_le(unsigned char *bytes, uint64_t value) {
+  for (int i = 0; i < 8; i++)
+    bytes[i] = (value >> (8 * i)) & 0xff;
+}
+
+static uint32_t le_to_uint32(const unsigned char *bytes) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t le_to_uint64(const unsigned char *bytes) {
+  return (uint64_t)le_to_uint32(bytes) |
+         ((uint64_t)le_to_uint32(bytes + 4) << 32);
+}
+
+static int pack_seek(FILE *file, uint64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(file, (int64_t)offset, SEEK_SET);
+#else
+  return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// Size of the file, leaving the position at its end. -1 on error.
+static int64_t pack_file_size(FILE *file) {
+#if defined(_WIN32)
+  if (_fseeki64(file, 0, SEEK_END) != 0)
+    return -1;
+  return _ftelli64(file);
+#else
+  if (fseeko(file, 0, SEEK_END) != 0)
+    return -1;
+  return (int64_t)ftello(file);
+#endif
+}
+
+// Drops whatever an interrupted append left after `size`.
+static int pack_truncate(FILE *file, uint64_t size) {
+  if (fflush(file) != 0)
+    return -1;
+#if defined(_WIN32)
+  return _chsize_s(_fileno(file), (int64_t)size);
+#else
+  return ftruncate(fileno(file), (off_t)size);
+#endif
+}
+
+static void encode_entry(unsigned char *out, const pack_entry_t *entry) {
+  memcpy(out, entry->map, PACK_MAP_LENGTH);
+  memcpy(out + PACK_MAP_LENGTH, entry->player, PACK_PLAYER_LENGTH);
+  out += PACK_MAP_LENGTH + PACK_PLAYER_LENGTH;
+  uint32_to_le(out, (uint32_t)entry->time);
+  uint32_to_le(out + 4, (uint32_t)entry->num_ticks);
+  uint64_to_le(out + 8, entry->offset);
+  uint64_to_le(out + 16, entry->size);
+}
+
+static void decode_entry(const unsigned char *in, pack_entry_t *entry) {
+  memcpy(entry->map, in, PACK_MAP_LENGTH);
+  memcpy(entry->player, in + PACK_MAP_LENGTH, PACK_PLAYER_LENGTH);
+  entry->map[PACK_MAP_LENGTH - 1] = '\0';
+  entry->player[PACK_PLAYER_LENGTH - 1] = '\0';
+  in += PACK_MAP_LENGTH + PACK_PLAYER_LENGTH;
+  entry->time = (int)le_to_uint32(in);
+  entry->num_ticks = (int)le_to_uint32(in + 4);
+  entry->offset = le_to_uint64(in + 8);
+  entry->size = le_to_uint64(in + 16);
+}
+
+static int compare_key(const char *map_a, const char *player_a, int time_a,
+                       const char *map_b, const char *player_b, int time_b) {
+  int result = strncmp(map_a, map_b, PACK_MAP_LENGTH);
+  if (result)
+    return result;
+  if (player_a && player_b) {
+    result = strncmp(player_a, player_b, PACK_PLAYER_LENGTH);
+    if (result)
+      return result;
+  }
+  return (time_a > time_b) - (time_a < time_b);
+}
+
+static int compare_entries(const void *a, const void *b) {
+  const pack_entry_t *entry_a = (const pack_entry_t *)a;
+  const pack_entry_t *entry_b = (const pack_entry_t *)b;
+  const int result =
+      compare_key(entry_a->map, entry_a->player, entry_a->time, entry_b->map,
+                  entry_b->player, entry_b->time);
+  if (result)
+    return result;
+  return (entry_a->offset > entry_b->offset) -
+         (entry_a->offset < entry_b->offset);
+}
+
+static const unsigned char *entry_at(const ghost_pack_t *pack, int index) {
+  return pack->index + (size_t)index * PACK_ENTRY_SIZE;
+}
+
+static bool read_trailer(const unsigned char *trailer, uint64_t file_size,
+                         uint64_t *index_offset, int *count) {
+  if (memcmp(trailer, index_marker, sizeof(index_marker)) != 0)
+    return false;
+
+  *index_offset = le_to_uint64(trailer + 8);
+  const uint32_t num = le_to_uint32(trailer + 16);
+  if (*index_offset < PACK_HEADER_SIZE || num > INT32_MAX ||
+      *index_offset + (uint64_t)num * PACK_ENTRY_SIZE + PACK_TRAILER_SIZE !=
+          file_size)
+    return false;
+
+  *count = (int)num;
+  return true;
+}
+
+// Searches `block`, which starts at file offset `offset`, for the last
+// valid trailer and returns the file offset just past it, or 0 if there is
+// none. Only needed when an append was interrupted after the old trailer.
+static uint64_t find_last_trailer(const unsigned char *block, uint64_t offset,
+                                  uint64_t size) {
+  uint64_t first = offset + PACK_TRAILER_SIZE;
+  if (first < PACK_HEADER_SIZE + PACK_TRAILER_SIZE)
+    first = PACK_HEADER_SIZE + PACK_TRAILER_SIZE;
+  for (uint64_t end = offset + size; end >= first; end--) {
+    uint64_t index_offset;
+    int count;
+    if (read_trailer(block + (end - offset) - PACK_TRAILER_SIZE, end,
+                     &index_offset, &count))
+      return end;
+  }
+  return 0;
+}
+
+static bool validate_pack_header(const unsigned char *header) {
+  return memcmp(header, pack_marker, sizeof(pack_marker)) == 0 &&
+         le_to_uint32(header + 8) == PACK_VERSION;
+}
+
+ghost_pack_t *ghost_pack_open(const char *filename) {
+  ghost_pack_t *pack = (ghost_pack_t *)calloc(1, sizeof(ghost_pack_t));
+  if (!pack)
+    return NULL;
+
+#if !defined(_WIN32)
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "ghost_pack: Failed to open pack '%s' for reading\n",
+            filename);
+    free(pack);
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < PACK_HEADER_SIZE + PACK_TRAILER_SIZE) {
+    fprintf(stderr, "ghost_pack: Failed to read pack '%s': file too small\n",
+            filename);
+    close(fd);
+    free(pack);
+    return NULL;
+  }
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "ghost_pack: Failed to map pack '%s'\n", filename);
+    free(pack);
+    return NULL;
+  }
+  pack->data = (const unsigned char *)data;
+  pack->size = (uint64_t)st.st_size;
+  pack->mapped = true;
+#else
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr, "ghost_pack: Failed to open pack '%s' for reading\n",
+            filename);
+    free(pack);
+    return NULL;
+  }
+  _fseeki64(file, 0, SEEK_END);
+  const int64_t size = _ftelli64(file);
+  _fseeki64(file, 0, SEEK_SET);
+  unsigned char *data =
+      size >= PACK_HEADER_SIZE + PACK_TRAILER_SIZE ? malloc((size_t)size)
+                                                   : NULL;
+  if (!data || fread(data, (size_t)size, 1, file) != 1) {
+    fprintf(stderr, "ghost_pack: Failed to read pack '%s'\n", filename);
+    fclose(file);
+    free(data);
+    free(pack);
+    return NULL;
+  }
+  fclose(file);
+  pack->data = data;
+  pack->size = (uint64_t)size;
+#endif
+
+  uint64_t index_offset;
+  uint64_t end = pack->size;
+  if (validate_pack_header(pack->data) &&
+      !read_trailer(pack->data + end - PACK_TRAILER_SIZE, end, &index_offset,
+                    &pack->count))
+    end = find_last_trailer(pack->data, 0, pack->size);
+  if (!validate_pack_header(pack->data) || end == 0 ||
+      !read_trailer(pack->data + end - PACK_TRAILER_SIZE, end, &index_offset,
+                    &pack->count)) {
+    fprintf(stderr, "ghost_pack: Failed to read pack '%s': invalid format\n",
+            filename);
+    ghost_pack_close(pack);
+    return NULL;
+  }
+  pack->index = pack->data + index_offset;
+  return pack;
+}
+
+void ghost_pack_close(ghost_pack_t *pack) {
+  if (!pack)
+    return;
+#if !defined(_WIN32)
+  if (pack->mapped)
+    munmap((void *)pack->data, (size_t)pack->size);
+#else
+  free((void *)pack->data);
+#endif
+  free(pack);
+}
+
+int ghost_pack_count(const ghost_pack_t *pack) {
+  return pack ? pack->count : 0;
+}
+
+int ghost_pack_entry(const ghost_pack_t *pack, int index,
+                     ghost_pack_entry_t *entry) {
+  if (!pack || !entry || index < 0 || index >= pack->count)
+    return -1;
+
+  const unsigned char *raw = entry_at(pack, index);
+  const uint64_t offset = le_to_uint64(raw + PACK_ENTRY_SIZE - 16);
+  const uint64_t size = le_to_uint64(raw + PACK_ENTRY_SIZE - 8);
+  const uint64_t index_offset = (uint64_t)(pack->index - pack->data);
+  if (!memchr(raw, 0, PACK_MAP_LENGTH) ||
+      !memchr(raw + PACK_MAP_LENGTH, 0, PACK_PLAYER_LENGTH) ||
+      offset < PACK_HEADER_SIZE || offset > index_offset ||
+      size > index_offset - offset) {
+    fprintf(stderr, "ghost_pack: Pack entry %d is corrupt\n", index);
+    return -1;
+  }
+
+  entry->map = (const char *)raw;
+  entry->player = (const char *)raw + PACK_MAP_LENGTH;
+  entry->time = (int)le_to_uint32(raw + PACK_MAP_LENGTH + PACK_PLAYER_LENGTH);
+  entry->num_ticks =
+      (int)le_to_uint32(raw + PACK_MAP_LENGTH + PACK_PLAYER_LENGTH + 4);
+  entry->data = pack->data + offset;
+  entry->size = (size_t)size;
+  return 0;
+}
+
+// First entry whose key is not less than the given one.
+static int lower_bound(const ghost_pack_t *pack, const char *map,
+                       const char *player, int time) {
+  int lo = 0, hi = pack->count;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    const unsigned char *raw = entry_at(pack, mid);
+    const char *mid_player = player ? (const char *)raw + PACK_MAP_LENGTH : NULL;
+    const int mid_time =
+        player ? (int)le_to_uint32(raw + PACK_MAP_LENGTH + PACK_PLAYER_LENGTH)
+               : 0;
+    if (compare_key((const char *)raw, mid_player, mid_time, map, player,
+                    time) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+int ghost_pack_find(const ghost_pack_t *pack, const char *map,
+                    const char *player, int time) {
+  if (!pack || !map || !player)
+    return -1;
+
+  const int index = lower_bound(pack, map, player, time < 0 ? INT32_MIN : time);
+  if (index >= pack->count)
+    return -1;
+
+  const unsigned char *raw = entry_at(pack, index);
+  if (strncmp((const char *)raw, map, PACK_MAP_LENGTH) != 0 ||
+      strncmp((const char *)raw + PACK_MAP_LENGTH, player,
+              PACK_PLAYER_LENGTH) != 0)
+    return -1;
+  if (time >= 0 &&
+      (int)le_to_uint32(raw + PACK_MAP_LENGTH + PACK_PLAYER_LENGTH) != time)
+    return -1;
+  return index;
+}
+
+int ghost_pack_find_map(const ghost_pack_t *pack, const char *map,
+                        int *count) {
+  if (!pack || !map)
+    return -1;
+
+  const int first = lower_bound(pack, map, NULL, 0);
+  int last = first;
+  int step = 1;
+  // Gallop to the end of the map's range, then bisect.
+  while (last + step <= pack->count &&
+         strncmp((const char *)entry_at(pack, last + step - 1), map,
+                 PACK_MAP_LENGTH) == 0) {
+    last += step;
+    step *= 2;
+  }
+  int lo = last, hi = last + step - 1 < pack->count ? last + step - 1
+                                                    : pack->count;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (strncmp((const char *)entry_at(pack, mid), map, PACK_MAP_LENGTH) == 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (count)
+    *count = lo - first;
+  return lo > first ? first : -1;
+}
+
+ghost_t *ghost_pack_load(const ghost_pack_t *pack, int index) {
+  ghost_pack_entry_t entry;
+  if (ghost_pack_entry(pack, index, &entry) != 0)
+    return NULL;
+  return ghost_load_mem(entry.data, entry.size);
+}
+
+static void free_writer(ghost_pack_writer_t *writer) {
+  if (writer->file)
+    fclose(writer->file);
+  free(writer->entries);
+  free(writer);
+}
+
+// Reads the file backwards in blocks overlapping by one trailer.
+static uint64_t recover_trailer(FILE *file, uint64_t size) {
+  unsigned char *block = (unsigned char *)malloc(RECOVER_BLOCK_SIZE);
+  if (!block)
+    return 0;
+  uint64_t end = 0;
+  uint64_t hi = size;
+  while (end == 0 && hi >= PACK_HEADER_SIZE + PACK_TRAILER_SIZE) {
+    const uint64_t lo = hi > RECOVER_BLOCK_SIZE ? hi - RECOVER_BLOCK_SIZE : 0;
+    if (pack_seek(file, lo) != 0 ||
+        fread(block, (size_t)(hi - lo), 1, file) != 1)
+      break;
+    end = find_last_trailer(block, lo, hi - lo);
+    if (lo == 0)
+      break;
+    hi = lo + PACK_TRAILER_SIZE - 1;
+  }
+  free(block);
+  return end;
+}
+
+static bool load_existing_index(ghost_pack_writer_t *writer) {
+  FILE *file = writer->file;
+  const int64_t file_size = pack_file_size(file);
+  if (file_size < PACK_HEADER_SIZE + PACK_TRAILER_SIZE)
+    return false;
+
+  uint64_t size = (uint64_t)file_size;
+  unsigned char header[PACK_HEADER_SIZE];
+  unsigned char trailer[PACK_TRAILER_SIZE];
+  if (pack_seek(file, 0) != 0 || fread(header, sizeof(header), 1, file) != 1 ||
+      !validate_pack_header(header) ||
+      pack_seek(file, size - PACK_TRAILER_SIZE) != 0 ||
+      fread(trailer, sizeof(trailer), 1, file) != 1)
+    return false;
+
+  uint64_t index_offset;
+  int count;
+  if (!read_trailer(trailer, size, &index_offset, &count)) {
+    size = recover_trailer(file, size);
+    if (size == 0 || pack_seek(file, size - PACK_TRAILER_SIZE) != 0 ||
+        fread(trailer, sizeof(trailer), 1, file) != 1 ||
+        !read_trailer(trailer, size, &index_offset, &count))
+      return false;
+  }
+
+  writer->entries =
+      (pack_entry_t *)malloc((count ? count : 1) * sizeof(pack_entry_t));
+  if (!writer->entries)
+    return false;
+  writer->capacity = count ? count : 1;
+
+  if (pack_seek(file, index_offset) != 0)
+    return false;
+  for (int i = 0; i < count; i++) {
+    unsigned char raw[PACK_ENTRY_SIZE];
+    if (fread(raw, sizeof(raw), 1, file) != 1)
+      return false;
+    decode_entry(raw, &writer->entries[i]);
+  }
+  writer->count = count;
+  writer->data_end = size;
+  return true;
+}
+
+ghost_pack_writer_t *ghost_pack_writer_open(const char *filename) {
+  ghost_pack_writer_t *writer =
+      (ghost_pack_writer_t *)calloc(1, sizeof(ghost_pack_writer_t));
+  if (!writer)
+    return NULL;
+  strncpy(writer->filename, filename, sizeof(writer->filename) - 1);
+
+  writer->file = fopen(filename, "r+b");
+  if (writer->file) {
+    if (!load_existing_index(writer)) {
+      fprintf(stderr, "ghost_pack: Failed to append to pack '%s': invalid "
+                      "format\n",
+              filename);
+      free_writer(writer);
+      return NULL;
+    }
+    return writer;
+  }
+
+  writer->file = fopen(filename, "w+b");
+  if (!writer->file) {
+    fprintf(stderr, "ghost_pack: Failed to open pack '%s' for writing\n",
+            filename);
+    free_writer(writer);
+    return NULL;
+  }
+
+  unsigned char header[PACK_HEADER_SIZE] = {0};
+  memcpy(header, pack_marker, sizeof(pack_marker));
+  uint32_to_le(header + 8, PACK_VERSION);
+  if (fwrite(header, sizeof(header), 1, writer->file) != 1) {
+    fprintf(stderr, "ghost_pack: Failed to write pack '%s': failed to write "
+                    "header\n",
+            filename);
+    free_writer(writer);
+    return NULL;
+  }
+  writer->data_end = PACK_HEADER_SIZE;
+  writer->modified = true;
+  return writer;
+}
+
+int ghost_pack_writer_add(ghost_pack_writer_t *writer, const void *data,
+                          size_t size) {
+  if (!writer || !data)
+    return -1;
+
+  ghost_header_info_t info;
+  if (ghost_read_info_mem(data, size, &info) != 0)
+    return -1;
+
+  if (writer->count == writer->capacity) {
+    const int capacity = writer->capacity ? writer->capacity * 2 : 64;
+    pack_entry_t *entries = (pack_entry_t *)realloc(
+        writer->entries, capacity * sizeof(pack_entry_t));
+    if (!entries)
+      return -1;
+    writer->entries = entries;
+    writer->capacity = capacity;
+  }
+
+  if (pack_seek(writer->file, writer->data_end) != 0 ||
+      fwrite(data, size, 1, writer->file) != 1) {
+    fprintf(stderr, "ghost_pack: Failed to write pack '%s': error writing "
+                    "ghost data\n",
+            writer->filename);
+    return -1;
+  }
+
+  pack_entry_t *entry = &writer->entries[writer->count++];
+  memset(entry, 0, sizeof(*entry));
+  strcpy(entry->map, info.map);
+  strcpy(entry->player, info.player);
+  entry->time = info.time;
+  entry->num_ticks = info.num_ticks;
+  entry->offset = writer->data_end;
+  entry->size = size;
+  writer->data_end += size;
+  writer->modified = true;
+  return 0;
+}
+
+int ghost_pack_writer_add_file(ghost_pack_writer_t *writer,
+                               const char *filename) {
+  if (!writer || !filename)
+    return -1;
+
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr, "ghost_pack: Failed to open ghost file '%s'\n", filename);
+    return -1;
+  }
+  const int64_t size = pack_file_size(file);
+  unsigned char *data =
+      size > 0 && (uint64_t)size <= SIZE_MAX && pack_seek(file, 0) == 0
+          ? (unsigned char *)malloc((size_t)size)
+          : NULL;
+  if (!data || fread(data, (size_t)size, 1, file) != 1) {
+    fprintf(stderr, "ghost_pack: Failed to read ghost file '%s'\n", filename);
+    free(data);
+    fclose(file);
+    return -1;
+  }
+  fclose(file);
+
+  const int result = ghost_pack_writer_add(writer, data, (size_t)size);
+  free(data);
+  return result;
+}
+
+int ghost_pack_writer_close(ghost_pack_writer_t *writer) {
+  if (!writer)
+    return -1;
+  if (!writer->modified) {
+    free_writer(writer);
+    return 0;
+  }
+
+  qsort(writer->entries, writer->count, sizeof(pack_entry_t), compare_entries);
+
+  bool error = pack_seek(writer->file, writer->data_end) != 0;
+  for (int i = 0; !error && i < writer->count; i++) {
+    unsigned char raw[PACK_ENTRY_SIZE];
+    encode_entry(raw, &writer->entries[i]);
+    if (fwrite(raw, sizeof(raw), 1, writer->file) != 1)
+      error = true;
+  }
+
+  unsigned char trailer[PACK_TRAILER_SIZE] = {0};
+  memcpy(trailer, index_marker, sizeof(index_marker));
+  uint64_to_le(trailer + 8, writer->data_end);
+  uint32_to_le(trailer + 16, (uint32_t)writer->count);
+  if (!error && fwrite(trailer, sizeof(trailer), 1, writer->file) != 1)
+    error = true;
+  if (!error &&
+      pack_truncate(writer->file,
+                    writer->data_end +
+                        (uint64_t)writer->count * PACK_ENTRY_SIZE +
+                        PACK_TRAILER_SIZE) != 0)
+    error = true;
+
+  if (error)
+    fprintf(stderr, "ghost_pack: Failed to write pack '%s': error writing "
+                    "index\n",
+            writer->filename);
+
+  uint64_t live = 0;
+  for (int i = 0; i < writer->count; i++)
+    live += writer->entries[i].size;
+  const bool compact = !error && writer->data_end - PACK_HEADER_SIZE > 2 * live;
+  char filename[PACK_FILENAME_LENGTH];
+  memcpy(filename, writer->filename, sizeof(filename));
+  free_writer(writer);
+  // The appended pack is complete, so it stays usable if compacting fails.
+  if (compact)
+    ghost_pack_compact(filename);
+  return error ? -1 : 0;
+}
+
+int ghost_pack_compact(const char *filename) {
+  if (!filename)
+    return -1;
+
+  char temp_name[PACK_FILENAME_LENGTH];
+  if (snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename) >=
+      (int)sizeof(temp_name)) {
+    fprintf(stderr, "ghost_pack: Failed to compact pack '%s': name too "
+                    "long\n",
+            filename);
+    return -1;
+  }
+  ghost_pack_t *pack = ghost_pack_open(filename);
+  if (!pack)
+    return -1;
+
+  remove(temp_name);
+  ghost_pack_writer_t *writer = ghost_pack_writer_open(temp_name);
+  bool error = !writer;
+  for (int i = 0; !error && i < pack->count; i++) {
+    ghost_pack_entry_t entry;
+    error = ghost_pack_entry(pack, i, &entry) != 0 ||
+            ghost_pack_writer_add(writer, entry.data, entry.size) != 0;
+  }
+  if (writer && ghost_pack_writer_close(writer) != 0)
+    error = true;
+  ghost_pack_close(pack);
+
+#if defined(_WIN32)
+  // rename does not replace existing files on Windows.
+  if (!error)
+    error = remove(filename) != 0;
+#endif
+  if (!error)
+    error = rename(temp_name, filename) != 0;
+  if (error) {
+    fprintf(stderr, "ghost_pack: Failed to compact pack '%s'\n", filename);
+    remove(temp_name);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ghost_parallel.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct parallel_batch_t {
+  ghost_parallel_fn fn;
+  void *context;
+  int num_items;
+  int next;
+  int num_done;
+} parallel_batch_t;
+
+typedef struct parallel_worker_t {
+  parallel_batch_t *batch;
+  int id;
+} parallel_worker_t;
+
+static void *parallel_worker(void *arg) {
+  const parallel_worker_t *worker = (const parallel_worker_t *)arg;
+  parallel_batch_t *batch = worker->batch;
+  int num_done = 0;
+  for (;;) {
+#if defined(_WIN32)
+    const int i = batch->next++;
+#else
+    const int i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+#endif
+    if (i >= batch->num_items)
+      break;
+    if (batch->fn(batch->context, worker->id, i) == 0)
+      num_done++;
+  }
+#if defined(_WIN32)
+  batch->num_done += num_done;
+#else
+  __atomic_fetch_add(&batch->num_done, num_done, __ATOMIC_RELAXED);
+#endif
+  return NULL;
+}
+
+int ghost_parallel_num_threads(int num_threads, int num_items) {
+#if defined(_WIN32)
+  (void)num_threads;
+  (void)num_items;
+  return 1;
+#else
+  if (num_threads <= 0) {
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = cpus > 0 ? (int)cpus : 1;
+  }
+  if (num_threads > GHOST_PARALLEL_MAX_THREADS)
+    num_threads = GHOST_PARALLEL_MAX_THREADS;
+  if (num_threads > num_items)
+    num_threads = num_items;
+  return num_threads > 0 ? num_threads : 1;
+#endif
+}
+
+int ghost_parallel_for(int num_items, int num_threads, ghost_parallel_fn fn,
+                       void *context) {
+  parallel_batch_t batch = {fn, context, num_items, 0, 0};
+  parallel_worker_t workers[GHOST_PARALLEL_MAX_THREADS];
+  num_threads = ghost_parallel_num_threads(num_threads, num_items);
+  for (int i = 0; i < num_threads; i++)
+    workers[i] = (parallel_worker_t){&batch, i};
+
+#if !defined(_WIN32)
+  // Workers that fail to start leave their share to the others.
+  pthread_t threads[GHOST_PARALLEL_MAX_THREADS];
+  int num_started = 0;
+  while (num_started < num_threads - 1 &&
+         pthread_create(&threads[num_started], NULL, parallel_worker,
+                        &workers[num_started + 1]) == 0)
+    num_started++;
+#endif
+  parallel_worker(&workers[0]);
+#if !defined(_WIN32)
+  for (int i = 0; i < num_started; i++)
+    pthread_join(threads[i], NULL);
+#endif
+  return batch.num_done;
+}
@@ -0,0 +1,25 @@
+#ifndef DDNET_GHOST_PARALLEL_H
+#define DDNET_GHOST_PARALLEL_H
+
+// Internal work sharing for the batch functions of the library.
+
+#define GHOST_PARALLEL_MAX_THREADS 64
+
+// Work item `index` run on worker `worker`. Returns 0 if the item counts as
+// done.
+typedef int (*ghost_parallel_fn)(void *context, int worker, int index);
+
+// Number of workers ghost_parallel_for uses for `num_threads` (0 selects
+// one per CPU) and `num_items`: at least 1 and at most
+// GHOST_PARALLEL_MAX_THREADS. Always 1 on Windows, where the items run on
+// the calling thread.
+int ghost_parallel_num_threads(int num_threads, int num_items);
+
+// Calls `fn` for every index in [0, num_items) on up to
+// ghost_parallel_num_threads(num_threads, num_items) workers, with worker
+// ids below that count. The calling thread is worker 0. Returns the number
+// of items done.
+int ghost_parallel_for(int num_items, int num_threads, ghost_parallel_fn fn,
+                       void *context);
+
+#endif // DDNET_GHOST_PARALLEL_H
@@ -0,0 +1,26 @@
+#include "ghost_parallel.h"
+#include <ddnet_ghost/ghost_resample.h>
+#include <stddef.h>
+
+typedef struct resample_batch_t {
+  ghost_resample_job_t *jobs;
+  float rate;
+} resample_batch_t;
+
+static int resample_job(void *context, int worker, int index) {
+  const resample_batch_t *batch = (const resample_batch_t *)context;
+  ghost_resample_job_t *job = &batch->jobs[index];
+  (void)worker;
+  job->num_frames =
+      ghost_resample(job->path, batch->rate, job->out, job->max_frames);
+  return job->num_frames >= 0 ? 0 : -1;
+}
+
+int ghost_resample_paths(ghost_resample_job_t *jobs, int num_jobs, float rate,
+                         int num_threads) {
+  if (!jobs || num_jobs < 0)
+    return -1;
+
+  resample_batch_t batch = {jobs, rate};
+  return ghost_parallel_for(num_jobs, num_threads, resample_job, &batch);
+}
@@ -0,0 +1,465 @@
+#include "ghost_parallel.h"
+#include <ddnet_ghost/ghost_route.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_TOLERANCE 16.0f
+#define DEFAULT_RADIUS 64.0f
+
+enum {
+  DIMENSIONS = GHOST_ROUTE_POINTS * 2,
+  NUM_TABLES = 8,
+  NUM_HASHES = 6,
+  INITIAL_CAPACITY = 64,
+};
+
+// Radial-distance simplification of the x/y path: a point is kept once it
+// is more than SIMPLIFY_TOLERANCE away from the last kept one.
+typedef struct route_builder_t {
+  float *points;
+  int num_points;
+  int capacity;
+  float last_x, last_y;
+  int num_ticks;
+} route_builder_t;
+
+static int builder_push(route_builder_t *builder, float x, float y) {
+  if (builder->num_points == builder->capacity) {
+    const int capacity =
+        builder->capacity ? builder->capacity * 2 : INITIAL_CAPACITY;
+    float *points =
+        (float *)realloc(builder->points, sizeof(float) * 2 * capacity);
+    if (!points)
+      return -1;
+    builder->points = points;
+    builder->capacity = capacity;
+  }
+  builder->points[builder->num_points * 2] = x;
+  builder->points[builder->num_points * 2 + 1] = y;
+  builder->num_points++;
+  return 0;
+}
+
+static int builder_add(route_builder_t *builder, int x, int y) {
+  builder->last_x = (float)x;
+  builder->last_y = (float)y;
+  builder->num_ticks++;
+  if (builder->num_points > 0) {
+    const float *prev = &builder->points[(builder->num_points - 1) * 2];
+    const float dx = builder->last_x - prev[0];
+    const float dy = builder->last_y - prev[1];
+    if (dx * dx + dy * dy <= SIMPLIFY_TOLERANCE * SIMPLIFY_TOLERANCE)
+      return 0;
+  }
+  return builder_push(builder, builder->last_x, builder->last_y);
+}
+
+// Resamples the simplified path (ending at the last recorded position) to
+// evenly spaced points.
+static int builder_finish(route_builder_t *builder, ghost_route_t *route) {
+  memset(route, 0, sizeof(*route));
+  if (builder->num_ticks == 0)
+    return -1;
+  const float *last = &builder->points[(builder->num_points - 1) * 2];
+  if (last[0] != builder->last_x || last[1] != builder->last_y) {
+    if (builder_push(builder, builder->last_x, builder->last_y) != 0)
+      return -1;
+  }
+
+  const float *points = builder->points;
+  const int num_points = builder->num_points;
+  double length = 0.0;
+  for (int i = 1; i < num_points; i++)
+    length += hypot(points[i * 2] - points[i * 2 - 2],
+                    points[i * 2 + 1] - points[i * 2 - 1]);
+
+  int segment = 1;
+  double segment_start = 0.0;
+  for (int i = 0; i < GHOST_ROUTE_POINTS; i++) {
+    const double target = length * i / (GHOST_ROUTE_POINTS - 1);
+    double segment_length = 0.0;
+    while (segment < num_points) {
+      segment_length = hypot(points[segment * 2] - points[segment * 2 - 2],
+                             points[segment * 2 + 1] - points[segment * 2 - 1]);
+      if (segment_start + segment_length >= target ||
+          segment == num_points - 1)
+        break;
+      segment_start += segment_length;
+      segment++;
+    }
+    if (segment >= num_points || segment_length <= 0.0) {
+      const int point = segment >= num_points ? num_points - 1 : segment;
+      route->x[i] = points[point * 2];
+      route->y[i] = points[point * 2 + 1];
+      continue;
+    }
+    double amount = (target - segment_start) / segment_length;
+    if (amount > 1.0)
+      amount = 1.0;
+    const float *a = &points[segment * 2 - 2];
+    const float *b = &points[segment * 2];
+    route->x[i] = (float)(a[0] + (b[0] - a[0]) * amount);
+    route->y[i] = (float)(a[1] + (b[1] - a[1]) * amount);
+  }
+  route->length = (float)length;
+  route->num_ticks = builder->num_ticks;
+  return 0;
+}
+
+int ghost_route_fingerprint(const ghost_path_t *path, ghost_route_t *route) {
+  if (!path || !route)
+    return -1;
+
+  route_builder_t builder = {0};
+  int result = 0;
+  for (int i = 0; i < path->num_items && result == 0; i++) {
+    const ghost_character_t *snap = ghost_get_snap(path, i);
+    result = builder_add(&builder, snap->x, snap->y);
+  }
+  if (result == 0)
+    result = builder_finish(&builder, route);
+  else
+    memset(route, 0, sizeof(*route));
+  free(builder.points);
+  return result;
+}
+
+int ghost_route_fingerprint_file(const char *filename, ghost_route_t *route) {
+  if (!route)
+    return -1;
+  memset(route, 0, sizeof(*route));
+  ghost_reader_t *reader = ghost_reader_open(filename);
+  if (!reader)
+    return -1;
+
+  route_builder_t builder = {0};
+  ghost_character_t snap;
+  int status;
+  while ((status = ghost_reader_next(reader, &snap)) == 1) {
+    if (builder_add(&builder, snap.x, snap.y) != 0) {
+      status = -1;
+      break;
+    }
+  }
+  ghost_reader_close(reader);
+
+  const int result = status == 0 ? builder_finish(&builder, route) : -1;
+  free(builder.points);
+  return result;
+}
+
+typedef struct fingerprint_batch_t {
+  const char *const *filenames;
+  ghost_route_t *routes;
+} fingerprint_batch_t;
+
+static int fingerprint_job(void *context, int worker, int index) {
+  const fingerprint_batch_t *batch = (const fingerprint_batch_t *)context;
+  (void)worker;
+  return ghost_route_fingerprint_file(batch->filenames[index],
+                                      &batch->routes[index]);
+}
+
+int ghost_route_fingerprint_files(const char *const *filenames, int num_files,
+                                  ghost_route_t *routes, int num_threads) {
+  if (!filenames || !routes || num_files < 0)
+    return -1;
+  fingerprint_batch_t batch = {filenames, routes};
+  return ghost_parallel_for(num_files, num_threads, fingerprint_job, &batch);
+}
+
+float ghost_route_distance(const ghost_route_t *a, const ghost_route_t *b) {
+  float sum = 0.0f;
+  for (int i = 0; i < GHOST_ROUTE_POINTS; i++) {
+    const float dx = a->x[i] - b->x[i];
+    const float dy = a->y[i] - b->y[i];
+    sum += dx * dx + dy * dy;
+  }
+  return sqrtf(sum / GHOST_ROUTE_POINTS);
+}
+
+typedef struct route_entry_t {
+  uint64_t key;
+  int id;
+} route_entry_t;
+
+// p-stable LSH: each table hashes a route by NUM_HASHES random Gaussian
+// projections of its points, quantized to buckets of `width`.
+struct ghost_route_index_t {
+  float width;
+  float projections[NUM_TABLES][NUM_HASHES][DIMENSIONS];
+  float offsets[NUM_TABLES][NUM_HASHES];
+
+  ghost_route_t *routes;
+  int num_routes;
+  int capacity;
+
+  // Entries before `num_sorted` are sorted by key; later ones were added
+  // since the last ghost_route_index_build and are scanned linearly.
+  route_entry_t *tables[NUM_TABLES];
+  int num_sorted;
+};
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static double random_uniform(uint64_t *state) {
+  return ((splitmix64(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double random_gaussian(uint64_t *state) {
+  const double u = random_uniform(state);
+  const double v = random_uniform(state);
+  return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+// Projections of `route` in bucket units for one table.
+static void project(const ghost_route_index_t *index, int table,
+                    const ghost_route_t *route, double *out) {
+  for (int h = 0; h < NUM_HASHES; h++) {
+    const float *projection = index->projections[table][h];
+    double sum = 0.0;
+    for (int i = 0; i < GHOST_ROUTE_POINTS; i++)
+      sum += projection[i * 2] * route->x[i] +
+             projection[i * 2 + 1] * route->y[i];
+    out[h] = sum / index->width + index->offsets[table][h];
+  }
+}
+
+static uint64_t bucket_key(const int64_t *buckets) {
+  uint64_t key = 0xcbf29ce484222325ull;
+  for (int h = 0; h < NUM_HASHES; h++) {
+    key ^= (uint64_t)buckets[h];
+    key *= 0x100000001b3ull;
+    key ^= key >> 29;
+  }
+  return key;
+}
+
+static int compare_entries(const void *a, const void *b) {
+  const route_entry_t *entry_a = (const route_entry_t *)a;
+  const route_entry_t *entry_b = (const route_entry_t *)b;
+  if (entry_a->key != entry_b->key)
+    return entry_a->key < entry_b->key ? -1 : 1;
+  return entry_a->id - entry_b->id;
+}
+
+ghost_route_index_t *ghost_route_index_create(float radius) {
+  ghost_route_index_t *index =
+      (ghost_route_index_t *)calloc(1, sizeof(ghost_route_index_t));
+  if (!index) {
+    fprintf(stderr, "ghost_route: Failed to allocate memory for index\n");
+    return NULL;
+  }
+  if (!(radius > 0.0f))
+    radius = DEFAULT_RADIUS;
+  // Two routes `radius` apart differ by radius * sqrt(GHOST_ROUTE_POINTS)
+  // as vectors; buckets four times that wide keep them together in most
+  // projections.
+  index->width = 4.0f * radius * sqrtf((float)GHOST_ROUTE_POINTS);
+
+  // A fixed seed keeps bucket assignment reproducible between runs.
+  uint64_t state = 0x5EED0F6057ull;
+  for (int t = 0; t < NUM_TABLES; t++) {
+    for (int h = 0; h < NUM_HASHES; h++) {
+      for (int d = 0; d < DIMENSIONS; d++)
+        index->projections[t][h][d] = (float)random_gaussian(&state);
+      index->offsets[t][h] = (float)random_uniform(&state);
+    }
+  }
+  return index;
+}
+
+void ghost_route_index_free(ghost_route_index_t *index) {
+  if (!index)
+    return;
+  for (int t = 0; t < NUM_TABLES; t++)
+    free(index->tables[t]);
+  free(index->routes);
+  free(index);
+}
+
+int ghost_route_index_add(ghost_route_index_t *index,
+                          const ghost_route_t *route) {
+  if (!index || !route)
+    return -1;
+
+  if (index->num_routes == index->capacity) {
+    const int capacity =
+        index->capacity ? index->capacity * 2 : INITIAL_CAPACITY;
+    ghost_route_t *routes = (ghost_route_t *)realloc(
+        index->routes, sizeof(ghost_route_t) * capacity);
+    if (!routes) {
+      fprintf(stderr, "ghost_route: Failed to allocate memory for index\n");
+      return -1;
+    }
+    index->routes = routes;
+    for (int t = 0; t < NUM_TABLES; t++) {
+      route_entry_t *entries = (route_entry_t *)realloc(
+          index->tables[t], sizeof(route_entry_t) * capacity);
+      if (!entries) {
+        fprintf(stderr, "ghost_route: Failed to allocate memory for index\n");
+        return -1;
+      }
+      index->tables[t] = entries;
+    }
+    index->capacity = capacity;
+  }
+
+  const int id = index->num_routes;
+  index->routes[id] = *route;
+  for (int t = 0; t < NUM_TABLES; t++) {
+    double projected[NUM_HASHES];
+    int64_t buckets[NUM_HASHES];
+    project(index, t, route, projected);
+    for (int h = 0; h < NUM_HASHES; h++)
+      buckets[h] = (int64_t)floor(projected[h]);
+    index->tables[t][id].key = bucket_key(buckets);
+    index->tables[t][id].id = id;
+  }
+  index->num_routes++;
+  return id;
+}
+
+int ghost_route_index_build(ghost_route_index_t *index) {
+  if (!index)
+    return -1;
+  if (index->num_sorted == index->num_routes)
+    return 0;
+  for (int t = 0; t < NUM_TABLES; t++)
+    qsort(index->tables[t], index->num_routes, sizeof(route_entry_t),
+          compare_entries);
+  index->num_sorted = index->num_routes;
+  return 0;
+}
+
+int ghost_route_index_size(const ghost_route_index_t *index) {
+  return index ? index->num_routes : 0;
+}
+
+const ghost_route_t *ghost_route_index_get(const ghost_route_index_t *index,
+                                           int id) {
+  if (!index || id < 0 || id >= index->num_routes)
+    return NULL;
+  return &index->routes[id];
+}
+
+typedef struct route_results_t {
+  int *ids;
+  float *distances;
+  int k;
+  int count;
+} route_results_t;
+
+// Insertion into the sorted top-k list.
+static void results_offer(route_results_t *results, int id, float distance) {
+  if (results->count == results->k &&
+      distance >= results->distances[results->count - 1])
+    return;
+  int i = results->count < results->k ? results->count++ : results->k - 1;
+  while (i > 0 && results->distances[i - 1] > distance) {
+    results->ids[i] = results->ids[i - 1];
+    results->distances[i] = results->distances[i - 1];
+    i--;
+  }
+  results->ids[i] = id;
+  results->distances[i] = distance;
+}
+
+static int find_bucket(const route_entry_t *entries, int num_entries,
+                       uint64_t key) {
+  int low = 0, high = num_entries;
+  while (low < high) {
+    const int mid = low + (high - low) / 2;
+    if (entries[mid].key < key)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+int ghost_route_index_query(const ghost_route_index_t *index,
+                            const ghost_route_t *route, int k, int *ids,
+                            float *distances) {
+  if (!index || !route || !ids || k <= 0)
+    return -1;
+  if (k > index->num_routes)
+    k = index->num_routes;
+  if (k == 0)
+    return 0;
+
+  float *result_distances = (float *)malloc(sizeof(float) * k);
+  uint64_t *seen = (uint64_t *)calloc((index->num_routes + 63) / 64,
+                                      sizeof(uint64_t));
+  if (!result_distances || !seen) {
+    fprintf(stderr, "ghost_route: Failed to allocate memory for query\n");
+    free(result_distances);
+    free(seen);
+    return -1;
+  }
+  route_results_t results = {ids, result_distances, k, 0};
+
+  // Probe the query's bucket in every table and, per hash, the neighbouring
+  // bucket on the side the query is closest to.
+  int num_candidates = 0;
+  for (int t = 0; t < NUM_TABLES; t++) {
+    double projected[NUM_HASHES];
+    int64_t buckets[NUM_HASHES];
+    project(index, t, route, projected);
+    for (int h = 0; h < NUM_HASHES; h++)
+      buckets[h] = (int64_t)floor(projected[h]);
+
+    for (int probe = -1; probe < NUM_HASHES; probe++) {
+      int64_t saved = 0;
+      if (probe >= 0) {
+        saved = buckets[probe];
+        buckets[probe] += projected[probe] - saved < 0.5 ? -1 : 1;
+      }
+      const uint64_t key = bucket_key(buckets);
+      if (probe >= 0)
+        buckets[probe] = saved;
+
+      const route_entry_t *entries = index->tables[t];
+      const int num_sorted = index->num_sorted;
+      int i = find_bucket(entries, num_sorted, key);
+      while (i < index->num_routes) {
+        if (entries[i].key == key) {
+          const int id = entries[i].id;
+          if (!(seen[id / 64] & (1ull << (id % 64)))) {
+            seen[id / 64] |= 1ull << (id % 64);
+            num_candidates++;
+            results_offer(&results, id,
+                          ghost_route_distance(route, &index->routes[id]));
+          }
+        } else if (i < num_sorted) {
+          // End of the bucket; continue with the unsorted entries.
+          i = num_sorted;
+          continue;
+        }
+        i++;
+      }
+    }
+  }
+
+  if (num_candidates < k) {
+    for (int id = 0; id < index->num_routes; id++) {
+      if (!(seen[id / 64] & (1ull << (id % 64))))
+        results_offer(&results, id,
+                      ghost_route_distance(route, &index->routes[id]));
+    }
+  }
+
+  if (distances)
+    memcpy(distances, result_distances, sizeof(float) * results.count);
+  free(result_distances);
+  free(seen);
+  return results.count;
+}
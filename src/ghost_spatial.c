@@ -0,0 +1,377 @@
+#include <ddnet_ghost/ghost_spatial.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { DEFAULT_CELL_SIZE = 32, INITIAL_CAPACITY = 64 };
+
+typedef struct spatial_point_t {
+  int x;
+  int y;
+  int path_index;
+  int next;
+} spatial_point_t;
+
+typedef struct spatial_cell_t {
+  uint64_t key;
+  int head;
+} spatial_cell_t;
+
+struct ghost_spatial_index_t {
+  int cell_size;
+
+  spatial_point_t *points;
+  int num_points;
+  int points_capacity;
+
+  spatial_cell_t *cells;
+  int num_cells;
+  int cells_capacity;
+
+  int min_cx, min_cy;
+  int max_cx, max_cy;
+
+  int synced_items;
+};
+
+static int cell_coord(int v, int cell_size) {
+  return v >= 0 ? v / cell_size : -((-(v + 1)) / cell_size) - 1;
+}
+
+static uint64_t cell_key(int cx, int cy) {
+  return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+static unsigned cell_slot(uint64_t key, int capacity) {
+  return (unsigned)((key * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+static const spatial_cell_t *find_cell(const ghost_spatial_index_t *index,
+                                       int cx, int cy) {
+  const uint64_t key = cell_key(cx, cy);
+  unsigned slot = cell_slot(key, index->cells_capacity);
+  while (index->cells[slot].head != -1) {
+    if (index->cells[slot].key == key)
+      return &index->cells[slot];
+    slot = (slot + 1) & (index->cells_capacity - 1);
+  }
+  return NULL;
+}
+
+static spatial_cell_t *insert_cell(spatial_cell_t *cells, int capacity,
+                                   uint64_t key) {
+  unsigned slot = cell_slot(key, capacity);
+  while (cells[slot].head != -1 && cells[slot].key != key)
+    slot = (slot + 1) & (capacity - 1);
+  cells[slot].key = key;
+  return &cells[slot];
+}
+
+static int grow_cells(ghost_spatial_index_t *index) {
+  const int capacity = index->cells_capacity * 2;
+  spatial_cell_t *cells =
+      (spatial_cell_t *)malloc(capacity * sizeof(spatial_cell_t));
+  if (!cells)
+    return -1;
+  for (int i = 0; i < capacity; i++)
+    cells[i].head = -1;
+
+  for (int i = 0; i < index->cells_capacity; i++) {
+    if (index->cells[i].head == -1)
+      continue;
+    spatial_cell_t *cell = insert_cell(cells, capacity, index->cells[i].key);
+    cell->head = index->cells[i].head;
+  }
+
+  free(index->cells);
+  index->cells = cells;
+  index->cells_capacity = capacity;
+  return 0;
+}
+
+ghost_spatial_index_t *ghost_spatial_index_create(int cell_size) {
+  ghost_spatial_index_t *index =
+      (ghost_spatial_index_t *)calloc(1, sizeof(ghost_spatial_index_t));
+  if (!index)
+    return NULL;
+
+  index->cell_size = cell_size > 0 ? cell_size : DEFAULT_CELL_SIZE;
+  index->cells_capacity = INITIAL_CAPACITY;
+  index->cells =
+      (spatial_cell_t *)malloc(index->cells_capacity * sizeof(spatial_cell_t));
+  if (!index->cells) {
+    free(index);
+    return NULL;
+  }
+  for (int i = 0; i < index->cells_capacity; i++)
+    index->cells[i].head = -1;
+  return index;
+}
+
+ghost_spatial_index_t *ghost_spatial_index_build(const ghost_path_t *path,
+                                                 int cell_size) {
+  ghost_spatial_index_t *index = ghost_spatial_index_create(cell_size);
+  if (!index)
+    return NULL;
+  if (ghost_spatial_index_sync(index, path) != 0) {
+    ghost_spatial_index_free(index);
+    return NULL;
+  }
+  return index;
+}
+
+void ghost_spatial_index_free(ghost_spatial_index_t *index) {
+  if (!index)
+    return;
+  free(index->points);
+  free(index->cells);
+  free(index);
+}
+
+int ghost_spatial_index_add(ghost_spatial_index_t *index,
+                            const ghost_character_t *snap, int path_index) {
+  if (!index || !snap)
+    return -1;
+
+  if (index->num_points == index->points_capacity) {
+    const int capacity =
+        index->points_capacity ? index->points_capacity * 2 : INITIAL_CAPACITY;
+    spatial_point_t *points = (spatial_point_t *)realloc(
+        index->points, capacity * sizeof(spatial_point_t));
+    if (!points) {
+      fprintf(stderr, "ghost_spatial: Failed to grow point storage\n");
+      return -1;
+    }
+    index->points = points;
+    index->points_capacity = capacity;
+  }
+
+  if ((index->num_cells + 1) * 2 > index->cells_capacity &&
+      grow_cells(index) != 0) {
+    fprintf(stderr, "ghost_spatial: Failed to grow cell table\n");
+    return -1;
+  }
+
+  const int cx = cell_coord(snap->x, index->cell_size);
+  const int cy = cell_coord(snap->y, index->cell_size);
+  spatial_cell_t *cell =
+      insert_cell(index->cells, index->cells_capacity, cell_key(cx, cy));
+  if (cell->head == -1)
+    index->num_cells++;
+
+  spatial_point_t *point = &index->points[index->num_points];
+  point->x = snap->x;
+  point->y = snap->y;
+  point->path_index = path_index;
+  point->next = cell->head;
+  cell->head = index->num_points;
+
+  if (index->num_points == 0) {
+    index->min_cx = index->max_cx = cx;
+    index->min_cy = index->max_cy = cy;
+  } else {
+    if (cx < index->min_cx)
+      index->min_cx = cx;
+    if (cx > index->max_cx)
+      index->max_cx = cx;
+    if (cy < index->min_cy)
+      index->min_cy = cy;
+    if (cy > index->max_cy)
+      index->max_cy = cy;
+  }
+
+  index->num_points++;
+  return 0;
+}
+
+int ghost_spatial_index_sync(ghost_spatial_index_t *index,
+                             const ghost_path_t *path) {
+  if (!index || !path)
+    return -1;
+  for (int i = index->synced_items; i < path->num_items; i++) {
+    if (ghost_spatial_index_add(index, ghost_get_snap(path, i), i) != 0)
+      return -1;
+    index->synced_items = i + 1;
+  }
+  return 0;
+}
+
+int ghost_spatial_index_size(const ghost_spatial_index_t *index) {
+  return index ? index->num_points : 0;
+}
+
+static void scan_points(const ghost_spatial_index_t *index,
+                        const spatial_cell_t *cell, int x, int y,
+                        int64_t *best_dist, int *best_index) {
+  for (int i = cell->head; i != -1; i = index->points[i].next) {
+    const spatial_point_t *point = &index->points[i];
+    const int64_t dx = (int64_t)point->x - x;
+    const int64_t dy = (int64_t)point->y - y;
+    const int64_t dist = dx * dx + dy * dy;
+    if (dist < *best_dist ||
+        (dist == *best_dist && point->path_index < *best_index)) {
+      *best_dist = dist;
+      *best_index = point->path_index;
+    }
+  }
+}
+
+static void scan_cell(const ghost_spatial_index_t *index, int cx, int cy,
+                      int x, int y, int64_t *best_dist, int *best_index) {
+  const spatial_cell_t *cell = find_cell(index, cx, cy);
+  if (cell)
+    scan_points(index, cell, x, y, best_dist, best_index);
+}
+
+// Distance from `v` to the span [lo, hi) along one axis, 0 inside it.
+static int64_t axis_gap(int64_t v, int64_t lo, int64_t hi) {
+  if (v < lo)
+    return lo - v;
+  if (v >= hi)
+    return v - hi + 1;
+  return 0;
+}
+
+// Far from the route the rings would visit mostly empty cells, so every
+// occupied cell is checked instead, skipping those that cannot be closer.
+static void scan_occupied_cells(const ghost_spatial_index_t *index, int x,
+                                int y, int64_t *best_dist, int *best_index) {
+  const int64_t cs = index->cell_size;
+  for (int slot = 0; slot < index->cells_capacity; slot++) {
+    const spatial_cell_t *cell = &index->cells[slot];
+    if (cell->head == -1)
+      continue;
+    const int64_t cx = (int32_t)(uint32_t)(cell->key >> 32);
+    const int64_t cy = (int32_t)(uint32_t)cell->key;
+    const int64_t gx = axis_gap(x, cx * cs, (cx + 1) * cs);
+    const int64_t gy = axis_gap(y, cy * cs, (cy + 1) * cs);
+    if (*best_index >= 0 && gx * gx + gy * gy > *best_dist)
+      continue;
+    scan_points(index, cell, x, y, best_dist, best_index);
+  }
+}
+
+static int max_int(int a, int b) { return a > b ? a : b; }
+
+int ghost_spatial_index_nearest(const ghost_spatial_index_t *index, int x,
+                                int y, float *distance) {
+  if (!index || index->num_points == 0)
+    return -1;
+
+  const int cx = cell_coord(x, index->cell_size);
+  const int cy = cell_coord(y, index->cell_size);
+  const int max_ring =
+      max_int(max_int(cx - index->min_cx, index->max_cx - cx),
+              max_int(cy - index->min_cy, index->max_cy - cy));
+
+  int64_t best_dist = INT64_MAX;
+  int best_index = -1;
+  // Ring cells looked up so far; once they outnumber the occupied cells a
+  // scan of those is cheaper.
+  int64_t visited = 0;
+  bool done = false;
+  for (int ring = 0; ring <= max_ring; ring++) {
+    if (visited > index->num_cells)
+      break;
+    visited += ring == 0 ? 1 : 8 * (int64_t)ring;
+    if (ring == 0) {
+      scan_cell(index, cx, cy, x, y, &best_dist, &best_index);
+    } else {
+      const int lo_y = max_int(cy - ring + 1, index->min_cy);
+      const int hi_y = cy + ring - 1 < index->max_cy ? cy + ring - 1
+                                                     : index->max_cy;
+      for (int gx = max_int(cx - ring, index->min_cx);
+           gx <= cx + ring && gx <= index->max_cx; gx++) {
+        if (cy - ring >= index->min_cy)
+          scan_cell(index, gx, cy - ring, x, y, &best_dist, &best_index);
+        if (cy + ring <= index->max_cy)
+          scan_cell(index, gx, cy + ring, x, y, &best_dist, &best_index);
+      }
+      for (int gy = lo_y; gy <= hi_y; gy++) {
+        if (cx - ring >= index->min_cx)
+          scan_cell(index, cx - ring, gy, x, y, &best_dist, &best_index);
+        if (cx + ring <= index->max_cx)
+          scan_cell(index, cx + ring, gy, x, y, &best_dist, &best_index);
+      }
+    }
+
+    // Anything not scanned yet lies outside the square covered by the rings
+    // so far, so its distance is at least the distance to that square's edge.
+    const int64_t cs = index->cell_size;
+    int64_t reach = x - (cx - ring) * cs;
+    if ((cx + ring + 1) * cs - x < reach)
+      reach = (cx + ring + 1) * cs - x;
+    if (y - (cy - ring) * cs < reach)
+      reach = y - (cy - ring) * cs;
+    if ((cy + ring + 1) * cs - y < reach)
+      reach = (cy + ring + 1) * cs - y;
+    if (best_index >= 0 && best_dist <= reach * reach) {
+      done = true;
+      break;
+    }
+  }
+  if (!done)
+    scan_occupied_cells(index, x, y, &best_dist, &best_index);
+
+  if (distance)
+    *distance = sqrtf((float)best_dist);
+  return best_index;
+}
+
+static int64_t cell_coord64(int64_t v, int cell_size) {
+  return v >= 0 ? v / cell_size : -((-(v + 1)) / cell_size) - 1;
+}
+
+static int clamp_cell(int64_t c, int lo, int hi) {
+  return c < lo ? lo : c > hi ? hi : (int)c;
+}
+
+int ghost_spatial_index_within(const ghost_spatial_index_t *index, int x,
+                               int y, float radius, int *out, int max_out) {
+  if (!index || index->num_points == 0 || !(radius >= 0))
+    return 0;
+
+  // The squared radius only fits in int64 up to sqrt(INT64_MAX); larger radii
+  // accept every point the grid holds.
+  const double max_radius = 3037000499.0;
+  const bool clamped = radius >= max_radius;
+  const int64_t r = clamped ? (int64_t)max_radius : (int64_t)radius + 1;
+  const int64_t r2 =
+      clamped ? INT64_MAX : (int64_t)((double)radius * radius);
+  const int lo_cx = clamp_cell(cell_coord64(x - r, index->cell_size),
+                               index->min_cx, index->max_cx);
+  const int hi_cx = clamp_cell(cell_coord64(x + r, index->cell_size),
+                               index->min_cx, index->max_cx);
+  const int lo_cy = clamp_cell(cell_coord64(y - r, index->cell_size),
+                               index->min_cy, index->max_cy);
+  const int hi_cy = clamp_cell(cell_coord64(y + r, index->cell_size),
+                               index->min_cy, index->max_cy);
+  if (x + r < (int64_t)index->min_cx * index->cell_size ||
+      x - r >= ((int64_t)index->max_cx + 1) * index->cell_size ||
+      y + r < (int64_t)index->min_cy * index->cell_size ||
+      y - r >= ((int64_t)index->max_cy + 1) * index->cell_size)
+    return 0;
+
+  int count = 0;
+  for (int gy = lo_cy; gy <= hi_cy; gy++) {
+    for (int gx = lo_cx; gx <= hi_cx; gx++) {
+      const spatial_cell_t *cell = find_cell(index, gx, gy);
+      if (!cell)
+        continue;
+      for (int i = cell->head; i != -1; i = index->points[i].next) {
+        const spatial_point_t *point = &index->points[i];
+        const int64_t dx = (int64_t)point->x - x;
+        const int64_t dy = (int64_t)point->y - y;
+        if (dx * dx + dy * dy > r2)
+          continue;
+        if (out && count < max_out)
+          out[count] = point->path_index;
+        count++;
+      }
+    }
+  }
+  return count;
+}
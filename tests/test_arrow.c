@@ -0,0 +1,269 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_arrow.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int expect_int(const char *what, long long got, long long wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%lld != %lld)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, long *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  rewind(file);
+  unsigned char *data = (unsigned char *)malloc(*size ? *size : 1);
+  if (data && fread(data, 1, *size, file) != (size_t)*size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+static uint64_t le(const unsigned char *bytes, int size) {
+  uint64_t value = 0;
+  for (int i = size - 1; i >= 0; i--)
+    value = (value << 8) | bytes[i];
+  return value;
+}
+
+// Just enough of a flatbuffer reader to follow the footer and the record
+// batch messages. Positions are relative to `fb`.
+static const unsigned char *fb_field(const unsigned char *table, int field) {
+  const unsigned char *vtable = table - (int32_t)le(table, 4);
+  const int vtable_size = (int)le(vtable, 2);
+  if (4 + 2 * field >= vtable_size)
+    return NULL;
+  const int offset = (int)le(vtable + 4 + 2 * field, 2);
+  return offset ? table + offset : NULL;
+}
+
+static const unsigned char *fb_deref(const unsigned char *pos) {
+  return pos ? pos + le(pos, 4) : NULL;
+}
+
+typedef struct table_t {
+  int num_rows;
+  int num_batches;
+  int *ghost;
+  int *x;
+  int *tick;
+} table_t;
+
+// Checks the file layout and collects the ghost, x and tick columns.
+static int read_table(const char *filename, table_t *table) {
+  memset(table, 0, sizeof(*table));
+  long size;
+  unsigned char *data = read_file(filename, &size);
+  if (!data) {
+    printf("MISMATCH: '%s' could not be read\n", filename);
+    return 1;
+  }
+  int mismatches = 0;
+  if (size < 32 || memcmp(data, "ARROW1\0\0", 8) != 0 ||
+      memcmp(data + size - 6, "ARROW1", 6) != 0) {
+    printf("MISMATCH: '%s' lacks the Arrow magic\n", filename);
+    free(data);
+    return 1;
+  }
+  mismatches += expect_int("schema continuation", le(data + 8, 4), 0xffffffff);
+
+  const long footer_size = (long)le(data + size - 10, 4);
+  if (footer_size <= 0 || footer_size > size - 24) {
+    printf("MISMATCH: footer size %ld out of range\n", footer_size);
+    free(data);
+    return mismatches + 1;
+  }
+  const unsigned char *footer = data + size - 10 - footer_size;
+  const unsigned char *root = fb_deref(footer);
+  mismatches += expect_int("footer version", le(fb_field(root, 0), 2), 4);
+  const unsigned char *blocks = fb_deref(fb_field(root, 3));
+  table->num_batches = blocks ? (int)le(blocks, 4) : 0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    int row = 0;
+    for (int b = 0; b < table->num_batches; b++) {
+      const unsigned char *block = blocks + 4 + 24 * b;
+      const long offset = (long)le(block, 8);
+      const long metadata_length = (long)le(block + 8, 4);
+      const unsigned char *message = data + offset;
+      if (le(message, 4) != 0xffffffff) {
+        printf("MISMATCH: batch %d lacks the continuation marker\n", b);
+        free(data);
+        return mismatches + 1;
+      }
+      const unsigned char *header = fb_deref(message + 8);
+      const unsigned char *batch = fb_deref(fb_field(header, 2));
+      const int rows = (int)le(fb_field(batch, 0), 8);
+      if (pass == 0) {
+        mismatches += expect_int("message type", *fb_field(header, 1), 3);
+        table->num_rows += rows;
+        continue;
+      }
+      // Buffers of the ghost, x and tick columns; the player string column
+      // has three, every int32 column two.
+      const unsigned char *buffers = fb_deref(fb_field(batch, 2));
+      const unsigned char *body = message + metadata_length;
+      const int columns[3] = {1, 10, 2 * 15 + 2};
+      int *outputs[3] = {table->ghost, table->x, table->tick};
+      for (int c = 0; c < 3; c++) {
+        const unsigned char *buffer = buffers + 4 + 16 * columns[c];
+        const unsigned char *values = body + le(buffer, 8);
+        for (int i = 0; i < rows; i++)
+          outputs[c][row + i] = (int)le(values + 4 * i, 4);
+      }
+      row += rows;
+    }
+    if (pass == 0) {
+      const size_t bytes = (table->num_rows ? table->num_rows : 1) * sizeof(int);
+      table->ghost = (int *)malloc(bytes);
+      table->x = (int *)malloc(bytes);
+      table->tick = (int *)malloc(bytes);
+    }
+  }
+  free(data);
+  return mismatches;
+}
+
+static void free_table(table_t *table) {
+  free(table->ghost);
+  free(table->x);
+  free(table->tick);
+}
+
+static ghost_t *create_ghost(const char *map, int num_ticks) {
+  ghost_t *ghost = ghost_create();
+  snprintf(ghost->map, sizeof(ghost->map), "%s", map);
+  snprintf(ghost->player, sizeof(ghost->player), "nameless tee");
+  ghost->time = 12345;
+  ghost_character_t snap = {0};
+  for (int i = 0; i < num_ticks; i++) {
+    snap.x = i * 7;
+    snap.y = i % 300;
+    snap.tick = 100 + i;
+    ghost_add_snap(ghost, &snap);
+  }
+  return ghost;
+}
+
+// Saves a ghost long enough to span several record batches, then breaks its
+// last chunk so decoding fails after batches holding its rows were written.
+static int write_broken_ghost(const char *filename) {
+  ghost_t *ghost = create_ghost("broken", 10000);
+  const int result = ghost_save(ghost, filename);
+  ghost_free(ghost);
+  long size;
+  unsigned char *data = result == 0 ? read_file(filename, &size) : NULL;
+  if (!data)
+    return -1;
+  memset(data + size - 16, 0xff, 16);
+  FILE *file = fopen(filename, "wb");
+  const int written = file && fwrite(data, size, 1, file) == 1;
+  if (file)
+    fclose(file);
+  free(data);
+  return written ? 0 : -1;
+}
+
+// A file, a ghost that fails part way and the file again must leave exactly
+// the two good copies, numbered 0 and 1.
+static int check_rollback(const ghost_t *ghost) {
+  int mismatches = 0;
+  if (write_broken_ghost("arrow_broken.gho") != 0) {
+    printf("MISMATCH: broken ghost could not be written\n");
+    return 1;
+  }
+  ghost_arrow_writer_t *writer = ghost_arrow_open("arrow_test.arrow", "map");
+  if (!writer) {
+    printf("MISMATCH: Arrow file could not be opened\n");
+    remove("arrow_broken.gho");
+    return 1;
+  }
+  mismatches += expect_int("first add_file",
+                           ghost_arrow_add_file(writer, "run_dead_silence.gho"),
+                           0);
+  mismatches += expect_int("broken add_file",
+                           ghost_arrow_add_file(writer, "arrow_broken.gho"), -1);
+  mismatches += expect_int("second add_file",
+                           ghost_arrow_add_file(writer, "run_dead_silence.gho"),
+                           0);
+  mismatches += expect_int("close", ghost_arrow_close(writer), 0);
+  remove("arrow_broken.gho");
+
+  table_t table;
+  mismatches += read_table("arrow_test.arrow", &table);
+  const int num_ticks = ghost->path.num_items;
+  mismatches += expect_int("num_rows", table.num_rows, 2 * num_ticks);
+  for (int i = 0; i < table.num_rows && i < 2 * num_ticks; i++) {
+    const ghost_character_t *snap = ghost_get_snap(&ghost->path, i % num_ticks);
+    if (expect_int("ghost", table.ghost[i], i / num_ticks) ||
+        expect_int("x", table.x[i], snap->x) ||
+        expect_int("tick", table.tick[i], snap->tick)) {
+      printf("...at row %d\n", i);
+      mismatches++;
+      break;
+    }
+  }
+  free_table(&table);
+  remove("arrow_test.arrow");
+  return mismatches;
+}
+
+// Two maps whose names sanitize to the same file name and a third that only
+// differs from them in case must end up in three files.
+static int check_export_by_map(void) {
+  const char *maps[3] = {"arrow test", "arrow_test", "Arrow_Test"};
+  const char *files[3] = {"arrow_map0.gho", "arrow_map1.gho", "arrow_map2.gho"};
+  // In order of map names, "Arrow_Test" keeps its name and the other two
+  // get suffixes.
+  const char *outputs[3] = {"./Arrow_Test.arrow", "./arrow_test_2.arrow",
+                            "./arrow_test_3.arrow"};
+  int mismatches = 0;
+  for (int i = 0; i < 3; i++) {
+    ghost_t *ghost = create_ghost(maps[i], 100 * (i + 1));
+    mismatches += expect_int("save", ghost_save(ghost, files[i]), 0);
+    ghost_free(ghost);
+  }
+  mismatches +=
+      expect_int("export_by_map", ghost_arrow_export_by_map(files, 3, "."), 3);
+
+  const int rows[3] = {300, 100, 200};
+  for (int i = 0; i < 3; i++) {
+    table_t table;
+    mismatches += read_table(outputs[i], &table);
+    mismatches += expect_int("map rows", table.num_rows, rows[i]);
+    free_table(&table);
+    remove(outputs[i]);
+    remove(files[i]);
+  }
+  return mismatches;
+}
+
+int main(void) {
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+
+  int mismatches = 0;
+  mismatches += check_rollback(ghost);
+  mismatches += check_export_by_map();
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Arrow tables have the expected layout and rows.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in Arrow tables.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
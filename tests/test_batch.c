@@ -0,0 +1,77 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_batch.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+enum { NUM_FILES = 200 };
+
+// Loads the test ghost NUM_FILES times, plus one missing file, and checks
+// every result against ghost_load.
+static int run_batch(const char *what, const ghost_batch_options_t *options,
+                     const ghost_t *wanted) {
+  ghost_batch_t *batch = ghost_batch_create(options);
+  if (!batch) {
+    printf("MISMATCH: %s: batch could not be created\n", what);
+    return 1;
+  }
+  for (int i = 0; i < NUM_FILES; i++)
+    ghost_batch_submit(batch, "run_dead_silence.gho", (void *)(intptr_t)i);
+  ghost_batch_submit(batch, "missing_ghost.gho", (void *)(intptr_t)NUM_FILES);
+
+  int mismatches = 0;
+  int seen[NUM_FILES + 1] = {0};
+  ghost_batch_result_t result;
+  while (ghost_batch_wait(batch, &result)) {
+    const int index = (int)(intptr_t)result.user_data;
+    if (index < 0 || index > NUM_FILES || seen[index]++) {
+      printf("MISMATCH: %s: unexpected result %d\n", what, index);
+      mismatches++;
+    } else if (index == NUM_FILES) {
+      if (result.ghost) {
+        printf("MISMATCH: %s: missing file was loaded\n", what);
+        mismatches++;
+      }
+    } else if (!result.ghost ||
+               ghost_hash(result.ghost) != ghost_hash(wanted)) {
+      printf("MISMATCH: %s: ghost %d differs\n", what, index);
+      mismatches++;
+    }
+    ghost_free(result.ghost);
+  }
+  for (int i = 0; i <= NUM_FILES; i++) {
+    if (!seen[i]) {
+      printf("MISMATCH: %s: no result for %d\n", what, i);
+      mismatches++;
+      break;
+    }
+  }
+  ghost_batch_destroy(batch);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+
+  ghost_batch_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.queue_depth = 16;
+  mismatches += run_batch("default", &options, ghost);
+  options.disable_io_uring = 1;
+  mismatches += run_batch("pread", &options, ghost);
+
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Batch loads match ghost_load.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in batch loads.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
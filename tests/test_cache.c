@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_cache.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum { NUM_FILES = 4, NUM_THREADS = 8 };
+
+static int expect_int(const char *what, long long got, long long wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%lld != %lld)\n", what, got, wanted);
+  return 1;
+}
+
+static int copy_file(const char *from, const char *to) {
+  FILE *in = fopen(from, "rb");
+  FILE *out = fopen(to, "wb");
+  int result = in && out ? 0 : -1;
+  char buffer[4096];
+  size_t size;
+  while (result == 0 && (size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    if (fwrite(buffer, 1, size, out) != size)
+      result = -1;
+  if (in)
+    fclose(in);
+  if (out && fclose(out) != 0)
+    result = -1;
+  return result;
+}
+
+// Acquires and releases `filename`, returning the number of snapshots of
+// the cached ghost or -1.
+static int touch(ghost_cache_t *cache, const char *filename) {
+  ghost_cache_entry_t *entry = ghost_cache_acquire(cache, filename);
+  if (!entry)
+    return -1;
+  const int num_items = ghost_cache_entry_ghost(entry)->path.num_items;
+  ghost_cache_release(cache, entry);
+  return num_items;
+}
+
+static int check_stats(const char *name, ghost_cache_t *cache, int hits,
+                       int misses, int evictions, int num_entries) {
+  ghost_cache_stats_t stats;
+  ghost_cache_get_stats(cache, &stats);
+  if (stats.hits == hits && stats.misses == misses &&
+      stats.evictions == evictions && stats.num_entries == num_entries)
+    return 0;
+  printf("MISMATCH: %s: %lld hits, %lld misses, %lld evictions, %d entries; "
+         "wanted %d, %d, %d, %d\n",
+         name, stats.hits, stats.misses, stats.evictions, stats.num_entries,
+         hits, misses, evictions, num_entries);
+  return 1;
+}
+
+// Room for three copies of the test ghost, used least recently first.
+static int check_lru(char files[NUM_FILES][64], const ghost_t *ghost) {
+  const size_t ghost_bytes = ghost->path.num_items * sizeof(ghost_character_t);
+  ghost_cache_t *cache = ghost_cache_create(3 * ghost_bytes);
+  int mismatches = 0;
+
+  ghost_cache_entry_t *entry = ghost_cache_acquire(cache, files[0]);
+  const ghost_t *cached = ghost_cache_entry_ghost(entry);
+  mismatches += expect_int("ghost", cached && ghost_hash(cached) ==
+                                                  ghost_hash(ghost),
+                           1);
+  ghost_cache_entry_t *again = ghost_cache_acquire(cache, files[0]);
+  mismatches += expect_int("same entry", again == entry, 1);
+  ghost_cache_release(cache, again);
+  ghost_cache_release(cache, entry);
+  mismatches += check_stats("first file", cache, 1, 1, 0, 1);
+
+  touch(cache, files[1]);
+  touch(cache, files[2]);
+  touch(cache, files[0]);
+  mismatches += check_stats("full", cache, 2, 3, 0, 3);
+  // The fourth file pushes out the second, which was used longest ago.
+  touch(cache, files[3]);
+  mismatches += check_stats("fourth file", cache, 2, 4, 1, 3);
+  touch(cache, files[0]);
+  touch(cache, files[2]);
+  mismatches += check_stats("kept files", cache, 4, 4, 1, 3);
+  touch(cache, files[1]);
+  mismatches += check_stats("evicted file", cache, 4, 5, 2, 3);
+
+  ghost_cache_stats_t stats;
+  ghost_cache_get_stats(cache, &stats);
+  mismatches += expect_int("bytes", (long long)stats.bytes,
+                           (long long)(3 * ghost_bytes));
+
+  // Referenced ghosts outlive a budget of zero and go on their release.
+  entry = ghost_cache_acquire(cache, files[1]);
+  ghost_cache_set_budget(cache, 0);
+  mismatches += check_stats("held", cache, 5, 5, 4, 1);
+  mismatches += expect_int("held ghost",
+                           ghost_cache_entry_ghost(entry)->path.num_items,
+                           ghost->path.num_items);
+  ghost_cache_release(cache, entry);
+  mismatches += check_stats("released", cache, 5, 5, 5, 0);
+  ghost_cache_get_stats(cache, &stats);
+  mismatches += expect_int("released bytes", (long long)stats.bytes, 0);
+  ghost_cache_destroy(cache);
+  return mismatches;
+}
+
+// A file rewritten on disk is decoded again; holders of the old entry keep
+// the old ghost.
+static int check_changed_file(const char *filename, const ghost_t *ghost) {
+  ghost_cache_t *cache = ghost_cache_create(1 << 20);
+  int mismatches = 0;
+  ghost_cache_entry_t *old_entry = ghost_cache_acquire(cache, filename);
+
+  ghost_t *shorter = ghost_create();
+  ghost_set_meta(shorter, ghost->player, ghost->map, ghost->time);
+  for (int i = 0; i < 100; i++)
+    ghost_add_snap(shorter, ghost_get_snap(&ghost->path, i));
+  mismatches += expect_int("save", ghost_save(shorter, filename), 0);
+  ghost_free(shorter);
+
+  mismatches += expect_int("new ghost", touch(cache, filename), 100);
+  mismatches += expect_int("old ghost",
+                           ghost_cache_entry_ghost(old_entry)->path.num_items,
+                           ghost->path.num_items);
+  mismatches += check_stats("changed file", cache, 0, 2, 0, 1);
+  ghost_cache_release(cache, old_entry);
+  mismatches += expect_int("cached new ghost", touch(cache, filename), 100);
+
+  // Missing and broken files fail and are not kept.
+  char broken[80];
+  snprintf(broken, sizeof(broken), "%s.broken", filename);
+  FILE *file = fopen(broken, "wb");
+  if (file) {
+    fputs("not a ghost", file);
+    fclose(file);
+  }
+  mismatches += expect_int("missing", touch(cache, "/nonexistent.gho"), -1);
+  mismatches += expect_int("broken", touch(cache, broken), -1);
+  mismatches += expect_int("broken again", touch(cache, broken), -1);
+  remove(broken);
+  ghost_cache_stats_t stats;
+  ghost_cache_get_stats(cache, &stats);
+  mismatches += expect_int("failures", stats.failures, 3);
+  mismatches += expect_int("entries", stats.num_entries, 1);
+  ghost_cache_destroy(cache);
+  return mismatches;
+}
+
+typedef struct request_t {
+  pthread_t thread;
+  ghost_cache_t *cache;
+  const char *filename;
+  ghost_cache_entry_t *entry;
+} request_t;
+
+static void *run_request(void *arg) {
+  request_t *request = (request_t *)arg;
+  request->entry = ghost_cache_acquire(request->cache, request->filename);
+  return NULL;
+}
+
+// Concurrent requests for one file share a single decode.
+static int check_concurrent(const char *filename) {
+  ghost_cache_t *cache = ghost_cache_create(1 << 20);
+  request_t requests[NUM_THREADS];
+  int started = 0;
+  for (int i = 0; i < NUM_THREADS; i++) {
+    requests[i].cache = cache;
+    requests[i].filename = filename;
+    requests[i].entry = NULL;
+    if (pthread_create(&requests[i].thread, NULL, run_request, &requests[i]) !=
+        0)
+      break;
+    started++;
+  }
+  int mismatches = expect_int("threads", started, NUM_THREADS);
+  for (int i = 0; i < started; i++) {
+    pthread_join(requests[i].thread, NULL);
+    mismatches += expect_int("shared entry",
+                             requests[i].entry && requests[i].entry ==
+                                                      requests[0].entry,
+                             1);
+  }
+  mismatches += check_stats("concurrent", cache, started - 1, 1, 0, 1);
+  for (int i = 0; i < started; i++)
+    ghost_cache_release(cache, requests[i].entry);
+  ghost_cache_destroy(cache);
+  return mismatches;
+}
+
+int main(void) {
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  char dir[] = "/tmp/ghost_cache_XXXXXX";
+  if (!mkdtemp(dir)) {
+    printf("Temporary directory could not be created\n");
+    ghost_free(ghost);
+    return 1;
+  }
+
+  int mismatches = 0;
+  char files[NUM_FILES][64];
+  for (int i = 0; i < NUM_FILES; i++) {
+    snprintf(files[i], sizeof(files[i]), "%s/run%d.gho", dir, i);
+    if (copy_file("run_dead_silence.gho", files[i]) != 0) {
+      printf("MISMATCH: ghost could not be copied\n");
+      mismatches++;
+    }
+  }
+  if (mismatches == 0) {
+    mismatches += check_lru(files, ghost);
+    mismatches += check_concurrent(files[1]);
+    mismatches += check_changed_file(files[0], ghost);
+  }
+  for (int i = 0; i < NUM_FILES; i++)
+    remove(files[i]);
+  rmdir(dir);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Cached ghosts are shared and evicted as expected.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in the ghost cache.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
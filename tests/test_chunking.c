@@ -0,0 +1,207 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Version 6 files: a 133-byte header, then chunks with a 4-byte header of
+// type, item count and big-endian size.
+enum { HEADER_SIZE = 133, CHARACTER_CHUNK = 2 };
+
+static int expect_int(const char *what, long got, long wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%ld != %ld)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, *size, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+typedef struct chunks_t {
+  int num_chunks;
+  int num_items;
+  int max_items;
+  int num_unusual;
+} chunks_t;
+
+// Walks the snapshot chunks and counts those not holding the fixed 50.
+static int read_chunks(const unsigned char *data, size_t size,
+                       chunks_t *chunks) {
+  memset(chunks, 0, sizeof(*chunks));
+  size_t pos = HEADER_SIZE;
+  while (pos + 4 <= size) {
+    const int items = data[pos + 1];
+    if (data[pos] == CHARACTER_CHUNK) {
+      chunks->num_chunks++;
+      chunks->num_items += items;
+      chunks->max_items = items > chunks->max_items ? items : chunks->max_items;
+      chunks->num_unusual += items != 50;
+    }
+    pos += 4 + ((data[pos + 2] << 8) | data[pos + 3]);
+  }
+  return pos == size ? 0 : 1;
+}
+
+static int check_snaps(const char *name, const ghost_t *got,
+                       const ghost_t *wanted) {
+  if (got->path.num_items != wanted->path.num_items) {
+    printf("MISMATCH: %s has %d snapshots, wanted %d\n", name,
+           got->path.num_items, wanted->path.num_items);
+    return 1;
+  }
+  for (int i = 0; i < got->path.num_items; i++) {
+    if (memcmp(ghost_get_snap(&got->path, i), ghost_get_snap(&wanted->path, i),
+               sizeof(ghost_character_t)) != 0) {
+      printf("MISMATCH: %s differs at snapshot %d\n", name, i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Saves `ghost` with both chunkings and reads the smallest one back through
+// ghost_load, ghost_verify and lazy loading.
+static int check_ghost(const char *name, const ghost_t *ghost, int table,
+                       int min_unusual) {
+  int mismatches = 0;
+  ghost_save_options_t options = {.version = 6, .huffman_table = table};
+  mismatches +=
+      expect_int("save fixed", ghost_save_ex(ghost, "fixed.gho", &options), 0);
+  options.chunking = GHOST_CHUNKING_SMALLEST;
+  mismatches += expect_int("save smallest",
+                           ghost_save_ex(ghost, "smallest.gho", &options), 0);
+
+  size_t fixed_size = 0, size = 0;
+  unsigned char *fixed = read_file("fixed.gho", &fixed_size);
+  unsigned char *data = read_file("smallest.gho", &size);
+  chunks_t chunks;
+  if (!fixed || !data || read_chunks(data, size, &chunks) != 0) {
+    printf("MISMATCH: %s could not be read\n", name);
+    free(fixed);
+    free(data);
+    return mismatches + 1;
+  }
+  if (size > fixed_size) {
+    printf("MISMATCH: %s is %zu bytes with the smallest chunks, %zu fixed\n",
+           name, size, fixed_size);
+    mismatches++;
+  }
+  mismatches += expect_int("chunk items", chunks.num_items,
+                           ghost->path.num_items);
+  if (chunks.num_unusual < min_unusual || chunks.max_items > 255) {
+    printf("MISMATCH: %s has %d of %d chunks not holding 50 snapshots, up "
+           "to %d\n",
+           name, chunks.num_unusual, chunks.num_chunks, chunks.max_items);
+    mismatches++;
+  }
+
+  ghost_t *loaded = ghost_load_mem(data, size);
+  if (loaded) {
+    mismatches += check_snaps(name, loaded, ghost);
+    ghost_free(loaded);
+  } else {
+    printf("MISMATCH: %s could not be loaded\n", name);
+    mismatches++;
+  }
+
+  ghost_verify_result_t result;
+  mismatches += expect_int("verify", ghost_verify_mem(data, size, &result), 0);
+  ghost_verify_result_t fixed_result;
+  ghost_verify_mem(fixed, fixed_size, &fixed_result);
+  mismatches += expect_int("verify hash", result.hash == fixed_result.hash, 1);
+
+  // Lazy loading indexes chunks of any length; read back to front.
+  ghost_lazy_t *lazy = ghost_load_lazy_mem(data, size);
+  if (lazy) {
+    for (int i = ghost->path.num_items - 1; i >= 0; i--) {
+      const ghost_character_t *snap = ghost_lazy_get_snap(lazy, i);
+      if (!snap || memcmp(snap, ghost_get_snap(&ghost->path, i),
+                          sizeof(ghost_character_t)) != 0) {
+        printf("MISMATCH: %s lazy snapshot %d differs\n", name, i);
+        mismatches++;
+        break;
+      }
+    }
+    ghost_lazy_free(lazy);
+  } else {
+    printf("MISMATCH: %s could not be loaded lazily\n", name);
+    mismatches++;
+  }
+
+  free(fixed);
+  free(data);
+  remove("fixed.gho");
+  remove("smallest.gho");
+  return mismatches;
+}
+
+// Standing still, running straight and jittering: stretches that want
+// longer and shorter chunks than 50.
+static ghost_t *create_ghost(int num_ticks) {
+  ghost_t *ghost = ghost_create();
+  ghost_set_meta(ghost, "nameless tee", "chunking", 9000);
+  ghost_character_t snap = {0};
+  uint32_t state = 7;
+  for (int i = 0; i < num_ticks; i++) {
+    const int phase = (i / 300) % 3;
+    state = state * 1664525u + 1013904223u;
+    if (phase == 1) {
+      snap.x += 12;
+      snap.vel_x = 12 * 256;
+    } else if (phase == 2) {
+      snap.x += (int)(state >> 24) - 128;
+      snap.y += (int)((state >> 16) & 0xff) - 128;
+      snap.angle = (int)((state >> 4) % 1600);
+    }
+    snap.tick = 100 + i;
+    ghost_add_snap(ghost, &snap);
+  }
+  ghost->start_tick = 100;
+  return ghost;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  mismatches += check_ghost("run_dead_silence", ghost,
+                            GHOST_HUFFMAN_TABLE_NETWORK, 1);
+  mismatches += check_ghost("run_dead_silence with the ghost table", ghost,
+                            GHOST_HUFFMAN_TABLE_GHOST, 1);
+  ghost_free(ghost);
+
+  ghost = create_ghost(3000);
+  mismatches +=
+      check_ghost("synthetic", ghost, GHOST_HUFFMAN_TABLE_NETWORK, 2);
+  ghost_free(ghost);
+
+  ghost = create_ghost(1);
+  mismatches +=
+      check_ghost("single snapshot", ghost, GHOST_HUFFMAN_TABLE_NETWORK, 1);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Files with the smallest chunks read back unchanged.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in chunked files.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
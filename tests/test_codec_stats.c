@@ -0,0 +1,261 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  HEADER_SIZE = 133,
+  NUM_FIELDS = sizeof(ghost_character_t) / sizeof(int),
+};
+
+static const char *const filename = "codec_stats.gho";
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static int expect_long(const char *what, long long got, long long wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%lld != %lld)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *name, size_t *size) {
+  FILE *file = fopen(name, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  rewind(file);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, 1, *size, file) != *size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+// Saves the ghost with `table` and returns the file's contents.
+static unsigned char *save_ghost(const ghost_t *ghost, int table,
+                                 size_t *size) {
+  ghost_save_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.huffman_table = table;
+  unsigned char *data = ghost_save_ex(ghost, filename, &options) == 0
+                            ? read_file(filename, size)
+                            : NULL;
+  remove(filename);
+  return data;
+}
+
+// The first `num_snaps` snapshots with the metadata of `ghost`, so only the
+// snapshot chunks differ between the two.
+static ghost_t *copy_head(const ghost_t *ghost, int num_snaps) {
+  ghost_t *copy = ghost_create();
+  const ghost_path_t path = copy->path;
+  *copy = *ghost;
+  copy->path = path;
+  for (int i = 0; i < num_snaps; i++)
+    ghost_add_snap(copy, ghost_get_snap(&ghost->path, i));
+  return copy;
+}
+
+static long long sum_fields(const long long *fields) {
+  long long sum = 0;
+  for (int i = 0; i < NUM_FIELDS; i++)
+    sum += fields[i];
+  return sum;
+}
+
+// Counts and sizes must describe the file the encoder writes.
+static int check_file_layout(const char *name, const ghost_t *ghost,
+                             int table) {
+  int mismatches = 0;
+  ghost_codec_stats_t stats;
+  memset(&stats, 0, sizeof(stats));
+  mismatches +=
+      expect_int("stats", ghost_codec_stats_add(&stats, ghost, table), 0);
+
+  size_t size;
+  unsigned char *data = save_ghost(ghost, table, &size);
+  if (!data) {
+    printf("MISMATCH: %s could not be saved\n", name);
+    return mismatches + 1;
+  }
+
+  long long num_chunks = 0;
+  long long num_items = 0;
+  long long data_bytes = 0;
+  for (size_t pos = HEADER_SIZE; pos + 4 <= size;) {
+    const size_t chunk_size = (data[pos + 2] << 8) | data[pos + 3];
+    num_chunks++;
+    // Snapshot chunks are types 1 (without ticks) and 2 (with ticks).
+    if (data[pos] == 1 || data[pos] == 2)
+      num_items += data[pos + 1];
+    data_bytes += chunk_size;
+    pos += 4 + chunk_size;
+  }
+  free(data);
+
+  mismatches += expect_int("ghosts", stats.num_ghosts, 1);
+  mismatches += expect_long("snapshots", stats.num_snapshots,
+                            ghost->path.num_items);
+  mismatches += expect_long("snapshots in the file", num_items,
+                            ghost->path.num_items);
+  mismatches += expect_long("chunks", stats.num_chunks, num_chunks);
+  mismatches += expect_long("total bytes", stats.total_bytes, (long long)size);
+
+  // Every chunk is its Huffman bits rounded up to whole bytes.
+  if (data_bytes * 8 < stats.huffman_bits ||
+      data_bytes * 8 >= stats.huffman_bits + 8 * num_chunks) {
+    printf("MISMATCH: %s chunks hold %lld bytes for %lld Huffman bits\n",
+           name, data_bytes, stats.huffman_bits);
+    mismatches++;
+  }
+
+  long long freq_sum = 0;
+  for (int b = 0; b < 256; b++)
+    freq_sum += stats.byte_freq[b];
+  mismatches += expect_long("byte frequencies", freq_sum, stats.varint_bytes);
+  if (mismatches)
+    printf("...in the stats of %s\n", name);
+  return mismatches;
+}
+
+// The per-field numbers cover exactly the snapshot chunks. Taking away the
+// stats of the same ghost without snapshots leaves the snapshot chunks,
+// whose Huffman bits add one end-of-chunk symbol per chunk to the fields.
+static int check_fields(const ghost_t *ghost, int table) {
+  int mismatches = 0;
+  ghost_t *empty = copy_head(ghost, 0);
+  ghost_t *one = copy_head(ghost, 1);
+  ghost_codec_stats_t full_stats, empty_stats, one_stats;
+  memset(&full_stats, 0, sizeof(full_stats));
+  memset(&empty_stats, 0, sizeof(empty_stats));
+  memset(&one_stats, 0, sizeof(one_stats));
+  ghost_codec_stats_add(&full_stats, ghost, table);
+  ghost_codec_stats_add(&empty_stats, empty, table);
+  ghost_codec_stats_add(&one_stats, one, table);
+
+  mismatches += expect_long("no fields without snapshots",
+                            sum_fields(empty_stats.field_varint_bytes) +
+                                sum_fields(empty_stats.field_huffman_bits),
+                            0);
+  mismatches += expect_long(
+      "field bytes", sum_fields(full_stats.field_varint_bytes),
+      full_stats.varint_bytes - empty_stats.varint_bytes);
+
+  const long long eof_bits = one_stats.huffman_bits -
+                             empty_stats.huffman_bits -
+                             sum_fields(one_stats.field_huffman_bits);
+  const long long snap_chunks = full_stats.num_chunks - empty_stats.num_chunks;
+  if (eof_bits <= 0 || eof_bits > 32) {
+    printf("MISMATCH: end-of-chunk symbol takes %lld bits\n", eof_bits);
+    mismatches++;
+  }
+  mismatches += expect_long(
+      "field bits", sum_fields(full_stats.field_huffman_bits),
+      full_stats.huffman_bits - empty_stats.huffman_bits -
+          snap_chunks * eof_bits);
+
+  // Adding a ghost again doubles everything.
+  ghost_codec_stats_t twice = full_stats;
+  ghost_codec_stats_add(&twice, ghost, table);
+  mismatches += expect_long("twice the bits", twice.huffman_bits,
+                            2 * full_stats.huffman_bits);
+  mismatches += expect_long("twice the chunks", twice.num_chunks,
+                            2 * full_stats.num_chunks);
+  mismatches += expect_int("twice the ghosts", twice.num_ghosts, 2);
+
+  ghost_free(one);
+  ghost_free(empty);
+  return mismatches;
+}
+
+// Gathering stats must not change the ghost or what is saved afterwards.
+static int check_unchanged(const ghost_t *ghost) {
+  int mismatches = 0;
+  size_t before_size, after_size;
+  unsigned char *before =
+      save_ghost(ghost, GHOST_HUFFMAN_TABLE_NETWORK, &before_size);
+  ghost_t *copy = copy_head(ghost, ghost->path.num_items);
+
+  ghost_codec_stats_t stats;
+  memset(&stats, 0, sizeof(stats));
+  ghost_codec_stats_add(&stats, ghost, GHOST_HUFFMAN_TABLE_NETWORK);
+  ghost_codec_stats_add(&stats, ghost, GHOST_HUFFMAN_TABLE_GHOST);
+
+  unsigned char *after =
+      save_ghost(ghost, GHOST_HUFFMAN_TABLE_NETWORK, &after_size);
+  mismatches += expect_int("saved after stats",
+                           before && after && before_size == after_size &&
+                               memcmp(before, after, before_size) == 0,
+                           1);
+  for (int i = 0; i < ghost->path.num_items; i++) {
+    if (memcmp(ghost_get_snap(&ghost->path, i),
+               ghost_get_snap(&copy->path, i),
+               sizeof(ghost_character_t)) != 0) {
+      printf("MISMATCH: snapshot %d changed by the stats\n", i);
+      mismatches++;
+      break;
+    }
+  }
+
+  ghost_t *reloaded = after ? ghost_load_mem(after, after_size) : NULL;
+  mismatches += expect_int("reloaded ticks",
+                           reloaded ? reloaded->path.num_items : -1,
+                           ghost->path.num_items);
+  for (int i = 0; reloaded && i < reloaded->path.num_items; i++) {
+    if (memcmp(ghost_get_snap(&reloaded->path, i),
+               ghost_get_snap(&ghost->path, i),
+               sizeof(ghost_character_t)) != 0) {
+      printf("MISMATCH: reloaded snapshot %d differs\n", i);
+      mismatches++;
+      break;
+    }
+  }
+
+  ghost_free(reloaded);
+  ghost_free(copy);
+  free(before);
+  free(after);
+  return mismatches;
+}
+
+int main(void) {
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+
+  int mismatches = 0;
+  mismatches += check_file_layout("network table", ghost,
+                                  GHOST_HUFFMAN_TABLE_NETWORK);
+  mismatches +=
+      check_file_layout("ghost table", ghost, GHOST_HUFFMAN_TABLE_GHOST);
+  mismatches += check_fields(ghost, GHOST_HUFFMAN_TABLE_NETWORK);
+  mismatches += check_fields(ghost, GHOST_HUFFMAN_TABLE_GHOST);
+  mismatches += check_unchanged(ghost);
+
+  ghost_codec_stats_t stats;
+  mismatches += expect_int("bad table", ghost_codec_stats_add(&stats, ghost, 9),
+                           -1);
+  mismatches += expect_int("NULL stats",
+                           ghost_codec_stats_add(NULL, ghost, 0), -1);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Codec stats describe the saved file.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in the codec stats.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
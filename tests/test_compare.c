@@ -0,0 +1,162 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_compare.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Long enough to span chunk boundaries (1500 snapshots per chunk).
+static ghost_t *create_ghost(int num_ticks) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  for (int i = 0; i < num_ticks; i++) {
+    snap.x = 1000 + i * 3;
+    snap.y = 2000 - i;
+    snap.tick = 500 + i;
+    ghost_add_snap(ghost, &snap);
+  }
+  return ghost;
+}
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static int expect_float(const char *what, float got, float wanted) {
+  if (fabsf(got - wanted) <= 1e-4f * (1.0f + fabsf(wanted)))
+    return 0;
+  printf("MISMATCH: %s (%f != %f)\n", what, got, wanted);
+  return 1;
+}
+
+// Coordinates at opposite ends of the int range, for both the vector
+// blocks and the scalar tail.
+static int check_far_apart(void) {
+  int mismatches = 0;
+  ghost_t *a = ghost_create();
+  ghost_t *b = ghost_create();
+  ghost_character_t snap = {0};
+  for (int i = 0; i < 7; i++) {
+    snap.x = INT32_MAX - i;
+    snap.y = INT32_MIN + i * 1000;
+    snap.tick = i;
+    ghost_add_snap(a, &snap);
+    snap.x = INT32_MIN + i;
+    snap.y = INT32_MAX;
+    ghost_add_snap(b, &snap);
+  }
+
+  float distances[7];
+  ghost_compare_result_t result;
+  mismatches += expect_int("far apart",
+                           ghost_compare(&a->path, &b->path, &result,
+                                         distances),
+                           0);
+  for (int i = 0; i < 7; i++) {
+    const double dx = (double)INT32_MAX - INT32_MIN - 2 * i;
+    const double dy = (double)INT32_MAX - INT32_MIN - i * 1000;
+    if (expect_float("far apart distances", distances[i],
+                     (float)sqrt(dx * dx + dy * dy)) != 0) {
+      printf("...at index %d\n", i);
+      mismatches++;
+      break;
+    }
+  }
+  mismatches +=
+      expect_int("far apart max_distance_index", result.max_distance_index, 0);
+  ghost_free(a);
+  ghost_free(b);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_compare_result_t result;
+
+  ghost_t *a = create_ghost(3200);
+  ghost_t *same = create_ghost(3200);
+  if (ghost_compare(&a->path, &same->path, &result, NULL) != 0) {
+    printf("MISMATCH: identical paths could not be compared\n");
+    mismatches++;
+  } else {
+    mismatches += expect_int("identical first_mismatch", result.first_mismatch,
+                             -1);
+    mismatches += expect_int("identical tick_delta", result.tick_delta, 0);
+    mismatches += expect_float("identical max_distance", result.max_distance,
+                               0.0f);
+  }
+
+  // `b` is 100 snapshots shorter, 50 units off at 1700 and 10 units off at
+  // 2600, and differs only in its hook state at 1600.
+  ghost_t *b = create_ghost(3100);
+  ghost_get_snap(&b->path, 1600)->hook_state = 4;
+  ghost_get_snap(&b->path, 1700)->x += 30;
+  ghost_get_snap(&b->path, 1700)->y += 40;
+  ghost_get_snap(&b->path, 2600)->y -= 10;
+
+  float *distances = (float *)malloc(3100 * sizeof(float));
+  if (ghost_compare(&a->path, &b->path, &result, distances) != 0) {
+    printf("MISMATCH: differing paths could not be compared\n");
+    mismatches++;
+  } else {
+    mismatches += expect_int("num_compared", result.num_compared, 3100);
+    mismatches += expect_int("tick_delta", result.tick_delta, -100);
+    mismatches += expect_int("first_mismatch", result.first_mismatch, 1600);
+    mismatches +=
+        expect_int("first_mismatch_tick", result.first_mismatch_tick, 2100);
+    mismatches +=
+        expect_int("max_distance_index", result.max_distance_index, 1700);
+    mismatches += expect_float("max_distance", result.max_distance, 50.0f);
+    mismatches +=
+        expect_float("mean_distance", result.mean_distance, 60.0f / 3100);
+    for (int i = 0; i < 3100; i++) {
+      const float wanted = i == 1700 ? 50.0f : i == 2600 ? 10.0f : 0.0f;
+      if (expect_float("distances", distances[i], wanted) != 0) {
+        printf("...at index %d\n", i);
+        mismatches++;
+        break;
+      }
+    }
+  }
+
+  // The other way round only the sign of the length difference changes.
+  if (ghost_compare(&b->path, &a->path, &result, NULL) != 0) {
+    printf("MISMATCH: reversed paths could not be compared\n");
+    mismatches++;
+  } else {
+    mismatches += expect_int("reversed tick_delta", result.tick_delta, 100);
+    mismatches +=
+        expect_int("reversed first_mismatch", result.first_mismatch, 1600);
+    mismatches +=
+        expect_float("reversed max_distance", result.max_distance, 50.0f);
+  }
+
+  ghost_t *empty = ghost_create();
+  if (ghost_compare(&a->path, &empty->path, &result, NULL) != 0) {
+    printf("MISMATCH: empty path could not be compared\n");
+    mismatches++;
+  } else {
+    mismatches += expect_int("empty num_compared", result.num_compared, 0);
+    mismatches += expect_int("empty tick_delta", result.tick_delta, -3200);
+  }
+
+  mismatches += check_far_apart();
+
+  free(distances);
+  ghost_free(a);
+  ghost_free(same);
+  ghost_free(b);
+  ghost_free(empty);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Path comparison reports all known differences.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in comparison results.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,227 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { HEADER_SIZE = 133, FIRST_SNAP_CHUNK = 197 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, *size, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+typedef struct received_t {
+  const ghost_t *ghost;
+  int num_snaps;
+  int mismatches;
+} received_t;
+
+static void on_snap(void *user_data, const ghost_character_t *snap) {
+  received_t *received = (received_t *)user_data;
+  const ghost_path_t *path = &received->ghost->path;
+  const ghost_character_t *wanted = ghost_get_snap(path, received->num_snaps);
+  if (!wanted || memcmp(snap, wanted, sizeof(*snap)) != 0)
+    received->mismatches++;
+  received->num_snaps++;
+}
+
+// Feeds the file in pieces of up to `max_piece` bytes; 1 feeds it one byte
+// at a time.
+static int check_pieces(const char *name, const unsigned char *data,
+                        size_t size, const ghost_t *ghost, size_t max_piece) {
+  int mismatches = 0;
+  received_t received = {ghost, 0, 0};
+  ghost_decoder_t *decoder = ghost_decoder_create(on_snap, &received);
+  uint32_t state = (uint32_t)max_piece;
+  size_t pos = 0;
+  while (pos < size) {
+    state = state * 1664525u + 1013904223u;
+    size_t piece = 1 + (state >> 8) % max_piece;
+    if (piece > size - pos)
+      piece = size - pos;
+    if (pos < HEADER_SIZE && ghost_decoder_meta(decoder) != NULL) {
+      printf("MISMATCH: %s has metadata before the header\n", name);
+      mismatches++;
+    }
+    if (ghost_decoder_feed(decoder, data + pos, piece) != 0) {
+      printf("MISMATCH: %s rejected the bytes at %zu\n", name, pos);
+      mismatches++;
+      break;
+    }
+    pos += piece;
+  }
+
+  mismatches += expect_int("snapshots", received.num_snaps,
+                           ghost->path.num_items);
+  mismatches += expect_int("snapshot values", received.mismatches, 0);
+  mismatches += expect_int("num_ticks", ghost_decoder_num_ticks(decoder),
+                           ghost->path.num_items);
+  mismatches += expect_int("finish", ghost_decoder_finish(decoder), 0);
+  mismatches +=
+      expect_int("error", ghost_decoder_error(decoder), GHOST_VERIFY_OK);
+  const ghost_t *meta = ghost_decoder_meta(decoder);
+  if (meta) {
+    mismatches += expect_int("start_tick", meta->start_tick, ghost->start_tick);
+    mismatches += expect_int("time", meta->time, ghost->time);
+    mismatches += expect_int("player", strcmp(meta->player, ghost->player), 0);
+    mismatches += expect_int("map", strcmp(meta->map, ghost->map), 0);
+  } else {
+    printf("MISMATCH: %s has no metadata\n", name);
+    mismatches++;
+  }
+  ghost_decoder_free(decoder);
+  if (mismatches)
+    printf("...while feeding %s in pieces of up to %zu bytes\n", name,
+           max_piece);
+  return mismatches;
+}
+
+static int check_file(const char *name, const char *filename) {
+  size_t size;
+  unsigned char *data = read_file(filename, &size);
+  ghost_t *ghost = ghost_load(filename);
+  if (!data || !ghost) {
+    printf("MISMATCH: %s could not be loaded\n", name);
+    free(data);
+    ghost_free(ghost);
+    return 1;
+  }
+  int mismatches = check_pieces(name, data, size, ghost, 1);
+  mismatches += check_pieces(name, data, size, ghost, 7);
+  mismatches += check_pieces(name, data, size, ghost, 300);
+  mismatches += check_pieces(name, data, size, ghost, size);
+  free(data);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// Feeds `size` bytes one at a time and expects the decoder to give up with
+// `error`, either while feeding or at finish.
+static int check_failure(const char *name, const unsigned char *data,
+                         size_t size, int error) {
+  int mismatches = 0;
+  ghost_decoder_t *decoder = ghost_decoder_create(NULL, NULL);
+  size_t failed_at = size;
+  for (size_t i = 0; i < size; i++) {
+    if (ghost_decoder_feed(decoder, data + i, 1) != 0) {
+      failed_at = i;
+      break;
+    }
+  }
+  const int finished = ghost_decoder_finish(decoder);
+  if (finished != -1 || ghost_decoder_error(decoder) != error) {
+    printf("MISMATCH: %s finished with %d and '%s', wanted '%s'\n", name,
+           finished, ghost_verify_error_string(ghost_decoder_error(decoder)),
+           ghost_verify_error_string(error));
+    mismatches++;
+  }
+  // A failed decoder rejects everything that follows.
+  mismatches += expect_int("feed after failure",
+                           ghost_decoder_feed(decoder, data, 1), -1);
+  mismatches +=
+      expect_int("finish after failure", ghost_decoder_finish(decoder), -1);
+  ghost_decoder_free(decoder);
+  if (mismatches)
+    printf("...%s stopped feeding at byte %zu\n", name, failed_at);
+  return mismatches;
+}
+
+static int check_failures(void) {
+  size_t size;
+  unsigned char *data = read_file("run_dead_silence.gho", &size);
+  if (!data) {
+    printf("MISMATCH: test ghost could not be read\n");
+    return 1;
+  }
+  unsigned char *copy = (unsigned char *)malloc(size + 400);
+  int mismatches = 0;
+
+  mismatches += check_failure("empty upload", data, 0,
+                              GHOST_VERIFY_ERROR_TRUNCATED);
+  mismatches += check_failure("cut header", data, HEADER_SIZE - 1,
+                              GHOST_VERIFY_ERROR_TRUNCATED);
+  mismatches += check_failure("cut chunk", data, size - 1,
+                              GHOST_VERIFY_ERROR_TRUNCATED);
+  mismatches += check_failure("missing chunk", data, FIRST_SNAP_CHUNK,
+                              GHOST_VERIFY_ERROR_TRUNCATED);
+
+  memcpy(copy, data, size);
+  copy[1] = 'X';
+  mismatches += check_failure("marker", copy, size, GHOST_VERIFY_ERROR_MARKER);
+
+  memcpy(copy, data, size);
+  copy[8] = 9;
+  mismatches +=
+      check_failure("version", copy, size, GHOST_VERIFY_ERROR_VERSION);
+
+  memcpy(copy, data, size);
+  copy[FIRST_SNAP_CHUNK + 2] = 0;
+  copy[FIRST_SNAP_CHUNK + 3] = 0;
+  mismatches +=
+      check_failure("chunk size", copy, size, GHOST_VERIFY_ERROR_CHUNK_SIZE);
+
+  // The first snapshot chunk again after the last one.
+  memcpy(copy, data, size);
+  memcpy(copy + size, data + FIRST_SNAP_CHUNK, 290);
+  mismatches += check_failure("extra chunk", copy, size + 290,
+                              GHOST_VERIFY_ERROR_TOO_MANY_TICKS);
+
+  free(copy);
+  free(data);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  mismatches += check_file("run_dead_silence", "run_dead_silence.gho");
+
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  ghost_save_options_t options = {.version = 7};
+  mismatches += expect_int(
+      "save version 7", ghost_save_ex(ghost, "decoder_test.gho", &options), 0);
+  mismatches += check_file("version 7", "decoder_test.gho");
+  options = (ghost_save_options_t){.version = 6,
+                                   .huffman_table = GHOST_HUFFMAN_TABLE_GHOST,
+                                   .chunking = GHOST_CHUNKING_SMALLEST};
+  mismatches += expect_int(
+      "save smallest", ghost_save_ex(ghost, "decoder_test.gho", &options), 0);
+  mismatches += check_file("smallest chunks", "decoder_test.gho");
+  remove("decoder_test.gho");
+  ghost_free(ghost);
+
+  mismatches += check_failures();
+  mismatches += expect_int("finish NULL", ghost_decoder_finish(NULL), -1);
+  mismatches += expect_int("feed NULL", ghost_decoder_feed(NULL, "", 1), -1);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: The push decoder reads uploads in any pieces.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in the push decoder.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,137 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int expect_int(const char *what, long got, long wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%ld != %ld)\n", what, got, wanted);
+  return 1;
+}
+
+static long file_size(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+// A faster run on the same route: it starts at other ticks, skips part of
+// the reference, runs 32 units to the side for a while and has a gap.
+static ghost_t *create_new_best(const ghost_t *reference) {
+  ghost_t *ghost = ghost_create();
+  ghost_set_meta(ghost, "nameless tee", reference->map, reference->time - 800);
+  ghost->skin = reference->skin;
+  int tick = 5000;
+  for (int i = 0; i < reference->path.num_items; i++) {
+    if (i >= 200 && i < 240)
+      continue;
+    ghost_character_t snap = *ghost_get_snap(&reference->path, i);
+    if (i >= 300 && i < 400)
+      snap.x += 32;
+    if (i == 500)
+      tick += 3;
+    snap.tick = tick++;
+    ghost_add_snap(ghost, &snap);
+  }
+  return ghost;
+}
+
+static int check_equal(const ghost_t *got, const ghost_t *wanted) {
+  // Ghosts built in memory start at their first snapshot.
+  const int start_tick = wanted->start_tick != -1
+                             ? wanted->start_tick
+                             : ghost_get_snap(&wanted->path, 0)->tick;
+  int mismatches = 0;
+  mismatches += expect_int("num_items", got->path.num_items,
+                           wanted->path.num_items);
+  mismatches += expect_int("start_tick", got->start_tick, start_tick);
+  mismatches += expect_int("time", got->time, wanted->time);
+  mismatches += expect_int("player", strcmp(got->player, wanted->player), 0);
+  mismatches += expect_int("map", strcmp(got->map, wanted->map), 0);
+  mismatches += expect_int("skin", memcmp(got->skin.skin, wanted->skin.skin,
+                                          sizeof(got->skin.skin)),
+                           0);
+  for (int i = 0; i < got->path.num_items && i < wanted->path.num_items; i++) {
+    if (memcmp(ghost_get_snap(&got->path, i), ghost_get_snap(&wanted->path, i),
+               sizeof(ghost_character_t)) != 0) {
+      printf("MISMATCH: snapshot %d differs\n", i);
+      return mismatches + 1;
+    }
+  }
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *reference = ghost_load("run_dead_silence.gho");
+  if (!reference) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  ghost_t *ghost = create_new_best(reference);
+
+  mismatches += expect_int(
+      "save", ghost_save_delta(ghost, reference, "delta_test.ghd"), 0);
+  mismatches += expect_int("save full", ghost_save(ghost, "delta_full.gho"), 0);
+  ghost_t *loaded = ghost_load_delta("delta_test.ghd", reference);
+  if (loaded) {
+    mismatches += check_equal(loaded, ghost);
+    ghost_free(loaded);
+  } else {
+    printf("MISMATCH: delta ghost could not be loaded\n");
+    mismatches++;
+  }
+  // Following the reference closely, the delta must beat the plain file.
+  const long delta_size = file_size("delta_test.ghd");
+  const long full_size = file_size("delta_full.gho");
+  if (delta_size <= 0 || delta_size >= full_size) {
+    printf("MISMATCH: delta file has %ld bytes, the full one %ld\n",
+           delta_size, full_size);
+    mismatches++;
+  }
+
+  // Any other reference is refused, even one that differs in one field.
+  ghost_t *other = create_new_best(reference);
+  ghost_get_snap(&other->path, 100)->angle++;
+  mismatches += expect_int(
+      "other reference", ghost_load_delta("delta_test.ghd", other) == NULL, 1);
+  mismatches += expect_int(
+      "self reference", ghost_load_delta("delta_test.ghd", ghost) == NULL, 1);
+  mismatches +=
+      expect_int("plain load", ghost_load("delta_test.ghd") == NULL, 1);
+  mismatches += expect_int(
+      "plain file", ghost_load_delta("delta_full.gho", reference) == NULL, 1);
+  mismatches += expect_int(
+      "missing file", ghost_load_delta("missing.ghd", reference) == NULL, 1);
+  ghost_free(other);
+
+  // A reference compared with itself stores nothing but zeros.
+  mismatches += expect_int(
+      "save self", ghost_save_delta(reference, reference, "delta_test.ghd"), 0);
+  loaded = ghost_load_delta("delta_test.ghd", reference);
+  if (loaded) {
+    mismatches += check_equal(loaded, reference);
+    ghost_free(loaded);
+  } else {
+    printf("MISMATCH: delta of the reference could not be loaded\n");
+    mismatches++;
+  }
+
+  remove("delta_test.ghd");
+  remove("delta_full.gho");
+  ghost_free(ghost);
+  ghost_free(reference);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Delta ghosts load back against their reference.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in delta ghosts.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
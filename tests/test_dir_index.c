@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_dir_index.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static int copy_file(const char *from, const char *to) {
+  FILE *in = fopen(from, "rb");
+  FILE *out = fopen(to, "wb");
+  int result = in && out ? 0 : -1;
+  char buffer[4096];
+  size_t size;
+  while (result == 0 && (size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    if (fwrite(buffer, 1, size, out) != size)
+      result = -1;
+  if (in)
+    fclose(in);
+  if (out && fclose(out) != 0)
+    result = -1;
+  return result;
+}
+
+// Opens the index and returns the stats ticks of the one entry, or -1.
+static int indexed_ticks(const char *dir, const char *cache, int flags) {
+  ghost_dir_index_t *index = ghost_dir_index_open(dir, cache, flags);
+  if (!index)
+    return -1;
+  const ghost_dir_entry_t *entry = ghost_dir_index_find(index, "run.gho");
+  const int ticks = entry ? entry->stats.num_ticks : -1;
+  ghost_dir_index_close(index);
+  return ticks;
+}
+
+static int save_ghost(const char *dir, const char *name, const char *map,
+                      int time) {
+  char path[128];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  ghost_t *ghost = ghost_create();
+  ghost_set_meta(ghost, "nameless tee", map, time);
+  ghost_character_t snap = {0};
+  for (int i = 0; i < 120; i++) {
+    snap.x = i * 32;
+    snap.tick = 500 + i;
+    ghost_add_snap(ghost, &snap);
+  }
+  const int result = ghost_save(ghost, path);
+  ghost_free(ghost);
+  return result;
+}
+
+// Gives the file a fixed modification time.
+static void set_mtime(const char *dir, const char *name) {
+  char path[128];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  const struct timespec times[2] = {{1600000000, 0}, {1600000000, 0}};
+  utimensat(AT_FDCWD, path, times, 0);
+}
+
+static int entry_time(const ghost_dir_index_t *index, const char *name) {
+  const ghost_dir_entry_t *entry = ghost_dir_index_find(index, name);
+  return entry ? entry->time : -1;
+}
+
+// Times of the fastest ghosts on `map`, in order, as "time,time,...".
+static int check_top(const ghost_dir_index_t *index, const char *map,
+                     const char *wanted) {
+  const ghost_dir_entry_t *top[8];
+  const int count = ghost_dir_index_top(index, map, top, 8);
+  char got[128] = "";
+  for (int i = 0; i < count; i++)
+    snprintf(got + strlen(got), sizeof(got) - strlen(got), "%s%d",
+             i ? "," : "", top[i]->time);
+  if (strcmp(got, wanted) == 0)
+    return 0;
+  printf("MISMATCH: top of '%s' is '%s', wanted '%s'\n", map, got, wanted);
+  return 1;
+}
+
+// Polls until no more changes arrive and returns how many were applied.
+static int poll_all(ghost_dir_index_t *index) {
+  int changes = 0;
+  int applied;
+  while ((applied = ghost_dir_index_poll(index, 200)) > 0)
+    changes += applied;
+  return changes;
+}
+
+// Files added, rewritten and removed after opening are picked up by polls;
+// the cache spares unchanged files from being read again.
+static int check_updates(const char *dir) {
+  char cache_path[64], path[128];
+  snprintf(cache_path, sizeof(cache_path), "%s/updates.cache", dir);
+  int mismatches = 0;
+  mismatches += expect_int("save", save_ghost(dir, "a.gho", "beach", 9000), 0);
+  mismatches += expect_int("save", save_ghost(dir, "b.gho", "beach", 7000), 0);
+  mismatches += expect_int("save", save_ghost(dir, "c.gho", "cave", 8000), 0);
+  set_mtime(dir, "b.gho");
+  snprintf(path, sizeof(path), "%s/notes.txt", dir);
+  FILE *file = fopen(path, "wb");
+  if (file) {
+    fputs("not a ghost", file);
+    fclose(file);
+  }
+
+  ghost_dir_index_t *index = ghost_dir_index_open(dir, cache_path, 0);
+  if (!index) {
+    printf("MISMATCH: index could not be opened\n");
+    return mismatches + 1;
+  }
+  mismatches += expect_int("count", ghost_dir_index_count(index), 3);
+  const ghost_dir_entry_t *entry = ghost_dir_index_find(index, "a.gho");
+  mismatches += expect_int("ticks", entry ? entry->num_ticks : -1, 120);
+  mismatches += check_top(index, "beach", "7000,9000");
+  mismatches += check_top(index, "cave", "8000");
+  mismatches += check_top(index, "desert", "");
+
+  mismatches += expect_int("save", save_ghost(dir, "d.gho", "beach", 6000), 0);
+  mismatches += expect_int("save", save_ghost(dir, "a.gho", "beach", 5000), 0);
+  snprintf(path, sizeof(path), "%s/c.gho", dir);
+  remove(path);
+  snprintf(path, sizeof(path), "%s/broken.gho", dir);
+  file = fopen(path, "wb");
+  if (file) {
+    fputs("not a ghost", file);
+    fclose(file);
+  }
+  const int changes = poll_all(index);
+  if (changes < 3) {
+    printf("MISMATCH: %d changes polled, wanted at least 3\n", changes);
+    mismatches++;
+  }
+  mismatches += expect_int("count after poll", ghost_dir_index_count(index), 3);
+  mismatches += expect_int("rewritten", entry_time(index, "a.gho"), 5000);
+  mismatches += expect_int("removed", entry_time(index, "c.gho"), -1);
+  mismatches += expect_int("broken", entry_time(index, "broken.gho"), -1);
+  mismatches += check_top(index, "beach", "5000,6000,7000");
+  mismatches += check_top(index, "cave", "");
+  mismatches += expect_int("rescan", ghost_dir_index_rescan(index), 0);
+  ghost_dir_index_close(index);
+
+  // Rewrite b with the same size and mtime: the cached entry is kept.
+  mismatches += expect_int("save", save_ghost(dir, "b.gho", "beach", 7001), 0);
+  set_mtime(dir, "b.gho");
+  index = ghost_dir_index_open(dir, cache_path, 0);
+  mismatches += expect_int("cached count", ghost_dir_index_count(index), 3);
+  mismatches += expect_int("cached time", entry_time(index, "b.gho"), 7000);
+  ghost_dir_index_close(index);
+  // Without the cache the file is read.
+  index = ghost_dir_index_open(dir, NULL, 0);
+  mismatches += expect_int("uncached time", entry_time(index, "b.gho"), 7001);
+  ghost_dir_index_close(index);
+
+  const char *names[] = {"a.gho", "b.gho", "d.gho", "broken.gho",
+                         "notes.txt", "updates.cache"};
+  for (int i = 0; i < 6; i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+    remove(path);
+  }
+  return mismatches;
+}
+
+int main(void) {
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  const int num_ticks = ghost->path.num_items;
+  ghost_free(ghost);
+
+  char dir[] = "/tmp/ghost_dir_index_XXXXXX";
+  if (!mkdtemp(dir)) {
+    printf("Temporary directory could not be created\n");
+    return 1;
+  }
+  char ghost_path[64], cache_path[64];
+  snprintf(ghost_path, sizeof(ghost_path), "%s/run.gho", dir);
+  snprintf(cache_path, sizeof(cache_path), "%s/index.cache", dir);
+
+  int mismatches = 0;
+  if (copy_file("run_dead_silence.gho", ghost_path) != 0) {
+    printf("MISMATCH: ghost could not be copied\n");
+    mismatches++;
+  } else {
+    // Without the flag the files are not decoded; the cache then lacks
+    // stats and a later index wanting them re-reads the file. An index
+    // without the flag keeps cached stats.
+    mismatches += expect_int("headers only", indexed_ticks(dir, NULL, 0), 0);
+    mismatches += expect_int("cached headers only",
+                             indexed_ticks(dir, cache_path, 0), 0);
+    mismatches +=
+        expect_int("stats over cache",
+                   indexed_ticks(dir, cache_path, GHOST_DIR_INDEX_STATS),
+                   num_ticks);
+    mismatches += expect_int("cached stats", indexed_ticks(dir, cache_path, 0),
+                             num_ticks);
+  }
+  remove(ghost_path);
+  remove(cache_path);
+  mismatches += check_updates(dir);
+  rmdir(dir);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Directory index follows the directory.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in directory index.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,291 @@
+#include <ddnet_ghost/ghost_heatmap.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { FIRST_SNAP_CHUNK = 197, NUM_GHOSTS = 40, NUM_THREADS = 8 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static int expect_cell(const char *what, const ghost_heatmap_t *heatmap,
+                       int x, int y, float wanted) {
+  const float got = heatmap->cells[y * heatmap->width + x];
+  if (fabsf(got - wanted) <= 1e-6f * (1.0f + fabsf(wanted)))
+    return 0;
+  printf("MISMATCH: %s cell (%d, %d) is %g, wanted %g\n", what, x, y, got,
+         wanted);
+  return 1;
+}
+
+// Compares all cells. `tolerance` is relative; 0 asks for identical grids.
+static int expect_grid(const char *what, const ghost_heatmap_t *got,
+                       const ghost_heatmap_t *wanted, float tolerance) {
+  const int num_cells = wanted->width * wanted->height;
+  for (int i = 0; i < num_cells; i++) {
+    const float diff = fabsf(got->cells[i] - wanted->cells[i]);
+    if (diff > tolerance * fabsf(wanted->cells[i])) {
+      printf("MISMATCH: %s cell %d is %g, wanted %g\n", what, i,
+             got->cells[i], wanted->cells[i]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static float sum_cells(const ghost_heatmap_t *heatmap) {
+  float sum = 0.0f;
+  for (int i = 0; i < heatmap->width * heatmap->height; i++)
+    sum += heatmap->cells[i];
+  return sum;
+}
+
+static void add_snap(ghost_t *ghost, int x, int y, int tick) {
+  ghost_character_t snap = {0};
+  snap.x = x;
+  snap.y = y;
+  snap.tick = tick;
+  ghost_add_snap(ghost, &snap);
+}
+
+// Eight snapshots on a 10x10 grid of 100 units. Three of them lie outside
+// the grid: left of it, right of it and below it.
+static ghost_t *create_small_ghost(void) {
+  ghost_t *ghost = ghost_create();
+  add_snap(ghost, 50, 50, 100);
+  add_snap(ghost, 150, 50, 101);
+  add_snap(ghost, 150, 50, 102);
+  add_snap(ghost, 450, 450, 107);
+  add_snap(ghost, -10, 50, 108);
+  add_snap(ghost, 1050, 50, 109);
+  add_snap(ghost, 50, 999, 110);
+  add_snap(ghost, 50, 1000, 111);
+  return ghost;
+}
+
+static int check_weighting(void) {
+  int mismatches = 0;
+  ghost_t *ghost = create_small_ghost();
+  const float tick = 1.0f / GHOST_TICKS_PER_SECOND;
+  const float jump = (float)sqrt(1000.0 * 1000.0 + 949.0 * 949.0);
+  // Cells (0, 0), (1, 0), (4, 4) and (0, 9) for each weighting.
+  const float wanted[3][4] = {
+      {1.0f, 2.0f, 1.0f, 1.0f},
+      {tick, 2 * tick, 5 * tick, tick},
+      // The first snapshot has no speed, the speed into (0, 9) is measured
+      // from the dropped snapshot before it.
+      {0.0f, 100.0f, 100.0f, jump},
+  };
+  const char *names[3] = {"count", "time", "speed"};
+
+  for (int w = 0; w < 3; w++) {
+    ghost_heatmap_t *heatmap = ghost_heatmap_create(10, 10, 100, w);
+    if (!heatmap) {
+      printf("MISMATCH: %s heatmap could not be created\n", names[w]);
+      mismatches++;
+      continue;
+    }
+    mismatches +=
+        expect_int("add_path", ghost_heatmap_add_path(heatmap, &ghost->path),
+                   0);
+    mismatches += expect_cell(names[w], heatmap, 0, 0, wanted[w][0]);
+    mismatches += expect_cell(names[w], heatmap, 1, 0, wanted[w][1]);
+    mismatches += expect_cell(names[w], heatmap, 4, 4, wanted[w][2]);
+    mismatches += expect_cell(names[w], heatmap, 0, 9, wanted[w][3]);
+    // Nothing else was deposited, so the dropped snapshots went nowhere.
+    const float total =
+        wanted[w][0] + wanted[w][1] + wanted[w][2] + wanted[w][3];
+    if (fabsf(sum_cells(heatmap) - total) > 1e-3f) {
+      printf("MISMATCH: %s heatmap sums to %g, wanted %g\n", names[w],
+             sum_cells(heatmap), total);
+      mismatches++;
+    }
+
+    ghost_heatmap_clear(heatmap);
+    mismatches += expect_int("cleared", sum_cells(heatmap) == 0.0f, 1);
+    ghost_heatmap_free(heatmap);
+  }
+
+  mismatches += expect_int("zero width",
+                           ghost_heatmap_create(0, 10, 1, 0) == NULL, 1);
+  mismatches += expect_int("bad weighting",
+                           ghost_heatmap_create(10, 10, 1, 3) == NULL, 1);
+  ghost_heatmap_t *tiles = ghost_heatmap_create(10, 10, 0, 0);
+  mismatches += expect_int("default cell size", tiles ? tiles->cell_size : 0,
+                           32);
+  ghost_heatmap_free(tiles);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// Ghosts running right at whole speeds, so counts and speeds sum exactly in
+// float and those grids must match bit for bit.
+static ghost_t *create_runner(int index) {
+  ghost_t *ghost = ghost_create();
+  for (int i = 0; i < 300; i++)
+    add_snap(ghost, i * (index % 5 + 1) * 8, 64 * (index % 7) + i / 10,
+             1000 + i);
+  return ghost;
+}
+
+static int check_threads(void) {
+  int mismatches = 0;
+  ghost_t *ghosts[NUM_GHOSTS];
+  for (int i = 0; i < NUM_GHOSTS; i++)
+    ghosts[i] = create_runner(i);
+  const ghost_t *const *list = (const ghost_t *const *)ghosts;
+
+  for (int w = 0; w < 3; w++) {
+    ghost_heatmap_t *single = ghost_heatmap_create(100, 20, 32, w);
+    ghost_heatmap_t *multi = ghost_heatmap_create(100, 20, 32, w);
+    ghost_heatmap_t *one_by_one = ghost_heatmap_create(100, 20, 32, w);
+    for (int i = 0; i < NUM_GHOSTS; i++)
+      ghost_heatmap_add_path(one_by_one, &ghosts[i]->path);
+    mismatches += expect_int(
+        "single thread", ghost_heatmap_add_ghosts(single, list, NUM_GHOSTS, 1),
+        NUM_GHOSTS);
+    mismatches += expect_int(
+        "threads",
+        ghost_heatmap_add_ghosts(multi, list, NUM_GHOSTS, NUM_THREADS),
+        NUM_GHOSTS);
+    // Time weights are fractions of a second, which sum up with rounding
+    // that depends on how the ghosts were split between threads.
+    const float tolerance = w == GHOST_HEATMAP_WEIGHT_TIME ? 1e-5f : 0.0f;
+    mismatches += expect_grid("single thread", single, one_by_one, 0.0f);
+    mismatches += expect_grid("threads", multi, single, tolerance);
+    ghost_heatmap_free(single);
+    ghost_heatmap_free(multi);
+    ghost_heatmap_free(one_by_one);
+  }
+
+  for (int i = 0; i < NUM_GHOSTS; i++)
+    ghost_free(ghosts[i]);
+  return mismatches;
+}
+
+static int check_save_raw(void) {
+  int mismatches = 0;
+  ghost_heatmap_t *heatmap = ghost_heatmap_create(3, 2, 0, 0);
+  for (int i = 0; i < 6; i++)
+    heatmap->cells[i] = i * 1.5f - 2.0f;
+  const char *filename = "heatmap.raw";
+  mismatches +=
+      expect_int("save_raw", ghost_heatmap_save_raw(heatmap, filename), 0);
+
+  // No header: six float32 values, cell (x, y) at index y * 3 + x.
+  unsigned char data[64];
+  FILE *file = fopen(filename, "rb");
+  const size_t size = file ? fread(data, 1, sizeof(data), file) : 0;
+  if (file)
+    fclose(file);
+  remove(filename);
+  mismatches += expect_int("raw size", (int)size, 6 * 4);
+  for (int i = 0; i < 6 && (size_t)i * 4 + 4 <= size; i++) {
+    const uint32_t bits = (uint32_t)data[i * 4] |
+                          (uint32_t)data[i * 4 + 1] << 8 |
+                          (uint32_t)data[i * 4 + 2] << 16 |
+                          (uint32_t)data[i * 4 + 3] << 24;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != heatmap->cells[i]) {
+      printf("MISMATCH: raw cell %d is %g, wanted %g\n", i, value,
+             heatmap->cells[i]);
+      mismatches++;
+    }
+  }
+
+  mismatches += expect_int(
+      "save_raw to a missing directory",
+      ghost_heatmap_save_raw(heatmap, "missing_dir/heatmap.raw"), -1);
+  ghost_heatmap_free(heatmap);
+  return mismatches;
+}
+
+// Copies the first `num_chunks` snapshot chunks of the file and half of the
+// next one.
+static int write_truncated(const char *filename, int num_chunks) {
+  FILE *file = fopen("run_dead_silence.gho", "rb");
+  if (!file)
+    return -1;
+  unsigned char data[8192];
+  const size_t size = fread(data, 1, sizeof(data), file);
+  fclose(file);
+
+  size_t pos = FIRST_SNAP_CHUNK;
+  for (int i = 0; i < num_chunks && pos + 4 <= size; i++)
+    pos += 4 + ((data[pos + 2] << 8) | data[pos + 3]);
+  const size_t cut = pos + 4 + (((data[pos + 2] << 8) | data[pos + 3]) / 2);
+  file = fopen(filename, "wb");
+  if (!file)
+    return -1;
+  const int written = fwrite(data, 1, cut, file) == cut;
+  return fclose(file) == 0 && written ? 0 : -1;
+}
+
+// A file that fails half way still adds the snapshots decoded before the
+// error, while the batch only counts the files that were read completely.
+static int check_partial_files(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  const char *truncated = "heatmap_truncated.gho";
+  if (!ghost || write_truncated(truncated, 5) != 0) {
+    printf("MISMATCH: test ghosts could not be prepared\n");
+    ghost_free(ghost);
+    return 1;
+  }
+  ghost_t *head = ghost_create();
+  for (int i = 0; i < 5 * 50; i++)
+    ghost_add_snap(head, ghost_get_snap(&ghost->path, i));
+
+  const char *files[] = {"run_dead_silence.gho", truncated,
+                         "run_dead_silence.gho", "missing.gho"};
+  for (int w = 0; w < 3; w++) {
+    ghost_heatmap_t *wanted = ghost_heatmap_create(400, 200, 32, w);
+    ghost_heatmap_add_path(wanted, &ghost->path);
+    ghost_heatmap_add_path(wanted, &head->path);
+    ghost_heatmap_add_path(wanted, &ghost->path);
+
+    ghost_heatmap_t *single = ghost_heatmap_create(400, 200, 32, w);
+    ghost_heatmap_t *multi = ghost_heatmap_create(400, 200, 32, w);
+    mismatches += expect_int("truncated file",
+                             ghost_heatmap_add_file(single, truncated), -1);
+    ghost_heatmap_clear(single);
+    mismatches += expect_int("files added",
+                             ghost_heatmap_add_files(single, files, 4, 1), 2);
+    mismatches += expect_int(
+        "files added on threads",
+        ghost_heatmap_add_files(multi, files, 4, NUM_THREADS), 2);
+    mismatches += expect_int("partial deposit", sum_cells(single) > 0, 1);
+    mismatches += expect_grid("partial files", single, wanted, 1e-5f);
+    mismatches += expect_grid("partial files on threads", multi, wanted, 1e-5f);
+    ghost_heatmap_free(wanted);
+    ghost_heatmap_free(single);
+    ghost_heatmap_free(multi);
+  }
+
+  remove(truncated);
+  ghost_free(head);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = check_weighting();
+  mismatches += check_threads();
+  mismatches += check_save_raw();
+  mismatches += check_partial_files();
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Heatmaps hold exactly the deposited positions.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in the heatmaps.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,206 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { FIRST_SNAP_CHUNK = 197, CHUNK_ITEMS = 50, NUM_SLOTS = 4 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, *size, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+// Reads snapshot `index` from the lazy ghost and compares it to the fully
+// loaded one.
+static int check_snap(ghost_lazy_t *lazy, const ghost_t *ghost, int index) {
+  const ghost_character_t *snap = ghost_lazy_get_snap(lazy, index);
+  const ghost_character_t *wanted = ghost_get_snap(&ghost->path, index);
+  if (snap && wanted && memcmp(snap, wanted, sizeof(*snap)) == 0)
+    return 0;
+  printf("MISMATCH: snapshot %d %s\n", index,
+         snap ? "differs from the full load" : "could not be read");
+  return 1;
+}
+
+// Decoded chunks live in a fixed number of slots, so reading more of the
+// ghost must never grow it beyond the slots, and releasing returns it to
+// its idle size.
+static int check_resident(ghost_lazy_t *lazy, const ghost_t *ghost,
+                          size_t file_size) {
+  int mismatches = 0;
+  ghost_lazy_release(lazy);
+  const size_t idle = ghost_lazy_resident_bytes(lazy);
+  const size_t full_path =
+      (size_t)ghost->path.num_items * sizeof(ghost_character_t);
+  if (idle < file_size || idle >= file_size + full_path / 4) {
+    printf("MISMATCH: idle ghost holds %zu bytes for a %zu byte file\n",
+           idle, file_size);
+    mismatches++;
+  }
+
+  mismatches += check_snap(lazy, ghost, 0);
+  const size_t active = ghost_lazy_resident_bytes(lazy);
+  const size_t slots = NUM_SLOTS * CHUNK_ITEMS * sizeof(ghost_character_t);
+  if (active < idle + slots) {
+    printf("MISMATCH: active ghost holds %zu bytes, idle %zu\n", active,
+           idle);
+    mismatches++;
+  }
+
+  for (int i = 0; i < ghost->path.num_items; i++) {
+    mismatches += check_snap(lazy, ghost, i);
+    if (ghost_lazy_resident_bytes(lazy) != active) {
+      printf("MISMATCH: resident bytes changed at snapshot %d\n", i);
+      mismatches++;
+      break;
+    }
+  }
+
+  ghost_lazy_release(lazy);
+  if (ghost_lazy_resident_bytes(lazy) != idle) {
+    printf("MISMATCH: released ghost holds %zu bytes, wanted %zu\n",
+           ghost_lazy_resident_bytes(lazy), idle);
+    mismatches++;
+  }
+  return mismatches;
+}
+
+static int check_access(ghost_lazy_t *lazy, const ghost_t *ghost) {
+  int mismatches = 0;
+  const int num_ticks = ghost->path.num_items;
+  mismatches +=
+      expect_int("num_ticks", ghost_lazy_num_ticks(lazy), num_ticks);
+  mismatches += expect_int("start_tick", ghost_lazy_meta(lazy)->start_tick,
+                           ghost->start_tick);
+
+  // Backwards, so every chunk boundary is crossed in the other direction.
+  for (int i = num_ticks - 1; i >= 0; i--)
+    mismatches += check_snap(lazy, ghost, i);
+
+  // Back and forth over each chunk boundary.
+  for (int b = CHUNK_ITEMS; b < num_ticks; b += CHUNK_ITEMS) {
+    mismatches += check_snap(lazy, ghost, b - 1);
+    mismatches += check_snap(lazy, ghost, b);
+    mismatches += check_snap(lazy, ghost, b - 1);
+  }
+
+  // Random order.
+  unsigned state = 12345;
+  for (int i = 0; i < 2000; i++) {
+    state = state * 1664525u + 1013904223u;
+    mismatches += check_snap(lazy, ghost, (int)((state >> 8) % num_ticks));
+  }
+
+  if (ghost_lazy_get_snap(lazy, -1) ||
+      ghost_lazy_get_snap(lazy, num_ticks)) {
+    printf("MISMATCH: snapshot outside the ghost was returned\n");
+    mismatches++;
+  }
+  return mismatches;
+}
+
+// Cycles through one more chunk than there are slots, so each access
+// evicts the least recently used chunk, then keeps revisiting a set that
+// fits.
+static int check_eviction(ghost_lazy_t *lazy, const ghost_t *ghost) {
+  int mismatches = 0;
+  ghost_lazy_release(lazy);
+  for (int round = 0; round < 3; round++)
+    for (int c = 0; c <= NUM_SLOTS; c++)
+      mismatches += check_snap(lazy, ghost, c * CHUNK_ITEMS + round);
+
+  for (int round = 0; round < 3; round++)
+    for (int c = NUM_SLOTS; c > 0; c--)
+      mismatches += check_snap(lazy, ghost, c * CHUNK_ITEMS + round);
+
+  return mismatches;
+}
+
+// Overwrites the data of the last snapshot chunk. Every snapshot before it
+// must still read back, including on a sequential pass that runs into the
+// broken chunk.
+static int check_corrupt_tail(const unsigned char *data, size_t size,
+                              const ghost_t *ghost) {
+  int mismatches = 0;
+  size_t last = 0;
+  for (size_t pos = FIRST_SNAP_CHUNK; size - pos >= 4;
+       pos += 4 + ((data[pos + 2] << 8) | data[pos + 3]))
+    if (data[pos] == data[FIRST_SNAP_CHUNK])
+      last = pos;
+  const size_t last_size = (data[last + 2] << 8) | data[last + 3];
+
+  unsigned char *copy = (unsigned char *)malloc(size);
+  memcpy(copy, data, size);
+  memset(copy + last + 4, 0xff, last_size);
+  ghost_lazy_t *lazy = ghost_load_lazy_mem(copy, size);
+  free(copy);
+  if (!lazy) {
+    printf("MISMATCH: ghost with a corrupt last chunk was rejected\n");
+    return 1;
+  }
+
+  const int num_ticks = ghost->path.num_items;
+  const int first_broken = num_ticks - data[last + 1];
+  for (int i = 0; i < first_broken; i++)
+    mismatches += check_snap(lazy, ghost, i);
+  if (ghost_lazy_get_snap(lazy, first_broken) ||
+      ghost_lazy_get_snap(lazy, num_ticks - 1)) {
+    printf("MISMATCH: snapshot of the corrupt chunk was returned\n");
+    mismatches++;
+  }
+  // The failure must not break later reads of good chunks.
+  mismatches += check_snap(lazy, ghost, first_broken - 1);
+  mismatches += check_snap(lazy, ghost, 0);
+  ghost_lazy_free(lazy);
+  return mismatches;
+}
+
+int main(void) {
+  size_t size;
+  unsigned char *data = read_file("run_dead_silence.gho", &size);
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  ghost_lazy_t *lazy = ghost_load_lazy("run_dead_silence.gho");
+  if (!data || !ghost || !lazy) {
+    printf("Ghost file could not be loaded\n");
+    free(data);
+    ghost_free(ghost);
+    ghost_lazy_free(lazy);
+    return 1;
+  }
+
+  int mismatches = check_resident(lazy, ghost, size);
+  mismatches += check_access(lazy, ghost);
+  mismatches += check_eviction(lazy, ghost);
+  mismatches += check_corrupt_tail(data, size, ghost);
+
+  ghost_lazy_free(lazy);
+  ghost_free(ghost);
+  free(data);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Lazy ghost reads match the full load.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in lazy ghost reads.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
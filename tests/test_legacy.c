@@ -0,0 +1,198 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, *size, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+typedef struct decoded_t {
+  int index;
+  int mismatches;
+} decoded_t;
+
+static void on_snap(void *user_data, const ghost_character_t *snap) {
+  decoded_t *decoded = (decoded_t *)user_data;
+  if (snap->tick != decoded->index++)
+    decoded->mismatches++;
+}
+
+// Version 4 files store no ticks: ghost_load derives them from the attack
+// ticks, the reader and the decoder number snapshots from 0 and report the
+// same start tick once the whole file was read.
+static int check_no_tick(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence_v4.gho");
+  if (!ghost) {
+    printf("MISMATCH: version 4 ghost could not be loaded\n");
+    return 1;
+  }
+
+  for (int i = 0; i < ghost->path.num_items; i++) {
+    if (ghost_get_snap(&ghost->path, i)->tick != ghost->start_tick + i) {
+      printf("MISMATCH: loaded tick at %d\n", i);
+      mismatches++;
+      break;
+    }
+  }
+
+  ghost_reader_t *reader = ghost_reader_open("run_dead_silence_v4.gho");
+  if (!reader) {
+    printf("MISMATCH: version 4 ghost could not be opened\n");
+    ghost_free(ghost);
+    return mismatches + 1;
+  }
+  ghost_character_t snap;
+  int index = 0;
+  int status;
+  while ((status = ghost_reader_next(reader, &snap)) == 1) {
+    if (snap.tick != index) {
+      printf("MISMATCH: reader tick at %d (%d)\n", index, snap.tick);
+      mismatches++;
+      break;
+    }
+    index++;
+  }
+  mismatches += expect_int("reader status", status, 0);
+  mismatches += expect_int("reader start_tick",
+                           ghost_reader_meta(reader)->start_tick,
+                           ghost->start_tick);
+  ghost_reader_close(reader);
+
+  size_t size;
+  unsigned char *data = read_file("run_dead_silence_v4.gho", &size);
+  ghost_decoder_t *decoder = NULL;
+  decoded_t decoded = {0, 0};
+  if (data)
+    decoder = ghost_decoder_create(on_snap, &decoded);
+  if (!decoder) {
+    printf("MISMATCH: version 4 ghost could not be decoded\n");
+    mismatches++;
+  } else {
+    for (size_t i = 0; i < size; i++)
+      ghost_decoder_feed(decoder, &data[i], 1);
+    mismatches += expect_int("decoder finish", ghost_decoder_finish(decoder), 0);
+    mismatches += expect_int("decoder start_tick",
+                             ghost_decoder_meta(decoder)->start_tick,
+                             ghost->start_tick);
+    mismatches += expect_int("decoder ticks", decoded.mismatches, 0);
+    ghost_decoder_free(decoder);
+  }
+  free(data);
+
+  ghost_verify_result_t result;
+  if (ghost_verify("run_dead_silence_v4.gho", &result) != 0) {
+    printf("MISMATCH: version 4 ghost does not verify\n");
+    mismatches++;
+  } else {
+    mismatches += expect_int("verify version", result.version, 4);
+    mismatches +=
+        expect_int("verify start_tick", result.start_tick, ghost->start_tick);
+  }
+
+  ghost_free(ghost);
+  return mismatches;
+}
+
+enum { V5_HEADER_SIZE = 101, SHA256_SIZE = 32, CRC_OFFSET = 89 };
+
+// Before version 6 the four bytes this library reads as a Huffman table
+// marker held the map CRC, so they must be ignored there.
+static int check_crc(void) {
+  int mismatches = 0;
+  size_t size;
+  unsigned char *v6 = read_file("run_dead_silence.gho", &size);
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!v6 || !ghost || size < V5_HEADER_SIZE + SHA256_SIZE) {
+    printf("MISMATCH: version 6 ghost could not be read\n");
+    free(v6);
+    ghost_free(ghost);
+    return 1;
+  }
+
+  const size_t v5_size = size - SHA256_SIZE;
+  unsigned char *v5 = (unsigned char *)malloc(v5_size);
+  memcpy(v5, v6, V5_HEADER_SIZE);
+  memcpy(v5 + V5_HEADER_SIZE, v6 + V5_HEADER_SIZE + SHA256_SIZE,
+         size - V5_HEADER_SIZE - SHA256_SIZE);
+  v5[8] = 5;
+  const unsigned char crc[4] = {0xab, 0xcd, 0x12, 0x34};
+  memcpy(v5 + CRC_OFFSET, crc, sizeof(crc));
+
+  ghost_t *loaded = ghost_load_mem(v5, v5_size);
+  if (!loaded) {
+    printf("MISMATCH: version 5 ghost with a CRC could not be loaded\n");
+    mismatches++;
+  } else {
+    mismatches += expect_int("crc num_items", loaded->path.num_items,
+                             ghost->path.num_items);
+    for (int i = 0; i < loaded->path.num_items && i < ghost->path.num_items;
+         i++) {
+      if (memcmp(ghost_get_snap(&loaded->path, i),
+                 ghost_get_snap(&ghost->path, i),
+                 sizeof(ghost_character_t)) != 0) {
+        printf("MISMATCH: crc snapshot %d\n", i);
+        mismatches++;
+        break;
+      }
+    }
+    ghost_free(loaded);
+  }
+
+  ghost_verify_result_t result;
+  if (ghost_verify_mem(v5, v5_size, &result) != 0) {
+    printf("MISMATCH: version 5 ghost with a CRC does not verify (%s)\n",
+           ghost_verify_error_string(result.error));
+    mismatches++;
+  } else if (result.hash != ghost_hash(ghost)) {
+    printf("MISMATCH: version 5 hash differs from version 6\n");
+    mismatches++;
+  }
+
+  ghost_lazy_t *lazy = ghost_load_lazy_mem(v5, v5_size);
+  if (!lazy || !ghost_lazy_get_snap(lazy, ghost->path.num_items - 1)) {
+    printf("MISMATCH: version 5 ghost with a CRC could not be loaded lazily\n");
+    mismatches++;
+  }
+  ghost_lazy_free(lazy);
+
+  free(v5);
+  free(v6);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  mismatches += check_no_tick();
+  mismatches += check_crc();
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Old ghost versions are read consistently.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) reading old ghost versions.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
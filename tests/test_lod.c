@@ -0,0 +1,279 @@
+#include <ddnet_ghost/ghost_lod.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { NUM_LEVELS = 8 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static double segment_distance(const ghost_character_t *p,
+                               const ghost_character_t *a,
+                               const ghost_character_t *b) {
+  const double abx = (double)b->x - a->x;
+  const double aby = (double)b->y - a->y;
+  const double apx = (double)p->x - a->x;
+  const double apy = (double)p->y - a->y;
+  const double len2 = abx * abx + aby * aby;
+  double t = len2 > 0.0 ? (apx * abx + apy * aby) / len2 : 0.0;
+  t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+  const double dx = apx - t * abx;
+  const double dy = apy - t * aby;
+  return sqrt(dx * dx + dy * dy);
+}
+
+// Plain recursive Douglas-Peucker: marks the snapshots between `first` and
+// `last` that are kept at `tolerance`.
+static void simplify(const ghost_path_t *path, int first, int last,
+                     float tolerance, char *keep) {
+  if (last - first < 2)
+    return;
+  int split = -1;
+  float max_dist = -1.0f;
+  for (int i = first + 1; i < last; i++) {
+    const float dist = (float)segment_distance(ghost_get_snap(path, i),
+                                               ghost_get_snap(path, first),
+                                               ghost_get_snap(path, last));
+    if (dist > max_dist) {
+      max_dist = dist;
+      split = i;
+    }
+  }
+  if (max_dist <= tolerance)
+    return;
+  keep[split] = 1;
+  simplify(path, first, split, tolerance, keep);
+  simplify(path, split, last, tolerance, keep);
+}
+
+static int check_level(const char *name, const ghost_path_t *path,
+                       const ghost_lod_level_t *level, int index,
+                       float base_error) {
+  int mismatches = 0;
+  const int num_items = path->num_items;
+  const float wanted_error =
+      index == 0 ? 0.0f : base_error * (float)(1 << (index - 1));
+  if (level->max_error != wanted_error) {
+    printf("MISMATCH: %s level %d has error %g, wanted %g\n", name, index,
+           level->max_error, wanted_error);
+    mismatches++;
+  }
+
+  char *keep = (char *)calloc(num_items ? num_items : 1, 1);
+  if (index == 0) {
+    memset(keep, 1, num_items);
+  } else if (num_items > 0) {
+    keep[0] = 1;
+    keep[num_items - 1] = 1;
+    simplify(path, 0, num_items - 1, level->max_error, keep);
+  }
+  int num_kept = 0;
+  for (int i = 0; i < num_items; i++)
+    num_kept += keep[i];
+  mismatches += expect_int("level size", level->num_points, num_kept);
+
+  // The points are the kept snapshots, unchanged and in order, and every
+  // snapshot between two of them lies within the error bound of the
+  // segment joining them.
+  int point = 0;
+  for (int i = 0; i < num_items && point < level->num_points; i++) {
+    const ghost_character_t *snap = ghost_get_snap(path, i);
+    if (!keep[i])
+      continue;
+    const ghost_lod_point_t *p = &level->points[point++];
+    if (p->x != snap->x || p->y != snap->y || p->tick != snap->tick) {
+      printf("MISMATCH: %s level %d point %d is (%d, %d) at %d, wanted "
+             "snapshot %d (%d, %d) at %d\n",
+             name, index, point - 1, p->x, p->y, p->tick, i, snap->x,
+             snap->y, snap->tick);
+      mismatches++;
+      break;
+    }
+  }
+
+  int last_kept = 0;
+  for (int i = 1; i < num_items; i++) {
+    if (!keep[i])
+      continue;
+    const ghost_character_t *a = ghost_get_snap(path, last_kept);
+    const ghost_character_t *b = ghost_get_snap(path, i);
+    for (int j = last_kept + 1; j < i; j++) {
+      const double dist = segment_distance(ghost_get_snap(path, j), a, b);
+      if (dist > level->max_error + 1e-3) {
+        printf("MISMATCH: %s level %d leaves snapshot %d %g units away, "
+               "allowed %g\n",
+               name, index, j, dist, level->max_error);
+        mismatches++;
+        break;
+      }
+    }
+    last_kept = i;
+  }
+  free(keep);
+  return mismatches;
+}
+
+static int check_lod(const char *name, const ghost_path_t *path,
+                     const ghost_lod_t *lod, float base_error) {
+  if (!lod) {
+    printf("MISMATCH: %s pyramid could not be built\n", name);
+    return 1;
+  }
+  int mismatches = expect_int("levels", lod->num_levels, NUM_LEVELS);
+  for (int i = 0; i < lod->num_levels; i++) {
+    const ghost_lod_level_t *level = &lod->levels[i];
+    mismatches += check_level(name, path, level, i, base_error);
+    if (path->num_items > 0 && level->num_points > 0) {
+      const ghost_lod_point_t *first = &level->points[0];
+      const ghost_lod_point_t *last = &level->points[level->num_points - 1];
+      mismatches += expect_int("first tick", first->tick,
+                               ghost_get_snap(path, 0)->tick);
+      mismatches +=
+          expect_int("last tick", last->tick,
+                     ghost_get_snap(path, path->num_items - 1)->tick);
+    }
+    if (i > 0 && level->num_points > lod->levels[i - 1].num_points) {
+      printf("MISMATCH: %s level %d has more points than level %d\n", name, i,
+             i - 1);
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+static int equal_lods(const ghost_lod_t *a, const ghost_lod_t *b) {
+  if (!a || !b || a->num_levels != b->num_levels)
+    return 0;
+  for (int i = 0; i < a->num_levels; i++) {
+    const ghost_lod_level_t *la = &a->levels[i];
+    const ghost_lod_level_t *lb = &b->levels[i];
+    if (la->max_error != lb->max_error || la->num_points != lb->num_points ||
+        memcmp(la->points, lb->points,
+               la->num_points * sizeof(ghost_lod_point_t)) != 0)
+      return 0;
+  }
+  return 1;
+}
+
+// A spiral sampled with small wobbles, straight runs with collinear and
+// repeated points, and a jump back to the start.
+static ghost_t *create_spiral(void) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  int tick = 0;
+  for (int i = 0; i < 400; i++) {
+    const double angle = i * 0.05;
+    snap.x = (int)lround(cos(angle) * (200 + i * 5)) + (i % 7) - 3;
+    snap.y = (int)lround(sin(angle) * (200 + i * 5)) + (i % 5) - 2;
+    snap.tick = tick++;
+    ghost_add_snap(ghost, &snap);
+  }
+  for (int i = 0; i < 100; i++) {
+    snap.x += i < 50 ? 32 : 0;
+    snap.tick = tick++;
+    ghost_add_snap(ghost, &snap);
+  }
+  snap.x = 0;
+  snap.y = 0;
+  snap.tick = tick;
+  ghost_add_snap(ghost, &snap);
+  return ghost;
+}
+
+static int check_file(const char *filename, float base_error) {
+  ghost_t *ghost = ghost_load(filename);
+  ghost_reader_t *reader = ghost_reader_open(filename);
+  if (!ghost || !reader) {
+    printf("MISMATCH: %s could not be loaded\n", filename);
+    ghost_free(ghost);
+    ghost_reader_close(reader);
+    return 1;
+  }
+  ghost_lod_t *lod = ghost_lod_build(&ghost->path, base_error, NUM_LEVELS);
+  ghost_lod_t *streamed =
+      ghost_lod_build_from_reader(reader, base_error, NUM_LEVELS);
+  int mismatches = check_lod(filename, &ghost->path, lod, base_error);
+  if (!equal_lods(lod, streamed)) {
+    printf("MISMATCH: %s pyramid from the reader differs\n", filename);
+    mismatches++;
+  }
+  ghost_lod_free(streamed);
+  ghost_lod_free(lod);
+  ghost_reader_close(reader);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+static int check_pick(void) {
+  int mismatches = 0;
+  ghost_t *ghost = create_spiral();
+  ghost_lod_t *lod = ghost_lod_build(&ghost->path, 2.0f, NUM_LEVELS);
+  // Errors 0, 2, 4, ..., 128.
+  mismatches += expect_int("pick below the base",
+                           (int)(ghost_lod_pick(lod, 1.0f) - lod->levels), 0);
+  mismatches += expect_int("pick exact",
+                           (int)(ghost_lod_pick(lod, 8.0f) - lod->levels), 3);
+  mismatches += expect_int("pick between",
+                           (int)(ghost_lod_pick(lod, 20.0f) - lod->levels), 4);
+  mismatches += expect_int("pick above the top",
+                           (int)(ghost_lod_pick(lod, 1e6f) - lod->levels),
+                           NUM_LEVELS - 1);
+  mismatches += expect_int("pick NULL", ghost_lod_pick(NULL, 1.0f) == NULL, 1);
+  ghost_lod_free(lod);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *spiral = create_spiral();
+  const float errors[] = {0.0f, 0.5f, 3.0f, 25.0f};
+  for (int i = 0; i < 4; i++) {
+    ghost_lod_t *lod = ghost_lod_build(&spiral->path, errors[i], NUM_LEVELS);
+    mismatches += check_lod("spiral", &spiral->path, lod, errors[i]);
+    ghost_lod_free(lod);
+  }
+  ghost_free(spiral);
+
+  // Paths too short to simplify.
+  ghost_t *short_ghost = ghost_create();
+  for (int n = 0; n < 3; n++) {
+    ghost_lod_t *lod = ghost_lod_build(&short_ghost->path, 4.0f, NUM_LEVELS);
+    mismatches += check_lod("short path", &short_ghost->path, lod, 4.0f);
+    ghost_lod_free(lod);
+    ghost_character_t snap = {0};
+    snap.x = n * 100;
+    snap.y = n * n * 50;
+    snap.tick = n;
+    ghost_add_snap(short_ghost, &snap);
+  }
+  mismatches += expect_int("no levels",
+                           ghost_lod_build(&short_ghost->path, 1.0f, 0) ==
+                               NULL,
+                           1);
+  mismatches += expect_int("negative error",
+                           ghost_lod_build(&short_ghost->path, -1.0f, 2) ==
+                               NULL,
+                           1);
+  ghost_free(short_ghost);
+
+  mismatches += check_file("run_dead_silence.gho", 1.0f);
+  mismatches += check_file("run_dead_silence.gho", 16.0f);
+  mismatches += check_file("run_dead_silence_v4.gho", 4.0f);
+  mismatches += check_pick();
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Every level stays within its error bound.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in the level pyramids.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,143 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_pack.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *const pack_name = "written_pack.gpk";
+
+// Bytes per index entry, and the file header plus trailer.
+enum { ENTRY_SIZE = 104, OVERHEAD = 16 + 24, NUM_APPENDS = 300 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static long file_size(const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+// Adds the test ghost under a different player name and time.
+static int add_ghost(ghost_pack_writer_t *writer, ghost_t *ghost, int n) {
+  char player[32];
+  snprintf(player, sizeof(player), "player%d", n);
+  snprintf(ghost->player, sizeof(ghost->player), "%.*s",
+           (int)sizeof(ghost->player) - 1, player);
+  ghost->time = 10000 + n;
+  if (ghost_save(ghost, "written_ghost.gho") != 0)
+    return -1;
+  return ghost_pack_writer_add_file(writer, "written_ghost.gho");
+}
+
+static int add_ghosts(ghost_t *ghost, int first, int count) {
+  ghost_pack_writer_t *writer = ghost_pack_writer_open(pack_name);
+  if (!writer)
+    return -1;
+  int result = 0;
+  for (int n = first; n < first + count; n++)
+    result |= add_ghost(writer, ghost, n);
+  return ghost_pack_writer_close(writer) | result;
+}
+
+// Every ghost added so far must be found and load completely.
+static int check_pack(const char *what, const ghost_t *ghost, int count) {
+  ghost_pack_t *pack = ghost_pack_open(pack_name);
+  if (!pack) {
+    printf("MISMATCH: %s: pack could not be opened\n", what);
+    return 1;
+  }
+  int mismatches = 0;
+  mismatches += expect_int(what, ghost_pack_count(pack), count);
+  for (int n = 0; n < count; n++) {
+    char player[32];
+    snprintf(player, sizeof(player), "player%d", n);
+    const int index = ghost_pack_find(pack, ghost->map, player, 10000 + n);
+    ghost_t *loaded = index >= 0 ? ghost_pack_load(pack, index) : NULL;
+    if (!loaded || loaded->path.num_items != ghost->path.num_items) {
+      printf("MISMATCH: %s: ghost of %s\n", what, player);
+      mismatches++;
+    }
+    ghost_free(loaded);
+  }
+  ghost_pack_close(pack);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  remove(pack_name);
+
+  mismatches += expect_int("create", add_ghosts(ghost, 0, 3), 0);
+  mismatches += check_pack("created pack", ghost, 3);
+
+  mismatches += expect_int("append", add_ghosts(ghost, 3, 2), 0);
+  mismatches += check_pack("appended pack", ghost, 5);
+
+  // Opening and closing without adding anything leaves the file alone.
+  const long size = file_size(pack_name);
+  ghost_pack_writer_close(ghost_pack_writer_open(pack_name));
+  mismatches += expect_int("unchanged size", (int)file_size(pack_name),
+                           (int)size);
+
+  // An append that dies after writing ghost data but before its index.
+  // It is larger than the blocks the writer searches backwards in.
+  FILE *file = fopen(pack_name, "ab");
+  const char partial[] = "TWGHOST partial ghost data TWGPIDX";
+  for (int i = 0; i < 5000; i++)
+    fwrite(partial, sizeof(partial), 1, file);
+  fclose(file);
+  mismatches += check_pack("interrupted pack", ghost, 5);
+
+  mismatches += expect_int("append after interruption",
+                           add_ghosts(ghost, 5, 1), 0);
+  mismatches += check_pack("recovered pack", ghost, 6);
+
+  // One ghost per append leaves an old index behind each time. Without
+  // compacting, that dead space would outgrow the ghosts after about 80
+  // appends.
+  const long ghost_size = file_size("written_ghost.gho");
+  int num_too_large = 0;
+  for (int n = 6; n < NUM_APPENDS; n++) {
+    mismatches += expect_int("single append", add_ghosts(ghost, n, 1), 0);
+    const long compact_size = (n + 1) * (ghost_size + ENTRY_SIZE) + OVERHEAD;
+    num_too_large += file_size(pack_name) > 2 * compact_size;
+  }
+  mismatches += expect_int("packs above twice their size", num_too_large, 0);
+  mismatches += check_pack("compacted by appends", ghost, NUM_APPENDS);
+
+  // Compacting explicitly leaves no dead space at all.
+  mismatches += expect_int("compact", ghost_pack_compact(pack_name), 0);
+  mismatches +=
+      expect_int("compacted size", (int)file_size(pack_name),
+                 (int)(NUM_APPENDS * (ghost_size + ENTRY_SIZE) + OVERHEAD));
+  mismatches += check_pack("compacted pack", ghost, NUM_APPENDS);
+  mismatches += expect_int("no temporary file",
+                           (int)file_size("written_pack.gpk.tmp"), -1);
+  mismatches += expect_int("compact missing pack",
+                           ghost_pack_compact("missing_pack.gpk"), -1);
+
+  ghost_free(ghost);
+  remove(pack_name);
+  remove("written_ghost.gho");
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Packs survive appends and interrupted writes.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in pack contents.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
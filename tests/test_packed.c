@@ -0,0 +1,118 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+// Unpacks the whole path, a range starting in the middle and single
+// snapshots, and compares them with the original.
+static int check_round_trip(const char *name, const ghost_t *ghost,
+                            const ghost_packed_path_t *packed) {
+  const int num_items = ghost->path.num_items;
+  int mismatches =
+      expect_int(name, ghost_packed_path_num_items(packed), num_items);
+  ghost_character_t *out = (ghost_character_t *)malloc(
+      (num_items > 0 ? num_items : 1) * sizeof(ghost_character_t));
+  const int first = num_items / 3;
+  if (ghost_packed_path_unpack(packed, 0, num_items, out) != 0 ||
+      ghost_packed_path_unpack(packed, first, num_items - first,
+                               out + first) != 0) {
+    printf("MISMATCH: %s could not be unpacked\n", name);
+    free(out);
+    return mismatches + 1;
+  }
+  for (int i = 0; i < num_items; i++) {
+    ghost_character_t single;
+    const ghost_character_t *snap = ghost_get_snap(&ghost->path, i);
+    if (memcmp(&out[i], snap, sizeof(*snap)) != 0 ||
+        ghost_packed_path_get(packed, i, &single) != 0 ||
+        memcmp(&single, snap, sizeof(*snap)) != 0) {
+      printf("MISMATCH: %s differs at snapshot %d (tick %d != %d)\n", name, i,
+             single.tick, snap->tick);
+      mismatches++;
+      break;
+    }
+  }
+  free(out);
+  return mismatches;
+}
+
+static ghost_t *create_ghost(int num_ticks, int gap_every, int gap,
+                             int attack_every) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  int tick = 1000;
+  for (int i = 0; i < num_ticks; i++) {
+    if (gap_every > 0 && i > 0 && i % gap_every == 0)
+      tick += gap;
+    snap.x = 5000 + i * 3;
+    snap.y = 2000 - i % 700;
+    snap.vel_x = (i % 50) * 20;
+    snap.angle = i % 1600 - 800;
+    snap.direction = i % 3 - 1;
+    snap.hook_state = i % 5 - 1;
+    snap.hook_x = snap.x + 120;
+    snap.hook_y = snap.y - 80;
+    snap.attack_tick = tick - tick % attack_every;
+    snap.tick = tick++;
+    ghost_add_snap(ghost, &snap);
+  }
+  return ghost;
+}
+
+static int check_ghost(const char *name, ghost_t *ghost, size_t max_bytes) {
+  ghost_packed_path_t *packed = ghost_packed_path_create(&ghost->path);
+  if (!packed) {
+    printf("MISMATCH: %s could not be packed\n", name);
+    ghost_free(ghost);
+    return 1;
+  }
+  int mismatches = check_round_trip(name, ghost, packed);
+  const size_t bytes = ghost_packed_path_bytes(packed);
+  if (bytes > max_bytes) {
+    printf("MISMATCH: %s packs into %zu bytes, wanted at most %zu\n", name,
+           bytes, max_bytes);
+    mismatches++;
+  }
+  ghost_packed_path_free(packed);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  const size_t record = 24;
+
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  const int num_ticks = ghost->path.num_items;
+  mismatches += check_ghost("run_dead_silence", ghost, num_ticks * record * 2);
+
+  // One 200-tick gap must cost a single escape, not every later snapshot.
+  mismatches += check_ghost("one gap", create_ghost(10000, 5000, 200, 10),
+                            10000 * record + 16384);
+  // Small gaps add up past the range of a packed tick offset.
+  mismatches += check_ghost("small gaps", create_ghost(10000, 10, 5, 10),
+                            10000 * record + 16384);
+  // More attack runs than 16 bits can count.
+  mismatches += check_ghost("attack runs", create_ghost(140000, 0, 0, 1),
+                            140000 * (record + sizeof(int)) + 4096);
+  mismatches += check_ghost("empty", ghost_create(), 4096);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Packed paths unpack to the original snapshots.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in packed paths.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,173 @@
+#include <ddnet_ghost/ghost_resample.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { NUM_JOBS = 8, SPARE_FRAMES = 4 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+// Ticks with a gap and a run two apart.
+static ghost_t *create_gappy_ghost(void) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  int tick = 500;
+  for (int i = 0; i < 120; i++) {
+    snap.x = i * 37 - 1000;
+    snap.y = i * i - 300;
+    snap.vel_x = i * 13;
+    snap.angle = (i * 91) % 1600 - 400;
+    snap.tick = tick;
+    ghost_add_snap(ghost, &snap);
+    tick += i == 30 ? 40 : i > 60 && i < 90 ? 2 : 1;
+  }
+  return ghost;
+}
+
+static ghost_t *create_single_snap_ghost(void) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  snap.x = 123;
+  snap.y = -456;
+  snap.tick = 77;
+  ghost_add_snap(ghost, &snap);
+  return ghost;
+}
+
+// Two snapshots further apart than an int can count.
+static int check_wide_gap(void) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  snap.tick = -2147483000;
+  ghost_add_snap(ghost, &snap);
+  snap.x = 1000;
+  snap.tick = 2147483000;
+  ghost_add_snap(ghost, &snap);
+
+  int mismatches = 0;
+  const float rate = 0.001f;
+  const int num_frames = ghost_resample(&ghost->path, rate, NULL, 0);
+  ghost_character_t *frames = (ghost_character_t *)malloc(
+      (num_frames > 0 ? num_frames : 1) * sizeof(ghost_character_t));
+  mismatches += expect_int("wide gap frames",
+                           ghost_resample(&ghost->path, rate, frames,
+                                          num_frames),
+                           num_frames);
+  const double step = GHOST_TICKS_PER_SECOND / (double)rate;
+  for (int i = 0; i < num_frames; i++) {
+    const double wanted = 1000.0 * i * step / 4294966000.0;
+    if (fabs(frames[i].x - wanted) > 1.0) {
+      printf("MISMATCH: wide gap frame %d has x %d, wanted %g\n", i,
+             frames[i].x, wanted);
+      mismatches++;
+      break;
+    }
+  }
+  free(frames);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// Runs the batch on `num_threads` threads and compares each job with a
+// ghost_resample call of its own. Buffers get spare frames filled with a
+// marker, so writes past max_frames show up.
+static int check_batch(const ghost_path_t *const *paths, const int *limits,
+                       float rate, int num_threads) {
+  int mismatches = 0;
+  ghost_resample_job_t jobs[NUM_JOBS];
+  ghost_character_t *single[NUM_JOBS];
+  int num_single[NUM_JOBS];
+  int num_ok = 0;
+  for (int i = 0; i < NUM_JOBS; i++) {
+    const int needed = paths[i] ? ghost_resample(paths[i], rate, NULL, 0) : 0;
+    const int max_frames =
+        limits[i] >= 0 ? limits[i] : needed > 0 ? needed : 0;
+    const size_t bytes =
+        (max_frames + SPARE_FRAMES) * sizeof(ghost_character_t);
+    jobs[i].path = paths[i];
+    jobs[i].out = (ghost_character_t *)malloc(bytes);
+    jobs[i].max_frames = max_frames;
+    jobs[i].num_frames = -2;
+    memset(jobs[i].out, 0x5a, bytes);
+    single[i] = (ghost_character_t *)malloc(bytes);
+    memset(single[i], 0x5a, bytes);
+    num_single[i] =
+        paths[i] ? ghost_resample(paths[i], rate, single[i], max_frames) : -1;
+    num_ok += num_single[i] >= 0;
+  }
+
+  const int num_done =
+      ghost_resample_paths(jobs, NUM_JOBS, rate, num_threads);
+  mismatches += expect_int("jobs done", num_done, num_ok);
+  for (int i = 0; i < NUM_JOBS; i++) {
+    const size_t bytes =
+        (jobs[i].max_frames + SPARE_FRAMES) * sizeof(ghost_character_t);
+    if (jobs[i].num_frames != num_single[i] ||
+        memcmp(jobs[i].out, single[i], bytes) != 0) {
+      printf("MISMATCH: job %d at %g fps on %d threads gave %d frames, a "
+             "single call %d\n",
+             i, rate, num_threads, jobs[i].num_frames, num_single[i]);
+      mismatches++;
+    }
+    free(jobs[i].out);
+    free(single[i]);
+  }
+  return mismatches;
+}
+
+int main(void) {
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  ghost_t *legacy = ghost_load("run_dead_silence_v4.gho");
+  if (!ghost || !legacy) {
+    printf("Ghost file could not be loaded\n");
+    ghost_free(ghost);
+    ghost_free(legacy);
+    return 1;
+  }
+  ghost_t *empty = ghost_create();
+  ghost_t *single = create_single_snap_ghost();
+  ghost_t *gappy = create_gappy_ghost();
+
+  // -1 sizes the buffer for all frames; a smaller limit truncates the
+  // output, and a NULL path fails.
+  const ghost_path_t *paths[NUM_JOBS] = {
+      &ghost->path, &empty->path, &single->path, &gappy->path,
+      &legacy->path, &ghost->path, NULL, &gappy->path};
+  const int limits[NUM_JOBS] = {-1, -1, -1, -1, -1, 100, -1, 0};
+
+  int mismatches = 0;
+  const float rates[] = {50.0f, 60.0f, 144.0f, 7.5f};
+  const int threads[] = {1, 3, 0};
+  for (int r = 0; r < 4; r++)
+    for (int t = 0; t < 3; t++)
+      mismatches += check_batch(paths, limits, rates[r], threads[t]);
+
+  mismatches += expect_int("empty path",
+                           ghost_resample(&empty->path, 60.0f, NULL, 0), 0);
+  mismatches += expect_int(
+      "single snapshot", ghost_resample(&single->path, 60.0f, NULL, 0), 1);
+  mismatches += check_wide_gap();
+  mismatches += expect_int("NULL jobs",
+                           ghost_resample_paths(NULL, 0, 60.0f, 1), -1);
+
+  ghost_free(gappy);
+  ghost_free(single);
+  ghost_free(empty);
+  ghost_free(legacy);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Batch resampling matches single calls.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in batch resampling.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
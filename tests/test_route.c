@@ -0,0 +1,107 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_route.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { NUM_ROUTES = 2000, K = 5 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static uint32_t next_random(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+// Clusters of 20 routes around 100 base shapes, 10 to 40 units apart.
+static void create_routes(ghost_route_t *routes) {
+  uint32_t state = 1234;
+  for (int i = 0; i < NUM_ROUTES; i++) {
+    ghost_route_t *route = &routes[i];
+    const int base = i / 20;
+    for (int p = 0; p < GHOST_ROUTE_POINTS; p++) {
+      route->x[p] = base * 3000.0f + p * 100.0f +
+                    (float)(next_random(&state) % 40) - 20.0f;
+      route->y[p] = (base % 7) * 500.0f + p * (base % 5) * 30.0f +
+                    (float)(next_random(&state) % 40) - 20.0f;
+    }
+    route->length = 3100.0f;
+    route->num_ticks = 1000;
+  }
+}
+
+// Every route must find itself first; the rest of its neighbours must be
+// the same whether the index was built or not.
+static int check_queries(const char *name, const ghost_route_index_t *index,
+                         const ghost_route_t *routes, int num_routes,
+                         int (*wanted)[K]) {
+  for (int i = 0; i < num_routes; i++) {
+    int ids[K];
+    float distances[K];
+    const int count =
+        ghost_route_index_query(index, &routes[i], K, ids, distances);
+    if (count != K || ids[0] != i || distances[0] != 0.0f) {
+      printf("MISMATCH: %s query %d returned %d ids, first %d\n", name, i,
+             count, count > 0 ? ids[0] : -1);
+      return 1;
+    }
+    for (int j = 0; wanted && j < K; j++) {
+      if (ids[j] != wanted[i][j]) {
+        printf("MISMATCH: %s neighbour %d of route %d (%d != %d)\n", name, j,
+               i, ids[j], wanted[i][j]);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_route_t *routes =
+      (ghost_route_t *)malloc(NUM_ROUTES * sizeof(ghost_route_t));
+  int(*neighbours)[K] = (int(*)[K])malloc(NUM_ROUTES * sizeof(*neighbours));
+  create_routes(routes);
+
+  // Queries before the first build scan the unsorted entries.
+  ghost_route_index_t *index = ghost_route_index_create(0.0f);
+  for (int i = 0; i < NUM_ROUTES; i++)
+    mismatches +=
+        expect_int("add", ghost_route_index_add(index, &routes[i]), i);
+  mismatches += check_queries("unbuilt", index, routes, NUM_ROUTES, NULL);
+  for (int i = 0; i < NUM_ROUTES; i++)
+    ghost_route_index_query(index, &routes[i], K, neighbours[i], NULL);
+
+  mismatches += expect_int("build", ghost_route_index_build(index), 0);
+  mismatches += check_queries("built", index, routes, NUM_ROUTES, neighbours);
+  ghost_route_index_free(index);
+
+  // Half built, half added afterwards.
+  index = ghost_route_index_create(0.0f);
+  for (int i = 0; i < NUM_ROUTES; i++) {
+    ghost_route_index_add(index, &routes[i]);
+    if (i == NUM_ROUTES / 2)
+      ghost_route_index_build(index);
+  }
+  mismatches += check_queries("partly built", index, routes, NUM_ROUTES,
+                              neighbours);
+  mismatches += expect_int("size", ghost_route_index_size(index), NUM_ROUTES);
+  ghost_route_index_free(index);
+
+  mismatches += expect_int("build NULL", ghost_route_index_build(NULL), -1);
+  free(neighbours);
+  free(routes);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Route queries agree before and after building.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in route queries.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
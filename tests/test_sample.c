@@ -0,0 +1,205 @@
+#include <ddnet_ghost/ghost.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { NUM_SNAPS = 200 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+// Contiguous ticks, a 200-tick gap, ticks two apart and contiguous ticks
+// again, spread over several chunks.
+static ghost_t *create_ghost(void) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  int tick = 1000;
+  for (int i = 0; i < NUM_SNAPS; i++) {
+    snap.x = i * 100;
+    snap.y = -i * 10;
+    snap.vel_x = i;
+    snap.angle = (i * 37) % 1600;
+    snap.weapon = i % 5;
+    snap.tick = tick;
+    ghost_add_snap(ghost, &snap);
+    tick += i == 59 ? 200 : i >= 60 && i < 120 ? 2 : 1;
+  }
+  return ghost;
+}
+
+// Index of the last snapshot at or before `tick`, found by scanning.
+static int scan_tick_index(const ghost_t *ghost, int tick) {
+  int index = -1;
+  for (int i = 0; i < ghost->path.num_items; i++) {
+    if (ghost_get_snap(&ghost->path, i)->tick <= tick)
+      index = i;
+  }
+  const ghost_character_t *last =
+      ghost_get_snap(&ghost->path, ghost->path.num_items - 1);
+  return tick > last->tick ? -1 : index;
+}
+
+static int check_lookup(const char *name, ghost_t *ghost,
+                        ghost_cursor_t *cursor, int tick) {
+  const int index = scan_tick_index(ghost, tick);
+  const ghost_character_t *wanted =
+      index >= 0 ? ghost_get_snap(&ghost->path, index) : NULL;
+  const ghost_character_t *got = ghost_get_snap_at_tick(ghost, tick);
+  const ghost_character_t *got_cursor =
+      ghost_cursor_snap_at_tick(cursor, tick);
+  if (got == wanted && got_cursor == wanted)
+    return 0;
+  printf("MISMATCH: %s lookup of tick %d (wanted snapshot %d)\n", name, tick,
+         index);
+  return 1;
+}
+
+// Looks every tick up forwards, backwards and in a scrambled order, so
+// the playback position is reused, stepped and jumped across the gaps.
+static int check_lookups(ghost_t *ghost) {
+  const int first = ghost_get_snap(&ghost->path, 0)->tick;
+  const int last = ghost_get_snap(&ghost->path, NUM_SNAPS - 1)->tick;
+  const int num_ticks = last - first + 21;
+  int mismatches = 0;
+  ghost_cursor_t cursor;
+  ghost_cursor_init(&cursor, ghost);
+  for (int t = 0; t < num_ticks && !mismatches; t++)
+    mismatches += check_lookup("forward", ghost, &cursor, first - 10 + t);
+  for (int t = num_ticks - 1; t >= 0 && !mismatches; t--)
+    mismatches += check_lookup("backward", ghost, &cursor, first - 10 + t);
+  uint32_t state = 99;
+  for (int t = 0; t < 2000 && !mismatches; t++) {
+    state = state * 1664525u + 1013904223u;
+    mismatches += check_lookup("scrambled", ghost, &cursor,
+                               first - 10 + (int)((state >> 8) % num_ticks));
+  }
+  return mismatches;
+}
+
+static int check_samples(ghost_t *ghost) {
+  int mismatches = 0;
+  ghost_character_t out;
+  const ghost_character_t *before_gap = ghost_get_snap(&ghost->path, 59);
+  const ghost_character_t *after_gap = ghost_get_snap(&ghost->path, 60);
+
+  // Whole ticks give the snapshot itself.
+  mismatches += expect_int(
+      "whole tick", ghost_sample(ghost, (float)before_gap->tick, &out), 0);
+  mismatches += expect_int("whole tick x", out.x, before_gap->x);
+
+  // A quarter of the way across the gap.
+  const float tick = before_gap->tick + 50.25f;
+  mismatches += expect_int("gap", ghost_sample(ghost, tick, &out), 0);
+  const double amount = (tick - before_gap->tick) / 200.0;
+  mismatches += expect_int(
+      "gap x", out.x,
+      (int)lround(before_gap->x + (after_gap->x - before_gap->x) * amount));
+  mismatches += expect_int(
+      "gap y", out.y,
+      (int)lround(before_gap->y + (after_gap->y - before_gap->y) * amount));
+  mismatches += expect_int("gap weapon", out.weapon, before_gap->weapon);
+  mismatches += expect_int("gap tick", out.tick, before_gap->tick);
+
+  // Between two snapshots two ticks apart.
+  const ghost_character_t *spread = ghost_get_snap(&ghost->path, 80);
+  mismatches += expect_int(
+      "spread", ghost_sample(ghost, spread->tick + 1.0f, &out), 0);
+  mismatches += expect_int("spread x", out.x, spread->x + 50);
+
+  // Outside the ghost and at invalid ticks.
+  const int last = ghost_get_snap(&ghost->path, NUM_SNAPS - 1)->tick;
+  mismatches += expect_int("before", ghost_sample(ghost, 999.5f, &out), -1);
+  mismatches +=
+      expect_int("after", ghost_sample(ghost, last + 1.0f, &out), -1);
+  // Within the last tick the last snapshot is held.
+  mismatches += expect_int("last", ghost_sample(ghost, last + 0.5f, &out), 0);
+  mismatches += expect_int("last x", out.x, (NUM_SNAPS - 1) * 100);
+  mismatches += expect_int("nan", ghost_sample(ghost, NAN, &out), -1);
+  mismatches += expect_int("huge", ghost_sample(ghost, 1e20f, &out), -1);
+  return mismatches;
+}
+
+// Aim angles turn the short way across the -pi/2 and 3pi/2 seam.
+static int check_angle_wrap(void) {
+  const int angles[4][2] = {{1600, 10}, {10, 1600}, {-400, 1200}, {0, 800}};
+  const int wanted[4] = {1609, 1, -404, 400};
+  int mismatches = 0;
+  for (int i = 0; i < 4; i++) {
+    ghost_t *ghost = ghost_create();
+    ghost_character_t snap = {0};
+    snap.angle = angles[i][0];
+    snap.tick = 50;
+    ghost_add_snap(ghost, &snap);
+    snap.angle = angles[i][1];
+    snap.tick = 52;
+    ghost_add_snap(ghost, &snap);
+
+    ghost_character_t out;
+    ghost_cursor_t cursor;
+    ghost_cursor_init(&cursor, ghost);
+    mismatches +=
+        expect_int("angle sample", ghost_sample(ghost, 51.0f, &out), 0);
+    mismatches += expect_int("angle", out.angle, wanted[i]);
+    mismatches += expect_int("cursor angle sample",
+                             ghost_cursor_sample(&cursor, 51.0f, &out), 0);
+    mismatches += expect_int("cursor angle", out.angle, wanted[i]);
+    ghost_free(ghost);
+  }
+  return mismatches;
+}
+
+// Ticks that do not fit a float, and a gap wider than an int.
+static int check_large_ticks(void) {
+  const int ticks[2][2] = {{16777217, 16777219}, {-2147483000, 2147483000}};
+  const float samples[2] = {16777218.0f, 0.0f};
+  int mismatches = 0;
+  for (int i = 0; i < 2; i++) {
+    ghost_t *ghost = ghost_create();
+    ghost_character_t snap = {0};
+    snap.tick = ticks[i][0];
+    ghost_add_snap(ghost, &snap);
+    snap.x = 1000;
+    snap.y = -1000;
+    snap.tick = ticks[i][1];
+    ghost_add_snap(ghost, &snap);
+
+    ghost_character_t out;
+    mismatches += expect_int("large tick sample",
+                             ghost_sample(ghost, samples[i], &out), 0);
+    mismatches += expect_int("large tick x", out.x, 500);
+    mismatches += expect_int("large tick y", out.y, -500);
+    ghost_free(ghost);
+  }
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *ghost = create_ghost();
+  mismatches += check_lookups(ghost);
+  mismatches += check_samples(ghost);
+  ghost_free(ghost);
+  mismatches += check_angle_wrap();
+  mismatches += check_large_ticks();
+
+  ghost_t *empty = ghost_create();
+  ghost_character_t out;
+  mismatches +=
+      expect_int("empty lookup", ghost_get_snap_at_tick(empty, 0) == NULL, 1);
+  mismatches +=
+      expect_int("empty sample", ghost_sample(empty, 0.0f, &out), -1);
+  ghost_free(empty);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Tick lookups and samples match the path.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in tick lookups.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,294 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Long enough for the scan to cross several blocks of 256 snapshots.
+enum { NUM_SNAPS = 600, FIRST_TICK = 1000, MAX_RANGES = 32 };
+enum { HOOK_IDLE = 0, HOOK_RETRACT_START = 1 };
+
+static const char *const filename = "scan_ghost.gho";
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+// A tee running right at 100 units per tick, with matching velocity.
+static ghost_t *create_clean_ghost(void) {
+  ghost_t *ghost = ghost_create();
+  ghost->time = NUM_SNAPS * 20;
+  ghost_character_t snap = {0};
+  for (int i = 0; i < NUM_SNAPS; i++) {
+    snap.x = i * 100;
+    snap.y = 500;
+    snap.vel_x = 100 * 256;
+    snap.hook_state = HOOK_IDLE;
+    snap.tick = FIRST_TICK + i;
+    ghost_add_snap(ghost, &snap);
+  }
+  return ghost;
+}
+
+static ghost_character_t *snap_at(ghost_t *ghost, int index) {
+  return ghost_get_snap(&ghost->path, index);
+}
+
+static int tick_at(ghost_t *ghost, int index) {
+  return snap_at(ghost, index)->tick;
+}
+
+// Scans the path, the saved file and the file in memory and expects the
+// same `wanted` ranges from all three.
+static int check_scan(const char *name, ghost_t *ghost,
+                      const ghost_scan_options_t *options,
+                      const ghost_scan_range_t *wanted, int num_wanted) {
+  int mismatches = 0;
+  ghost_scan_range_t ranges[MAX_RANGES];
+  int num_ranges = ghost_scan(&ghost->path, options, ranges, MAX_RANGES);
+  if (num_ranges == num_wanted) {
+    for (int i = 0; i < num_ranges; i++) {
+      if (ranges[i].first_tick != wanted[i].first_tick ||
+          ranges[i].last_tick != wanted[i].last_tick ||
+          ranges[i].flags != wanted[i].flags) {
+        printf("MISMATCH: %s range %d is [%d, %d] with flags %#x, wanted "
+               "[%d, %d] with %#x\n",
+               name, i, ranges[i].first_tick, ranges[i].last_tick,
+               ranges[i].flags, wanted[i].first_tick, wanted[i].last_tick,
+               wanted[i].flags);
+        mismatches++;
+      }
+    }
+  } else {
+    printf("MISMATCH: %s found %d ranges, wanted %d\n", name, num_ranges,
+           num_wanted);
+    mismatches++;
+  }
+
+  if (ghost_save(ghost, filename) != 0) {
+    printf("MISMATCH: %s could not be saved\n", name);
+    return mismatches + 1;
+  }
+  ghost_scan_range_t file_ranges[MAX_RANGES];
+  const int num_file_ranges =
+      ghost_scan_file(filename, options, file_ranges, MAX_RANGES);
+  if (num_file_ranges != num_ranges ||
+      memcmp(file_ranges, ranges,
+             (num_ranges > 0 ? num_ranges : 0) * sizeof(*ranges)) != 0) {
+    printf("MISMATCH: %s scans differently from its file\n", name);
+    mismatches++;
+  }
+
+  FILE *file = fopen(filename, "rb");
+  unsigned char data[65536];
+  const size_t size = file ? fread(data, 1, sizeof(data), file) : 0;
+  if (file)
+    fclose(file);
+  const int num_mem_ranges =
+      ghost_scan_mem(data, size, options, file_ranges, MAX_RANGES);
+  if (num_mem_ranges != num_ranges ||
+      memcmp(file_ranges, ranges,
+             (num_ranges > 0 ? num_ranges : 0) * sizeof(*ranges)) != 0) {
+    printf("MISMATCH: %s scans differently from memory\n", name);
+    mismatches++;
+  }
+  remove(filename);
+  return mismatches;
+}
+
+static int check_clean(void) {
+  ghost_t *ghost = create_clean_ghost();
+  int mismatches = check_scan("clean path", ghost, NULL, NULL, 0);
+  mismatches += expect_int("clean path without ranges",
+                           ghost_scan(&ghost->path, NULL, NULL, 0), 0);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// The tee jumps ahead at `at` and stays there: one position step that
+// neither the step limit nor the velocity explains.
+static int check_teleport(int at) {
+  ghost_t *ghost = create_clean_ghost();
+  for (int i = at; i < NUM_SNAPS; i++)
+    snap_at(ghost, i)->x += 10000;
+  const ghost_scan_range_t wanted[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at),
+       GHOST_SCAN_TELEPORT | GHOST_SCAN_VELOCITY}};
+  int mismatches = check_scan("teleport", ghost, NULL, wanted, 1);
+
+  // Without the step limit only the velocity check sees the jump.
+  ghost_scan_options_t options;
+  ghost_scan_default_options(&options);
+  options.max_step = -1;
+  const ghost_scan_range_t velocity_only[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_VELOCITY}};
+  mismatches += check_scan("teleport without step limit", ghost, &options,
+                           velocity_only, 1);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// Five ticks are missing before `at`. Snapshots further apart than a tick
+// skip the movement checks, so the jump in position is not flagged.
+static int check_tick_gap(int at) {
+  ghost_t *ghost = create_clean_ghost();
+  for (int i = at; i < NUM_SNAPS; i++)
+    snap_at(ghost, i)->tick += 5;
+  const ghost_scan_range_t wanted[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_TICK_GAP}};
+  int mismatches = check_scan("tick gap", ghost, NULL, wanted, 1);
+
+  ghost_scan_options_t options;
+  ghost_scan_default_options(&options);
+  options.max_tick_gap = 6;
+  mismatches += check_scan("allowed tick gap", ghost, &options, NULL, 0);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// The idle hook skips the first retract state, then returns to idle, which
+// is valid.
+static int check_hook(int at) {
+  ghost_t *ghost = create_clean_ghost();
+  snap_at(ghost, at)->hook_state = HOOK_RETRACT_START + 1;
+  const ghost_scan_range_t wanted[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_HOOK}};
+  int mismatches = check_scan("hook transition", ghost, NULL, wanted, 1);
+
+  // An unknown hook state is flagged on its own snapshot only.
+  snap_at(ghost, at)->hook_state = 9;
+  const ghost_scan_range_t invalid[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_HOOK}};
+  mismatches += check_scan("invalid hook state", ghost, NULL, invalid, 1);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// The attack tick runs backwards at `at`.
+static int check_attack(int at) {
+  ghost_t *ghost = create_clean_ghost();
+  for (int i = 0; i < NUM_SNAPS; i++)
+    snap_at(ghost, i)->attack_tick = i < at ? FIRST_TICK : FIRST_TICK - 50;
+  const ghost_scan_range_t wanted[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_ATTACK}};
+  int mismatches =
+      check_scan("backwards attack tick", ghost, NULL, wanted, 1);
+
+  // An attack tick ahead of the snapshot's own tick.
+  for (int i = 0; i < NUM_SNAPS; i++)
+    snap_at(ghost, i)->attack_tick = FIRST_TICK;
+  snap_at(ghost, 0)->attack_tick = FIRST_TICK + 1;
+  const ghost_scan_range_t ahead[] = {
+      {FIRST_TICK, FIRST_TICK + 1, GHOST_SCAN_ATTACK}};
+  mismatches += check_scan("attack tick ahead", ghost, NULL, ahead, 1);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+static int check_angle(int at) {
+  ghost_t *ghost = create_clean_ghost();
+  // Out of the protocol's range, on the first snapshot and one later.
+  snap_at(ghost, 0)->angle = -500;
+  snap_at(ghost, at)->angle = 2000;
+  const ghost_scan_range_t wanted[] = {
+      {FIRST_TICK, FIRST_TICK, GHOST_SCAN_ANGLE},
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_ANGLE}};
+  int mismatches = check_scan("angle range", ghost, NULL, wanted, 2);
+
+  // Aim steps are only limited when asked for. The step from 1200 to -400
+  // wraps around and is only 8 units.
+  snap_at(ghost, 0)->angle = 0;
+  for (int i = 0; i < NUM_SNAPS; i++)
+    snap_at(ghost, i)->angle = i < at ? 0 : i < at + 10 ? 200 : 1200;
+  snap_at(ghost, at + 20)->angle = -400;
+  mismatches += check_scan("unlimited aim steps", ghost, NULL, NULL, 0);
+
+  ghost_scan_options_t options;
+  ghost_scan_default_options(&options);
+  options.max_angle_step = 150;
+  const ghost_scan_range_t steps[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at), GHOST_SCAN_ANGLE},
+      {tick_at(ghost, at + 9), tick_at(ghost, at + 10), GHOST_SCAN_ANGLE}};
+  mismatches += check_scan("aim steps", ghost, &options, steps, 2);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// A teleport followed by a tick gap flags two adjacent pairs, which merge
+// into one range, also across the scan's block boundary.
+static int check_merge(int at) {
+  ghost_t *ghost = create_clean_ghost();
+  snap_at(ghost, at)->x += 10000;
+  for (int i = at + 1; i < NUM_SNAPS; i++)
+    snap_at(ghost, i)->tick += 2;
+  const ghost_scan_range_t wanted[] = {
+      {tick_at(ghost, at - 1), tick_at(ghost, at + 1),
+       GHOST_SCAN_TELEPORT | GHOST_SCAN_VELOCITY | GHOST_SCAN_TICK_GAP}};
+  int mismatches = check_scan("merged ranges", ghost, NULL, wanted, 1);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+// More ranges than fit: all are counted, only the first are stored.
+static int check_truncation(void) {
+  int mismatches = 0;
+  ghost_t *ghost = create_clean_ghost();
+  for (int i = 1; i <= 20; i++)
+    snap_at(ghost, i * 25)->angle = 2000;
+
+  ghost_scan_range_t ranges[6];
+  memset(ranges, 0xab, sizeof(ranges));
+  mismatches +=
+      expect_int("truncated count", ghost_scan(&ghost->path, NULL, ranges, 5),
+                 20);
+  for (int i = 0; i < 5; i++) {
+    mismatches += expect_int("truncated first tick", ranges[i].first_tick,
+                             tick_at(ghost, (i + 1) * 25 - 1));
+    mismatches += expect_int("truncated last tick", ranges[i].last_tick,
+                             tick_at(ghost, (i + 1) * 25));
+    mismatches +=
+        expect_int("truncated flags", ranges[i].flags, GHOST_SCAN_ANGLE);
+  }
+  ghost_scan_range_t untouched;
+  memset(&untouched, 0xab, sizeof(untouched));
+  mismatches += expect_int(
+      "range past max_ranges",
+      memcmp(&ranges[5], &untouched, sizeof(untouched)) == 0, 1);
+  mismatches += expect_int("count without ranges",
+                           ghost_scan(&ghost->path, NULL, NULL, 0), 20);
+  mismatches += expect_int("truncated file count",
+                           ghost_save(ghost, filename) == 0
+                               ? ghost_scan_file(filename, NULL, ranges, 5)
+                               : -1,
+                           20);
+  remove(filename);
+  ghost_free(ghost);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = check_clean();
+  mismatches += check_teleport(100);
+  mismatches += check_tick_gap(300);
+  mismatches += check_hook(400);
+  mismatches += check_attack(500);
+  mismatches += check_angle(200);
+  mismatches += check_merge(100);
+  // The first block ends with the pair (255, 256).
+  mismatches += check_merge(256);
+  mismatches += check_truncation();
+
+  mismatches += expect_int("NULL path", ghost_scan(NULL, NULL, NULL, 0), -1);
+  mismatches += expect_int(
+      "missing file", ghost_scan_file("missing.gho", NULL, NULL, 0), -1);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: The scanner flags exactly the crafted faults.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in the scanner.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,101 @@
+#include <ddnet_ghost/ghost.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { NUM_THREADS = 8, NUM_ROUNDS = 100000 };
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+typedef struct viewer_t {
+  pthread_t thread;
+  ghost_shared_t *shared;
+  const ghost_character_t *wanted;
+  int num_items;
+  int mismatches;
+} viewer_t;
+
+// Takes and drops extra references while playing the ghost back with its
+// own cursor, then drops the reference it was started with.
+static void *run_viewer(void *arg) {
+  viewer_t *viewer = (viewer_t *)arg;
+  const ghost_t *ghost = ghost_shared_ghost(viewer->shared);
+  ghost_cursor_t cursor;
+  ghost_cursor_init(&cursor, ghost);
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    ghost_shared_t *extra = ghost_retain(viewer->shared);
+    const int index = round % viewer->num_items;
+    const ghost_character_t *wanted = &viewer->wanted[index];
+    const ghost_character_t *snap =
+        ghost_cursor_snap_at_tick(&cursor, wanted->tick);
+    if (extra != viewer->shared || !snap ||
+        memcmp(snap, wanted, sizeof(*snap)) != 0)
+      viewer->mismatches++;
+    ghost_release(extra);
+  }
+  ghost_release(viewer->shared);
+  return NULL;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  const int num_items = ghost->path.num_items;
+  ghost_character_t *wanted =
+      (ghost_character_t *)malloc(num_items * sizeof(ghost_character_t));
+  for (int i = 0; i < num_items; i++)
+    wanted[i] = *ghost_get_snap(&ghost->path, i);
+
+  ghost_shared_t *shared = ghost_share(ghost);
+  mismatches += expect_int("shared ghost", ghost_shared_ghost(shared) == ghost,
+                           1);
+
+  // Every viewer holds its own reference; the creator lets go first, so the
+  // last viewer to finish frees the ghost.
+  viewer_t viewers[NUM_THREADS];
+  int started = 0;
+  for (int i = 0; i < NUM_THREADS; i++) {
+    viewer_t *viewer = &viewers[i];
+    viewer->shared = ghost_retain(shared);
+    viewer->wanted = wanted;
+    viewer->num_items = num_items;
+    viewer->mismatches = 0;
+    if (pthread_create(&viewer->thread, NULL, run_viewer, viewer) != 0) {
+      ghost_release(viewer->shared);
+      break;
+    }
+    started++;
+  }
+  mismatches += expect_int("threads", started, NUM_THREADS);
+  ghost_release(shared);
+  for (int i = 0; i < started; i++) {
+    pthread_join(viewers[i].thread, NULL);
+    mismatches += expect_int("viewer", viewers[i].mismatches, 0);
+  }
+
+  // NULL is passed through.
+  mismatches += expect_int("share NULL", ghost_share(NULL) == NULL, 1);
+  mismatches += expect_int("retain NULL", ghost_retain(NULL) == NULL, 1);
+  mismatches +=
+      expect_int("shared NULL", ghost_shared_ghost(NULL) == NULL, 1);
+  ghost_release(NULL);
+  free(wanted);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Shared ghosts stay valid until the last release.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in shared ghosts.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
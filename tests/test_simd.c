@@ -0,0 +1,250 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_compare.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned char *read_file(const char *filename, long *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = (unsigned char *)malloc(*size > 0 ? *size : 1);
+  if (data && fread(data, *size, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+// Random walk with occasional jumps so that deltas cover one to five byte
+// varints and both signs.
+static ghost_t *create_random_ghost(int num_ticks) {
+  ghost_t *ghost = ghost_create();
+  ghost_set_meta(ghost, "simd", "test_map", num_ticks * 20);
+  ghost_set_skin(ghost, "default", 1, 0x123456, -42);
+
+  unsigned seed = 12345;
+  ghost_character_t snap;
+  memset(&snap, 0, sizeof(snap));
+  for (int i = 0; i < num_ticks; i++) {
+    int *fields = (int *)&snap;
+    for (int f = 0; f < 11; f++) {
+      seed = seed * 1103515245u + 12345u;
+      const int r = (int)(seed >> 8);
+      // Computed in unsigned so large values wrap instead of overflowing.
+      if (r % 50 == 0)
+        fields[f] = (int)((unsigned)r * 977u);
+      else
+        fields[f] = (int)((unsigned)fields[f] + (unsigned)(r % 129 - 64));
+    }
+    snap.tick = 1000 + i;
+    ghost_add_snap(ghost, &snap);
+  }
+  return ghost;
+}
+
+static int compare_ghosts(const ghost_t *a, const ghost_t *b) {
+  if (a->path.num_items != b->path.num_items ||
+      memcmp(&a->skin, &b->skin, sizeof(ghost_skin_t)) != 0)
+    return 1;
+  ghost_compare_result_t result;
+  if (ghost_compare(&a->path, &b->path, &result, NULL) != 0)
+    return 1;
+  return result.first_mismatch >= 0;
+}
+
+// Saves `ghost` with every table under the current variant and compares the
+// bytes with the scalar output, then loads them back.
+static int check_variant(const ghost_t *ghost, const char *name, int variant) {
+  int mismatches = 0;
+  for (int table = 0; table < 2; table++) {
+    ghost_save_options_t options = {.version = 6, .huffman_table = table};
+    char reference[64], written[64];
+    snprintf(reference, sizeof(reference), "simd_%s_%d_ref.gho", name, table);
+    snprintf(written, sizeof(written), "simd_%s_%d.gho", name, table);
+
+    if (variant == GHOST_SIMD_SCALAR &&
+        ghost_save_ex(ghost, reference, &options) != 0)
+      return 1;
+    if (ghost_save_ex(ghost, written, &options) != 0)
+      return 1;
+
+    long size_a = 0, size_b = 0;
+    unsigned char *a = read_file(reference, &size_a);
+    unsigned char *b = read_file(written, &size_b);
+    if (!a || !b || size_a != size_b || memcmp(a, b, size_a) != 0) {
+      printf("MISMATCH: %s encoded '%s' differently (table %d)\n",
+             ghost_simd_variant_name(variant), name, table);
+      mismatches++;
+    }
+    free(a);
+    free(b);
+
+    ghost_t *loaded = ghost_load(written);
+    if (!loaded || compare_ghosts(ghost, loaded) != 0) {
+      printf("MISMATCH: %s decoded '%s' differently (table %d)\n",
+             ghost_simd_variant_name(variant), name, table);
+      mismatches++;
+    }
+    ghost_free(loaded);
+    remove(written);
+  }
+  return mismatches;
+}
+
+enum { MAX_SCAN_RANGES = 4096 };
+
+// Scans `ghost` under the current variant and compares the flagged ranges
+// with the scalar scan.
+static int check_scan(const ghost_t *ghost, const char *name, int variant,
+                      const ghost_scan_range_t *reference,
+                      int num_reference) {
+  static ghost_scan_range_t ranges[MAX_SCAN_RANGES];
+  const int num_ranges =
+      ghost_scan(&ghost->path, NULL, ranges, MAX_SCAN_RANGES);
+  if (num_ranges != num_reference ||
+      memcmp(ranges, reference, sizeof(ghost_scan_range_t) *
+                                    (num_ranges < MAX_SCAN_RANGES
+                                         ? num_ranges
+                                         : MAX_SCAN_RANGES)) != 0) {
+    printf("MISMATCH: %s scanned '%s' differently\n",
+           ghost_simd_variant_name(variant), name);
+    return 1;
+  }
+  return 0;
+}
+
+enum { MAX_RESAMPLE_FRAMES = 16384 };
+
+// Resamples `ghost` to 144 fps under the current variant and compares the
+// frames with the scalar output.
+static int check_resample(const ghost_t *ghost, const char *name, int variant,
+                          const ghost_character_t *reference,
+                          int num_reference) {
+  static ghost_character_t frames[MAX_RESAMPLE_FRAMES];
+  const int num_frames =
+      ghost_resample(&ghost->path, 144.0f, frames, MAX_RESAMPLE_FRAMES);
+  if (num_frames != num_reference ||
+      memcmp(frames, reference, sizeof(ghost_character_t) *
+                                    (num_frames < MAX_RESAMPLE_FRAMES
+                                         ? num_frames
+                                         : MAX_RESAMPLE_FRAMES)) != 0) {
+    printf("MISMATCH: %s resampled '%s' differently\n",
+           ghost_simd_variant_name(variant), name);
+    return 1;
+  }
+  return 0;
+}
+
+// Snapshots two ticks apart with odd differences, resampled at four frames
+// per snapshot, land on halves and quarters of both signs. Every variant
+// must round them like lround.
+static int check_resample_ties(int variant) {
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap;
+  memset(&snap, 0, sizeof(snap));
+  for (int i = 0; i < 200; i++) {
+    const int step = (i % 2 ? -1 : 1) * (2 * (i % 7) + 1);
+    snap.x += step;
+    snap.y -= step * 3;
+    snap.vel_x = -snap.x;
+    snap.vel_y = snap.y / 2;
+    snap.tick = 100 + 2 * i;
+    ghost_add_snap(ghost, &snap);
+  }
+
+  static ghost_character_t frames[1024];
+  const int num_frames = ghost_resample(&ghost->path, 100.0f, frames, 1024);
+  int mismatches = 0;
+  for (int i = 0; i < num_frames && mismatches == 0; i++) {
+    const ghost_character_t *prev = ghost_get_snap(&ghost->path, i / 4);
+    const ghost_character_t *next =
+        ghost_get_snap(&ghost->path, i / 4 + (i % 4 ? 1 : 0));
+    const double amount = (i % 4) / 4.0;
+    const int *from = (const int *)prev;
+    const int *to = (const int *)next;
+    const int *got = (const int *)&frames[i];
+    for (int f = 0; f < 4; f++) {
+      const long wanted = lround(from[f] + ((double)to[f] - from[f]) * amount);
+      if (got[f] != wanted) {
+        printf("MISMATCH: %s rounded field %d of frame %d to %d, not %ld\n",
+               ghost_simd_variant_name(variant), f, i, got[f], wanted);
+        mismatches++;
+        break;
+      }
+    }
+  }
+  mismatches += num_frames == 797 ? 0 : 1;
+  ghost_free(ghost);
+  return mismatches;
+}
+
+int main(void) {
+  printf("Selected variant: %s\n",
+         ghost_simd_variant_name(ghost_simd_variant()));
+  const int selected = ghost_simd_variant();
+
+  ghost_t *ghosts[2];
+  const char *names[2] = {"sample", "random"};
+  ghost_simd_set_variant(GHOST_SIMD_SCALAR);
+  ghosts[0] = ghost_load("run_dead_silence.gho");
+  ghosts[1] = create_random_ghost(5000);
+  if (!ghosts[0] || !ghosts[1]) {
+    printf("Test ghosts could not be created\n");
+    return 1;
+  }
+
+  static ghost_scan_range_t scan_ranges[2][MAX_SCAN_RANGES];
+  int num_scan_ranges[2];
+  for (int i = 0; i < 2; i++)
+    num_scan_ranges[i] =
+        ghost_scan(&ghosts[i]->path, NULL, scan_ranges[i], MAX_SCAN_RANGES);
+
+  static ghost_character_t resampled[2][MAX_RESAMPLE_FRAMES];
+  int num_resampled[2];
+  for (int i = 0; i < 2; i++)
+    num_resampled[i] = ghost_resample(&ghosts[i]->path, 144.0f, resampled[i],
+                                      MAX_RESAMPLE_FRAMES);
+
+  int mismatches = 0;
+  for (int variant = 0; variant < GHOST_SIMD_NUM_VARIANTS; variant++) {
+    if (ghost_simd_set_variant(variant) != 0) {
+      printf("Skipping %s (not supported)\n",
+             ghost_simd_variant_name(variant));
+      continue;
+    }
+    printf("Checking %s...\n", ghost_simd_variant_name(variant));
+    mismatches += check_resample_ties(variant);
+    for (int i = 0; i < 2; i++) {
+      mismatches += check_variant(ghosts[i], names[i], variant);
+      mismatches += check_scan(ghosts[i], names[i], variant, scan_ranges[i],
+                               num_scan_ranges[i]);
+      mismatches += check_resample(ghosts[i], names[i], variant,
+                                   resampled[i], num_resampled[i]);
+    }
+  }
+
+  for (int i = 0; i < 2; i++) {
+    for (int table = 0; table < 2; table++) {
+      char reference[64];
+      snprintf(reference, sizeof(reference), "simd_%s_%d_ref.gho", names[i],
+               table);
+      remove(reference);
+    }
+    ghost_free(ghosts[i]);
+  }
+  ghost_simd_set_variant(selected);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: All variants produce identical output.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) between variants.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
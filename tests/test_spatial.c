@@ -0,0 +1,120 @@
+#include <ddnet_ghost/ghost.h>
+#include <ddnet_ghost/ghost_spatial.h>
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { NUM_SNAPS = 5000, NUM_QUERIES = 2000 };
+
+static uint32_t next_random(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+static int64_t squared_distance(const ghost_character_t *snap, int x, int y) {
+  const int64_t dx = (int64_t)snap->x - x;
+  const int64_t dy = (int64_t)snap->y - y;
+  return dx * dx + dy * dy;
+}
+
+static int brute_nearest(const ghost_path_t *path, int x, int y) {
+  int best = -1;
+  int64_t best_dist = INT64_MAX;
+  for (int i = 0; i < path->num_items; i++) {
+    const int64_t dist = squared_distance(ghost_get_snap(path, i), x, y);
+    if (dist < best_dist) {
+      best_dist = dist;
+      best = i;
+    }
+  }
+  return best;
+}
+
+static int brute_within(const ghost_path_t *path, int x, int y, float radius) {
+  const int64_t r2 = (int64_t)((double)radius * radius);
+  int count = 0;
+  for (int i = 0; i < path->num_items; i++)
+    if (squared_distance(ghost_get_snap(path, i), x, y) <= r2)
+      count++;
+  return count;
+}
+
+int main(void) {
+  int mismatches = 0;
+  uint32_t state = 1;
+
+  // A winding route with a few jumps, like a player teleporting.
+  ghost_t *ghost = ghost_create();
+  ghost_character_t snap = {0};
+  for (int i = 0; i < NUM_SNAPS; i++) {
+    snap.x += (int)(next_random(&state) % 41) - 16;
+    snap.y += (int)(next_random(&state) % 41) - 20;
+    if (i % 1000 == 999)
+      snap.x += 20000;
+    snap.tick = i;
+    ghost_add_snap(ghost, &snap);
+  }
+
+  ghost_spatial_index_t *index = ghost_spatial_index_build(&ghost->path, 32);
+  if (!index) {
+    printf("Spatial index could not be built\n");
+    ghost_free(ghost);
+    return 1;
+  }
+
+  for (int q = 0; q < NUM_QUERIES; q++) {
+    int x, y;
+    // Half near the route, half far away from it.
+    if (q % 2 == 0) {
+      const ghost_character_t *near =
+          ghost_get_snap(&ghost->path, next_random(&state) % NUM_SNAPS);
+      x = near->x + (int)(next_random(&state) % 401) - 200;
+      y = near->y + (int)(next_random(&state) % 401) - 200;
+    } else {
+      x = (int)(next_random(&state) % 2000001) - 1000000;
+      y = (int)(next_random(&state) % 2000001) - 1000000;
+    }
+
+    const int wanted = brute_nearest(&ghost->path, x, y);
+    const int got = ghost_spatial_index_nearest(index, x, y, NULL);
+    if (got != wanted) {
+      printf("MISMATCH: nearest to (%d, %d) (%d != %d)\n", x, y, got, wanted);
+      mismatches++;
+    }
+
+    const float radius = (float)(next_random(&state) % 300);
+    const int count = ghost_spatial_index_within(index, x, y, radius, NULL, 0);
+    if (count != brute_within(&ghost->path, x, y, radius)) {
+      printf("MISMATCH: within %.0f of (%d, %d)\n", radius, x, y);
+      mismatches++;
+    }
+  }
+
+  // Radii too large for int must still cover the whole route.
+  const float huge[] = {3e9f, 1e20f, FLT_MAX};
+  for (int i = 0; i < 3; i++) {
+    const int count =
+        ghost_spatial_index_within(index, 0, 0, huge[i], NULL, 0);
+    if (count != NUM_SNAPS) {
+      printf("MISMATCH: within %g (%d != %d)\n", huge[i], count, NUM_SNAPS);
+      mismatches++;
+    }
+  }
+  if (ghost_spatial_index_within(index, 2000000000, -2000000000, 1e9f, NULL,
+                                 0) != 0) {
+    printf("MISMATCH: within near the coordinate limits\n");
+    mismatches++;
+  }
+
+  ghost_spatial_index_free(index);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Spatial queries match a brute-force search.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in spatial queries.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
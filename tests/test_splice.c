@@ -0,0 +1,145 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <string.h>
+
+// Compares `count` snapshots of `a` from `first_a` with `b` from `first_b`,
+// expecting the ticks of `b` to be `tick_shift` later.
+static int compare_range(const char *what, const ghost_t *a, int first_a,
+                         const ghost_t *b, int first_b, int count,
+                         int tick_shift) {
+  for (int i = 0; i < count; i++) {
+    ghost_character_t wanted = *ghost_get_snap(&a->path, first_a + i);
+    wanted.tick += tick_shift;
+    const ghost_character_t *got = ghost_get_snap(&b->path, first_b + i);
+    if (!got || memcmp(got, &wanted, sizeof(wanted)) != 0) {
+      printf("MISMATCH: %s snapshot %d\n", what, first_b + i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int check_ticks_increase(const char *what, const ghost_t *ghost) {
+  for (int i = 1; i < ghost->path.num_items; i++) {
+    if (ghost_get_snap(&ghost->path, i)->tick <=
+        ghost_get_snap(&ghost->path, i - 1)->tick) {
+      printf("MISMATCH: %s tick goes backwards at %d\n", what, i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Concatenates `filename` with itself: the second copy must continue one
+// tick after the first ends.
+static int check_self_concat(const char *what, const char *filename,
+                             const ghost_t *original) {
+  const char *sources[] = {filename, filename};
+  if (ghost_concat(sources, 2, "written_ghost.gho") != 0) {
+    printf("MISMATCH: %s could not be concatenated\n", what);
+    return 1;
+  }
+  ghost_t *joined = ghost_load("written_ghost.gho");
+  if (!joined) {
+    printf("MISMATCH: %s concatenation could not be loaded\n", what);
+    return 1;
+  }
+  const int n = original->path.num_items;
+  const int shift = ghost_get_snap(&original->path, n - 1)->tick + 1 -
+                    ghost_get_snap(&original->path, 0)->tick;
+  int mismatches = 0;
+  if (joined->path.num_items != 2 * n) {
+    printf("MISMATCH: %s concatenation has %d snapshots\n", what,
+           joined->path.num_items);
+    mismatches++;
+  } else {
+    mismatches += compare_range(what, original, 0, joined, 0, n, 0);
+    mismatches += compare_range(what, original, 0, joined, n, n, shift);
+    mismatches += check_ticks_increase(what, joined);
+  }
+  ghost_free(joined);
+  return mismatches;
+}
+
+int main(void) {
+  int mismatches = 0;
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  const int n = ghost->path.num_items;
+
+  // Slicing keeps the snapshots and moves the start tick.
+  const int first = 120, count = 333;
+  if (ghost_slice("run_dead_silence.gho", "written_slice_a.gho", 0, first) !=
+          0 ||
+      ghost_slice("run_dead_silence.gho", "written_slice_b.gho", first,
+                  n - first) != 0 ||
+      ghost_slice("run_dead_silence.gho", "written_ghost.gho", first, count) !=
+          0) {
+    printf("MISMATCH: ghost could not be sliced\n");
+    mismatches++;
+  } else {
+    ghost_t *slice = ghost_load("written_ghost.gho");
+    if (!slice || slice->path.num_items != count ||
+        slice->start_tick != ghost_get_snap(&ghost->path, first)->tick) {
+      printf("MISMATCH: slice metadata\n");
+      mismatches++;
+    } else {
+      mismatches += compare_range("slice", ghost, first, slice, 0, count, 0);
+    }
+    ghost_free(slice);
+
+    // Both halves joined again give back the original.
+    const char *halves[] = {"written_slice_a.gho", "written_slice_b.gho"};
+    ghost_t *joined = NULL;
+    if (ghost_concat(halves, 2, "written_ghost.gho") == 0)
+      joined = ghost_load("written_ghost.gho");
+    if (!joined || joined->path.num_items != n ||
+        joined->start_tick != ghost->start_tick) {
+      printf("MISMATCH: slices could not be joined\n");
+      mismatches++;
+    } else {
+      mismatches += compare_range("joined slices", ghost, 0, joined, 0, n, 0);
+    }
+    ghost_free(joined);
+  }
+
+  // Copied row chunks, copied columnar chunks and re-encoded snapshots all
+  // get their ticks shifted.
+  mismatches += check_self_concat("version 6", "run_dead_silence.gho", ghost);
+  ghost_save_options_t options = {.version = 7};
+  ghost_save_ex(ghost, "written_slice_a.gho", &options);
+  mismatches += check_self_concat("version 7", "written_slice_a.gho", ghost);
+  options = (ghost_save_options_t){.huffman_table = GHOST_HUFFMAN_TABLE_GHOST};
+  ghost_save_ex(ghost, "written_slice_b.gho", &options);
+  const char *mixed[] = {"run_dead_silence.gho", "written_slice_b.gho"};
+  ghost_t *joined = NULL;
+  if (ghost_concat(mixed, 2, "written_ghost.gho") == 0)
+    joined = ghost_load("written_ghost.gho");
+  if (!joined || joined->path.num_items != 2 * n) {
+    printf("MISMATCH: differently encoded ghosts could not be joined\n");
+    mismatches++;
+  } else {
+    mismatches += compare_range("re-encoded", ghost, 0, joined, n, n,
+                                ghost_get_snap(&ghost->path, n - 1)->tick + 1 -
+                                    ghost_get_snap(&ghost->path, 0)->tick);
+  }
+  ghost_free(joined);
+
+  ghost_free(ghost);
+  remove("written_slice_a.gho");
+  remove("written_slice_b.gho");
+  remove("written_ghost.gho");
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Sliced and concatenated ghosts match the original.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in sliced or concatenated "
+           "ghosts.\n",
+           mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
@@ -0,0 +1,119 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static int expect_stats(const char *what, const ghost_run_stats_t *got,
+                        const ghost_run_stats_t *wanted) {
+  if (memcmp(got, wanted, sizeof(*got)) == 0)
+    return 0;
+  printf("MISMATCH: %s stats (%d ticks, %f distance != %d ticks, %f "
+         "distance)\n",
+         what, got->num_ticks, got->distance, wanted->num_ticks,
+         wanted->distance);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  rewind(file);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, 1, *size, file) != *size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+// Stats are only collected once enabled, and only before the first
+// snapshot.
+static int check_reader(const ghost_run_stats_t *wanted) {
+  int mismatches = 0;
+  ghost_run_stats_t stats;
+  ghost_character_t snap;
+
+  ghost_reader_t *reader = ghost_reader_open("run_dead_silence.gho");
+  mismatches += expect_int("stats without enable",
+                           ghost_reader_stats(reader, &stats), -1);
+  ghost_reader_next(reader, &snap);
+  mismatches += expect_int("enable after next",
+                           ghost_reader_enable_stats(reader), -1);
+  ghost_reader_close(reader);
+
+  reader = ghost_reader_open("run_dead_silence.gho");
+  mismatches += expect_int("enable", ghost_reader_enable_stats(reader), 0);
+  while (ghost_reader_next(reader, &snap) == 1)
+    ;
+  mismatches +=
+      expect_int("reader stats", ghost_reader_stats(reader, &stats), 0);
+  mismatches += expect_stats("reader", &stats, wanted);
+  ghost_reader_close(reader);
+  return mismatches;
+}
+
+static int check_decoder(const ghost_run_stats_t *wanted) {
+  int mismatches = 0;
+  size_t size;
+  unsigned char *data = read_file("run_dead_silence.gho", &size);
+  if (!data) {
+    printf("MISMATCH: ghost file could not be read\n");
+    return 1;
+  }
+
+  ghost_run_stats_t stats;
+  ghost_decoder_t *decoder = ghost_decoder_create(NULL, NULL);
+  ghost_decoder_feed(decoder, data, size);
+  ghost_decoder_finish(decoder);
+  mismatches += expect_int("decoder stats without enable",
+                           ghost_decoder_stats(decoder, &stats), -1);
+  mismatches += expect_int("decoder enable after feed",
+                           ghost_decoder_enable_stats(decoder), -1);
+  ghost_decoder_free(decoder);
+
+  decoder = ghost_decoder_create(NULL, NULL);
+  mismatches +=
+      expect_int("decoder enable", ghost_decoder_enable_stats(decoder), 0);
+  ghost_decoder_feed(decoder, data, size);
+  mismatches += expect_int("decoder finish", ghost_decoder_finish(decoder), 0);
+  mismatches +=
+      expect_int("decoder stats", ghost_decoder_stats(decoder, &stats), 0);
+  mismatches += expect_stats("decoder", &stats, wanted);
+  ghost_decoder_free(decoder);
+  free(data);
+  return mismatches;
+}
+
+int main(void) {
+  ghost_run_stats_t wanted;
+  ghost_t *ghost = ghost_load_stats("run_dead_silence.gho", &wanted);
+  if (!ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+
+  int mismatches = 0;
+  mismatches += expect_int("num_ticks", wanted.num_ticks, ghost->path.num_items);
+  mismatches += check_reader(&wanted);
+  mismatches += check_decoder(&wanted);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: Run stats are collected only when enabled.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in run stats.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}
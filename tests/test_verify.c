@@ -0,0 +1,174 @@
+#include <ddnet_ghost/ghost.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Layout of run_dead_silence.gho: a 133-byte header, a skin and an info
+// chunk, then snapshot chunks, the first of them at 197.
+enum {
+  HEADER_SIZE = 133,
+  VERSION_OFFSET = 8,
+  OWNER_OFFSET = 9,
+  ZEROES_OFFSET = 89,
+  NUM_TICKS_OFFSET = 93,
+  TIME_OFFSET = 97,
+  FIRST_SNAP_CHUNK = 197,
+};
+
+static int expect_int(const char *what, int got, int wanted) {
+  if (got == wanted)
+    return 0;
+  printf("MISMATCH: %s (%d != %d)\n", what, got, wanted);
+  return 1;
+}
+
+static unsigned char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char *data = (unsigned char *)malloc(*size);
+  if (data && fread(data, *size, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+static void set_be32(unsigned char *bytes, int value) {
+  bytes[0] = (unsigned char)(value >> 24);
+  bytes[1] = (unsigned char)(value >> 16);
+  bytes[2] = (unsigned char)(value >> 8);
+  bytes[3] = (unsigned char)value;
+}
+
+// Verifies `size` bytes of `data` and expects `error` at chunk `offset`.
+static int check_error(const char *name, const unsigned char *data,
+                       size_t size, int error, long offset) {
+  ghost_verify_result_t result;
+  const int status = ghost_verify_mem(data, size, &result);
+  if (status == -1 && result.error == error && result.offset == offset)
+    return 0;
+  printf("MISMATCH: %s returned %d with '%s' at %ld, wanted '%s' at %ld\n",
+         name, status, ghost_verify_error_string(result.error), result.offset,
+         ghost_verify_error_string(error), offset);
+  return 1;
+}
+
+int main(void) {
+  int mismatches = 0;
+  size_t size;
+  unsigned char *data = read_file("run_dead_silence.gho", &size);
+  ghost_t *ghost = ghost_load("run_dead_silence.gho");
+  if (!data || !ghost) {
+    printf("Ghost file could not be loaded\n");
+    return 1;
+  }
+  unsigned char *copy = (unsigned char *)malloc(size);
+
+  ghost_verify_result_t result;
+  mismatches += expect_int("valid", ghost_verify_mem(data, size, &result), 0);
+  mismatches += expect_int("valid error", result.error, GHOST_VERIFY_OK);
+  mismatches += expect_int("valid version", result.version, 6);
+  mismatches += expect_int("valid num_ticks", result.num_ticks,
+                           ghost->path.num_items);
+  mismatches += expect_int("valid start_tick", result.start_tick,
+                           ghost->start_tick);
+  mismatches += expect_int("valid hash", result.hash == ghost_hash(ghost), 1);
+  mismatches += expect_int(
+      "file", ghost_verify("run_dead_silence.gho", &result), 0);
+  mismatches += expect_int("missing file",
+                           ghost_verify("missing_ghost.gho", &result), -1);
+  mismatches += expect_int("missing file error", result.error,
+                           GHOST_VERIFY_ERROR_IO);
+  mismatches += check_error("NULL data", NULL, size, GHOST_VERIFY_ERROR_IO, -1);
+
+  // Every prefix of the file is truncated somewhere.
+  for (size_t prefix = 0; prefix < size; prefix++) {
+    ghost_verify_result_t truncated;
+    if (ghost_verify_mem(data, prefix, &truncated) != -1 ||
+        truncated.error != GHOST_VERIFY_ERROR_TRUNCATED) {
+      printf("MISMATCH: %zu-byte prefix verified with '%s'\n", prefix,
+             ghost_verify_error_string(truncated.error));
+      mismatches++;
+      break;
+    }
+  }
+  mismatches += check_error("short header", data, HEADER_SIZE - 1,
+                            GHOST_VERIFY_ERROR_TRUNCATED, -1);
+  mismatches += check_error("cut chunk", data, FIRST_SNAP_CHUNK + 20,
+                            GHOST_VERIFY_ERROR_TRUNCATED, FIRST_SNAP_CHUNK);
+
+  // Header fields, each broken on its own.
+  memcpy(copy, data, size);
+  copy[0] = 'X';
+  mismatches +=
+      check_error("marker", copy, size, GHOST_VERIFY_ERROR_MARKER, -1);
+
+  memcpy(copy, data, size);
+  copy[VERSION_OFFSET] = 3;
+  mismatches +=
+      check_error("version", copy, size, GHOST_VERIFY_ERROR_VERSION, -1);
+
+  memcpy(copy, data, size);
+  copy[ZEROES_OFFSET] = 200;
+  mismatches += check_error("huffman table", copy, size,
+                            GHOST_VERIFY_ERROR_HUFFMAN_TABLE, -1);
+
+  memcpy(copy, data, size);
+  memset(copy + OWNER_OFFSET, 'a', 16);
+  mismatches += check_error("owner", copy, size, GHOST_VERIFY_ERROR_NAME, -1);
+
+  memcpy(copy, data, size);
+  set_be32(copy + NUM_TICKS_OFFSET, 0);
+  mismatches +=
+      check_error("no ticks", copy, size, GHOST_VERIFY_ERROR_NUM_TICKS, -1);
+
+  memcpy(copy, data, size);
+  set_be32(copy + TIME_OFFSET, -5);
+  mismatches += check_error("time", copy, size, GHOST_VERIFY_ERROR_TIME, -1);
+
+  // The header and the chunks disagree on the number of snapshots.
+  memcpy(copy, data, size);
+  set_be32(copy + NUM_TICKS_OFFSET, ghost->path.num_items + 1);
+  mismatches += check_error("missing tick", copy, size,
+                            GHOST_VERIFY_ERROR_TRUNCATED, (long)size);
+
+  memcpy(copy, data, size);
+  set_be32(copy + NUM_TICKS_OFFSET, ghost->path.num_items - 1);
+  ghost_verify_mem(copy, size, &result);
+  mismatches += expect_int("extra tick", result.error,
+                           GHOST_VERIFY_ERROR_TOO_MANY_TICKS);
+
+  // Broken chunks.
+  memcpy(copy, data, size);
+  copy[FIRST_SNAP_CHUNK + 2] = 0;
+  copy[FIRST_SNAP_CHUNK + 3] = 0;
+  mismatches += check_error("chunk size", copy, size,
+                            GHOST_VERIFY_ERROR_CHUNK_SIZE, FIRST_SNAP_CHUNK);
+
+  memcpy(copy, data, size);
+  memset(copy + FIRST_SNAP_CHUNK + 4, 0xff, 256);
+  mismatches += check_error("chunk data", copy, size,
+                            GHOST_VERIFY_ERROR_DECOMPRESS, FIRST_SNAP_CHUNK);
+
+  memcpy(copy, data, size);
+  copy[FIRST_SNAP_CHUNK + 1]++;
+  mismatches += check_error("chunk items", copy, size,
+                            GHOST_VERIFY_ERROR_ITEM_SIZE, FIRST_SNAP_CHUNK);
+
+  free(copy);
+  free(data);
+  ghost_free(ghost);
+
+  printf("----------------------------------------\n");
+  if (mismatches == 0)
+    printf("SUCCESS: ghost_verify reports the expected errors.\n");
+  else
+    printf("FAILURE: Found %d mismatch(es) in ghost_verify.\n", mismatches);
+  printf("----------------------------------------\n");
+  return mismatches;
+}